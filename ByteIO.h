@@ -0,0 +1,111 @@
+#ifndef BYTE_IO_H
+#define BYTE_IO_H
+
+#include <Arduino.h>
+#include <vector>
+#include "CardId.h"
+#include "TextArena.h"
+
+// Little-endian helpers for the binary records kept on the SD card.
+// Strings are stored as a u16 length followed by their bytes.
+
+inline void putU16(std::vector<uint8_t>& out, uint16_t value) {
+  out.push_back(value & 0xFF);
+  out.push_back(value >> 8);
+}
+
+inline void putU32(uint8_t* out, uint32_t value) {
+  for (int i = 0; i < 4; i++) {
+    out[i] = (value >> (8 * i)) & 0xFF;
+  }
+}
+
+inline void putU32(std::vector<uint8_t>& out, uint32_t value) {
+  uint8_t bytes[4];
+  putU32(bytes, value);
+  out.insert(out.end(), bytes, bytes + 4);
+}
+
+inline uint16_t getU16(const uint8_t* in) {
+  return in[0] | (in[1] << 8);
+}
+
+inline uint32_t getU32(const uint8_t* in) {
+  return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+}
+
+inline void putString(std::vector<uint8_t>& out, const char* value, size_t length) {
+  length = min(length, (size_t)0xFFFF);
+  putU16(out, length);
+  out.insert(out.end(), value, value + length);
+}
+
+inline void putString(std::vector<uint8_t>& out, const String& value) {
+  putString(out, value.c_str(), value.length());
+}
+
+inline bool getU8(const std::vector<uint8_t>& in, size_t& pos, uint8_t& value) {
+  if (pos >= in.size()) {
+    return false;
+  }
+  value = in[pos++];
+  return true;
+}
+
+inline bool getU16(const std::vector<uint8_t>& in, size_t& pos, uint16_t& value) {
+  if (pos + 2 > in.size()) {
+    return false;
+  }
+  value = getU16(in.data() + pos);
+  pos += 2;
+  return true;
+}
+
+inline bool getU32(const std::vector<uint8_t>& in, size_t& pos, uint32_t& value) {
+  if (pos + 4 > in.size()) {
+    return false;
+  }
+  value = getU32(in.data() + pos);
+  pos += 4;
+  return true;
+}
+
+inline bool getString(const std::vector<uint8_t>& in, size_t& pos, String& value) {
+  uint16_t length;
+  if (!getU16(in, pos, length) || pos + length > in.size()) {
+    return false;
+  }
+  value = "";
+  value.reserve(length);
+  for (uint16_t i = 0; i < length; i++) {
+    value += (char)in[pos + i];
+  }
+  pos += length;
+  return true;
+}
+
+// Reads a string straight into an arena, with no String in between
+inline bool getText(const std::vector<uint8_t>& in, size_t& pos, TextArena& arena, TextRef& ref) {
+  uint16_t length;
+  if (!getU16(in, pos, length) || pos + length > in.size()) {
+    return false;
+  }
+  ref = arena.add((const char*)in.data() + pos, length);
+  pos += length;
+  return true;
+}
+
+inline void putCardId(std::vector<uint8_t>& out, const CardId& id) {
+  out.insert(out.end(), id.bytes, id.bytes + CardId::SIZE);
+}
+
+inline bool getCardId(const std::vector<uint8_t>& in, size_t& pos, CardId& id) {
+  if (pos + CardId::SIZE > in.size()) {
+    return false;
+  }
+  memcpy(id.bytes, &in[pos], CardId::SIZE);
+  pos += CardId::SIZE;
+  return true;
+}
+
+#endif // BYTE_IO_H
@@ -0,0 +1,142 @@
+#include "CardCache.h"
+#include <algorithm>
+#include "CardCodec.h"
+
+CardCache::CardCache() : budget(CARD_CACHE_HEAP_BYTES), used(0), inPsram(false) {
+}
+
+CardCache::~CardCache() {
+  clear();
+}
+
+void CardCache::begin() {
+  inPsram = psramFound();
+  budget = inPsram ? CARD_CACHE_PSRAM_BYTES : CARD_CACHE_HEAP_BYTES;
+  Serial.printf("Card cache: %u bytes in %s\n", (unsigned)budget, inPsram ? "PSRAM" : "heap");
+}
+
+int CardCache::indexOf(const String& cardId) const {
+  CardId id = CardId::fromString(cardId);
+  for (size_t i = 0; i < entries.size(); i++) {
+    if (entries[i].cardId == id) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// Drops an entry, charging its bytes as waste if it was prefetched for nothing
+void CardCache::discard(size_t index) {
+  Entry& entry = entries[index];
+  if (entry.prefetched && !entry.used) {
+    stats.wastedBytes += entry.bytes;
+  }
+  used -= entry.length;
+  free(entry.blob);
+  entries.erase(entries.begin() + index);
+}
+
+bool CardCache::get(const String& cardId, FullCard& card) {
+  int index = indexOf(cardId);
+  if (index < 0) {
+    stats.misses++;
+    return false;
+  }
+
+  Entry& entry = entries[index];
+  std::vector<uint8_t> encoded(entry.blob, entry.blob + entry.length);
+  FullCard decoded;
+  if (!CardCodec::decode(encoded, 0, CardCodec::VERSION, decoded)) {
+    discard(index);
+    stats.misses++;
+    return false;
+  }
+  decoded.summary.id = entry.cardId;
+  decoded.fetchedAt = entry.fetchedAt;
+  card = decoded;
+
+  stats.hits++;
+  if (entry.prefetched && !entry.used) {
+    stats.prefetchUsed++;
+  }
+  entry.used = true;
+
+  // Move to the most recently used end
+  std::rotate(entries.begin() + index, entries.begin() + index + 1, entries.end());
+  return true;
+}
+
+bool CardCache::contains(const String& cardId) const {
+  return indexOf(cardId) >= 0;
+}
+
+void CardCache::put(const FullCard& card, size_t bytes, bool prefetched) {
+  if (card.summary.id.isEmpty()) {
+    return;
+  }
+
+  std::vector<uint8_t> encoded;
+  CardCodec::encode(card, encoded);
+
+  int index = indexOf(card.summary.id.toString());
+  if (index >= 0) {
+    discard(index);
+  }
+  if (encoded.size() > budget) {
+    return;
+  }
+  while (used + encoded.size() > budget && !entries.empty()) {
+    discard(0);
+    stats.evictions++;
+  }
+
+  uint8_t* blob = (uint8_t*)(inPsram ? ps_malloc(encoded.size()) : malloc(encoded.size()));
+  if (!blob) {
+    return;
+  }
+  memcpy(blob, encoded.data(), encoded.size());
+
+  if (prefetched) {
+    stats.prefetched++;
+    stats.prefetchBytes += bytes;
+  }
+
+  Entry entry;
+  entry.cardId = card.summary.id;
+  entry.blob = blob;
+  entry.length = encoded.size();
+  entry.bytes = bytes;
+  entry.fetchedAt = card.fetchedAt;
+  entry.prefetched = prefetched;
+  entry.used = !prefetched;
+  entries.push_back(entry);
+  used += entry.length;
+}
+
+void CardCache::invalidate(const String& cardId) {
+  int index = indexOf(cardId);
+  if (index >= 0) {
+    discard(index);
+  }
+}
+
+void CardCache::markFresh(const String& cardId, unsigned long fetchedAt) {
+  int index = indexOf(cardId);
+  if (index >= 0) {
+    entries[index].fetchedAt = fetchedAt;
+  }
+}
+
+void CardCache::clear() {
+  while (!entries.empty()) {
+    discard(entries.size() - 1);
+  }
+}
+
+void CardCache::printStats() {
+  Serial.printf("Card cache: %u entries, %u/%u bytes, %lu hits, %lu misses (%lu%%), "
+                "%lu evictions, %lu prefetched, %lu used, %lu bytes prefetched, %lu wasted\n",
+                (unsigned)entries.size(), (unsigned)used, (unsigned)budget,
+                stats.hits, stats.misses, stats.hitRatePercent(), stats.evictions,
+                stats.prefetched, stats.prefetchUsed, stats.prefetchBytes, stats.wastedBytes);
+}
@@ -0,0 +1,78 @@
+#ifndef CARD_CACHE_H
+#define CARD_CACHE_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+#include "DataStructures.h"
+
+// Hit rate and prefetch efficiency counters
+struct CardCacheStats {
+  unsigned long hits;
+  unsigned long misses;
+  unsigned long prefetched;       // Entries added by prefetch
+  unsigned long prefetchUsed;     // ...that were opened before leaving the cache
+  unsigned long prefetchBytes;    // Bytes downloaded by prefetch
+  unsigned long wastedBytes;      // Prefetched bytes evicted or replaced unused
+  unsigned long evictions;
+
+  CardCacheStats() : hits(0), misses(0), prefetched(0), prefetchUsed(0),
+                     prefetchBytes(0), wastedBytes(0), evictions(0) {}
+
+  unsigned long hitRatePercent() const {
+    unsigned long total = hits + misses;
+    return total > 0 ? hits * 100 / total : 0;
+  }
+};
+
+// LRU of card details held in RAM so opening a card from the list is
+// instant when it was prefetched or viewed recently. Cards are kept in
+// CardCodec's binary form, in PSRAM when the board has it, and the cache
+// is bounded by the bytes they take rather than a card count. Owned by
+// the UI loop.
+class CardCache {
+private:
+  struct Entry {
+    CardId cardId;
+    uint8_t* blob;      // Encoded card, in PSRAM if there is any
+    size_t length;
+    size_t bytes;       // Response bytes it cost to fetch, 0 if read from SD
+    unsigned long fetchedAt;  // FullCard::fetchedAt, which the encoding leaves out
+    bool prefetched;
+    bool used;
+  };
+
+  std::vector<Entry> entries;   // Least recently used first
+  size_t budget;                // Bytes of encoded cards kept at most
+  size_t used;
+  bool inPsram;
+  CardCacheStats stats;
+
+  int indexOf(const String& cardId) const;
+  void discard(size_t index);
+
+public:
+  CardCache();
+  ~CardCache();
+
+  // Picks PSRAM and its larger budget when available; call from setup()
+  void begin();
+
+  // Counts a hit or miss; decodes the cached card into card on a hit
+  bool get(const String& cardId, FullCard& card);
+  bool contains(const String& cardId) const;
+
+  void put(const FullCard& card, size_t bytes, bool prefetched);
+  void invalidate(const String& cardId);
+
+  // Records that the server confirmed the cached copy is current
+  void markFresh(const String& cardId, unsigned long fetchedAt);
+  void clear();
+
+  size_t size() const { return entries.size(); }
+  size_t bytesUsed() const { return used; }
+  const CardCacheStats& getStats() const { return stats; }
+  void printStats();
+};
+
+#endif // CARD_CACHE_H
@@ -0,0 +1,155 @@
+#include "CardCodec.h"
+#include "ByteIO.h"
+#include "StringPool.h"
+
+// Defined here as well, since push_back() takes them by reference
+const uint8_t CardCodec::VERSION;
+const uint8_t CardCodec::LIST_MAGIC;
+
+enum CodecCardFlags {
+  CODEC_HAS_DUE = 1 << 0,
+  CODEC_DONE = 1 << 1
+};
+
+// Everything in a CardSummary but the id, which the card store keeps in
+// its record header
+static void encodeSummaryFields(const CardSummary& summary, std::vector<uint8_t>& out) {
+  out.push_back((summary.hasDueDate ? CODEC_HAS_DUE : 0) | (summary.isDone ? CODEC_DONE : 0));
+  putString(out, summary.name);
+  putU16(out, summary.labels);
+}
+
+static bool decodeSummaryFields(const std::vector<uint8_t>& in, size_t& pos,
+                                CardSummary& summary) {
+  uint8_t flags;
+  if (!getU8(in, pos, flags)) {
+    return false;
+  }
+  summary.hasDueDate = flags & CODEC_HAS_DUE;
+  summary.isDone = flags & CODEC_DONE;
+
+  String name;
+  if (!getString(in, pos, name)) {
+    return false;
+  }
+  summary.name = StringPool::names().intern(name);
+  return getU16(in, pos, summary.labels);
+}
+
+static void putText(const FullCard& card, const TextRef& ref, std::vector<uint8_t>& out) {
+  putString(out, card.str(ref), ref.length);
+}
+
+void CardCodec::encode(const FullCard& card, std::vector<uint8_t>& out) {
+  encodeSummaryFields(card.summary, out);
+  putText(card, card.description, out);
+  putText(card, card.dueDate, out);
+
+  uint16_t comments = min(card.comments.size(), (size_t)0xFFFF);
+  putU16(out, comments);
+  for (uint16_t i = 0; i < comments; i++) {
+    putText(card, card.comments[i], out);
+  }
+
+  uint16_t items = min(card.checklists.size(), (size_t)0xFFFF);
+  putU16(out, items);
+  for (uint16_t i = 0; i < items; i++) {
+    putText(card, card.checklists[i].id, out);
+    putText(card, card.checklists[i].name, out);
+    out.push_back(card.checklists[i].isComplete ? 1 : 0);
+  }
+
+  putText(card, card.lastActivity, out);
+}
+
+bool CardCodec::decode(const std::vector<uint8_t>& in, size_t pos, uint8_t version,
+                       FullCard& card) {
+  if (version != VERSION || !decodeSummaryFields(in, pos, card.summary)) {
+    return false;
+  }
+
+  // The text can't be longer than what is left of the record, so one
+  // block holds all of it
+  card.clearContents();
+  card.text.reserve(in.size() - pos);
+
+  uint16_t comments;
+  if (!getText(in, pos, card.text, card.description) ||
+      !getText(in, pos, card.text, card.dueDate) || !getU16(in, pos, comments)) {
+    return false;
+  }
+  card.comments.resize(comments);
+  for (uint16_t i = 0; i < comments; i++) {
+    if (!getText(in, pos, card.text, card.comments[i])) {
+      return false;
+    }
+  }
+
+  uint16_t items;
+  if (!getU16(in, pos, items)) {
+    return false;
+  }
+  card.checklists.resize(items);
+  for (uint16_t i = 0; i < items; i++) {
+    ChecklistItem& item = card.checklists[i];
+    uint8_t complete;
+    if (!getText(in, pos, card.text, item.id) || !getText(in, pos, card.text, item.name) ||
+        !getU8(in, pos, complete)) {
+      return false;
+    }
+    item.isComplete = complete != 0;
+  }
+
+  return getText(in, pos, card.text, card.lastActivity) && pos == in.size();
+}
+
+void CardCodec::encodeSummary(const CardSummary& summary, std::vector<uint8_t>& out) {
+  putCardId(out, summary.id);
+  encodeSummaryFields(summary, out);
+}
+
+bool CardCodec::decodeSummary(const std::vector<uint8_t>& in, size_t& pos, uint8_t version,
+                              CardSummary& summary) {
+  if (version != VERSION || !getCardId(in, pos, summary.id)) {
+    return false;
+  }
+  return decodeSummaryFields(in, pos, summary);
+}
+
+void CardCodec::beginList(std::vector<uint8_t>& out) {
+  out.push_back(LIST_MAGIC);
+  out.push_back(VERSION);
+}
+
+void CardCodec::writeSummary(std::vector<uint8_t>& out, const CardSummary& summary) {
+  size_t start = out.size();
+  putU16(out, 0);
+  encodeSummary(summary, out);
+  uint16_t length = min(out.size() - start - 2, (size_t)0xFFFF);
+  out[start] = length & 0xFF;
+  out[start + 1] = length >> 8;
+}
+
+// Fails on a short or damaged file rather than returning part of the list
+bool CardCodec::decodeList(const std::vector<uint8_t>& in, std::vector<CardSummary>& cards) {
+  cards.clear();
+  if (in.size() < 2 || in[0] != LIST_MAGIC) {
+    return false;
+  }
+  uint8_t version = in[1];
+  size_t pos = 2;
+  while (pos < in.size()) {
+    uint16_t length;
+    if (!getU16(in, pos, length) || pos + length > in.size()) {
+      return false;
+    }
+    size_t end = pos + length;
+    CardSummary summary;
+    if (!decodeSummary(in, pos, version, summary) || pos > end) {
+      return false;
+    }
+    cards.push_back(summary);
+    pos = end;
+  }
+  return true;
+}
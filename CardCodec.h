@@ -0,0 +1,36 @@
+#ifndef CARD_CODEC_H
+#define CARD_CODEC_H
+
+#include <Arduino.h>
+#include <vector>
+#include "DataStructures.h"
+
+// Binary form of CardSummary and FullCard, shared by the SD caches and
+// CardCache so cached cards are read straight back into the structs with
+// no JSON step. Every file or record says which version of the layout it
+// was written with; any other version is treated as a cache miss, so a
+// layout change only needs VERSION bumped.
+class CardCodec {
+public:
+  static const uint8_t VERSION = 1;
+  static const uint8_t LIST_MAGIC = 'L';
+
+  // A card's details, without its id
+  static void encode(const FullCard& card, std::vector<uint8_t>& out);
+  // Decodes from pos to the end of the buffer
+  static bool decode(const std::vector<uint8_t>& in, size_t pos, uint8_t version,
+                     FullCard& card);
+
+  // A list entry, id included
+  static void encodeSummary(const CardSummary& summary, std::vector<uint8_t>& out);
+  static bool decodeSummary(const std::vector<uint8_t>& in, size_t& pos, uint8_t version,
+                            CardSummary& summary);
+
+  // List cache file: LIST_MAGIC and the version, then each card prefixed
+  // with its length. Cards are appended one at a time as they are parsed.
+  static void beginList(std::vector<uint8_t>& out);
+  static void writeSummary(std::vector<uint8_t>& out, const CardSummary& summary);
+  static bool decodeList(const std::vector<uint8_t>& in, std::vector<CardSummary>& cards);
+};
+
+#endif // CARD_CODEC_H
@@ -0,0 +1,117 @@
+#ifndef CARD_ID_H
+#define CARD_ID_H
+
+#include <Arduino.h>
+#include <string.h>
+#include "config.h"
+
+// A Trello card id held as its 12 bytes instead of 24 hex characters on the
+// heap. Bytes compare in the same order as the hex strings, so sorting by
+// id still sorts by age. Cards created offline get ids whose timestamp
+// bytes are all 0xFF, which no Trello id has; they print as
+// PENDING_CARD_PREFIX and the mutation's sequence number.
+struct CardId {
+  static const size_t SIZE = 12;
+
+  uint8_t bytes[SIZE];
+
+  CardId() {
+    memset(bytes, 0, SIZE);
+  }
+
+  // Empty unless text is 24 hex digits or a pending id
+  static CardId fromString(const char* text) {
+    CardId id;
+    size_t prefixLength = strlen(PENDING_CARD_PREFIX);
+    if (strncmp(text, PENDING_CARD_PREFIX, prefixLength) == 0) {
+      return pending(strtoul(text + prefixLength, nullptr, 10));
+    }
+    if (strlen(text) != SIZE * 2) {
+      return id;
+    }
+    for (size_t i = 0; i < SIZE * 2; i++) {
+      int digit = hexDigit(text[i]);
+      if (digit < 0) {
+        return CardId();
+      }
+      id.bytes[i / 2] = (id.bytes[i / 2] << 4) | digit;
+    }
+    return id;
+  }
+
+  static CardId fromString(const String& text) {
+    return fromString(text.c_str());
+  }
+
+  static CardId pending(uint32_t seq) {
+    CardId id;
+    memset(id.bytes, 0xFF, 4);
+    for (int i = 0; i < 4; i++) {
+      id.bytes[SIZE - 1 - i] = (seq >> (8 * i)) & 0xFF;
+    }
+    return id;
+  }
+
+  bool isEmpty() const {
+    for (size_t i = 0; i < SIZE; i++) {
+      if (bytes[i] != 0) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // Every Trello id starts with the Unix time it was made, in seconds
+  uint32_t createdAt() const {
+    return isPending() ? 0 : ((uint32_t)bytes[0] << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+  }
+
+  // The lowest id made at a time, for since= and before=
+  static CardId madeAt(uint32_t seconds) {
+    CardId id;
+    for (int i = 0; i < 4; i++) {
+      id.bytes[i] = (seconds >> (24 - 8 * i)) & 0xFF;
+    }
+    return id;
+  }
+
+  bool isPending() const {
+    return bytes[0] == 0xFF && bytes[1] == 0xFF && bytes[2] == 0xFF && bytes[3] == 0xFF;
+  }
+
+  String toString() const {
+    if (isEmpty()) {
+      return String();
+    }
+    if (isPending()) {
+      uint32_t seq = 0;
+      for (size_t i = SIZE - 4; i < SIZE; i++) {
+        seq = (seq << 8) | bytes[i];
+      }
+      return PENDING_CARD_PREFIX + String(seq);
+    }
+    static const char digits[] = "0123456789abcdef";
+    char text[SIZE * 2 + 1];
+    for (size_t i = 0; i < SIZE; i++) {
+      text[2 * i] = digits[bytes[i] >> 4];
+      text[2 * i + 1] = digits[bytes[i] & 0x0F];
+    }
+    text[SIZE * 2] = '\0';
+    return String(text);
+  }
+
+  bool operator==(const CardId& other) const { return memcmp(bytes, other.bytes, SIZE) == 0; }
+  bool operator!=(const CardId& other) const { return !(*this == other); }
+  bool operator<(const CardId& other) const { return memcmp(bytes, other.bytes, SIZE) < 0; }
+  bool operator>(const CardId& other) const { return other < *this; }
+
+private:
+  static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+};
+
+#endif // CARD_ID_H
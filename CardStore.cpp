@@ -0,0 +1,386 @@
+#include "CardStore.h"
+#include <algorithm>
+#include "Crc32.h"
+#include "ByteIO.h"
+#include "CardCodec.h"
+
+// Record layout: magic, kind, id length (u8), CardCodec version of the
+// payload, payload length (u32), CRC-32 (u32), the card id, then the payload. The CRC covers
+// everything after the magic byte except the CRC itself.
+static const uint8_t RECORD_MAGIC = 'K';
+static const size_t RECORD_HEADER_SIZE = 12;
+static const size_t MAX_ID_LENGTH = 255;
+
+enum StoreRecordKind {
+  STORE_CARD = 1,
+  STORE_REMOVED = 2
+};
+
+static uint32_t hashBytes(const uint8_t* data, size_t length) {
+  // FNV-1a
+  uint32_t hash = 2166136261UL;
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ data[i]) * 16777619UL;
+  }
+  return hash;
+}
+
+// Starts a record with its header and id; finishRecord() fills in the rest
+static void beginRecord(std::vector<uint8_t>& record, uint8_t kind, const String& cardId) {
+  record.assign(RECORD_HEADER_SIZE, 0);
+  record[0] = RECORD_MAGIC;
+  record[1] = kind;
+  record[2] = cardId.length();
+  record[3] = CardCodec::VERSION;
+  record.insert(record.end(), cardId.c_str(), cardId.c_str() + cardId.length());
+}
+
+static void finishRecord(std::vector<uint8_t>& record) {
+  putU32(&record[4], record.size() - RECORD_HEADER_SIZE - record[2]);
+  uint32_t crc = crc32Update(0, &record[1], 7);
+  crc = crc32Update(crc, &record[RECORD_HEADER_SIZE], record.size() - RECORD_HEADER_SIZE);
+  putU32(&record[8], crc);
+}
+
+CardStore::CardStore(Storage* storage)
+  : storage(storage), log(nullptr), logSize(0), deadBytes(0), ready(false), dirty(false) {
+}
+
+CardStore::~CardStore() {
+  delete log;
+}
+
+uint32_t CardStore::hashId(const String& cardId) {
+  return hashBytes((const uint8_t*)cardId.c_str(), cardId.length());
+}
+
+CardStore::IndexEntry* CardStore::find(uint32_t hash) {
+  auto it = std::lower_bound(index.begin(), index.end(), hash,
+                             [](const IndexEntry& entry, uint32_t value) {
+                               return entry.hash < value;
+                             });
+  return (it != index.end() && it->hash == hash) ? &*it : nullptr;
+}
+
+void CardStore::setEntry(uint32_t hash, uint32_t offset, uint32_t size) {
+  IndexEntry* existing = find(hash);
+  if (existing) {
+    deadBytes += existing->size;
+    existing->offset = offset;
+    existing->size = size;
+    return;
+  }
+  IndexEntry added = { hash, offset, size };
+  auto it = std::lower_bound(index.begin(), index.end(), hash,
+                             [](const IndexEntry& entry, uint32_t value) {
+                               return entry.hash < value;
+                             });
+  index.insert(it, added);
+}
+
+void CardStore::dropEntry(uint32_t hash) {
+  IndexEntry* existing = find(hash);
+  if (existing) {
+    deadBytes += existing->size;
+    index.erase(index.begin() + (existing - index.data()));
+  }
+}
+
+bool CardStore::open() {
+  log = storage->open(CARD_STORE_FILE, STORAGE_UPDATE);
+  if (!log) {
+    return false;
+  }
+  logSize = log->size();
+  return true;
+}
+
+bool CardStore::begin() {
+  ready = storage->begin();
+  if (!ready) {
+    Serial.println("Card store: no SD card, card details will not be cached");
+    return false;
+  }
+
+  // Finish or roll back an interrupted compaction
+  storage->recover(CARD_STORE_FILE);
+
+  if (!storage->exists(CARD_STORE_FILE)) {
+    removeLegacyFiles();
+  }
+
+  ready = open();
+  if (!ready) {
+    Serial.println("Card store: cannot open " + String(CARD_STORE_FILE));
+    return false;
+  }
+
+  bool clean = scan();
+  Serial.printf("Card store: %u cards, %lu bytes (%lu dead)\n",
+                (unsigned)index.size(), (unsigned long)logSize, (unsigned long)deadBytes);
+
+  // Records appended after a corrupt tail would be lost on the next scan
+  if (!clean && !compact()) {
+    Serial.println("Card store: could not repair the log, caching disabled");
+    ready = false;
+    return false;
+  }
+  return true;
+}
+
+// Rebuilds the index from the record headers, without reading payloads.
+// Returns false if the log ends in a torn or corrupt record.
+bool CardStore::scan() {
+  index.clear();
+  deadBytes = 0;
+
+  uint32_t offset = 0;
+  uint8_t header[RECORD_HEADER_SIZE];
+  uint8_t id[MAX_ID_LENGTH];
+  while (offset < logSize) {
+    if (offset + RECORD_HEADER_SIZE > logSize || !log->seek(offset) ||
+        log->read(header, RECORD_HEADER_SIZE) != RECORD_HEADER_SIZE || header[0] != RECORD_MAGIC) {
+      break;
+    }
+    uint8_t idLength = header[2];
+    uint32_t size = RECORD_HEADER_SIZE + idLength + getU32(header + 4);
+    if (size > logSize - offset || log->read(id, idLength) != idLength) {
+      break;
+    }
+
+    uint32_t hash = hashBytes(id, idLength);
+    if (header[1] == STORE_CARD) {
+      setEntry(hash, offset, size);
+    } else {
+      dropEntry(hash);
+      deadBytes += size;
+    }
+    offset += size;
+  }
+
+  if (offset < logSize) {
+    Serial.printf("Card store: discarding corrupt tail at byte %lu\n", (unsigned long)offset);
+    deadBytes += logSize - offset;
+    return false;
+  }
+  return true;
+}
+
+bool CardStore::writeRecord(const std::vector<uint8_t>& record) {
+  bool ok = log->seek(logSize) && log->write(record.data(), record.size()) == record.size();
+  if (!ok) {
+    // Part of the record may be on the card; the next boot's scan cuts it off
+    Serial.println("Card store: write failed, caching disabled");
+    ready = false;
+    return false;
+  }
+  logSize += record.size();
+  dirty = true;
+  stats.writes++;
+  stats.bytesWritten += record.size();
+  return true;
+}
+
+// Reads a whole record with one seek, and checks it before trusting it
+bool CardStore::readRecord(const IndexEntry& entry, std::vector<uint8_t>& record,
+                           String& cardId) {
+  record.resize(entry.size);
+  if (!log->seek(entry.offset) || log->read(record.data(), entry.size) != entry.size ||
+      record[0] != RECORD_MAGIC) {
+    return false;
+  }
+  uint8_t idLength = record[2];
+  if (RECORD_HEADER_SIZE + idLength + getU32(&record[4]) != entry.size) {
+    return false;
+  }
+  uint32_t crc = crc32Update(0, &record[1], 7);
+  crc = crc32Update(crc, &record[RECORD_HEADER_SIZE], entry.size - RECORD_HEADER_SIZE);
+  if (crc != getU32(&record[8])) {
+    return false;
+  }
+
+  cardId = "";
+  cardId.reserve(idLength);
+  for (uint8_t i = 0; i < idLength; i++) {
+    cardId += (char)record[RECORD_HEADER_SIZE + i];
+  }
+  return true;
+}
+
+bool CardStore::get(const String& cardId, FullCard& card) {
+  if (!ready) {
+    return false;
+  }
+  stats.reads++;
+  uint32_t hash = hashId(cardId);
+  IndexEntry* entry = find(hash);
+  if (!entry) {
+    return false;
+  }
+
+  unsigned long startedAt = micros();
+  std::vector<uint8_t> record;
+  String storedId;
+  if (!readRecord(*entry, record, storedId)) {
+    Serial.println("Card store: corrupt record for card " + cardId);
+    stats.corrupt++;
+    dropEntry(hash);
+    return false;
+  }
+  if (storedId != cardId) {
+    return false;
+  }
+
+  FullCard decoded;
+  if (!CardCodec::decode(record, RECORD_HEADER_SIZE + storedId.length(), record[3], decoded)) {
+    stats.corrupt++;
+    dropEntry(hash);
+    return false;
+  }
+  decoded.summary.id = CardId::fromString(cardId);
+  card = decoded;
+  stats.hits++;
+  stats.readUs += micros() - startedAt;
+  return true;
+}
+
+bool CardStore::put(const FullCard& card) {
+  String cardId = card.summary.id.toString();
+  if (!ready || cardId.length() == 0 || cardId.length() > MAX_ID_LENGTH) {
+    return false;
+  }
+
+  std::vector<uint8_t> record;
+  beginRecord(record, STORE_CARD, cardId);
+  CardCodec::encode(card, record);
+  finishRecord(record);
+
+  uint32_t offset = logSize;
+  if (!writeRecord(record)) {
+    return false;
+  }
+  setEntry(hashId(cardId), offset, record.size());
+  compactIfNeeded();
+  return true;
+}
+
+bool CardStore::remove(const String& cardId) {
+  uint32_t hash = hashId(cardId);
+  if (!ready || !find(hash)) {
+    return true;
+  }
+
+  // The removal has to be logged, or the next scan brings the card back
+  std::vector<uint8_t> record;
+  beginRecord(record, STORE_REMOVED, cardId);
+  finishRecord(record);
+  if (!writeRecord(record)) {
+    return false;
+  }
+  dropEntry(hash);
+  deadBytes += record.size();
+  compactIfNeeded();
+  return true;
+}
+
+void CardStore::compactIfNeeded() {
+  if (logSize >= CARD_STORE_COMPACT_MIN_BYTES &&
+      (uint64_t)deadBytes * 100 >= (uint64_t)logSize * CARD_STORE_COMPACT_PERCENT) {
+    compact();
+  }
+}
+
+bool CardStore::compact() {
+  if (!ready) {
+    return false;
+  }
+  unsigned long startedAt = millis();
+  uint32_t before = logSize;
+
+  String tempFile = String(CARD_STORE_FILE) + ".tmp";
+  StorageFile* out = storage->open(tempFile.c_str(), STORAGE_WRITE);
+  if (!out) {
+    return false;
+  }
+
+  // Live records keep their order, so the newest stay at the end
+  std::vector<IndexEntry> live = index;
+  std::sort(live.begin(), live.end(), [](const IndexEntry& a, const IndexEntry& b) {
+    return a.offset < b.offset;
+  });
+
+  bool ok = true;
+  uint32_t offset = 0;
+  std::vector<uint8_t> record;
+  for (auto& entry : live) {
+    record.resize(entry.size);
+    ok = log->seek(entry.offset) && log->read(record.data(), entry.size) == entry.size;
+    ok = ok && out->write(record.data(), entry.size) == entry.size;
+    if (!ok) {
+      break;
+    }
+    entry.offset = offset;
+    offset += entry.size;
+  }
+  ok = ok && out->flush();
+  delete out;
+
+  if (!ok) {
+    storage->remove(tempFile.c_str());
+    return false;
+  }
+
+  // begin() completes this sequence if power fails between the two steps
+  delete log;
+  log = nullptr;
+  dirty = false;
+  storage->remove(CARD_STORE_FILE);
+  storage->rename(tempFile.c_str(), CARD_STORE_FILE);
+
+  std::sort(live.begin(), live.end(), [](const IndexEntry& a, const IndexEntry& b) {
+    return a.hash < b.hash;
+  });
+  index.swap(live);
+  deadBytes = 0;
+  stats.compactions++;
+
+  ready = open();
+  Serial.printf("Card store: compacted %lu to %lu bytes in %lu ms\n",
+                (unsigned long)before, (unsigned long)logSize, millis() - startedAt);
+  return ready;
+}
+
+void CardStore::flush() {
+  if (ready && dirty) {
+    log->flush();
+    dirty = false;
+  }
+}
+
+void CardStore::printStats() {
+  Serial.printf("Card store: %u cards, %lu bytes (%lu dead), %lu reads, %lu hits "
+                "(avg %lu us), %lu corrupt, %lu writes (%lu bytes), %lu compactions\n",
+                (unsigned)index.size(), (unsigned long)logSize, (unsigned long)deadBytes,
+                stats.reads, stats.hits, stats.averageReadUs(), stats.corrupt,
+                stats.writes, stats.bytesWritten, stats.compactions);
+}
+
+// The per-card JSON files this store replaces
+void CardStore::removeLegacyFiles() {
+  std::vector<std::string> names;
+  if (!storage->list("/", names)) {
+    return;
+  }
+
+  String prefix = String(CACHE_DETAILS_PREFIX).substring(1);
+  size_t removed = 0;
+  for (const auto& name : names) {
+    if (String(name.c_str()).startsWith(prefix)) {
+      storage->remove(("/" + name).c_str());
+      removed++;
+    }
+  }
+  if (removed > 0) {
+    Serial.printf("Card store: removed %u old cache files\n", (unsigned)removed);
+  }
+}
@@ -0,0 +1,86 @@
+#ifndef CARD_STORE_H
+#define CARD_STORE_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+#include "DataStructures.h"
+#include "Storage.h"
+
+struct CardStoreStats {
+  unsigned long reads;
+  unsigned long hits;
+  unsigned long corrupt;        // Records that failed their CRC
+  unsigned long writes;
+  unsigned long bytesWritten;
+  unsigned long compactions;
+  unsigned long long readUs;    // Time spent in hits
+
+  CardStoreStats() : reads(0), hits(0), corrupt(0), writes(0), bytesWritten(0),
+                     compactions(0), readUs(0) {}
+
+  unsigned long averageReadUs() const {
+    return hits > 0 ? (unsigned long)(readUs / hits) : 0;
+  }
+};
+
+// Card details cached on the SD card as one append-only log of CardCodec
+// records, instead of a JSON file per card. An index in RAM maps each card
+// to its newest record, so a cached card is one seek and one read with no
+// JSON parsing. Updates and removals append; dead records are dropped by
+// compacting into a new file once they make up most of the log.
+class CardStore {
+private:
+  struct IndexEntry {
+    uint32_t hash;      // Of the card id; a collision only costs a miss
+    uint32_t offset;
+    uint32_t size;      // Whole record, header included
+  };
+
+  Storage* storage;
+  std::vector<IndexEntry> index;  // Sorted by hash
+  StorageFile* log;               // Open for reading and appending
+  uint32_t logSize;
+  uint32_t deadBytes;             // Superseded and removed records
+  bool ready;
+  bool dirty;                     // Appended since the last flush
+  CardStoreStats stats;
+
+  static uint32_t hashId(const String& cardId);
+
+  IndexEntry* find(uint32_t hash);
+  void setEntry(uint32_t hash, uint32_t offset, uint32_t size);
+  void dropEntry(uint32_t hash);
+  bool open();
+  bool scan();
+  bool writeRecord(const std::vector<uint8_t>& record);
+  bool readRecord(const IndexEntry& entry, std::vector<uint8_t>& record, String& cardId);
+  void compactIfNeeded();
+  void removeLegacyFiles();
+
+public:
+  explicit CardStore(Storage* storage);
+  ~CardStore();
+
+  // Builds the index from the log; call once the SD card is mounted
+  bool begin();
+
+  bool get(const String& cardId, FullCard& card);
+  bool put(const FullCard& card);
+  bool remove(const String& cardId);
+  bool contains(const String& cardId) { return find(hashId(cardId)) != nullptr; }
+
+  // Rewrites the log with live records only; runs by itself when
+  // CARD_STORE_COMPACT_PERCENT of the log is dead
+  bool compact();
+
+  // Appends are not flushed one by one; the network task calls this when
+  // idle. A record lost to a power cut before then is only a cache miss.
+  void flush();
+
+  size_t size() const { return index.size(); }
+  const CardStoreStats& getStats() const { return stats; }
+  void printStats();
+};
+
+#endif // CARD_STORE_H
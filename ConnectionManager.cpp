@@ -0,0 +1,381 @@
+#include "ConnectionManager.h"
+
+static const char* collectedHeaders[] = {
+  "Transfer-Encoding",
+  "Content-Encoding",
+  "Date",
+  "x-rate-limit-api-token-remaining"
+};
+static const size_t collectedHeaderCount = sizeof(collectedHeaders) / sizeof(collectedHeaders[0]);
+
+HttpBodyStream::HttpBodyStream() : source(nullptr), chunked(false),
+                                   remaining(-1), finished(true), consumed(0), waitUs(0) {
+}
+
+void HttpBodyStream::reset(Stream* stream, bool isChunked, long contentLength) {
+  source = stream;
+  chunked = isChunked;
+  remaining = isChunked ? 0 : contentLength;
+  finished = (stream == nullptr) || (!isChunked && contentLength == 0);
+  consumed = 0;
+  waitUs = 0;
+}
+
+// Only reads that have to wait for the network are timed; the rest is
+// buffered already and costs the parser, not the transfer
+int HttpBodyStream::readSource() {
+  char c;
+  if (source->available() > 0) {
+    if (source->readBytes(&c, 1) != 1) {
+      return -1;
+    }
+    return (uint8_t)c;
+  }
+  unsigned long start = micros();
+  size_t got = source->readBytes(&c, 1);
+  waitUs += micros() - start;
+  return got == 1 ? (uint8_t)c : -1;
+}
+
+bool HttpBodyStream::skipLine() {
+  int c;
+  while ((c = readSource()) >= 0) {
+    if (c == '\n') {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Positions the source at the next body byte, reading chunk headers as needed
+bool HttpBodyStream::prepare() {
+  if (finished) {
+    return false;
+  }
+  if (!chunked || remaining > 0) {
+    return true;
+  }
+
+  // Chunk header: hex size, optional extensions, CRLF
+  long size = 0;
+  bool sawDigit = false;
+  int c;
+  while ((c = readSource()) >= 0) {
+    if (c >= '0' && c <= '9') {
+      size = size * 16 + (c - '0');
+    } else if (c >= 'a' && c <= 'f') {
+      size = size * 16 + (c - 'a' + 10);
+    } else if (c >= 'A' && c <= 'F') {
+      size = size * 16 + (c - 'A' + 10);
+    } else if (c == '\r' && !sawDigit) {
+      continue; // CRLF left over from the previous chunk
+    } else if (c == '\n' && !sawDigit) {
+      continue;
+    } else {
+      break;
+    }
+    sawDigit = true;
+  }
+  if (c < 0 || !sawDigit || (c != '\n' && !skipLine())) {
+    finished = true;
+    return false;
+  }
+
+  if (size == 0) {
+    // Last chunk: consume trailers up to the terminating empty line
+    while (true) {
+      int first = readSource();
+      if (first < 0 || first == '\n') {
+        break;
+      }
+      if (first == '\r') {
+        readSource();
+        break;
+      }
+      if (!skipLine()) {
+        break;
+      }
+    }
+    finished = true;
+    return false;
+  }
+
+  remaining = size;
+  return true;
+}
+
+int HttpBodyStream::available() {
+  if (finished || !source) {
+    return 0;
+  }
+  int avail = source->available();
+  if (remaining >= 0 && avail > remaining) {
+    avail = remaining;
+  }
+  return avail;
+}
+
+int HttpBodyStream::read() {
+  if (!prepare()) {
+    return -1;
+  }
+  int c = readSource();
+  if (c < 0) {
+    // Connection closed: end of body when no length was given
+    finished = true;
+    return -1;
+  }
+  consumed++;
+  if (remaining > 0) {
+    remaining--;
+    if (remaining == 0 && !chunked) {
+      finished = true;
+    }
+  }
+  return c;
+}
+
+int HttpBodyStream::peek() {
+  if (!prepare()) {
+    return -1;
+  }
+  return source->peek();
+}
+
+void HttpBodyStream::drain() {
+  while (read() >= 0) {
+  }
+}
+
+ConnectionManager::ConnectionManager() : socket(nullptr), httpClient(nullptr),
+                                         gzipBody(false), bodyStartedAt(0), cacheUsAtBody(0),
+                                         port(443), requestOpen(false) {
+}
+
+ConnectionManager::~ConnectionManager() {
+  close();
+  if (httpClient) {
+    delete httpClient;
+  }
+  if (socket) {
+    delete socket;
+  }
+}
+
+bool ConnectionManager::begin(const char* rootCa, const String& baseUrl) {
+  // Derive scheme, host and port from the base URL
+  bool secure = !baseUrl.startsWith("http://");
+  int hostStart = baseUrl.indexOf("://");
+  hostStart = hostStart < 0 ? 0 : hostStart + 3;
+  int hostEnd = baseUrl.indexOf('/', hostStart);
+  host = hostEnd < 0 ? baseUrl.substring(hostStart) : baseUrl.substring(hostStart, hostEnd);
+  port = secure ? 443 : 80;
+  int portStart = host.indexOf(':');
+  if (portStart >= 0) {
+    port = host.substring(portStart + 1).toInt();
+    host = host.substring(0, portStart);
+  }
+
+  if (secure) {
+    WiFiClientSecure* secureClient = new WiFiClientSecure();
+    if (!secureClient) {
+      Serial.println("Failed to create secure client");
+      return false;
+    }
+    secureClient->setCACert(rootCa);
+    socket = secureClient;
+  } else {
+    Serial.println("Warning: " + baseUrl + " is not encrypted");
+    socket = new WiFiClient();
+    if (!socket) {
+      Serial.println("Failed to create client");
+      return false;
+    }
+  }
+
+  httpClient = new HTTPClient();
+  if (!httpClient) {
+    Serial.println("Failed to create HTTP client");
+    return false;
+  }
+
+  // HTTP/1.1 keep-alive: the socket stays open after end()
+  httpClient->useHTTP10(false);
+  httpClient->setReuse(true);
+
+  // Without the inflater's buffers, bodies are simply requested uncompressed
+  if (HTTP_ACCEPT_GZIP) {
+    gzipStream.begin();
+  }
+
+  return true;
+}
+
+bool ConnectionManager::ensureConnected(bool& reused) {
+  reused = socket->connected();
+  if (reused) {
+    return true;
+  }
+
+  // Server closed the idle socket or this is the first request
+  socket->stop();
+  
+  // Resolved up front so the lookup is timed on its own; connect() then
+  // finds the address in the resolver cache
+  unsigned long start = micros();
+  IPAddress address;
+  bool resolved = WiFi.hostByName(host.c_str(), address) == 1;
+  metrics.record(PHASE_DNS, micros() - start);
+  if (!resolved) {
+    Serial.println("DNS lookup of " + host + " failed");
+    return false;
+  }
+  
+  start = micros();
+  bool connected = socket->connect(host.c_str(), port);
+  unsigned long handshakeUs = micros() - start;
+  metrics.record(PHASE_TLS, handshakeUs);
+  if (!connected) {
+    Serial.println("TLS connect to " + host + " failed");
+    return false;
+  }
+  stats.handshakes++;
+  stats.totalHandshakeMs += handshakeUs / 1000;
+  return true;
+}
+
+int ConnectionManager::sendRequest(const String& url, const String& method,
+                                   const String& payload) {
+  if (requestOpen) {
+    release();
+  }
+
+  bool idempotent = (method == "GET" || method == "PUT");
+  metrics.begin(method, url);
+
+  for (int attempt = 0; attempt < 2; attempt++) {
+    bool reused = false;
+    if (!ensureConnected(reused)) {
+      metrics.setHttpCode(HTTPC_ERROR_CONNECTION_REFUSED);
+      return HTTPC_ERROR_CONNECTION_REFUSED;
+    }
+
+    httpClient->begin(*socket, url);
+    httpClient->addHeader("Content-Type", "application/json");
+    if (gzipStream.isReady()) {
+      httpClient->addHeader("Accept-Encoding", "gzip");
+    }
+    httpClient->setConnectTimeout(10000);
+    httpClient->setTimeout(10000);
+    httpClient->collectHeaders(collectedHeaders, collectedHeaderCount);
+
+    unsigned long sentAt = micros();
+    int httpCode = httpClient->sendRequest(method.c_str(), payload);
+    metrics.record(PHASE_TTFB, micros() - sentAt);
+    metrics.setHttpCode(httpCode);
+
+    // A reused socket the server already closed fails before any response.
+    // Nothing reached the server if the headers could not be sent; a lost
+    // connection is only retried when repeating the request is harmless.
+    bool staleSocket = reused && (httpCode == HTTPC_ERROR_SEND_HEADER_FAILED ||
+                                  httpCode == HTTPC_ERROR_NOT_CONNECTED ||
+                                  (httpCode == HTTPC_ERROR_CONNECTION_LOST && idempotent));
+    if (staleSocket && attempt == 0) {
+      httpClient->end();
+      socket->stop();
+      stats.staleReconnects++;
+      continue;
+    }
+
+    stats.requests++;
+    if (reused) {
+      stats.reusedRequests++;
+    }
+
+    if (httpCode > 0) {
+      bool chunked = httpClient->header("Transfer-Encoding").indexOf("chunked") >= 0;
+      bodyStream.reset(&httpClient->getStream(), chunked, httpClient->getSize());
+      gzipBody = gzipStream.isReady() && 
+                 httpClient->header("Content-Encoding").indexOf("gzip") >= 0;
+      gzipStream.reset(gzipBody ? &bodyStream : nullptr);
+      bodyStartedAt = micros();
+      cacheUsAtBody = metrics.currentUs(PHASE_CACHE);
+      requestOpen = true;
+    } else {
+      bodyStream.reset(nullptr, false, 0);
+      gzipBody = false;
+      httpClient->end();
+      socket->stop();
+    }
+    return httpCode;
+  }
+
+  return HTTPC_ERROR_CONNECTION_LOST;
+}
+
+Stream& ConnectionManager::getBody() {
+  if (gzipBody) {
+    return gzipStream;
+  }
+  return bodyStream;
+}
+
+int ConnectionManager::getSize() {
+  return httpClient->getSize();
+}
+
+String ConnectionManager::header(const char* name) {
+  return httpClient->header(name);
+}
+
+void ConnectionManager::release() {
+  if (!requestOpen) {
+    return;
+  }
+  // Whatever the caller spent reading the body, less waiting for it and
+  // mirroring it to the SD card, went into inflating and parsing
+  unsigned long readUs = micros() - bodyStartedAt;
+  unsigned long waitUs = bodyStream.waitMicros();
+  unsigned long cacheUs = metrics.currentUs(PHASE_CACHE) - cacheUsAtBody;
+  if (bodyStream.bytesConsumed() > 0) {
+    metrics.record(PHASE_PARSE, readUs > waitUs + cacheUs ? readUs - waitUs - cacheUs : 0);
+  }
+  
+  // Consume the rest of the body so the next response starts on a clean socket
+  // (the compressed bytes; what the parser did not read is not inflated)
+  unsigned long drainStart = micros();
+  bodyStream.drain();
+  metrics.record(PHASE_BODY, waitUs + (micros() - drainStart));
+  metrics.setBytes(bodyStream.bytesConsumed());
+  stats.bodyBytes += bodyStream.bytesConsumed();
+  if (gzipBody) {
+    stats.gzipResponses++;
+    stats.decodedBytes += gzipStream.bytesInflated();
+  } else {
+    stats.decodedBytes += bodyStream.bytesConsumed();
+  }
+  gzipBody = false;
+  httpClient->end();
+  requestOpen = false;
+}
+
+void ConnectionManager::close() {
+  if (requestOpen) {
+    httpClient->end();
+    requestOpen = false;
+  }
+  gzipBody = false;
+  if (socket) {
+    socket->stop();
+  }
+}
+
+void ConnectionManager::printStats() {
+  Serial.printf("Connections: %lu requests, %lu handshakes, %lu reused, %lu stale, "
+                "avg handshake %lu ms, saved ~%lu ms, %lu body bytes "
+                "(%lu decoded, %lu gzip responses)\n",
+                stats.requests, stats.handshakes, stats.reusedRequests,
+                stats.staleReconnects, stats.averageHandshakeMs(),
+                stats.estimatedSavedMs(), stats.bodyBytes, stats.decodedBytes,
+                stats.gzipResponses);
+}
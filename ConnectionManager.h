@@ -0,0 +1,83 @@
+#ifndef CONNECTION_MANAGER_H
+#define CONNECTION_MANAGER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiClientSecure.h>
+#include <HTTPClient.h>
+#include "config.h"
+#include "GzipStream.h"
+#include "HttpTransport.h"
+
+// Presents an HTTP/1.1 response body as a plain stream, decoding chunked
+// transfer encoding and stopping exactly at the end of the body so the
+// socket stays in sync for the next request
+class HttpBodyStream : public Stream {
+private:
+  Stream* source;
+  bool chunked;
+  long remaining;   // Bytes left in the current chunk or body, -1 if unknown
+  bool finished;
+  size_t consumed;  // Body bytes read since reset()
+  unsigned long waitUs;  // Time spent blocked on the socket since reset()
+
+  int readSource();
+  bool skipLine();
+  bool prepare();
+
+public:
+  HttpBodyStream();
+
+  void reset(Stream* stream, bool isChunked, long contentLength);
+  void drain();
+  bool isFinished() const { return finished; }
+  size_t bytesConsumed() const { return consumed; }
+  unsigned long waitMicros() const { return waitUs; }
+
+  // Stream interface
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t) override { return 0; }
+};
+
+// Keeps one TLS session to the Trello API open across requests. A plain
+// http:// base URL, such as a stand-in server on the LAN, is served over
+// an unencrypted socket instead.
+class ConnectionManager : public HttpTransport {
+private:
+  WiFiClient* socket;           // A WiFiClientSecure unless the base URL is http://
+  HTTPClient* httpClient;
+  HttpBodyStream bodyStream;
+  GzipStream gzipStream;
+  bool gzipBody;                // The open response is gzip encoded
+  ConnectionStats stats;
+  RequestMetrics metrics;
+  unsigned long bodyStartedAt;  // micros() when the response headers were in
+  uint32_t cacheUsAtBody;       // Cache time already charged at that point
+  String host;
+  uint16_t port;
+  bool requestOpen;
+
+  bool ensureConnected(bool& reused);
+
+public:
+  ConnectionManager();
+  ~ConnectionManager();
+
+  bool begin(const char* rootCa, const String& baseUrl = TRELLO_BASE_URL);
+
+  int sendRequest(const String& url, const String& method, const String& payload = "") override;
+  Stream& getBody() override;
+  int getSize() override;
+  String header(const char* name) override;
+  void release() override;
+  void close() override;
+
+  // Statistics
+  const ConnectionStats& getStats() const override { return stats; }
+  RequestMetrics& getMetrics() override { return metrics; }
+  void printStats() override;
+};
+
+#endif // CONNECTION_MANAGER_H
@@ -0,0 +1,33 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct Crc32Table {
+  uint32_t entries[256];
+
+  Crc32Table() {
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int bit = 0; bit < 8; bit++) {
+        c = (c & 1) ? (0xEDB88320UL ^ (c >> 1)) : (c >> 1);
+      }
+      entries[i] = c;
+    }
+  }
+};
+
+// CRC-32 (IEEE 802.3), used to detect torn or corrupt records on the SD card.
+// Start with crc = 0 and feed data in as many pieces as needed.
+inline uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+  static const Crc32Table table;
+
+  crc = ~crc;
+  for (size_t i = 0; i < length; i++) {
+    crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+#endif // CRC32_H
@@ -3,37 +3,117 @@
 
 #include <Arduino.h>
 #include <vector>
+#include "config.h"
+#include "CardId.h"
+#include "TextArena.h"
 
 // Forward declarations
 struct ChecklistItem {
-  String id;
-  String name;
+  TextRef id;     // In the owning FullCard's text
+  TextRef name;
   bool isComplete;
   
   ChecklistItem() : isComplete(false) {}
-  ChecklistItem(String _id, String _name, bool _complete = false) 
-    : id(_id), name(_name), isComplete(_complete) {}
 };
 
+// Trello's label colors, resolved from their names once when a card is
+// parsed. The "_light" and "_dark" shades count as their base color.
+enum LabelColor {
+  LABEL_GREEN,
+  LABEL_YELLOW,
+  LABEL_ORANGE,
+  LABEL_RED,
+  LABEL_PURPLE,
+  LABEL_BLUE,
+  LABEL_SKY,
+  LABEL_LIME,
+  LABEL_PINK,
+  LABEL_BLACK,
+  LABEL_OTHER,
+  LABEL_COLOR_COUNT
+};
+
+inline LabelColor labelColorFromName(const char* name) {
+  static const char* const names[] = {
+    "green", "yellow", "orange", "red", "purple", "blue", "sky", "lime", "pink", "black"
+  };
+  for (int i = 0; i < LABEL_OTHER; i++) {
+    size_t length = strlen(names[i]);
+    if (strncmp(name, names[i], length) == 0 && (name[length] == '\0' || name[length] == '_')) {
+      return (LabelColor)i;
+    }
+  }
+  return LABEL_OTHER;
+}
+
+// Kept small since whole chunks of the list are held and copied: the name
+// lives in StringPool::names() and labels are one bit per LabelColor
 struct CardSummary {
-  String id;
-  String name;
-  std::vector<String> labelColors;
+  CardId id;
+  const char* name;   // Interned; never null
+  uint16_t labels;    // Bit (1 << LabelColor) per color present
   bool hasDueDate;
   bool isDone;
   
-  CardSummary() : hasDueDate(false), isDone(false) {}
+  CardSummary() : name(""), labels(0), hasDueDate(false), isDone(false) {}
+  
+  bool hasLabel(LabelColor color) const { return labels & (1 << color); }
+  void addLabel(LabelColor color) { labels |= 1 << color; }
 };
 
+// Every string of a card lives in its TextArena, so a card is a handful
+// of blocks however many comments and checklist items it has. Read them
+// through str().
 struct FullCard {
   CardSummary summary;
-  String description;
-  String dueDate;
-  std::vector<String> comments;
+  TextArena text;
+  TextRef description;
+  TextRef dueDate;
+  std::vector<TextRef> comments;
   std::vector<ChecklistItem> checklists;
+  TextRef lastActivity;     // Trello "dateLastActivity"; changes with any edit or comment
+  unsigned long fetchedAt;  // millis() when downloaded, 0 if read from a cache
+  
+  FullCard() : fetchedAt(0) {}
+  FullCard(const CardSummary& _summary) : summary(_summary), fetchedAt(0) {}
+  
+  const char* str(const TextRef& ref) const { return text.get(ref); }
+  
+  // Empties the card for reuse, keeping its text block
+  void clearContents() {
+    text.clear();
+    description = TextRef();
+    dueDate = TextRef();
+    lastActivity = TextRef();
+    comments.clear();
+    checklists.clear();
+  }
+};
+
+// Card fields an updateCard action reports as changed
+enum ActionChange {
+  CHANGED_NAME = 1 << 0,
+  CHANGED_DUE = 1 << 1,
+  CHANGED_POS = 1 << 2,       // Moved within the list; nothing shown depends on it
+  CHANGED_CLOSED = 1 << 3,
+  CHANGED_LIST = 1 << 4,
+  CHANGED_DETAILS = 1 << 5   // Description or anything else only shown in details
+};
+
+// One entry from the board's action history, reduced to what sync needs
+struct BoardAction {
+  String id;
+  String type;
+  String cardId;
+  String cardName;
+  String listId;        // List the card is in after the action
+  uint8_t changed;      // ActionChange bits for updateCard
+  bool closed;
+  bool hasDueDate;
+  String checkItemId;
+  bool checkItemComplete;
   
-  FullCard() {}
-  FullCard(const CardSummary& _summary) : summary(_summary) {}
+  BoardAction() : changed(0), closed(false), hasDueDate(false), checkItemComplete(false) {}
 };
 
 // Screen states for navigation
@@ -46,6 +126,12 @@ enum ScreenState {
   ERROR_SCREEN
 };
 
+// Short name for logs and telemetry
+inline const char* screenStateName(ScreenState state) {
+  static const char* names[] = {"splash", "list", "card", "comment", "create", "error"};
+  return state <= ERROR_SCREEN ? names[state] : "?";
+}
+
 // Navigation context
 struct NavigationContext {
   ScreenState state;
@@ -61,11 +147,13 @@ struct NavigationContext {
 // API Response status
 enum ApiStatus {
   API_SUCCESS,
-  API_ERROR_NETWORK,
+  API_ERROR_NETWORK,       // The device is offline
+  API_ERROR_UNAVAILABLE,   // Online, but Trello is not answering
   API_ERROR_AUTH,
   API_ERROR_RATE_LIMIT,
   API_ERROR_NOT_FOUND,
   API_ERROR_PARSE,
+  API_ERROR_NO_MEMORY,     // A response or payload did not fit in the JSON document
   API_ERROR_UNKNOWN
 };
 
@@ -73,7 +161,10 @@ enum ApiStatus {
 struct AppState {
   ScreenState currentScreen;
   std::vector<NavigationContext> navigationStack;
-  std::vector<CardSummary> cardList;
+  std::vector<CardSummary> cardList;   // Loaded part of the list...
+  size_t listOffset;                   // ...starting at this list index
+  size_t listTotal;                    // Cards known so far
+  bool listHasMore;                    // The server has cards past listTotal
   FullCard currentCard;
   int selectedCardIndex;
   int currentPage;
@@ -81,10 +172,31 @@ struct AppState {
   bool isOnline;
   unsigned long lastActivity;
   bool needsRefresh;
+  bool listStale;       // Showing the cached list until a sync completes
+  bool cardStale;       // Showing cached details until they are revalidated
+  
+  AppState() : currentScreen(SPLASH_SCREEN), listOffset(0), listTotal(0), 
+               listHasMore(false), selectedCardIndex(0), currentPage(0), 
+               isOnline(false), lastActivity(0), needsRefresh(true),
+               listStale(false), cardStale(false) {}
+  
+  // Card at a list index, or nullptr while it is not loaded
+  const CardSummary* cardAt(int index) const {
+    if (index < (int)listOffset || index >= (int)(listOffset + cardList.size())) {
+      return nullptr;
+    }
+    return &cardList[index - listOffset];
+  }
+  
+  const CardSummary* selectedCard() const {
+    return cardAt(selectedCardIndex);
+  }
   
-  AppState() : currentScreen(SPLASH_SCREEN), selectedCardIndex(0), 
-               currentPage(0), isOnline(false), lastActivity(0), 
-               needsRefresh(true) {}
+  // Rows to navigate over: the known cards plus a page to page into while
+  // the server has more
+  int listLength() const {
+    return listTotal + (listHasMore ? CARDS_PER_PAGE : 0);
+  }
 };
 
 #endif // DATA_STRUCTURES_H
\ No newline at end of file
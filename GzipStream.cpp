@@ -0,0 +1,201 @@
+#include "GzipStream.h"
+
+// Gzip header flags (RFC 1952)
+static const uint8_t GZIP_FHCRC = 0x02;
+static const uint8_t GZIP_FEXTRA = 0x04;
+static const uint8_t GZIP_FNAME = 0x08;
+static const uint8_t GZIP_FCOMMENT = 0x10;
+
+GzipStream::GzipStream() : source(nullptr), inflater(nullptr), window(nullptr) {
+  reset(nullptr);
+}
+
+GzipStream::~GzipStream() {
+  free(inflater);
+  free(window);
+}
+
+// The 32 KB window and the inflater tables go in PSRAM when there is any;
+// malloc returns nullptr where new would abort
+static void* allocate(size_t bytes) {
+  return psramFound() ? ps_malloc(bytes) : malloc(bytes);
+}
+
+bool GzipStream::begin() {
+  if (isReady()) {
+    return true;
+  }
+  inflater = (tinfl_decompressor*)allocate(sizeof(tinfl_decompressor));
+  window = (uint8_t*)allocate(TINFL_LZ_DICT_SIZE);
+  if (!inflater || !window) {
+    Serial.println("Not enough memory for gzip, using plain responses");
+    free(inflater);
+    free(window);
+    inflater = nullptr;
+    window = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void GzipStream::reset(Stream* compressed) {
+  source = compressed;
+  inputPos = 0;
+  inputLen = 0;
+  outputPos = 0;
+  outputEnd = 0;
+  windowPos = 0;
+  status = TINFL_STATUS_NEEDS_MORE_INPUT;
+  headerRead = false;
+  ended = (compressed == nullptr) || !isReady();
+  failed = false;
+  inflated = 0;
+  if (inflater) {
+    tinfl_init(inflater);
+  }
+}
+
+bool GzipStream::fail(const char* reason) {
+  Serial.printf("Gzip body rejected: %s\n", reason);
+  failed = true;
+  ended = true;
+  outputPos = outputEnd;
+  return false;
+}
+
+// Waits for at least one byte, then takes whatever else has already arrived
+bool GzipStream::refill() {
+  inputPos = 0;
+  inputLen = 0;
+  int c = source->read();
+  if (c < 0) {
+    return false;
+  }
+  input[inputLen++] = c;
+  while (inputLen < sizeof(input) && source->available() > 0) {
+    c = source->read();
+    if (c < 0) {
+      break;
+    }
+    input[inputLen++] = c;
+  }
+  return true;
+}
+
+int GzipStream::nextInputByte() {
+  if (inputPos == inputLen && !refill()) {
+    return -1;
+  }
+  return input[inputPos++];
+}
+
+bool GzipStream::skipInput(size_t count) {
+  while (count-- > 0) {
+    if (nextInputByte() < 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool GzipStream::skipString() {
+  int c;
+  while ((c = nextInputByte()) > 0) {
+  }
+  return c == 0;
+}
+
+bool GzipStream::readHeader() {
+  uint8_t header[10];
+  for (size_t i = 0; i < sizeof(header); i++) {
+    int c = nextInputByte();
+    if (c < 0) {
+      return false;
+    }
+    header[i] = c;
+  }
+  // Magic number and deflate method
+  if (header[0] != 0x1F || header[1] != 0x8B || header[2] != 8) {
+    return false;
+  }
+
+  uint8_t flags = header[3];
+  if (flags & GZIP_FEXTRA) {
+    int low = nextInputByte();
+    int high = nextInputByte();
+    if (low < 0 || high < 0 || !skipInput(low | (high << 8))) {
+      return false;
+    }
+  }
+  if ((flags & GZIP_FNAME) && !skipString()) {
+    return false;
+  }
+  if ((flags & GZIP_FCOMMENT) && !skipString()) {
+    return false;
+  }
+  if ((flags & GZIP_FHCRC) && !skipInput(2)) {
+    return false;
+  }
+  return true;
+}
+
+// Makes at least one decompressed byte ready; false at the end of the body
+bool GzipStream::fill() {
+  while (outputPos == outputEnd) {
+    if (ended) {
+      return false;
+    }
+    if (!headerRead) {
+      if (!readHeader()) {
+        return fail("bad header");
+      }
+      headerRead = true;
+    }
+    if (status == TINFL_STATUS_NEEDS_MORE_INPUT && inputPos == inputLen && !refill()) {
+      return fail("truncated");
+    }
+
+    // The window wraps; the inflater writes up to its end and starts over
+    size_t inBytes = inputLen - inputPos;
+    size_t outBytes = TINFL_LZ_DICT_SIZE - windowPos;
+    status = tinfl_decompress(inflater, input + inputPos, &inBytes, window,
+                              window + windowPos, &outBytes, TINFL_FLAG_HAS_MORE_INPUT);
+    inputPos += inBytes;
+
+    outputPos = windowPos;
+    outputEnd = windowPos + outBytes;
+    windowPos = (windowPos + outBytes) & (TINFL_LZ_DICT_SIZE - 1);
+    inflated += outBytes;
+
+    if (status < 0) {
+      return fail("corrupt data");
+    }
+    // The 8-byte trailer is left for release() to drain; the inflater
+    // may already have read part of it into its bit buffer
+    if (status == TINFL_STATUS_DONE) {
+      ended = true;
+    }
+  }
+  return true;
+}
+
+int GzipStream::available() {
+  if (outputPos < outputEnd) {
+    return outputEnd - outputPos;
+  }
+  return (!ended && source && source->available() > 0) ? 1 : 0;
+}
+
+int GzipStream::read() {
+  if (!fill()) {
+    return -1;
+  }
+  return window[outputPos++];
+}
+
+int GzipStream::peek() {
+  if (!fill()) {
+    return -1;
+  }
+  return window[outputPos];
+}
@@ -0,0 +1,62 @@
+#ifndef GZIP_STREAM_H
+#define GZIP_STREAM_H
+
+#include <Arduino.h>
+#include "config.h"
+
+#if CONFIG_IDF_TARGET_ESP32S3
+#include "esp32s3/rom/miniz.h"
+#else
+#include "rom/miniz.h"
+#endif
+
+// Inflates a gzip response body as it is read, using the inflater in the
+// ESP32 ROM. Decompressed bytes are handed out of the 32 KB history window
+// deflate requires, so nothing beyond it and a small input buffer is held
+// however large the body is. A corrupt or truncated body ends the stream
+// early, so the JSON parser reports it as incomplete.
+class GzipStream : public Stream {
+private:
+  Stream* source;
+  tinfl_decompressor* inflater;
+  uint8_t* window;                    // Deflate history, also the output buffer
+  uint8_t input[GZIP_INPUT_BUFFER];
+  size_t inputPos;
+  size_t inputLen;
+  size_t outputPos;                   // Next decompressed byte in window...
+  size_t outputEnd;                   // ...and the end of what is ready
+  size_t windowPos;                   // Where the inflater writes next
+  tinfl_status status;
+  bool headerRead;
+  bool ended;                         // Inflation finished, cleanly or not
+  bool failed;
+  size_t inflated;
+
+  bool refill();
+  int nextInputByte();
+  bool skipInput(size_t count);
+  bool skipString();
+  bool readHeader();
+  bool fill();
+  bool fail(const char* reason);
+
+public:
+  GzipStream();
+  ~GzipStream();
+
+  // Allocates the inflater; gzip is not requested if this fails
+  bool begin();
+  bool isReady() const { return inflater != nullptr && window != nullptr; }
+
+  void reset(Stream* compressed);
+  bool hasFailed() const { return failed; }
+  size_t bytesInflated() const { return inflated; }
+
+  // Stream interface
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t write(uint8_t) override { return 0; }
+};
+
+#endif // GZIP_STREAM_H
@@ -0,0 +1,56 @@
+#ifndef HTTP_TRANSPORT_H
+#define HTTP_TRANSPORT_H
+
+#include <Arduino.h>
+#include "RequestMetrics.h"
+
+// Connection reuse counters
+struct ConnectionStats {
+  unsigned long requests;
+  unsigned long handshakes;
+  unsigned long reusedRequests;
+  unsigned long staleReconnects;
+  unsigned long totalHandshakeMs;
+  unsigned long bodyBytes;          // As received, compressed or not
+  unsigned long decodedBytes;       // After inflating gzip bodies
+  unsigned long gzipResponses;
+
+  ConnectionStats() : requests(0), handshakes(0), reusedRequests(0),
+                      staleReconnects(0), totalHandshakeMs(0), bodyBytes(0),
+                      decodedBytes(0), gzipResponses(0) {}
+
+  unsigned long averageHandshakeMs() const {
+    return handshakes > 0 ? totalHandshakeMs / handshakes : 0;
+  }
+
+  // Every reused request skipped one TLS handshake
+  unsigned long estimatedSavedMs() const {
+    return reusedRequests * averageHandshakeMs();
+  }
+};
+
+// Everything TrelloClient needs from the HTTP layer. ConnectionManager is
+// the real one; another implementation can stand in for it, for example
+// to replay recorded responses, via TrelloClient::setTransport().
+class HttpTransport {
+public:
+  virtual ~HttpTransport() {}
+
+  // Request lifecycle: sendRequest, read getBody(), then release().
+  // sendRequest returns the HTTP status or a negative HTTPClient error;
+  // getBody() is always the decoded body.
+  virtual int sendRequest(const String& url, const String& method,
+                          const String& payload = "") = 0;
+  virtual Stream& getBody() = 0;
+  virtual int getSize() = 0;
+  virtual String header(const char* name) = 0;
+  virtual void release() = 0;
+  virtual void close() = 0;
+
+  // Statistics
+  virtual const ConnectionStats& getStats() const = 0;
+  virtual RequestMetrics& getMetrics() = 0;
+  virtual void printStats() = 0;
+};
+
+#endif // HTTP_TRANSPORT_H
@@ -0,0 +1,54 @@
+#include "JsonBuffer.h"
+#include <utility>
+
+JsonBuffer::JsonBuffer()
+  : doc(0), limit(0), peak(0), grows(0), overflows(0) {
+}
+
+// A new block is allocated before the old one is let go, so a failed
+// resize leaves the current document usable
+bool JsonBuffer::resize(size_t bytes) {
+  if (limit == 0) {
+    limit = psramFound() ? JSON_DOC_MAX_BYTES : JSON_DOC_HEAP_MAX_BYTES;
+  }
+  bytes = min(max(bytes, (size_t)JSON_DOC_MIN_BYTES), limit);
+  if (bytes <= doc.capacity()) {
+    return false;
+  }
+
+  SpiRamJsonDocument bigger(bytes);
+  if (bigger.capacity() < bytes) {
+    Serial.printf("JSON document: out of memory growing to %u bytes\n", (unsigned)bytes);
+    return false;
+  }
+  doc = std::move(bigger);
+  grows++;
+  return true;
+}
+
+JsonDocument& JsonBuffer::prepare(size_t bytes) {
+  if (bytes > doc.capacity() || doc.capacity() == 0) {
+    resize(bytes);
+  }
+  doc.clear();
+  return doc;
+}
+
+JsonDocument& JsonBuffer::forResponse(int bodyBytes, bool compressed) {
+  size_t bytes = 0;
+  if (bodyBytes > 0) {
+    bytes = (size_t)bodyBytes * (compressed ? JSON_GZIP_RATIO : 1);
+  }
+  return prepare(bytes);
+}
+
+bool JsonBuffer::grow() {
+  overflows++;
+  return resize(doc.capacity() * 2);
+}
+
+void JsonBuffer::printStats() {
+  Serial.printf("JSON document: %u bytes (%s), peak %u, grown %lu times, %lu overflows\n",
+                (unsigned)doc.capacity(), psramFound() ? "PSRAM" : "heap",
+                (unsigned)peak, grows, overflows);
+}
@@ -0,0 +1,61 @@
+#ifndef JSON_BUFFER_H
+#define JSON_BUFFER_H
+
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include "config.h"
+
+// ArduinoJson allocator that puts documents in PSRAM when there is some,
+// leaving internal RAM to Wi-Fi, TLS and the display
+struct SpiRamAllocator {
+  void* allocate(size_t size) {
+    return psramFound() ? ps_malloc(size) : malloc(size);
+  }
+  void deallocate(void* pointer) {
+    free(pointer);
+  }
+  void* reallocate(void* pointer, size_t size) {
+    return psramFound() ? ps_realloc(pointer, size) : realloc(pointer, size);
+  }
+};
+
+typedef BasicJsonDocument<SpiRamAllocator> SpiRamJsonDocument;
+
+// The one JSON document TrelloClient parses responses and builds payloads
+// in, kept for the life of the program so requests stop allocating and
+// freeing a document each. It only ever grows: to the size a response
+// announces, or to twice its size after a parse ran out of room, up to a
+// limit so one huge response can't take all of memory. Nothing is
+// allocated until the first request.
+class JsonBuffer {
+private:
+  SpiRamJsonDocument doc;
+  size_t limit;
+  size_t peak;               // Most any document has used
+  unsigned long grows;
+  unsigned long overflows;
+
+  bool resize(size_t bytes);
+
+public:
+  JsonBuffer();
+
+  // The document, emptied, and grown first to at least bytes if it can be
+  JsonDocument& prepare(size_t bytes = 0);
+  // The same, sized for a response of bodyBytes (its Content-Length, or
+  // negative when it sent none); gzip bodies inflate to a few times that
+  JsonDocument& forResponse(int bodyBytes, bool compressed);
+
+  // Records what the last parse or payload used
+  void noteUsage() { peak = max(peak, doc.memoryUsage()); }
+  // After a parse ran out of room: doubles the document for the next
+  // attempt. False if it is already as large as it may get.
+  bool grow();
+
+  size_t capacity() const { return doc.capacity(); }
+  size_t peakUsage() const { return peak; }
+  unsigned long overflowCount() const { return overflows; }
+  void printStats();
+};
+
+#endif // JSON_BUFFER_H
@@ -0,0 +1,239 @@
+#include "ListPager.h"
+#include <algorithm>
+
+// Trello ids start with a creation timestamp, so comparing them orders
+// cards by age
+static bool newerFirst(const CardSummary& a, const CardSummary& b) {
+  return a.id > b.id;
+}
+
+ListPager::ListPager() : complete(false), unordered(0), overlapping(0) {
+}
+
+void ListPager::clear() {
+  chunks.clear();
+  complete = false;
+}
+
+size_t ListPager::knownCount() const {
+  size_t total = 0;
+  for (const auto& chunk : chunks) {
+    total += chunk.count;
+  }
+  return total;
+}
+
+bool ListPager::isResident(size_t chunk) const {
+  return chunk < chunks.size() && chunks[chunk].resident;
+}
+
+size_t ListPager::chunkSize(size_t chunk) const {
+  return chunk < chunks.size() ? chunks[chunk].count : 0;
+}
+
+size_t ListPager::chunkForIndex(size_t index) const {
+  size_t start = 0;
+  for (size_t i = 0; i < chunks.size(); i++) {
+    if (index < start + chunks[i].count) {
+      return i;
+    }
+    start += chunks[i].count;
+  }
+  return chunks.size();
+}
+
+String ListPager::cursorFor(size_t chunk) const {
+  if (chunk == 0 || chunk > chunks.size()) {
+    return "";
+  }
+  return chunks[chunk - 1].cursor.toString();
+}
+
+// A chunk covers the ids below the previous chunk's cursor down to its own;
+// the last chunk of a complete list extends to the oldest card
+int ListPager::chunkForId(const CardId& cardId) const {
+  for (size_t i = 0; i < chunks.size(); i++) {
+    bool last = (i + 1 == chunks.size());
+    if (i > 0 && !(cardId < chunks[i - 1].cursor)) {
+      continue;
+    }
+    if ((last && complete) || !(cardId < chunks[i].cursor)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void ListPager::store(size_t chunk, std::vector<CardSummary>& cards, bool shortResponse) {
+  if (!std::is_sorted(cards.begin(), cards.end(), newerFirst)) {
+    unordered++;
+    Serial.printf("List pager: chunk %u was not returned newest first\n", (unsigned)chunk);
+    std::sort(cards.begin(), cards.end(), newerFirst);
+  }
+
+  // Anything not below the previous chunk's cursor is already listed there
+  if (chunk > 0 && chunk <= chunks.size()) {
+    CardId upperBound = chunks[chunk - 1].cursor;
+    size_t before = cards.size();
+    cards.erase(std::remove_if(cards.begin(), cards.end(),
+                               [&upperBound](const CardSummary& card) {
+      return !(card.id < upperBound);
+    }), cards.end());
+    if (cards.size() < before) {
+      overlapping += before - cards.size();
+      Serial.printf("List pager: dropped %u cards of chunk %u above its cursor\n",
+                    (unsigned)(before - cards.size()), (unsigned)chunk);
+    }
+  }
+
+  if (chunk >= chunks.size()) {
+    if (cards.empty() && !chunks.empty()) {
+      // The previous chunk happened to end exactly at the end of the list
+      complete = true;
+      return;
+    }
+    chunks.push_back(Chunk());
+    chunk = chunks.size() - 1;
+    chunks[chunk].cursor = cards.empty() ? CardId() : cards.back().id;
+    complete = shortResponse;
+  } else if (chunk + 1 < chunks.size()) {
+    CardId lowerBound = chunks[chunk].cursor;
+    if (shortResponse || (!cards.empty() && !(lowerBound < cards.back().id))) {
+      // The response reached the next chunk; keep only this chunk's range
+      cards.erase(std::remove_if(cards.begin(), cards.end(),
+                                 [&lowerBound](const CardSummary& card) {
+        return card.id < lowerBound;
+      }), cards.end());
+    } else {
+      // Cards were added inside this chunk's range, so the response ends
+      // above it and the chunks after it no longer line up
+      chunks.resize(chunk + 1);
+      chunks[chunk].cursor = cards.back().id;
+      complete = false;
+    }
+  } else {
+    if (!cards.empty()) {
+      chunks[chunk].cursor = cards.back().id;
+    }
+    complete = shortResponse;
+  }
+
+  Chunk& target = chunks[chunk];
+  target.cards.swap(cards);
+  target.count = target.cards.size();
+  target.resident = true;
+}
+
+void ListPager::evictOutside(int first, int last) {
+  for (int i = 0; i < (int)chunks.size(); i++) {
+    if ((i < first || i > last) && chunks[i].resident) {
+      std::vector<CardSummary>().swap(chunks[i].cards);
+      chunks[i].resident = false;
+    }
+  }
+}
+
+CardSummary* ListPager::find(const CardId& cardId) {
+  int chunk = chunkForId(cardId);
+  if (chunk < 0 || !chunks[chunk].resident) {
+    return nullptr;
+  }
+  for (auto& card : chunks[chunk].cards) {
+    if (card.id == cardId) {
+      return &card;
+    }
+  }
+  return nullptr;
+}
+
+bool ListPager::remove(const CardId& cardId) {
+  int chunk = chunkForId(cardId);
+  if (chunk < 0 || !chunks[chunk].resident) {
+    return false;
+  }
+  std::vector<CardSummary>& cards = chunks[chunk].cards;
+  for (size_t i = 0; i < cards.size(); i++) {
+    if (cards[i].id == cardId) {
+      cards.erase(cards.begin() + i);
+      chunks[chunk].count = cards.size();
+      return true;
+    }
+  }
+  return false;
+}
+
+// Cards falling in an evicted chunk are left for its next fetch
+bool ListPager::upsert(const CardSummary& card) {
+  CardSummary* existing = find(card.id);
+  if (existing) {
+    *existing = card;
+    return true;
+  }
+
+  int chunk = chunkForId(card.id);
+  if (chunk < 0 || !chunks[chunk].resident) {
+    return false;
+  }
+  std::vector<CardSummary>& cards = chunks[chunk].cards;
+  cards.insert(std::upper_bound(cards.begin(), cards.end(), card, newerFirst), card);
+  chunks[chunk].count = cards.size();
+  return true;
+}
+
+const std::vector<CardSummary>* ListPager::chunkCards(size_t chunk) const {
+  if (!isResident(chunk)) {
+    return nullptr;
+  }
+  return &chunks[chunk].cards;
+}
+
+void ListPager::snapshot(size_t chunk, std::vector<CardSummary>& cards,
+                         ListWindow& window) const {
+  cards.clear();
+  window.total = knownCount();
+  window.hasMore = !complete;
+  window.offset = 0;
+
+  if (!isResident(chunk)) {
+    for (size_t i = 0; i < chunk && i < chunks.size(); i++) {
+      window.offset += chunks[i].count;
+    }
+    return;
+  }
+
+  size_t first = chunk;
+  size_t last = chunk;
+  while (first > 0 && chunks[first - 1].resident) {
+    first--;
+  }
+  while (last + 1 < chunks.size() && chunks[last + 1].resident) {
+    last++;
+  }
+
+  for (size_t i = 0; i < first; i++) {
+    window.offset += chunks[i].count;
+  }
+  for (size_t i = first; i <= last; i++) {
+    cards.insert(cards.end(), chunks[i].cards.begin(), chunks[i].cards.end());
+  }
+}
+
+// Card bytes exclude names, which StringPool accounts for
+void ListPager::printStats() {
+  size_t resident = 0;
+  size_t residentCards = 0;
+  for (const auto& chunk : chunks) {
+    if (chunk.resident) {
+      resident++;
+      residentCards += chunk.cards.size();
+    }
+  }
+  Serial.printf("List pager: %u chunks (%u resident, %u cards, %u bytes), %u cards known%s\n",
+                (unsigned)chunks.size(), (unsigned)resident, (unsigned)residentCards,
+                (unsigned)(residentCards * sizeof(CardSummary)), (unsigned)knownCount(),
+                complete ? "" : ", more on server");
+  if (unordered > 0 || overlapping > 0) {
+    Serial.printf("List pager: %lu responses out of id order, %lu cards above their cursor\n",
+                  unordered, overlapping);
+  }
+}
@@ -0,0 +1,83 @@
+#ifndef LIST_PAGER_H
+#define LIST_PAGER_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+#include "DataStructures.h"
+
+// Where a slice of the list sits within the whole
+struct ListWindow {
+  size_t offset;    // List index of the slice's first card
+  size_t total;     // Cards known so far
+  bool hasMore;     // More cards exist past the known ones
+
+  ListWindow() : offset(0), total(0), hasMore(false) {}
+};
+
+// A list too long to hold in RAM, loaded LIST_CHUNK_SIZE cards at a time
+// with Trello's cursor paging (newest card first, next chunk "before" the
+// oldest id seen). Every chunk keeps its cursor after its cards are
+// evicted, so any chunk can be fetched again on its own.
+//
+// The list is therefore shown newest card first, not in the order of the
+// board: a card's position can change at any time, so chunks cut by it
+// could not be refetched on their own. Paging relies on "before" returning
+// the newest cards with a lower id, in descending id order. store() checks
+// every response against that, drops cards that belong to an earlier
+// chunk and counts responses that break it.
+class ListPager {
+private:
+  struct Chunk {
+    std::vector<CardSummary> cards;   // Newest first; empty when evicted
+    CardId cursor;                    // Oldest id in the chunk when fetched
+    size_t count;
+    bool resident;
+
+    Chunk() : count(0), resident(false) {}
+  };
+
+  std::vector<Chunk> chunks;
+  bool complete;      // The last chunk reached the end of the list
+  unsigned long unordered;     // Responses not in descending id order
+  unsigned long overlapping;   // Cards returned at or above their cursor
+
+  int chunkForId(const CardId& cardId) const;
+
+public:
+  ListPager();
+
+  void clear();
+
+  size_t chunkCount() const { return chunks.size(); }
+  size_t knownCount() const;
+  bool hasMore() const { return !complete; }
+  bool isResident(size_t chunk) const;
+  size_t chunkSize(size_t chunk) const;
+
+  // Chunk holding the card at a list index; chunkCount() if not known yet
+  size_t chunkForIndex(size_t index) const;
+
+  // Cursor to request a chunk with: the previous chunk's oldest id
+  String cursorFor(size_t chunk) const;
+
+  // Stores a fetched chunk; chunk may be an existing index or chunkCount().
+  // A short response (fewer than LIST_CHUNK_SIZE cards) ends the list.
+  void store(size_t chunk, std::vector<CardSummary>& cards, bool shortResponse);
+
+  // Frees the cards of every chunk outside [first, last]
+  void evictOutside(int first, int last);
+
+  // Resident cards only; used by sync to patch the list in place
+  CardSummary* find(const CardId& cardId);
+  bool remove(const CardId& cardId);
+  bool upsert(const CardSummary& card);
+  const std::vector<CardSummary>* chunkCards(size_t chunk) const;
+
+  // Copies the contiguous run of resident chunks around a chunk
+  void snapshot(size_t chunk, std::vector<CardSummary>& cards, ListWindow& window) const;
+
+  void printStats();
+};
+
+#endif // LIST_PAGER_H
@@ -19,18 +19,29 @@
 
 #include <M5Cardputer.h>
 #include <WiFi.h>
-#include <SD.h>
+#include <algorithm>
 #include "config.h"
 #include "DataStructures.h"
 #include "TrelloClient.h"
 #include "UI.h"
 #include "NavigationManager.h"
+#include "NetworkWorker.h"
+#include "MutationLog.h"
+#include "CardCache.h"
+#include "SdStorage.h"
+#include "StateSnapshot.h"
+#include "MemoryTelemetry.h"
 
 // Global objects
-TrelloClient trelloClient;
+SdStorage storage;
+TrelloClient trelloClient(&storage);
 UI ui;
 AppState appState;
 NavigationManager navigation(&appState);
+NetworkWorker networkWorker(&trelloClient);
+MutationLog mutationLog(&storage);
+CardCache cardCache;
+StateSnapshot snapshot(&storage);
 
 // Timing variables
 unsigned long lastKeyPress = 0;
@@ -38,12 +49,42 @@ unsigned long lastRefresh = 0;
 unsigned long lastActivity = 0;
 bool inDeepSleep = false;
 
+// Resume: the last screen is restored from a snapshot at boot
+unsigned long lastSnapshotAt = 0;
+
+// Boot timing, in millis() since power on
+unsigned long bootFirstFrameAt = 0;
+unsigned long bootInteractiveAt = 0;  // setup() handed over to loop()
+unsigned long bootFreshAt = 0;        // First sync with Trello applied
+bool bootConnectPending = false;
+
 // Input handling
 String nameBuffer = "";
 String descBuffer = "";
 bool editingName = true;
 int scrollPosition = 0;
 
+// Network jobs in flight, so repeated key presses don't queue duplicates
+bool listRefreshPending = false;
+
+// Offline change replay: one change in flight at a time, in log order
+uint32_t replayInFlight = 0;
+unsigned long replayStartedAt = 0;
+size_t replayStartCount = 0;
+bool reconnectPending = false;
+unsigned long lastReconnectAttempt = 0;
+unsigned long replayRetryAt = 0;    // Held off while Trello is not answering
+
+// Detail prefetch for the visible and next page
+int prefetchPage = -1;
+bool prefetchDirty = true;
+std::vector<String> prefetchInFlight;
+
+// List paging: the part of the list around the cursor is loaded on demand
+bool listPageRequested = false;
+unsigned long listPageRetryAt = 0;
+size_t pendingCardCount = 0;    // Offline-created cards shown above the list
+
 // Function declarations
 void setup();
 void loop();
@@ -56,15 +97,37 @@ void handleErrorScreenInput();
 void updateDisplay();
 void refreshCardList();
 void refreshCurrentCard();
+void revalidateCurrentCard();
 void showCardDetails();
+void openCard(const String& cardId);
+void showCard(const FullCard& card);
+void prefetchVisibleCards();
+void ensureListWindow();
+void applyListWindow(NetworkResult& result);
+void addPendingCards();
 void addCommentToCard();
 void createNewCard();
 void markFirstChecklistDone();
-void handleApiError(ApiStatus status, const String& operation);
+bool isPendingCard(const String& cardId);
+bool isCurrentCard(const String& cardId);
+void replayMutations();
+void processNetworkResults();
+void onCardListLoaded(NetworkResult& result);
+void onCachedListLoaded(NetworkResult& result);
+void onListPageLoaded(NetworkResult& result);
+void onCardDetailsLoaded(NetworkResult& result);
+void onCardRevalidated(NetworkResult& result);
+void onCardPrefetched(NetworkResult& result);
+void onMutationReplayed(NetworkResult& result);
+void onConnectionChanged(NetworkResult& result);
+void handleApiError(ApiStatus status, const String& operation, const String& detail = "");
 void enterDeepSleep();
 void wakeFromDeepSleep();
 void showStatus(const String& message);
 bool isKeyPressed(char key);
+bool resumeFromSnapshot();
+void saveSnapshot();
+void saveSnapshotIfDue();
 
 void setup() {
   // Initialize M5Cardputer
@@ -81,52 +144,89 @@ void setup() {
   Serial.println("M5Cardputer Trello Client v1.0");
   Serial.println("Initializing...");
   
-  // Show splash screen
-  ui.renderSplashScreen();
-  delay(2000);
+  // Wi-Fi associates in the background while the card mounts and the
+  // caches load
+  trelloClient.startWiFi();
+  
+  // Recover changes that were queued before the last power off
+  storage.begin();
+  mutationLog.begin();
+  cardCache.begin();
+  
+  // Put the last screen back before anything slow; the network catches up
+  // with it afterwards. Without a snapshot the splash stays up until the
+  // cached list arrives.
+  bool resumed = resumeFromSnapshot();
+  if (!resumed) {
+    ui.renderSplashScreen();
+  }
+  bootFirstFrameAt = millis();
   
   // Initialize Trello client
-  ui.renderLoadingScreen("Initializing API client");
   if (!trelloClient.begin()) {
     ui.renderError("Failed to initialize Trello client", "Check SD card and restart");
     ui.playErrorSound();
     while (true) delay(1000);
   }
   
-  // Connect to WiFi
-  ui.renderLoadingScreen("Connecting to WiFi");
-  if (!trelloClient.connectWiFi()) {
-    ui.renderError("WiFi connection failed", "Check credentials in config.h");
+  // From here on only the network task talks to the Trello client
+  if (!networkWorker.begin()) {
+    ui.renderError("Failed to start network task", "Restart the device");
     ui.playErrorSound();
-    // Continue in offline mode
-    appState.isOnline = false;
-  } else {
-    appState.isOnline = true;
-    
-    // Test API connection
-    ui.renderLoadingScreen("Testing API connection");
-    if (!trelloClient.testConnection()) {
-      ui.renderError("API connection failed", "Check Trello credentials");
-      ui.playErrorSound();
-      appState.isOnline = false;
-    }
+    while (true) delay(1000);
   }
   
-  // Load initial card list
-  ui.renderLoadingScreen("Loading cards");
-  refreshCardList();
+  // The cached list is read first; joining Wi-Fi queues behind it, and the
+  // first sync follows from onConnectionChanged(). That sync is also the
+  // credentials check.
+  if (!resumed) {
+    networkWorker.submit(JOB_LOAD_CACHED_LIST);
+  }
+  bootConnectPending = networkWorker.submit(JOB_CONNECT) != 0;
   
-  // Initialize navigation
-  navigation.setState(LIST_VIEW);
   appState.lastActivity = millis();
-  
-  // Ready to go
+  lastSnapshotAt = millis();
   ui.playSuccessSound();
-  showStatus("Ready! Use arrows to navigate");
   
+  bootInteractiveAt = millis();
+  Serial.printf("Boot: first frame at %lu ms, interactive at %lu ms (%s)\n",
+                bootFirstFrameAt, bootInteractiveAt, resumed ? "resumed" : "no snapshot");
   Serial.println("Setup complete");
 }
 
+// Restores the snapshot and draws it. Screens that cannot be rebuilt from
+// it (errors, the splash, a card draft) are backed out of.
+bool resumeFromSnapshot() {
+  unsigned long startedAt = millis();
+  if (!snapshot.restore(appState)) {
+    return false;
+  }
+  
+  while (true) {
+    ScreenState screen = appState.currentScreen;
+    bool needsCard = screen == CARD_DETAIL || screen == ADD_COMMENT;
+    bool usable = screen == LIST_VIEW ||
+                  (needsCard && !appState.currentCard.summary.id.isEmpty());
+    if (usable) {
+      break;
+    }
+    if (!navigation.popState()) {
+      navigation.setState(LIST_VIEW);
+      break;
+    }
+  }
+  
+  // Offline-created cards were left out of the snapshot
+  addPendingCards();
+  scrollPosition = 0;
+  updateDisplay();
+  
+  Serial.printf("Snapshot: %u cards, screen %d, restored and drawn in %lu ms\n",
+                (unsigned)appState.cardList.size(), appState.currentScreen,
+                millis() - startedAt);
+  return true;
+}
+
 void loop() {
   M5Cardputer.update();
   
@@ -136,13 +236,31 @@ void loop() {
   // Update display
   updateDisplay();
   
+  // Apply completed network jobs
+  processNetworkResults();
+  
+  // Send queued offline changes
+  replayMutations();
+  
+  // Page in the part of the list around the cursor
+  ensureListWindow();
+  
+  // Warm the detail cache for what the user is browsing
+  prefetchVisibleCards();
+  
+  // Keep the resume snapshot close to what is on screen
+  saveSnapshotIfDue();
+  
+  // Track the heap against the screen in use, and its trend over time
+  MemoryTelemetry::instance().sampleScreen(screenStateName(appState.currentScreen));
+  
   // Check for idle timeout
   if (millis() - appState.lastActivity > IDLE_TIMEOUT_MS && !inDeepSleep) {
     enterDeepSleep();
   }
   
-  // Periodic refresh when online (every 5 minutes)
-  if (appState.isOnline && millis() - lastRefresh > 300000) {
+  // Periodic sync when online (every 5 minutes)
+  if (appState.isOnline && millis() - lastRefresh > SYNC_INTERVAL_MS) {
     refreshCardList();
     lastRefresh = millis();
   }
@@ -209,7 +327,7 @@ void handleKeyboard() {
 void handleListViewInput() {
   // Navigation using specific key checks
   if (M5Cardputer.Keyboard.isKeyPressed(';')) { // Down arrow equivalent
-    navigation.selectNext(appState.cardList.size());
+    navigation.selectNext(appState.listLength());
   } else if (M5Cardputer.Keyboard.isKeyPressed('/')) { // Up arrow equivalent  
     navigation.selectPrevious();
   } else if (M5Cardputer.Keyboard.isKeyPressed('.')) { // Right arrow equivalent
@@ -218,8 +336,7 @@ void handleListViewInput() {
     navigation.previousPage();
   } else if (M5Cardputer.Keyboard.isKeyPressed(KEY_ENTER)) {
     // Open selected card
-    if (!appState.cardList.empty() && 
-        appState.selectedCardIndex < (int)appState.cardList.size()) {
+    if (appState.selectedCard()) {
       showCardDetails();
     }
   }
@@ -227,10 +344,14 @@ void handleListViewInput() {
   // Shortcuts
   if (M5Cardputer.Keyboard.isKeyPressed('c') || M5Cardputer.Keyboard.isKeyPressed('C')) {
     // Quick comment on selected card
-    if (!appState.cardList.empty() && 
-        appState.selectedCardIndex < (int)appState.cardList.size()) {
-      navigation.pushState(ADD_COMMENT, 0, 0, 
-                          appState.cardList[appState.selectedCardIndex].id);
+    const CardSummary* selected = appState.selectedCard();
+    if (selected) {
+      String cardId = selected->id.toString();
+      if (isPendingCard(cardId)) {
+        showStatus("Card not synced yet");
+      } else {
+        navigation.pushState(ADD_COMMENT, 0, 0, cardId);
+      }
     }
   } else if (M5Cardputer.Keyboard.isKeyPressed('n') || M5Cardputer.Keyboard.isKeyPressed('N')) {
     // Create new card
@@ -243,8 +364,7 @@ void handleListViewInput() {
     refreshCardList();
   } else if (M5Cardputer.Keyboard.isKeyPressed('d') || M5Cardputer.Keyboard.isKeyPressed('D')) {
     // Quick mark done (first checklist item)
-    if (!appState.cardList.empty() && 
-        appState.selectedCardIndex < (int)appState.cardList.size()) {
+    if (appState.selectedCard()) {
       markFirstChecklistDone();
     }
   }
@@ -264,7 +384,7 @@ void handleCardDetailInput() {
   // Shortcuts
   if (M5Cardputer.Keyboard.isKeyPressed('c') || M5Cardputer.Keyboard.isKeyPressed('C')) {
     // Add comment
-    navigation.pushState(ADD_COMMENT, 0, 0, appState.currentCard.summary.id);
+    navigation.pushState(ADD_COMMENT, 0, 0, appState.currentCard.summary.id.toString());
   } else if (M5Cardputer.Keyboard.isKeyPressed('d') || M5Cardputer.Keyboard.isKeyPressed('D')) {
     // Mark first checklist item done
     markFirstChecklistDone();
@@ -346,14 +466,16 @@ void updateDisplay() {
       break;
       
     case LIST_VIEW: {
-      int totalPages = navigation.getTotalPages(appState.cardList.size());
-      ui.renderListView(appState.cardList, appState.selectedCardIndex, 
-                       appState.currentPage, totalPages, appState.isOnline);
+      int totalPages = navigation.getTotalPages(appState.listLength());
+      ui.renderListView(appState.cardList, appState.listOffset, appState.listLength(), 
+                       appState.selectedCardIndex, appState.currentPage, totalPages, 
+                       appState.isOnline, appState.listStale);
       break;
     }
     
     case CARD_DETAIL:
-      ui.renderCardDetail(appState.currentCard, scrollPosition);
+      ui.renderCardDetail(appState.currentCard, scrollPosition, appState.isOnline, 
+                          appState.cardStale);
       break;
       
     case ADD_COMMENT: {
@@ -375,58 +497,191 @@ void updateDisplay() {
 }
 
 void refreshCardList() {
-  showStatus("Refreshing card list...");
+  if (listRefreshPending) return;
   
-  ApiStatus status = trelloClient.fetchCardList(appState.cardList, !appState.isOnline);
+  // Show the cached list while the first sync runs
+  if (appState.isOnline && appState.listTotal == 0) {
+    networkWorker.submit(JOB_LOAD_CACHED_LIST);
+  }
   
-  if (status == API_SUCCESS) {
-    appState.needsRefresh = false;
-    ui.playTone(1200, 100);
-    showStatus("Cards loaded successfully");
+  // Online, only the changes since the last sync are downloaded
+  NetworkJobType type = appState.isOnline ? JOB_SYNC_LIST : JOB_FETCH_LIST;
+  if (networkWorker.submit(type, "", "", "", !appState.isOnline)) {
+    listRefreshPending = true;
+    showStatus("Refreshing card list...");
+  }
+}
+
+void refreshCurrentCard() {
+  if (appState.currentCard.summary.id.isEmpty()) return;
+  
+  // Reopening while the refresh is in flight should not show the old copy
+  String cardId = appState.currentCard.summary.id.toString();
+  cardCache.invalidate(cardId);
+  if (networkWorker.submit(JOB_REFRESH_CARD, cardId, 
+                           "", "", !appState.isOnline)) {
+    showStatus("Refreshing card details...");
+  }
+}
+
+// Cached details stay on screen, marked stale, until the network task
+// confirms them or swaps in the current version
+void revalidateCurrentCard() {
+  const FullCard& card = appState.currentCard;
+  if (!appState.isOnline || card.summary.id.isPending()) {
+    return;
+  }
+  networkWorker.submit(JOB_REVALIDATE_CARD, card.summary.id.toString(),
+                       card.str(card.lastActivity));
+}
+
+void showCardDetails() {
+  const CardSummary* selected = appState.selectedCard();
+  if (selected) {
+    String cardId = selected->id.toString();
+    if (isPendingCard(cardId)) {
+      // Created offline; there is nothing to fetch until it reaches Trello
+      showStatus("Card not synced yet");
+      return;
+    }
     
-    // Reset selection if out of bounds
-    if (appState.selectedCardIndex >= (int)appState.cardList.size()) {
-      appState.selectedCardIndex = max(0, (int)appState.cardList.size() - 1);
-      appState.currentPage = appState.selectedCardIndex / CARDS_PER_PAGE;
+    // Prefetched or recently viewed cards open without a round trip
+    FullCard cached;
+    if (cardCache.get(cardId, cached)) {
+      showCard(cached);
+      return;
     }
+    openCard(cardId);
+  }
+}
+
+// Asks the network task for the rows around the cursor that are not loaded
+// yet, LIST_LOOKAHEAD_PAGES ahead so paging forward rarely waits
+void ensureListWindow() {
+  if (appState.currentScreen != LIST_VIEW || inDeepSleep || !appState.isOnline) {
+    return;
+  }
+  if (listRefreshPending || listPageRequested || millis() < listPageRetryAt) {
+    return;
+  }
+  
+  int first = appState.currentPage * CARDS_PER_PAGE;
+  int last = first + CARDS_PER_PAGE * (1 + LIST_LOOKAHEAD_PAGES) - 1;
+  if (!appState.listHasMore) {
+    last = min(last, (int)appState.listTotal - 1);
+  }
+  if (first > last || (appState.cardAt(first) && appState.cardAt(last))) {
+    return;
+  }
+  
+  // The network task counts from the first card on Trello, below any
+  // cards still waiting to be created
+  NetworkJob job(JOB_LOAD_PAGE);
+  job.listFirst = max(first - (int)pendingCardCount, 0);
+  job.listLast = max(last - (int)pendingCardCount, 0);
+  listPageRequested = networkWorker.submit(job) != 0;
+}
+
+// Takes a loaded slice of the list from the network task
+void applyListWindow(NetworkResult& result) {
+  appState.cardList.swap(result.cards);
+  appState.listOffset = result.window.offset;
+  appState.listTotal = result.window.total;
+  appState.listHasMore = result.window.hasMore;
+  addPendingCards();
+  prefetchDirty = true;
+  
+  // The splash stays up until there is a list to show
+  if (appState.currentScreen == SPLASH_SCREEN) {
+    navigation.setState(LIST_VIEW);
+  }
+  
+  // Reset selection if out of bounds
+  if (appState.selectedCardIndex >= appState.listLength()) {
+    appState.selectedCardIndex = max(0, appState.listLength() - 1);
+    appState.currentPage = appState.selectedCardIndex / CARDS_PER_PAGE;
+  }
+}
+
+// Cards created offline are newest, so they sit at the top of the list; they
+// are counted either way so list indices do not depend on what is loaded
+void addPendingCards() {
+  std::vector<CardSummary> created;
+  mutationLog.applyPending(created);
+  pendingCardCount = created.size();
+  
+  if (appState.listOffset == 0) {
+    appState.cardList.insert(appState.cardList.begin(), created.begin(), created.end());
   } else {
-    handleApiError(status, "fetching card list");
+    appState.listOffset += created.size();
   }
+  appState.listTotal += created.size();
 }
 
-void refreshCurrentCard() {
-  if (appState.currentCard.summary.id.length() == 0) return;
+void showCard(const FullCard& card) {
+  appState.currentCard = card;
+  mutationLog.applyPending(appState.currentCard);
+  scrollPosition = 0;
+  navigation.pushState(CARD_DETAIL, 0, 0, card.summary.id.toString());
+  ui.playTone(1000, 100);
+  
+  appState.cardStale = !TrelloClient::isCacheFresh(card);
+  if (appState.cardStale) {
+    revalidateCurrentCard();
+  }
+}
+
+void prefetchVisibleCards() {
+  if (appState.currentScreen != LIST_VIEW || inDeepSleep) {
+    return;
+  }
+  if (appState.currentPage == prefetchPage && !prefetchDirty) {
+    return;
+  }
   
-  showStatus("Refreshing card details...");
+  // Work queued for a page the user has left is no longer worth doing
+  if (appState.currentPage != prefetchPage) {
+    networkWorker.cancelPrefetch();
+    prefetchInFlight.clear();
+  }
+  prefetchPage = appState.currentPage;
+  prefetchDirty = false;
   
-  ApiStatus status = trelloClient.fetchCardDetails(appState.currentCard.summary.id, 
-                                                  appState.currentCard, !appState.isOnline);
+  int first = appState.currentPage * CARDS_PER_PAGE;
+  int last = first + CARDS_PER_PAGE * PREFETCH_PAGES;
+  std::vector<String> wanted;
+  for (int i = first; i < last; i++) {
+    // Rows still being paged in are picked up when their window arrives
+    const CardSummary* card = appState.cardAt(i);
+    if (!card) {
+      continue;
+    }
+    if (card->id.isPending()) {
+      continue;
+    }
+    String cardId = card->id.toString();
+    if (cardCache.contains(cardId) ||
+        std::find(prefetchInFlight.begin(), prefetchInFlight.end(), cardId) != prefetchInFlight.end()) {
+      continue;
+    }
+    wanted.push_back(cardId);
+  }
   
-  if (status == API_SUCCESS) {
-    ui.playTone(1200, 100);
-    showStatus("Card details refreshed");
+  // One job for the whole window so it can go out as a single batch
+  if (wanted.empty()) {
+    return;
+  }
+  if (networkWorker.prefetch(wanted)) {
+    prefetchInFlight.insert(prefetchInFlight.end(), wanted.begin(), wanted.end());
   } else {
-    handleApiError(status, "refreshing card details");
+    prefetchDirty = true;  // Queue full; try again next loop
   }
 }
 
-void showCardDetails() {
-  if (appState.selectedCardIndex >= 0 && 
-      appState.selectedCardIndex < (int)appState.cardList.size()) {
-    
-    String cardId = appState.cardList[appState.selectedCardIndex].id;
+// A copy cached on SD is shown first and revalidated from showCard()
+void openCard(const String& cardId) {
+  if (networkWorker.submit(JOB_FETCH_CARD, cardId, "", "", true)) {
     showStatus("Loading card details...");
-    
-    ApiStatus status = trelloClient.fetchCardDetails(cardId, appState.currentCard, 
-                                                    !appState.isOnline);
-    
-    if (status == API_SUCCESS) {
-      scrollPosition = 0;
-      navigation.pushState(CARD_DETAIL, 0, 0, cardId);
-      ui.playTone(1000, 100);
-    } else {
-      handleApiError(status, "loading card details");
-    }
   }
 }
 
@@ -446,23 +701,20 @@ void addCommentToCard() {
     return;
   }
   
-  showStatus("Adding comment...");
-  
-  ApiStatus status = trelloClient.addComment(cardId, comment);
+  // Logged first so the text survives going offline or losing power
+  Mutation mutation(MUTATION_ADD_COMMENT);
+  mutation.cardId = cardId;
+  mutation.text = comment;
+  mutation.seq = mutationLog.append(mutation);
   
-  if (status == API_SUCCESS) {
-    ui.playSuccessSound();
-    showStatus("Comment added successfully");
-    navigation.clearInput();
-    navigation.popState();
-    
-    // Refresh card details if we're viewing them
-    if (appState.currentScreen == CARD_DETAIL) {
-      refreshCurrentCard();
-    }
-  } else {
-    handleApiError(status, "adding comment");
+  if (isCurrentCard(cardId)) {
+    MutationLog::apply(mutation, appState.currentCard);
   }
+  
+  ui.playSuccessSound();
+  showStatus(appState.isOnline ? "Adding comment..." : "Comment saved, will send when online");
+  navigation.clearInput();
+  navigation.popState();
 }
 
 void createNewCard() {
@@ -474,24 +726,26 @@ void createNewCard() {
     return;
   }
   
-  showStatus("Creating card...");
-  
   String trimmedDesc = descBuffer;
   trimmedDesc.trim();
-  ApiStatus status = trelloClient.createCard(trimmedName, trimmedDesc);
   
-  if (status == API_SUCCESS) {
-    ui.playSuccessSound();
-    showStatus("Card created successfully");
-    nameBuffer = "";
-    descBuffer = "";
-    navigation.popState();
-    
-    // Refresh the card list
-    refreshCardList();
+  Mutation mutation(MUTATION_CREATE_CARD);
+  mutation.text = trimmedName;
+  mutation.extra = trimmedDesc;
+  mutation.seq = mutationLog.append(mutation);
+  if (appState.listOffset == 0) {
+    MutationLog::apply(mutation, appState.cardList);
   } else {
-    handleApiError(status, "creating card");
+    appState.listOffset++;
   }
+  appState.listTotal++;
+  pendingCardCount++;
+  
+  ui.playSuccessSound();
+  showStatus(appState.isOnline ? "Creating card..." : "Card saved, will create when online");
+  nameBuffer = "";
+  descBuffer = "";
+  navigation.popState();
 }
 
 void markFirstChecklistDone() {
@@ -516,25 +770,84 @@ void markFirstChecklistDone() {
     return;
   }
   
-  showStatus("Marking item as done...");
+  Mutation mutation(MUTATION_SET_CHECK_ITEM);
+  mutation.cardId = appState.currentCard.summary.id.toString();
+  mutation.itemId = appState.currentCard.str(firstIncomplete->id);
+  mutation.complete = true;
+  mutation.wasComplete = false;
+  mutationLog.append(mutation);
   
-  // Note: This is simplified - in reality we'd need checklist ID
-  // For now, we'll use the card API to mark the item as complete
-  // This would require additional API calls to get the checklist structure
+  // Mark as complete locally; the log sends it to Trello
+  firstIncomplete->isComplete = true;
   
   ui.playSuccessSound();
-  showStatus("Item marked as done");
+  showStatus(appState.isOnline ? "Item marked as done" : "Item marked, will sync when online");
+}
+
+bool isPendingCard(const String& cardId) {
+  return cardId.startsWith(PENDING_CARD_PREFIX);
+}
+
+bool isCurrentCard(const String& cardId) {
+  return appState.currentCard.summary.id == CardId::fromString(cardId);
+}
+
+void replayMutations() {
+  if (replayInFlight || inDeepSleep || !mutationLog.hasPending()) {
+    return;
+  }
+  if (millis() < replayRetryAt) {
+    return;
+  }
   
-  // Mark as complete locally
-  firstIncomplete->isComplete = true;
+  if (!appState.isOnline) {
+    // Keep trying in the background so queued changes go out without a key press
+    // The join started at boot is still running
+    if (!reconnectPending && !bootConnectPending &&
+        millis() - lastReconnectAttempt > OFFLINE_RECONNECT_INTERVAL_MS) {
+      lastReconnectAttempt = millis();
+      reconnectPending = networkWorker.submit(JOB_CONNECT) != 0;
+    }
+    return;
+  }
   
-  // Refresh current card if we're viewing details
-  if (appState.currentScreen == CARD_DETAIL) {
-    refreshCurrentCard();
+  const Mutation* mutation = mutationLog.next();
+  NetworkJob job;
+  switch (mutation->type) {
+    case MUTATION_ADD_COMMENT:
+      job.type = JOB_ADD_COMMENT;
+      break;
+    case MUTATION_CREATE_CARD:
+      job.type = JOB_CREATE_CARD;
+      break;
+    case MUTATION_SET_CHECK_ITEM:
+      job.type = JOB_SET_CHECK_ITEM;
+      break;
+  }
+  job.cardId = mutation->cardId;
+  job.itemId = mutation->itemId;
+  job.text = mutation->text;
+  job.extra = mutation->extra;
+  job.complete = mutation->complete;
+  job.tag = mutation->seq;
+  job.verify = mutation->attempted;
+  job.attemptedAt = mutation->attemptedAt;
+  
+  if (!networkWorker.submit(job)) {
+    return;
+  }
+  // Recorded once queued, before the result comes back, so a reboot knows
+  // the outcome is unknown; a full queue leaves it as never sent
+  mutationLog.markAttempted(job.tag, trelloClient.getServerTime());
+  
+  replayInFlight = job.tag;
+  if (replayStartedAt == 0) {
+    replayStartedAt = millis();
+    replayStartCount = mutationLog.size();
   }
 }
 
-void handleApiError(ApiStatus status, const String& operation) {
+void handleApiError(ApiStatus status, const String& operation, const String& detail) {
   String errorMsg = "";
   String suggestion = "";
   
@@ -545,6 +858,12 @@ void handleApiError(ApiStatus status, const String& operation) {
       appState.isOnline = false;
       break;
       
+    case API_ERROR_UNAVAILABLE:
+      // Requests were already retried; the device itself is still online
+      errorMsg = "Trello is not responding";
+      suggestion = "Try again in a minute";
+      break;
+      
     case API_ERROR_AUTH:
       errorMsg = "Authentication failed";
       suggestion = "Check API key and token in config.h";
@@ -565,6 +884,11 @@ void handleApiError(ApiStatus status, const String& operation) {
       suggestion = "API response format may have changed";
       break;
       
+    case API_ERROR_NO_MEMORY:
+      errorMsg = "Response too large";
+      suggestion = "Try again; very large cards may not fit";
+      break;
+      
     default:
       errorMsg = "Unknown error while " + operation;
       suggestion = "Please try again";
@@ -576,10 +900,271 @@ void handleApiError(ApiStatus status, const String& operation) {
   navigation.pushState(ERROR_SCREEN);
   
   Serial.println("API Error: " + errorMsg);
+  if (detail.length() > 0) {
+    Serial.println("  " + detail);
+  }
+}
+
+void processNetworkResults() {
+  NetworkResult* result;
+  while ((result = networkWorker.poll()) != nullptr) {
+    switch (result->type) {
+      case JOB_FETCH_LIST:
+      case JOB_SYNC_LIST:
+        onCardListLoaded(*result);
+        break;
+        
+      case JOB_LOAD_CACHED_LIST:
+        onCachedListLoaded(*result);
+        break;
+        
+      case JOB_LOAD_PAGE:
+        onListPageLoaded(*result);
+        break;
+        
+      case JOB_FETCH_CARD:
+      case JOB_REFRESH_CARD:
+        onCardDetailsLoaded(*result);
+        break;
+        
+      case JOB_REVALIDATE_CARD:
+        onCardRevalidated(*result);
+        break;
+        
+      case JOB_PREFETCH_CARDS:
+        onCardPrefetched(*result);
+        break;
+        
+      case JOB_ADD_COMMENT:
+      case JOB_CREATE_CARD:
+      case JOB_SET_CHECK_ITEM:
+        onMutationReplayed(*result);
+        break;
+        
+      case JOB_CONNECT:
+      case JOB_DISCONNECT:
+        onConnectionChanged(*result);
+        break;
+    }
+    
+    delete result;
+  }
+}
+
+void onCardListLoaded(NetworkResult& result) {
+  listRefreshPending = false;
+  
+  if (result.status == API_SUCCESS) {
+    applyListWindow(result);
+    appState.needsRefresh = false;
+    appState.listStale = false;
+    if (bootFreshAt == 0 && result.type == JOB_SYNC_LIST) {
+      bootFreshAt = millis();
+      Serial.printf("Boot: first frame at %lu ms, interactive at %lu ms, fresh data at %lu ms\n",
+                    bootFirstFrameAt, bootInteractiveAt, bootFreshAt);
+    }
+    ui.playTone(1200, 100);
+    showStatus("Cards loaded successfully");
+    
+    // Cached details the sync saw change are stale; after a full fetch any
+    // of them might be
+    if (result.sync.fullFetch) {
+      cardCache.clear();
+    }
+    
+    // Reload the open card if the sync saw it change
+    const std::vector<String>& changed = result.sync.changedCards;
+    for (const auto& cardId : changed) {
+      cardCache.invalidate(cardId);
+      if (isCurrentCard(cardId)) {
+        refreshCurrentCard();
+      }
+    }
+  } else if (appState.listStale && result.status != API_ERROR_AUTH) {
+    // The cached list stays up; the periodic sync tries again. Bad
+    // credentials still get the error screen, as nothing else checks them.
+    if (result.status == API_ERROR_NETWORK) {
+      appState.isOnline = false;
+    }
+    Serial.println("Sync failed, showing cached list: " + result.error);
+    showStatus("Sync failed, showing cached cards");
+  } else {
+    handleApiError(result.status, "fetching card list", result.error);
+  }
+}
+
+void onCachedListLoaded(NetworkResult& result) {
+  // Too late if the sync has already finished; no cache is not an error
+  if (result.status != API_SUCCESS || !appState.needsRefresh || appState.listTotal > 0) {
+    return;
+  }
+  applyListWindow(result);
+  appState.listStale = true;
+  Serial.printf("Cached list shown %lu ms after it was queued\n", 
+                result.finishedAt - result.queuedAt);
+}
+
+void onListPageLoaded(NetworkResult& result) {
+  listPageRequested = false;
+  
+  // Paging happens in the background; retry later rather than interrupt
+  if (result.status != API_SUCCESS) {
+    Serial.printf("List page load failed: status %d\n", result.status);
+    listPageRetryAt = millis() + RETRY_DELAY_MS;
+    return;
+  }
+  applyListWindow(result);
+}
+
+void onCardDetailsLoaded(NetworkResult& result) {
+  bool isRefresh = (result.type == JOB_REFRESH_CARD);
+  
+  if (result.status != API_SUCCESS) {
+    handleApiError(result.status, isRefresh ? "refreshing card details" : "loading card details",
+                   result.error);
+    return;
+  }
+  
+  cardCache.put(result.card, result.bytes, false);
+  
+  if (isRefresh) {
+    // Ignore refreshes for a card the user has since left
+    if (isCurrentCard(result.cardId)) {
+      appState.currentCard = result.card;
+      
+      // Keep showing changes that have not reached Trello yet
+      mutationLog.applyPending(appState.currentCard);
+      appState.cardStale = false;
+      ui.playTone(1200, 100);
+      showStatus("Card details refreshed");
+    }
+  } else if (appState.currentScreen == LIST_VIEW) {
+    // Only open the card if the user is still waiting on the list
+    showCard(result.card);
+  }
+}
+
+void onCardRevalidated(NetworkResult& result) {
+  bool onScreen = isCurrentCard(result.cardId);
+  
+  // A failed check leaves the cached copy up, still marked stale
+  if (result.status != API_SUCCESS) {
+    if (result.status == API_ERROR_NETWORK) {
+      appState.isOnline = false;
+    }
+    Serial.printf("Revalidating card failed: status %d\n", result.status);
+    return;
+  }
+  
+  if (result.notModified) {
+    cardCache.markFresh(result.cardId, result.finishedAt);
+    if (onScreen) {
+      appState.currentCard.fetchedAt = result.finishedAt;
+    }
+  } else {
+    cardCache.put(result.card, result.bytes, false);
+    if (onScreen) {
+      appState.currentCard = result.card;
+      mutationLog.applyPending(appState.currentCard);
+    }
+  }
+  if (onScreen) {
+    appState.cardStale = false;
+  }
+}
+
+void onCardPrefetched(NetworkResult& result) {
+  for (const auto& cardId : result.cardIds) {
+    auto it = std::find(prefetchInFlight.begin(), prefetchInFlight.end(), cardId);
+    if (it != prefetchInFlight.end()) {
+      prefetchInFlight.erase(it);
+    }
+  }
+  
+  // Keep whatever arrived, even if part of the batch failed
+  for (size_t i = 0; i < result.details.size(); i++) {
+    cardCache.put(result.details[i], result.detailBytes[i], true);
+  }
+}
+
+void onMutationReplayed(NetworkResult& result) {
+  replayInFlight = 0;
+  
+  if (result.status == API_SUCCESS) {
+    mutationLog.markDone(result.tag);
+    cardCache.invalidate(result.cardId);
+    
+    if (result.type == JOB_CREATE_CARD) {
+      // Swap the placeholder for the real card
+      refreshCardList();
+    } else if (appState.currentScreen == CARD_DETAIL && 
+               isCurrentCard(result.cardId)) {
+      refreshCurrentCard();
+    }
+  } else if (result.status == API_ERROR_NETWORK || result.status == API_ERROR_RATE_LIMIT ||
+             result.status == API_ERROR_UNAVAILABLE) {
+    // Keep the change queued and try again later
+    if (result.status == API_ERROR_NETWORK) {
+      appState.isOnline = false;
+    } else if (result.status == API_ERROR_UNAVAILABLE) {
+      replayRetryAt = millis() + CIRCUIT_OPEN_MS;
+    }
+    showStatus(String(mutationLog.size()) + " changes waiting to sync");
+  } else {
+    // Trello rejected the change; retrying will not help
+    mutationLog.markDone(result.tag);
+    handleApiError(result.status, result.type == JOB_ADD_COMMENT ? "adding comment" :
+                                  result.type == JOB_CREATE_CARD ? "creating card" :
+                                  "updating checklist item", result.error);
+  }
+  
+  if (!mutationLog.hasPending() && replayStartedAt != 0) {
+    Serial.printf("Synced %u queued changes in %lu ms\n", 
+                  (unsigned)replayStartCount, millis() - replayStartedAt);
+    replayStartedAt = 0;
+  }
+}
+
+void onConnectionChanged(NetworkResult& result) {
+  if (result.type == JOB_DISCONNECT) {
+    return;
+  }
+  
+  // Background reconnects for queued changes only report success
+  bool background = reconnectPending;
+  reconnectPending = false;
+  
+  // The join started in setup(): sync now, or carry on with what is cached
+  if (bootConnectPending) {
+    bootConnectPending = false;
+    appState.isOnline = result.status == API_SUCCESS;
+    if (appState.isOnline) {
+      refreshCardList();
+      if (appState.currentScreen == CARD_DETAIL && appState.cardStale) {
+        revalidateCurrentCard();
+      }
+    } else if (appState.listTotal == 0) {
+      refreshCardList();
+    } else {
+      showStatus("Offline, showing saved cards");
+    }
+    return;
+  }
+  
+  if (result.status == API_SUCCESS) {
+    appState.isOnline = true;
+    showStatus("Reconnected to WiFi");
+  } else {
+    appState.isOnline = false;
+    if (!background) {
+      showStatus("WiFi reconnection failed");
+    }
+  }
 }
 
 void enterDeepSleep() {
   showStatus("Entering sleep mode...");
+  saveSnapshot();
   delay(1000);
   
   inDeepSleep = true;
@@ -591,7 +1176,7 @@ void enterDeepSleep() {
   M5Cardputer.Display.print("Press any key to wake");
   
   // Disconnect WiFi to save power
-  trelloClient.disconnect();
+  networkWorker.submit(JOB_DISCONNECT);
   
   // Note: ESP32 deep sleep would be configured here
   // For this implementation, we'll just show the sleep screen
@@ -601,20 +1186,39 @@ void wakeFromDeepSleep() {
   inDeepSleep = false;
   showStatus("Waking up...");
   
-  // Reconnect WiFi if needed
+  // Reconnect WiFi if needed, without blocking the UI
   if (!trelloClient.isConnected()) {
-    if (trelloClient.connectWiFi()) {
-      appState.isOnline = true;
-      showStatus("Reconnected to WiFi");
-    } else {
-      appState.isOnline = false;
-      showStatus("WiFi reconnection failed");
-    }
+    networkWorker.submit(JOB_CONNECT);
   }
   
   appState.lastActivity = millis();
 }
 
+// Saved once the keyboard has gone quiet after a key press, and on a timer
+// so background syncs are picked up too
+void saveSnapshotIfDue() {
+  if (inDeepSleep) {
+    return;
+  }
+  unsigned long now = millis();
+  bool settled = lastKeyPress > lastSnapshotAt && now - lastKeyPress > SNAPSHOT_IDLE_MS;
+  if (settled || now - lastSnapshotAt > SNAPSHOT_INTERVAL_MS) {
+    saveSnapshot();
+  }
+}
+
+// Queued behind; the network task writes it out when it is idle
+void saveSnapshot() {
+  lastSnapshotAt = millis();
+  if (appState.currentScreen == SPLASH_SCREEN) {
+    return;
+  }
+  unsigned long startedAt = micros();
+  if (snapshot.save(appState, pendingCardCount)) {
+    Serial.printf("Snapshot: saved in %lu us\n", micros() - startedAt);
+  }
+}
+
 void showStatus(const String& message) {
   ui.showMessage(message, 1000);
   Serial.println("Status: " + message);
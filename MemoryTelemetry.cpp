@@ -0,0 +1,296 @@
+#include "MemoryTelemetry.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(ARDUINO)
+static uint32_t nowMs() {
+  return millis();
+}
+#else
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <new>
+#include <stdlib.h>
+
+static uint32_t nowMs() {
+  using namespace std::chrono;
+  return duration_cast<milliseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Every operator new in a host build is counted, so tests can compare
+// how many allocations an operation makes before and after a change.
+// malloc() itself is not, which leaves out the arenas and pools that
+// exist precisely to make few large allocations.
+static std::atomic<unsigned long> hostAllocations(0);
+static std::atomic<unsigned long long> hostAllocatedBytes(0);
+static std::atomic<unsigned long long> hostLiveBytes(0);
+static std::atomic<unsigned long long> hostPeakBytes(0);
+
+// Each block carries its size in front, so delete knows what it frees;
+// the header keeps the block aligned for any type
+static const size_t HOST_HEADER = alignof(std::max_align_t);
+
+void* operator new(size_t size) {
+  hostAllocations++;
+  hostAllocatedBytes += size;
+  char* block = (char*)malloc(size + HOST_HEADER);
+  if (!block) {
+    throw std::bad_alloc();
+  }
+  *(size_t*)block = size;
+  unsigned long long live = hostLiveBytes += size;
+  unsigned long long peak = hostPeakBytes;
+  while (live > peak && !hostPeakBytes.compare_exchange_weak(peak, live)) {
+  }
+  return block + HOST_HEADER;
+}
+
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+
+void operator delete(void* block) noexcept {
+  if (block) {
+    char* start = (char*)block - HOST_HEADER;
+    hostLiveBytes -= *(size_t*)start;
+    free(start);
+  }
+}
+
+void operator delete[](void* block) noexcept {
+  operator delete(block);
+}
+
+void operator delete(void* block, size_t) noexcept {
+  operator delete(block);
+}
+
+void operator delete[](void* block, size_t) noexcept {
+  operator delete(block);
+}
+
+void MemoryTelemetry::resetPeak() {
+  hostPeakBytes = hostLiveBytes.load();
+}
+#endif
+
+static void printLine(const char* format, ...) {
+  char line[160];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+#if defined(ARDUINO)
+  Serial.print(line);
+#else
+  fputs(line, stdout);
+#endif
+}
+
+MemoryTelemetry::MemoryTelemetry()
+  : next(0), stored(0), lastScreen(nullptr), lastScreenSampleAt(0), fragmenting(false) {
+#if defined(ARDUINO)
+  lock = xSemaphoreCreateMutex();
+#endif
+}
+
+MemoryTelemetry& MemoryTelemetry::instance() {
+  static MemoryTelemetry telemetry;
+  return telemetry;
+}
+
+void MemoryTelemetry::acquire() {
+#if defined(ARDUINO)
+  xSemaphoreTake(lock, portMAX_DELAY);
+#else
+  lock.lock();
+#endif
+}
+
+void MemoryTelemetry::release() {
+#if defined(ARDUINO)
+  xSemaphoreGive(lock);
+#else
+  lock.unlock();
+#endif
+}
+
+MemorySample MemoryTelemetry::read() {
+  MemorySample sample;
+  sample.at = nowMs();
+#if defined(ARDUINO)
+  sample.freeHeap = ESP.getFreeHeap();
+  sample.largestBlock = ESP.getMaxAllocHeap();
+  sample.minFreeHeap = ESP.getMinFreeHeap();
+  sample.freePsram = ESP.getFreePsram();
+#else
+  sample.allocations = hostAllocations;
+  sample.allocatedBytes = hostAllocatedBytes;
+  sample.liveBytes = hostLiveBytes;
+  sample.peakBytes = hostPeakBytes;
+#endif
+  return sample;
+}
+
+// The bucket for name, claiming a free one the first time it is seen;
+// nullptr once all are taken
+MemoryBucket* MemoryTelemetry::find(MemoryBucket* buckets, size_t count, const char* name) {
+  for (size_t i = 0; i < count; i++) {
+    if (!buckets[i].name) {
+      buckets[i].name = name;
+      return &buckets[i];
+    }
+    if (buckets[i].name == name || strcmp(buckets[i].name, name) == 0) {
+      return &buckets[i];
+    }
+  }
+  return nullptr;
+}
+
+void MemoryTelemetry::note(MemoryBucket& bucket, const MemorySample& sample) {
+  bucket.count++;
+  if (sample.freeHeap < bucket.minFreeHeap) {
+    bucket.minFreeHeap = sample.freeHeap;
+  }
+  if (sample.largestBlock < bucket.minLargestBlock) {
+    bucket.minLargestBlock = sample.largestBlock;
+  }
+  if (sample.fragmentation() > bucket.maxFragmentation) {
+    bucket.maxFragmentation = sample.fragmentation();
+  }
+}
+
+void MemoryTelemetry::sampleScreen(const char* screen) {
+  uint32_t now = nowMs();
+  bool changed = screen != lastScreen;
+  bool historyDue = stored == 0 ||
+                    now - history[(next + MEMORY_HISTORY_COUNT - 1) % MEMORY_HISTORY_COUNT].at >=
+                    MEMORY_HISTORY_INTERVAL_MS;
+  if (!changed && !historyDue && now - lastScreenSampleAt < MEMORY_SCREEN_SAMPLE_MS) {
+    return;
+  }
+
+  MemorySample sample = read();
+  acquire();
+  lastScreen = screen;
+  lastScreenSampleAt = now;
+  MemoryBucket* bucket = find(screens, MEMORY_SCREEN_SLOTS, screen);
+  if (bucket) {
+    note(*bucket, sample);
+  }
+  bool wasFragmenting = fragmenting;
+  if (historyDue) {
+    addHistory(sample);
+    fragmenting = checkTrend();
+  }
+  release();
+
+  if (fragmenting != wasFragmenting) {
+    printLine("Memory: %s (free %u, largest block %u, %u%% fragmented)\n",
+              fragmenting ? "heap is fragmenting" : "fragmentation has settled",
+              (unsigned)sample.freeHeap, (unsigned)sample.largestBlock,
+              (unsigned)sample.fragmentation());
+  }
+}
+
+void MemoryTelemetry::recordCall(const char* name, const MemorySample& before,
+                                 const MemorySample& after) {
+  acquire();
+  MemoryBucket* bucket = find(calls, MEMORY_CALL_SLOTS, name);
+  if (bucket) {
+    note(*bucket, after);
+#if defined(ARDUINO)
+    bucket->retainedBytes += (long long)before.freeHeap - after.freeHeap;
+#else
+    bucket->retainedBytes += (long long)(after.liveBytes - before.liveBytes);
+#endif
+    unsigned long allocations = after.allocations - before.allocations;
+    bucket->allocations += allocations;
+    if (allocations > bucket->maxAllocations) {
+      bucket->maxAllocations = allocations;
+    }
+  }
+  release();
+}
+
+const MemoryBucket* MemoryTelemetry::callStats(const char* name) {
+  acquire();
+  MemoryBucket* bucket = find(calls, MEMORY_CALL_SLOTS, name);
+  release();
+  return bucket;
+}
+
+void MemoryTelemetry::addHistory(const MemorySample& sample) {
+  history[next] = sample;
+  next = (next + 1) % MEMORY_HISTORY_COUNT;
+  if (stored < MEMORY_HISTORY_COUNT) {
+    stored++;
+  }
+}
+
+// Compares the oldest quarter of the history with the newest. Free
+// memory alone says little: the heap can have plenty free in pieces too
+// small to use, so the trend is in how much of it the largest block is.
+bool MemoryTelemetry::checkTrend() {
+  const MemorySample& latest = history[(next + MEMORY_HISTORY_COUNT - 1) % MEMORY_HISTORY_COUNT];
+  if (latest.freeHeap == 0) {
+    return false;  // No heap figures on a host
+  }
+  if (latest.largestBlock < MEMORY_LOW_BLOCK_BYTES) {
+    return true;
+  }
+  if (stored < 8) {
+    return false;
+  }
+
+  size_t quarter = stored / 4;
+  size_t oldest = (next + MEMORY_HISTORY_COUNT - stored) % MEMORY_HISTORY_COUNT;
+  uint32_t early = 0;
+  uint32_t late = 0;
+  for (size_t i = 0; i < quarter; i++) {
+    early += history[(oldest + i) % MEMORY_HISTORY_COUNT].fragmentation();
+    late += history[(oldest + stored - quarter + i) % MEMORY_HISTORY_COUNT].fragmentation();
+  }
+  return late > early && (late - early) / quarter >= MEMORY_FRAGMENTATION_RISE_PCT;
+}
+
+void MemoryTelemetry::printBucket(const char* kind, const MemoryBucket& bucket) {
+  char calls[96] = "";
+  if (strcmp(kind, "call") == 0) {
+    snprintf(calls, sizeof(calls), " retained=%lld allocs=%lu max_allocs=%lu",
+             bucket.retainedBytes, bucket.allocations, bucket.maxAllocations);
+  }
+  printLine("memory %s=%s n=%lu min_free=%u min_block=%u max_frag=%u%s\n",
+            kind, bucket.name, bucket.count, (unsigned)bucket.minFreeHeap,
+            (unsigned)bucket.minLargestBlock, (unsigned)bucket.maxFragmentation, calls);
+}
+
+// One "memory" line per screen and call, key=value pairs like the
+// request metrics, then the history oldest first while it shows the heap
+// fragmenting
+void MemoryTelemetry::printStats() {
+  MemorySample now = read();
+  acquire();
+  printLine("Memory: free %u, largest block %u (%u%% fragmented), lowest %u, "
+            "PSRAM free %u%s\n",
+            (unsigned)now.freeHeap, (unsigned)now.largestBlock,
+            (unsigned)now.fragmentation(), (unsigned)now.minFreeHeap,
+            (unsigned)now.freePsram, fragmenting ? ", FRAGMENTING" : "");
+  for (size_t i = 0; i < MEMORY_SCREEN_SLOTS && screens[i].name; i++) {
+    printBucket("screen", screens[i]);
+  }
+  for (size_t i = 0; i < MEMORY_CALL_SLOTS && calls[i].name; i++) {
+    printBucket("call", calls[i]);
+  }
+  size_t oldest = (next + MEMORY_HISTORY_COUNT - stored) % MEMORY_HISTORY_COUNT;
+  for (size_t i = 0; fragmenting && i < stored; i++) {
+    const MemorySample& sample = history[(oldest + i) % MEMORY_HISTORY_COUNT];
+    printLine("memory history t=%lu free=%u block=%u frag=%u psram=%u\n",
+              (unsigned long)sample.at / 1000, (unsigned)sample.freeHeap,
+              (unsigned)sample.largestBlock, (unsigned)sample.fragmentation(),
+              (unsigned)sample.freePsram);
+  }
+  release();
+}
@@ -0,0 +1,125 @@
+#ifndef MEMORY_TELEMETRY_H
+#define MEMORY_TELEMETRY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "config.h"
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <mutex>
+#endif
+
+// The heap at one moment. Internal RAM only, since that is what Wi-Fi,
+// TLS and the display run out of; PSRAM is reported separately. On a
+// host the heap fields are 0 and only the allocation counters are real.
+struct MemorySample {
+  uint32_t at;             // millis()
+  uint32_t freeHeap;
+  uint32_t largestBlock;   // Biggest single allocation that would succeed
+  uint32_t minFreeHeap;    // Lowest freeHeap has been since boot
+  uint32_t freePsram;
+  unsigned long allocations;   // Host only: operator new calls since start,
+  unsigned long long allocatedBytes;   // ...the bytes they asked for,
+  unsigned long long liveBytes;        // ...how many are not freed yet,
+  unsigned long long peakBytes;        // ...and the most that ever were
+
+  MemorySample() : at(0), freeHeap(0), largestBlock(0), minFreeHeap(0), freePsram(0),
+                   allocations(0), allocatedBytes(0), liveBytes(0), peakBytes(0) {}
+
+  // Share of the free heap not in the largest block, in percent
+  uint32_t fragmentation() const {
+    return freeHeap > 0 ? 100 - (uint32_t)((uint64_t)largestBlock * 100 / freeHeap) : 0;
+  }
+};
+
+// What one screen or one TrelloClient call has seen of the heap
+struct MemoryBucket {
+  const char* name;            // A string literal; buckets match on it
+  unsigned long count;         // Samples for a screen, calls for a call
+  uint32_t minFreeHeap;
+  uint32_t minLargestBlock;
+  uint32_t maxFragmentation;
+  long long retainedBytes;     // Calls: heap they did not give back, in total
+  unsigned long allocations;   // Calls: operator new calls, in total...
+  unsigned long maxAllocations;   // ...and the most in one call
+
+  MemoryBucket() : name(nullptr), count(0), minFreeHeap(UINT32_MAX), minLargestBlock(UINT32_MAX),
+                   maxFragmentation(0), retainedBytes(0), allocations(0), maxAllocations(0) {}
+};
+
+// Records where memory goes over hours of use, since slowdowns and resets
+// after a long session are usually the heap fragmenting rather than
+// running out: free memory stays flat while the largest block shrinks
+// until a TLS handshake can't get its buffers.
+//
+// The loop samples the heap against the screen on display, MemoryScope
+// measures each TrelloClient call, and one sample a minute goes into a
+// rolling history that is checked for a fragmentation trend. On a Linux
+// host operator new is counted instead, so a test can assert how many
+// allocations an operation makes and how much it held at its peak. May be
+// used from any task.
+class MemoryTelemetry {
+private:
+  MemorySample history[MEMORY_HISTORY_COUNT];
+  size_t next;               // Slot the next history sample goes in
+  size_t stored;
+  MemoryBucket screens[MEMORY_SCREEN_SLOTS];
+  MemoryBucket calls[MEMORY_CALL_SLOTS];
+  const char* lastScreen;
+  uint32_t lastScreenSampleAt;
+  bool fragmenting;
+#if defined(ARDUINO)
+  SemaphoreHandle_t lock;
+#else
+  std::mutex lock;
+#endif
+
+  MemoryTelemetry();
+  void acquire();
+  void release();
+  static MemoryBucket* find(MemoryBucket* buckets, size_t count, const char* name);
+  static void note(MemoryBucket& bucket, const MemorySample& sample);
+  void addHistory(const MemorySample& sample);
+  bool checkTrend();
+  static void printBucket(const char* kind, const MemoryBucket& bucket);
+
+public:
+  static MemoryTelemetry& instance();
+
+  static MemorySample read();
+#if !defined(ARDUINO)
+  // Starts peakBytes again from what is live now, so a benchmark can
+  // measure one operation's high-water mark
+  static void resetPeak();
+#endif
+
+  // Called from the loop with the current screen's name. Cheap when
+  // nothing is due: the heap is walked at most every
+  // MEMORY_SCREEN_SAMPLE_MS, or when the screen changes.
+  void sampleScreen(const char* screen);
+  // Called by MemoryScope when a call it measured returns
+  void recordCall(const char* name, const MemorySample& before, const MemorySample& after);
+
+  // True while the history shows the largest block shrinking
+  // relative to free memory, or already too small for a TLS handshake
+  bool isFragmenting() const { return fragmenting; }
+  const MemoryBucket* callStats(const char* name);
+
+  void printStats();
+};
+
+// Measures one call for MemoryTelemetry from construction to the end of
+// the scope, like PhaseTimer does for request phases
+class MemoryScope {
+private:
+  const char* name;
+  MemorySample before;
+
+public:
+  explicit MemoryScope(const char* name) : name(name), before(MemoryTelemetry::read()) {}
+  ~MemoryScope() { MemoryTelemetry::instance().recordCall(name, before, MemoryTelemetry::read()); }
+};
+
+#endif // MEMORY_TELEMETRY_H
@@ -0,0 +1,335 @@
+#include "MutationLog.h"
+#include "StringPool.h"
+#include "Crc32.h"
+#include "ByteIO.h"
+
+// Record layout: magic, kind, payload length (u16), seq (u32), CRC-32 (u32),
+// then the payload. The CRC covers everything after the magic byte.
+static const uint8_t RECORD_MAGIC = 'W';
+static const size_t RECORD_HEADER_SIZE = 12;
+
+enum RecordKind {
+  RECORD_MUTATION = 1,
+  RECORD_ATTEMPT = 2,
+  RECORD_DONE = 3
+};
+
+MutationLog::MutationLog(Storage* storage)
+  : storage(storage), appendFile(nullptr), nextSeq(1), storageReady(false) {
+}
+
+MutationLog::~MutationLog() {
+  closeAppend();
+}
+
+void MutationLog::encode(const Mutation& mutation, std::vector<uint8_t>& payload) {
+  payload.clear();
+  payload.push_back((uint8_t)mutation.type);
+  payload.push_back((mutation.complete ? 1 : 0) | (mutation.wasComplete ? 2 : 0));
+  putString(payload, mutation.cardId);
+  putString(payload, mutation.itemId);
+  putString(payload, mutation.text);
+  putString(payload, mutation.extra);
+}
+
+bool MutationLog::decode(const std::vector<uint8_t>& payload, Mutation& mutation) {
+  if (payload.size() < 2) {
+    return false;
+  }
+  mutation.type = (MutationType)payload[0];
+  mutation.complete = payload[1] & 1;
+  mutation.wasComplete = payload[1] & 2;
+
+  size_t pos = 2;
+  return getString(payload, pos, mutation.cardId) &&
+         getString(payload, pos, mutation.itemId) &&
+         getString(payload, pos, mutation.text) &&
+         getString(payload, pos, mutation.extra);
+}
+
+void MutationLog::writeRecord(std::vector<uint8_t>& out, uint8_t kind, uint32_t seq,
+                              const std::vector<uint8_t>& payload) {
+  uint8_t header[RECORD_HEADER_SIZE];
+  header[0] = RECORD_MAGIC;
+  header[1] = kind;
+  header[2] = payload.size() & 0xFF;
+  header[3] = payload.size() >> 8;
+  putU32(header + 4, seq);
+
+  uint32_t crc = crc32Update(0, header + 1, 7);
+  crc = crc32Update(crc, payload.data(), payload.size());
+  putU32(header + 8, crc);
+
+  out.insert(out.end(), header, header + RECORD_HEADER_SIZE);
+  out.insert(out.end(), payload.begin(), payload.end());
+}
+
+bool MutationLog::readRecord(const std::vector<uint8_t>& in, size_t& pos, uint8_t& kind,
+                             uint32_t& seq, std::vector<uint8_t>& payload) {
+  if (pos + RECORD_HEADER_SIZE > in.size() || in[pos] != RECORD_MAGIC) {
+    return false;
+  }
+  const uint8_t* header = &in[pos];
+  kind = header[1];
+  uint16_t length = header[2] | (header[3] << 8);
+  seq = getU32(header + 4);
+
+  if (pos + RECORD_HEADER_SIZE + length > in.size()) {
+    return false;
+  }
+  payload.assign(in.begin() + pos + RECORD_HEADER_SIZE,
+                 in.begin() + pos + RECORD_HEADER_SIZE + length);
+
+  uint32_t crc = crc32Update(0, header + 1, 7);
+  crc = crc32Update(crc, payload.data(), payload.size());
+  if (crc != getU32(header + 8)) {
+    return false;
+  }
+  pos += RECORD_HEADER_SIZE + length;
+  return true;
+}
+
+bool MutationLog::appendRecord(uint8_t kind, uint32_t seq, const std::vector<uint8_t>& payload) {
+  if (!storageReady) {
+    return false;
+  }
+
+  // The handle stays open; flushing after every record pushes it to the
+  // card before we move on
+  if (!appendFile) {
+    appendFile = storage->open(MUTATION_LOG_FILE, STORAGE_APPEND);
+    if (!appendFile) {
+      return false;
+    }
+  }
+  std::vector<uint8_t> record;
+  writeRecord(record, kind, seq, payload);
+  return appendFile->write(record.data(), record.size()) == record.size() && appendFile->flush();
+}
+
+void MutationLog::closeAppend() {
+  delete appendFile;
+  appendFile = nullptr;
+}
+
+bool MutationLog::begin() {
+  storageReady = storage->begin();
+  if (!storageReady) {
+    Serial.println("Mutation log: no SD card, queued changes will not survive a reboot");
+    return false;
+  }
+
+  // Finish or roll back an interrupted compaction
+  storage->recover(MUTATION_LOG_FILE);
+
+  pending.clear();
+  std::vector<uint8_t> data;
+  if (!storage->readFile(MUTATION_LOG_FILE, data)) {
+    return true;
+  }
+
+  bool needsRewrite = false;
+  size_t records = 0;
+  size_t pos = 0;
+  uint8_t kind;
+  uint32_t seq;
+  std::vector<uint8_t> payload;
+
+  while (pos < data.size()) {
+    if (!readRecord(data, pos, kind, seq, payload)) {
+      // Torn tail from a power loss; everything before it is intact
+      Serial.println("Mutation log: discarding corrupt tail after " + String(records) + " records");
+      needsRewrite = true;
+      break;
+    }
+    records++;
+    nextSeq = max(nextSeq, seq + 1);
+
+    if (kind == RECORD_MUTATION) {
+      Mutation mutation;
+      if (decode(payload, mutation)) {
+        mutation.seq = seq;
+        pending.push_back(mutation);
+      }
+    } else {
+      for (size_t i = 0; i < pending.size(); i++) {
+        if (pending[i].seq != seq) {
+          continue;
+        }
+        if (kind == RECORD_ATTEMPT) {
+          size_t at = 0;
+          uint32_t attemptedAt = 0;
+          pending[i].attempted = true;
+          if (pending[i].attemptedAt == 0 && getU32(payload, at, attemptedAt)) {
+            pending[i].attemptedAt = attemptedAt;
+          }
+        } else {
+          pending.erase(pending.begin() + i);
+          needsRewrite = true;
+        }
+        break;
+      }
+    }
+  }
+
+  if (needsRewrite) {
+    rewrite();
+  }
+
+  Serial.println("Mutation log: " + String(pending.size()) + " pending changes");
+  return true;
+}
+
+// Replaces the log with one holding only the pending changes
+bool MutationLog::rewrite() {
+  if (!storageReady) {
+    return false;
+  }
+  closeAppend();
+
+  if (pending.empty()) {
+    return storage->remove(MUTATION_LOG_FILE);
+  }
+
+  std::vector<uint8_t> data;
+  std::vector<uint8_t> payload;
+  for (const auto& mutation : pending) {
+    encode(mutation, payload);
+    writeRecord(data, RECORD_MUTATION, mutation.seq, payload);
+    if (mutation.attempted) {
+      payload.clear();
+      putU32(payload, mutation.attemptedAt);
+      writeRecord(data, RECORD_ATTEMPT, mutation.seq, payload);
+    }
+  }
+  return storage->writeFile(MUTATION_LOG_FILE, data.data(), data.size());
+}
+
+uint32_t MutationLog::append(Mutation mutation) {
+  if (mutation.type == MUTATION_SET_CHECK_ITEM) {
+    // Collapse earlier unsent changes to the same item into this one
+    bool originalState = mutation.wasComplete;
+    bool foundEarlier = false;
+    for (size_t i = 0; i < pending.size(); ) {
+      const Mutation& earlier = pending[i];
+      if (earlier.type == MUTATION_SET_CHECK_ITEM && !earlier.attempted &&
+          earlier.cardId == mutation.cardId && earlier.itemId == mutation.itemId) {
+        if (!foundEarlier) {
+          originalState = earlier.wasComplete;
+          foundEarlier = true;
+        }
+        cancel(i);
+      } else {
+        i++;
+      }
+    }
+
+    // Toggled back to where it started: nothing to send
+    if (foundEarlier && mutation.complete == originalState) {
+      return 0;
+    }
+    mutation.wasComplete = originalState;
+  }
+
+  mutation.seq = nextSeq++;
+  mutation.attempted = false;
+  mutation.attemptedAt = 0;
+
+  std::vector<uint8_t> payload;
+  encode(mutation, payload);
+  if (!appendRecord(RECORD_MUTATION, mutation.seq, payload) && storageReady) {
+    Serial.println("Mutation log: write failed, change kept in memory only");
+  }
+
+  pending.push_back(mutation);
+  return mutation.seq;
+}
+
+bool MutationLog::cancel(size_t index) {
+  uint32_t seq = pending[index].seq;
+  pending.erase(pending.begin() + index);
+  return appendRecord(RECORD_DONE, seq, std::vector<uint8_t>());
+}
+
+bool MutationLog::markAttempted(uint32_t seq, uint32_t at) {
+  for (auto& mutation : pending) {
+    if (mutation.seq == seq) {
+      mutation.attempted = true;
+      if (mutation.attemptedAt == 0) {
+        mutation.attemptedAt = at;
+      }
+      std::vector<uint8_t> payload;
+      putU32(payload, mutation.attemptedAt);
+      return appendRecord(RECORD_ATTEMPT, seq, payload);
+    }
+  }
+  return false;
+}
+
+bool MutationLog::markDone(uint32_t seq) {
+  for (size_t i = 0; i < pending.size(); i++) {
+    if (pending[i].seq == seq) {
+      cancel(i);
+
+      // Start a fresh file once everything has been delivered
+      if (pending.empty()) {
+        rewrite();
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+const Mutation* MutationLog::next() {
+  return pending.empty() ? nullptr : &pending.front();
+}
+
+void MutationLog::apply(const Mutation& mutation, std::vector<CardSummary>& cards) {
+  if (mutation.type != MUTATION_CREATE_CARD) {
+    return;
+  }
+
+  CardId pendingId = CardId::pending(mutation.seq);
+  for (const auto& card : cards) {
+    if (card.id == pendingId) {
+      return;
+    }
+  }
+
+  CardSummary summary;
+  summary.id = pendingId;
+  summary.name = StringPool::names().intern(mutation.text);
+  // Newest cards list first
+  cards.insert(cards.begin(), summary);
+}
+
+void MutationLog::apply(const Mutation& mutation, FullCard& card) {
+  if (mutation.cardId != card.summary.id.toString()) {
+    return;
+  }
+
+  if (mutation.type == MUTATION_ADD_COMMENT) {
+    // Trello lists comments newest first
+    card.comments.insert(card.comments.begin(),
+                         card.text.add("You (pending): ", mutation.text.c_str()));
+  } else if (mutation.type == MUTATION_SET_CHECK_ITEM) {
+    for (auto& item : card.checklists) {
+      if (mutation.itemId == card.str(item.id)) {
+        item.isComplete = mutation.complete;
+      }
+    }
+  }
+}
+
+void MutationLog::applyPending(std::vector<CardSummary>& cards) {
+  for (const auto& mutation : pending) {
+    apply(mutation, cards);
+  }
+}
+
+void MutationLog::applyPending(FullCard& card) {
+  for (const auto& mutation : pending) {
+    apply(mutation, card);
+  }
+}
@@ -0,0 +1,84 @@
+#ifndef MUTATION_LOG_H
+#define MUTATION_LOG_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+#include "DataStructures.h"
+#include "Storage.h"
+
+enum MutationType {
+  MUTATION_ADD_COMMENT = 1,
+  MUTATION_CREATE_CARD = 2,
+  MUTATION_SET_CHECK_ITEM = 3
+};
+
+struct Mutation {
+  uint32_t seq;
+  MutationType type;
+  String cardId;
+  String itemId;
+  String text;        // Comment text or new card name
+  String extra;       // New card description
+  bool complete;      // Target check item state
+  bool wasComplete;   // Check item state before this change
+  bool attempted;     // Sent at least once; outcome unknown until committed
+  uint32_t attemptedAt;  // Trello's Unix time when first sent, 0 if not known
+
+  Mutation(MutationType _type = MUTATION_ADD_COMMENT)
+    : seq(0), type(_type), complete(false), wasComplete(false), attempted(false),
+      attemptedAt(0) {}
+};
+
+// Write-ahead log of user changes that have not reached Trello yet.
+// Every change is appended to the SD card before it is applied to the
+// UI, replayed in order when the device is online, and committed once
+// the server accepts it. Records are CRC-protected so a torn write from
+// a power loss is detected and discarded on the next boot.
+class MutationLog {
+private:
+  Storage* storage;
+  StorageFile* appendFile;    // Kept open between appends
+  std::vector<Mutation> pending;
+  uint32_t nextSeq;
+  bool storageReady;
+
+  bool appendRecord(uint8_t kind, uint32_t seq, const std::vector<uint8_t>& payload);
+  void closeAppend();
+  static void writeRecord(std::vector<uint8_t>& out, uint8_t kind, uint32_t seq, 
+                          const std::vector<uint8_t>& payload);
+  static bool readRecord(const std::vector<uint8_t>& in, size_t& pos, uint8_t& kind, 
+                         uint32_t& seq, std::vector<uint8_t>& payload);
+  bool rewrite();
+  bool cancel(size_t index);
+
+  static void encode(const Mutation& mutation, std::vector<uint8_t>& payload);
+  static bool decode(const std::vector<uint8_t>& payload, Mutation& mutation);
+
+public:
+  explicit MutationLog(Storage* storage);
+  ~MutationLog();
+
+  // Loads and recovers the log; call once the SD card is mounted
+  bool begin();
+
+  // Returns the sequence number of the queued change, or 0 if it cancelled
+  // out earlier pending changes and nothing needs to be sent
+  uint32_t append(Mutation mutation);
+  // at is Trello's time of the send; the first one known is kept
+  bool markAttempted(uint32_t seq, uint32_t at = 0);
+  bool markDone(uint32_t seq);
+
+  // Oldest pending change, or nullptr
+  const Mutation* next();
+  bool hasPending() const { return !pending.empty(); }
+  size_t size() const { return pending.size(); }
+
+  // Optimistic view: overlay pending changes on freshly loaded data
+  static void apply(const Mutation& mutation, std::vector<CardSummary>& cards);
+  static void apply(const Mutation& mutation, FullCard& card);
+  void applyPending(std::vector<CardSummary>& cards);
+  void applyPending(FullCard& card);
+};
+
+#endif // MUTATION_LOG_H
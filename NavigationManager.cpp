@@ -1,6 +1,7 @@
 #include "NavigationManager.h"
 
-NavigationManager::NavigationManager(AppState* state) : appState(state) {
+NavigationManager::NavigationManager(AppState* state)
+  : appState(state), navigationStack(state->navigationStack) {
   navigationStack.clear();
 }
 
@@ -74,7 +75,7 @@ ScreenState NavigationManager::getCurrentState() {
 }
 
 void NavigationManager::nextPage() {
-  int totalPages = getTotalPages(appState->cardList.size());
+  int totalPages = getTotalPages(appState->listLength());
   if (appState->currentPage < totalPages - 1) {
     appState->currentPage++;
     appState->selectedCardIndex = appState->currentPage * CARDS_PER_PAGE;
@@ -128,21 +129,22 @@ void NavigationManager::selectPrevious() {
       previousPage();
       // Select last item on previous page
       int prevPageStart = appState->currentPage * CARDS_PER_PAGE;
-      int prevPageEnd = min(prevPageStart + CARDS_PER_PAGE, (int)appState->cardList.size());
+      int prevPageEnd = min(prevPageStart + CARDS_PER_PAGE, appState->listLength());
       appState->selectedCardIndex = prevPageEnd - 1;
-    } else {
-      // Wrap to last page and last item
-      int totalPages = getTotalPages(appState->cardList.size());
+    } else if (!appState->listHasMore) {
+      // Wrap to last page and last item; a list still being paged in has
+      // no known last page
+      int totalPages = getTotalPages(appState->listLength());
       appState->currentPage = totalPages - 1;
       int lastPageStart = appState->currentPage * CARDS_PER_PAGE;
-      int lastPageEnd = min(lastPageStart + CARDS_PER_PAGE, (int)appState->cardList.size());
-      appState->selectedCardIndex = lastPageEnd - 1;
+      int lastPageEnd = min(lastPageStart + CARDS_PER_PAGE, appState->listLength());
+      appState->selectedCardIndex = max(lastPageEnd - 1, 0);
     }
   }
 }
 
 void NavigationManager::setSelection(int index) {
-  if (index >= 0 && index < (int)appState->cardList.size()) {
+  if (index >= 0 && index < appState->listLength()) {
     appState->selectedCardIndex = index;
     appState->currentPage = index / CARDS_PER_PAGE;
   }
@@ -180,9 +182,9 @@ String NavigationManager::getCurrentCardId() {
   if (!navigationStack.empty()) {
     return navigationStack.back().cardId;
   }
-  if (appState->selectedCardIndex >= 0 && 
-      appState->selectedCardIndex < (int)appState->cardList.size()) {
-    return appState->cardList[appState->selectedCardIndex].id;
+  const CardSummary* card = appState->selectedCard();
+  if (card) {
+    return card->id.toString();
   }
   return "";
 }
@@ -8,8 +8,8 @@
 
 class NavigationManager {
 private:
-  std::vector<NavigationContext> navigationStack;
   AppState* appState;
+  std::vector<NavigationContext>& navigationStack;   // Kept in AppState so it is snapshotted
   
   // Navigation helpers
   void saveCurrentContext();
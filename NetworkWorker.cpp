@@ -0,0 +1,278 @@
+#include "NetworkWorker.h"
+
+NetworkWorker::NetworkWorker(TrelloClient* client) 
+  : client(client), syncEngine(client), jobs(NETWORK_QUEUE_DEPTH), 
+    prefetchJobs(PREFETCH_PAGES), results(NETWORK_QUEUE_DEPTH), 
+    prefetchGeneration(0), nextJobId(1) {
+}
+
+bool NetworkWorker::begin() {
+  if (!thread.start(taskEntry, this, "network", NETWORK_TASK_STACK_SIZE, 
+                    NETWORK_TASK_PRIORITY, NETWORK_TASK_CORE)) {
+    Serial.println("Failed to start network task");
+    return false;
+  }
+  return true;
+}
+
+uint32_t NetworkWorker::submit(NetworkJobType type, const String& cardId, 
+                               const String& text, const String& extra, bool useCache) {
+  NetworkJob job(type);
+  job.cardId = cardId;
+  job.text = text;
+  job.extra = extra;
+  job.useCache = useCache;
+  return submit(job);
+}
+
+uint32_t NetworkWorker::submit(const NetworkJob& request) {
+  NetworkJob* job = new NetworkJob(request);
+  job->id = nextJobId++;
+  job->queuedAt = millis();
+  
+  if (!jobs.push(job)) {
+    Serial.println("Network queue full, dropping job");
+    delete job;
+    return 0;
+  }
+  return job->id;
+}
+
+uint32_t NetworkWorker::prefetch(const std::vector<String>& cardIds) {
+  NetworkJob* job = new NetworkJob(JOB_PREFETCH_CARDS);
+  job->id = nextJobId++;
+  job->cardIds = cardIds;
+  job->useCache = true;
+  job->generation = prefetchGeneration;
+  job->queuedAt = millis();
+  
+  // A full prefetch queue just means these cards wait for the next pass
+  if (!prefetchJobs.push(job)) {
+    delete job;
+    return 0;
+  }
+  return job->id;
+}
+
+void NetworkWorker::cancelPrefetch() {
+  prefetchGeneration++;
+}
+
+NetworkResult* NetworkWorker::poll() {
+  return results.pop(0);
+}
+
+size_t NetworkWorker::pendingJobs() {
+  return jobs.size();
+}
+
+void NetworkWorker::taskEntry(void* arg) {
+  static_cast<NetworkWorker*>(arg)->run();
+}
+
+void NetworkWorker::run() {
+  while (true) {
+    NetworkJob* job = nextJob();
+    if (!job) {
+      continue;
+    }
+    unsigned long bytesBefore = client->getConnectionStats().bodyBytes;
+    
+    NetworkResult* result = new NetworkResult();
+    result->type = job->type;
+    result->jobId = job->id;
+    result->tag = job->tag;
+    result->cardId = job->cardId;
+    result->queuedAt = job->queuedAt;
+    result->startedAt = millis();
+    
+    client->clearLastError();
+    execute(*job, *result);
+    if (result->status != API_SUCCESS) {
+      result->error = client->getLastError();
+    }
+    
+    result->finishedAt = millis();
+    result->bytes = client->getConnectionStats().bodyBytes - bytesBefore;
+    result->cardIds.swap(job->cardIds);
+    delete job;
+    
+    // The UI drains results every frame, so this only waits if it is stalled
+    results.push(result, WorkQueue<NetworkResult>::WAIT_FOREVER);
+  }
+}
+
+// User jobs always go first; prefetch work only fills idle time
+NetworkJob* NetworkWorker::nextJob() {
+  // The UI queues snapshot and cache writes but never writes them itself;
+  // once too much is held back it goes out here, between jobs
+  if (client->getStorage()->flushDue()) {
+    client->flushStorage();
+  }
+  NetworkJob* job = jobs.pop(0);
+  if (!job) {
+    job = prefetchJobs.pop(0);
+  }
+  if (!job) {
+    // Nothing to do, so cache writes held back in RAM go to the card now
+    client->flushStorage();
+    job = jobs.pop(PREFETCH_POLL_MS);
+  }
+  return job;
+}
+
+// Cards already cached on SD cost nothing; the rest are fetched together
+// through /batch, one request per BATCH_MAX_URLS cards
+void NetworkWorker::prefetchCards(const NetworkJob& job, NetworkResult& result) {
+  std::vector<String> missing;
+  for (const auto& cardId : job.cardIds) {
+    FullCard card;
+    if (client->loadCachedCardDetails(cardId, card)) {
+      result.details.push_back(card);
+      result.detailBytes.push_back(0);
+    } else {
+      missing.push_back(cardId);
+    }
+  }
+  
+  result.status = API_SUCCESS;
+  if (missing.empty()) {
+    return;
+  }
+  
+  // A failed prefetch is simply dropped; retrying would hold up user jobs
+  unsigned long bytesBefore = client->getConnectionStats().bodyBytes;
+  std::vector<FullCard> fetched;
+  client->setRetryEnabled(false);
+  result.status = client->fetchCardDetailsBatch(missing, fetched);
+  client->setRetryEnabled(true);
+  
+  // The batch response is shared, so each card is charged an equal part
+  unsigned long bytes = client->getConnectionStats().bodyBytes - bytesBefore;
+  unsigned long perCard = fetched.empty() ? 0 : bytes / fetched.size();
+  for (auto& card : fetched) {
+    result.details.push_back(card);
+    result.detailBytes.push_back(perCard);
+  }
+}
+
+// A write that was sent before a power loss or dropped connection may have
+// reached Trello even though no response arrived. Comments and new cards
+// are not idempotent, so look for one of ours made since the first attempt
+// before sending again. Without Trello's time of that attempt there is
+// nothing to tell it from an older identical one, so it is sent again.
+bool NetworkWorker::alreadyApplied(const NetworkJob& job) {
+  if (job.attemptedAt == 0 || (job.type != JOB_ADD_COMMENT && job.type != JOB_CREATE_CARD)) {
+    return false;
+  }
+  bool found = false;
+  String cardId = job.type == JOB_ADD_COMMENT ? job.cardId : String();
+  if (client->findOwnAction(cardId, job.text, job.attemptedAt, found) != API_SUCCESS) {
+    return false;
+  }
+  return found;
+}
+
+void NetworkWorker::execute(const NetworkJob& job, NetworkResult& result) {
+  if (job.type == JOB_PREFETCH_CARDS) {
+    // Skip batches for a page the user has left, and never wait for a
+    // rate limit token on work nobody asked for yet
+    if (job.generation != prefetchGeneration) {
+      result.status = API_ERROR_UNKNOWN;
+      return;
+    }
+    if (client->getRateLimitWaitMs() > 0) {
+      result.status = API_ERROR_RATE_LIMIT;
+      return;
+    }
+    if (client->getUnavailableWaitMs() > 0) {
+      result.status = API_ERROR_UNAVAILABLE;
+      return;
+    }
+  }
+  
+  if (job.verify && alreadyApplied(job)) {
+    Serial.println("Change already on the server, not resending");
+    result.status = API_SUCCESS;
+    return;
+  }
+  
+  bool changed = false;
+  for (int attempt = 0; ; attempt++) {
+    // Waiting for a rate limit token blocks this task, not the UI
+    unsigned long wait = client->getRateLimitWaitMs();
+    if (wait > 0) {
+      delay(wait);
+    }
+    
+    switch (job.type) {
+      case JOB_FETCH_LIST:
+        // Just the cached or newest chunk, without paging
+        result.status = client->fetchCardList(result.cards, job.useCache);
+        result.window = ListWindow();
+        result.window.total = result.cards.size();
+        break;
+        
+      case JOB_LOAD_CACHED_LIST:
+        result.status = client->loadCachedCardList(result.cards) ? API_SUCCESS : API_ERROR_NOT_FOUND;
+        result.window = ListWindow();
+        result.window.total = result.cards.size();
+        result.window.hasMore = result.cards.size() >= LIST_CHUNK_SIZE;
+        break;
+        
+      case JOB_SYNC_LIST:
+        result.sync = SyncOutcome();
+        result.status = syncEngine.sync(result.cards, result.sync, result.window);
+        if (result.status == API_SUCCESS) {
+          syncEngine.printStats();
+        }
+        break;
+        
+      case JOB_LOAD_PAGE:
+        result.status = syncEngine.loadRange(job.listFirst, job.listLast, 
+                                             result.cards, result.window);
+        break;
+        
+      case JOB_FETCH_CARD:
+      case JOB_REFRESH_CARD:
+        result.status = client->fetchCardDetails(job.cardId, result.card, job.useCache);
+        break;
+        
+      case JOB_REVALIDATE_CARD:
+        result.status = client->revalidateCard(job.cardId, job.text, result.card, changed);
+        result.notModified = result.status == API_SUCCESS && !changed;
+        break;
+        
+      case JOB_PREFETCH_CARDS:
+        prefetchCards(job, result);
+        break;
+        
+      case JOB_ADD_COMMENT:
+        result.status = client->addComment(job.cardId, job.text);
+        break;
+        
+      case JOB_CREATE_CARD:
+        result.status = client->createCard(job.text, job.extra);
+        break;
+        
+      case JOB_SET_CHECK_ITEM:
+        result.status = client->setCheckItemState(job.cardId, job.itemId, job.complete);
+        break;
+        
+      case JOB_CONNECT:
+        result.status = client->connectWiFi() ? API_SUCCESS : API_ERROR_NETWORK;
+        break;
+        
+      case JOB_DISCONNECT:
+        client->disconnect();
+        result.status = API_SUCCESS;
+        break;
+    }
+    
+    // A 429 leaves the bucket blocked; wait it out and try again
+    if (result.status != API_ERROR_RATE_LIMIT || attempt >= NETWORK_RATE_LIMIT_RETRIES ||
+        job.type == JOB_PREFETCH_CARDS) {
+      return;
+    }
+  }
+}
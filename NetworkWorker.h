@@ -0,0 +1,121 @@
+#ifndef NETWORK_WORKER_H
+#define NETWORK_WORKER_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <vector>
+#include "config.h"
+#include "DataStructures.h"
+#include "TrelloClient.h"
+#include "SyncEngine.h"
+#include "WorkQueue.h"
+
+// Kinds of work the network task performs
+enum NetworkJobType {
+  JOB_FETCH_LIST,
+  JOB_SYNC_LIST,
+  JOB_LOAD_PAGE,
+  JOB_FETCH_CARD,
+  JOB_REFRESH_CARD,
+  JOB_REVALIDATE_CARD,  // Cached details on screen; text holds their validator
+  JOB_LOAD_CACHED_LIST,
+  JOB_PREFETCH_CARDS,
+  JOB_ADD_COMMENT,
+  JOB_CREATE_CARD,
+  JOB_SET_CHECK_ITEM,
+  JOB_CONNECT,
+  JOB_DISCONNECT
+};
+
+struct NetworkJob {
+  NetworkJobType type;
+  uint32_t id;
+  String cardId;
+  std::vector<String> cardIds;  // Cards to prefetch
+  String itemId;
+  String text;
+  String extra;
+  bool useCache;
+  bool complete;      // Target check item state
+  uint32_t tag;       // Caller's reference, echoed in the result
+  bool verify;        // A previous attempt may have landed; check before resending
+  uint32_t attemptedAt; // Trello's time when it was first sent, 0 if not known
+  uint32_t generation;  // Prefetch batch; stale batches are skipped
+  size_t listFirst;     // List indices to load
+  size_t listLast;
+  unsigned long queuedAt;
+  
+  NetworkJob(NetworkJobType _type = JOB_FETCH_LIST) 
+    : type(_type), id(0), useCache(false), complete(false), tag(0), 
+      verify(false), attemptedAt(0), generation(0), listFirst(0), listLast(0), queuedAt(0) {}
+};
+
+// Posted back to the UI loop when a job completes
+struct NetworkResult {
+  NetworkJobType type;
+  uint32_t jobId;
+  uint32_t tag;
+  ApiStatus status;
+  String cardId;
+  std::vector<String> cardIds;
+  std::vector<CardSummary> cards;
+  ListWindow window;      // Where cards sits in the whole list
+  FullCard card;
+  bool notModified;       // Revalidation found the cached card current; card is empty
+  std::vector<FullCard> details;            // Prefetched cards...
+  std::vector<unsigned long> detailBytes;   // ...and what each cost to download
+  SyncOutcome sync;
+  String error;           // TrelloClient::getLastError() when the job failed
+  unsigned long bytes;    // Response body bytes the job downloaded
+  unsigned long queuedAt;
+  unsigned long startedAt;
+  unsigned long finishedAt;
+  
+  NetworkResult() : type(JOB_FETCH_LIST), jobId(0), tag(0), status(API_ERROR_UNKNOWN),
+                    notModified(false), bytes(0), queuedAt(0), startedAt(0), finishedAt(0) {}
+};
+
+// Runs every TrelloClient call on a dedicated task so the UI loop never
+// waits on the network. Only the network task touches the client once
+// begin() has been called.
+class NetworkWorker {
+private:
+  TrelloClient* client;
+  SyncEngine syncEngine;
+  WorkQueue<NetworkJob> jobs;
+  WorkQueue<NetworkJob> prefetchJobs;   // Only run when jobs is empty
+  WorkQueue<NetworkResult> results;
+  std::atomic<uint32_t> prefetchGeneration;
+  WorkerThread thread;
+  uint32_t nextJobId;
+  
+  static void taskEntry(void* arg);
+  void run();
+  NetworkJob* nextJob();
+  void prefetchCards(const NetworkJob& job, NetworkResult& result);
+  void execute(const NetworkJob& job, NetworkResult& result);
+  bool alreadyApplied(const NetworkJob& job);
+  
+public:
+  NetworkWorker(TrelloClient* client);
+  
+  bool begin();
+  
+  // Queue a job; returns its id, or 0 if the queue is full
+  uint32_t submit(NetworkJobType type, const String& cardId = "", 
+                  const String& text = "", const String& extra = "", 
+                  bool useCache = false);
+  uint32_t submit(const NetworkJob& job);
+  
+  // Low priority: runs only while no other job is waiting, and is skipped
+  // if cancelPrefetch() is called before it starts
+  uint32_t prefetch(const std::vector<String>& cardIds);
+  void cancelPrefetch();
+  
+  // Non-blocking; the caller owns and deletes the result
+  NetworkResult* poll();
+  
+  size_t pendingJobs();
+};
+
+#endif // NETWORK_WORKER_H
@@ -0,0 +1,101 @@
+#include "PosixStorage.h"
+#include <dirent.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+class PosixStorageFile : public StorageFile {
+private:
+  FILE* file;
+
+protected:
+  size_t readRaw(uint8_t* data, size_t length) override {
+    return fread(data, 1, length, file);
+  }
+  size_t writeRaw(const uint8_t* data, size_t length) override {
+    return fwrite(data, 1, length, file);
+  }
+  bool flushRaw() override {
+    return fflush(file) == 0 && fsync(fileno(file)) == 0;
+  }
+  bool seekRaw(uint32_t position) override { return fseek(file, position, SEEK_SET) == 0; }
+  uint32_t positionRaw() override { return ftell(file); }
+  uint32_t sizeRaw() override {
+    struct stat info;
+    fflush(file);
+    return fstat(fileno(file), &info) == 0 ? info.st_size : 0;
+  }
+
+public:
+  PosixStorageFile(Storage& owner, FILE* opened) : StorageFile(owner), file(opened) {}
+  ~PosixStorageFile() override {
+    lockMedium();
+    fclose(file);
+    unlockMedium();
+  }
+};
+
+PosixStorage::PosixStorage(const std::string& root) : root(root), mounted(false) {
+}
+
+bool PosixStorage::begin() {
+  struct stat info;
+  mounted = stat(root.c_str(), &info) == 0 && S_ISDIR(info.st_mode);
+  return mounted;
+}
+
+// Paths are absolute within the storage, as on the SD card
+std::string PosixStorage::resolve(const char* path) const {
+  return root + (path[0] == '/' ? "" : "/") + path;
+}
+
+StorageFile* PosixStorage::openPath(const char* path, StorageMode mode) {
+  std::string fullPath = resolve(path);
+  FILE* file = nullptr;
+  switch (mode) {
+    case STORAGE_READ:
+      file = fopen(fullPath.c_str(), "rb");
+      break;
+    case STORAGE_WRITE:
+      file = fopen(fullPath.c_str(), "wb");
+      break;
+    case STORAGE_APPEND:
+      file = fopen(fullPath.c_str(), "ab");
+      break;
+    case STORAGE_UPDATE:
+      file = fopen(fullPath.c_str(), "r+b");
+      if (!file) {
+        file = fopen(fullPath.c_str(), "w+b");
+      }
+      break;
+  }
+  return file ? new PosixStorageFile(*this, file) : nullptr;
+}
+
+bool PosixStorage::existsPath(const char* path) {
+  struct stat info;
+  return stat(resolve(path).c_str(), &info) == 0;
+}
+
+bool PosixStorage::removePath(const char* path) {
+  return ::remove(resolve(path).c_str()) == 0;
+}
+
+bool PosixStorage::renamePath(const char* from, const char* to) {
+  return ::rename(resolve(from).c_str(), resolve(to).c_str()) == 0;
+}
+
+bool PosixStorage::listPath(const char* dir, std::vector<std::string>& names) {
+  DIR* handle = opendir(resolve(dir).c_str());
+  if (!handle) {
+    return false;
+  }
+  while (struct dirent* entry = readdir(handle)) {
+    std::string name = entry->d_name;
+    if (name != "." && name != "..") {
+      names.push_back(name);
+    }
+  }
+  closedir(handle);
+  return true;
+}
@@ -0,0 +1,32 @@
+#ifndef POSIX_STORAGE_H
+#define POSIX_STORAGE_H
+
+#include <string>
+#include "Storage.h"
+
+// Storage in a directory of a POSIX filesystem, so the modules built on
+// Storage can be exercised on a Linux host. On the device the same code
+// works on the SD card's VFS mount point ("/sd").
+class PosixStorage : public Storage {
+private:
+  std::string root;
+  bool mounted;
+
+  std::string resolve(const char* path) const;
+
+protected:
+  StorageFile* openPath(const char* path, StorageMode mode) override;
+  bool existsPath(const char* path) override;
+  bool removePath(const char* path) override;
+  bool renamePath(const char* from, const char* to) override;
+  bool listPath(const char* dir, std::vector<std::string>& names) override;
+
+public:
+  explicit PosixStorage(const std::string& root);
+
+  // Succeeds if root is an existing directory
+  bool begin() override;
+  bool isMounted() const override { return mounted; }
+};
+
+#endif // POSIX_STORAGE_H
@@ -0,0 +1,76 @@
+#include "RateLimiter.h"
+
+TokenBucket::TokenBucket(unsigned int capacity, unsigned long windowMs, 
+                         unsigned long (*clock)()) 
+  : capacity(capacity), tokens(capacity), refillPerMs((float)capacity / windowMs),
+    rateScale(1.0f), blockedUntil(0), backoffMs(API_RATE_LIMIT_DELAY_MS), 
+    clock(clock), granted(0), throttled(0), rateLimited(0) {
+  lastRefill = clock();
+  blockedUntil = lastRefill;
+}
+
+void TokenBucket::refill() {
+  unsigned long now = clock();
+  unsigned long elapsed = now - lastRefill;
+  lastRefill = now;
+  
+  tokens += elapsed * refillPerMs * rateScale;
+  if (tokens > capacity) {
+    tokens = capacity;
+  }
+}
+
+unsigned long TokenBucket::waitTimeMs() {
+  refill();
+  
+  unsigned long wait = 0;
+  long blocked = (long)(blockedUntil - lastRefill);
+  if (blocked > 0) {
+    wait = blocked;
+  }
+  
+  if (tokens < 1.0f) {
+    unsigned long refillWait = (unsigned long)((1.0f - tokens) / (refillPerMs * rateScale)) + 1;
+    wait = max(wait, refillWait);
+  }
+  return wait;
+}
+
+bool TokenBucket::tryAcquire() {
+  if (waitTimeMs() > 0) {
+    throttled++;
+    return false;
+  }
+  tokens -= 1.0f;
+  granted++;
+  return true;
+}
+
+void TokenBucket::onResponse(int httpCode, long serverRemaining) {
+  refill();
+  
+  if (httpCode == 429) {
+    // The server disagrees with our estimate: drain, back off, slow down
+    rateLimited++;
+    tokens = 0;
+    blockedUntil = lastRefill + backoffMs;
+    backoffMs = min(backoffMs * 2, (unsigned long)API_RATE_LIMIT_WINDOW_MS * 4);
+    rateScale = max(0.125f, rateScale * 0.5f);
+    return;
+  }
+  
+  if (httpCode > 0) {
+    backoffMs = API_RATE_LIMIT_DELAY_MS;
+    rateScale = min(1.0f, rateScale + 0.0625f);
+    
+    // Trello reports the tokens left in the current window
+    if (serverRemaining >= 0 && serverRemaining < tokens) {
+      tokens = serverRemaining;
+    }
+  }
+}
+
+float TokenBucket::getTokens() {
+  refill();
+  return tokens;
+}
@@ -0,0 +1,49 @@
+#ifndef RATE_LIMITER_H
+#define RATE_LIMITER_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Token bucket modeled on Trello's per-token window: a full bucket lets a
+// burst through at once, then tokens refill at capacity/window. A 429 empties
+// the bucket, blocks for a back-off period and slows the refill rate, which
+// recovers gradually as requests succeed again.
+class TokenBucket {
+private:
+  float capacity;
+  float tokens;
+  float refillPerMs;
+  float rateScale;
+  unsigned long lastRefill;
+  unsigned long blockedUntil;
+  unsigned long backoffMs;
+  unsigned long (*clock)();
+  
+  // Statistics
+  unsigned long granted;
+  unsigned long throttled;
+  unsigned long rateLimited;
+  
+  void refill();
+  
+public:
+  TokenBucket(unsigned int capacity = API_RATE_LIMIT_REQUESTS, 
+              unsigned long windowMs = API_RATE_LIMIT_WINDOW_MS,
+              unsigned long (*clock)() = millis);
+  
+  // Never blocks: returns false when the caller should queue and retry later
+  bool tryAcquire();
+  unsigned long waitTimeMs();
+  
+  // Feedback from the server
+  void onResponse(int httpCode, long serverRemaining = -1);
+  
+  // Statistics
+  float getTokens();
+  float getRateScale() const { return rateScale; }
+  unsigned long getGranted() const { return granted; }
+  unsigned long getThrottled() const { return throttled; }
+  unsigned long getRateLimited() const { return rateLimited; }
+};
+
+#endif // RATE_LIMITER_H
@@ -0,0 +1,135 @@
+#include "RequestMetrics.h"
+#include <algorithm>
+
+static const char* phaseNames[PHASE_COUNT] = {
+  "wifi", "dns", "tls", "ttfb", "body", "parse", "cache"
+};
+
+void RequestSample::clear() {
+  label[0] = '\0';
+  httpCode = 0;
+  bytes = 0;
+  recorded = 0;
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    phaseUs[i] = 0;
+  }
+}
+
+RequestMetrics::RequestMetrics() : next(0), stored(0), open(false), total(0) {
+}
+
+const char* RequestMetrics::phaseName(RequestPhase phase) {
+  return phase < PHASE_COUNT ? phaseNames[phase] : "?";
+}
+
+void RequestMetrics::begin(const String& method, const String& url) {
+  commit();
+  current.clear();
+
+  // Label with the path only; the query holds the key and token
+  int pathStart = url.indexOf("://");
+  pathStart = url.indexOf('/', pathStart < 0 ? 0 : pathStart + 3);
+  int queryStart = url.indexOf('?');
+  String path = pathStart < 0 ? String("/") :
+                url.substring(pathStart, queryStart < 0 ? url.length() : queryStart);
+  snprintf(current.label, sizeof(current.label), "%s %s", method.c_str(), path.c_str());
+  open = true;
+}
+
+void RequestMetrics::record(RequestPhase phase, uint32_t us) {
+  if (!open || phase >= PHASE_COUNT) {
+    return;
+  }
+  current.phaseUs[phase] += us;
+  current.recorded |= (1 << phase);
+}
+
+void RequestMetrics::setHttpCode(int httpCode) {
+  if (open) {
+    current.httpCode = httpCode;
+  }
+}
+
+void RequestMetrics::setBytes(size_t bytes) {
+  if (open) {
+    current.bytes = bytes;
+  }
+}
+
+void RequestMetrics::commit() {
+  if (!open) {
+    return;
+  }
+  samples[next] = current;
+  next = (next + 1) % METRICS_SAMPLE_COUNT;
+  if (stored < METRICS_SAMPLE_COUNT) {
+    stored++;
+  }
+  total++;
+  open = false;
+}
+
+void RequestMetrics::recordStandalone(const char* label, RequestPhase phase, uint32_t us) {
+  commit();
+  current.clear();
+  snprintf(current.label, sizeof(current.label), "%s", label);
+  open = true;
+  record(phase, us);
+  commit();
+}
+
+PhaseSummary RequestMetrics::summarize(RequestPhase phase) const {
+  PhaseSummary summary;
+  uint32_t values[METRICS_SAMPLE_COUNT];
+  for (size_t i = 0; i < stored; i++) {
+    if (samples[i].has(phase)) {
+      values[summary.count++] = samples[i].phaseUs[phase];
+    }
+  }
+  if (summary.count == 0) {
+    return summary;
+  }
+
+  // Nearest-rank percentiles over a few dozen values
+  std::sort(values, values + summary.count);
+  summary.minUs = values[0];
+  summary.p50Us = values[(summary.count * 50 + 99) / 100 - 1];
+  summary.p99Us = values[(summary.count * 99 + 99) / 100 - 1];
+  return summary;
+}
+
+const RequestSample* RequestMetrics::latest() const {
+  if (open) {
+    return &current;
+  }
+  if (stored == 0) {
+    return nullptr;
+  }
+  return &samples[(next + METRICS_SAMPLE_COUNT - 1) % METRICS_SAMPLE_COUNT];
+}
+
+String RequestMetrics::describe(const RequestSample& sample) const {
+  String text = sample.label;
+  if (sample.httpCode != 0) {
+    text += " -> " + String(sample.httpCode);
+  }
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    if (sample.has((RequestPhase)i)) {
+      text += String(", ") + phaseNames[i] + " " + String(sample.phaseUs[i] / 1000) + " ms";
+    }
+  }
+  return text;
+}
+
+void RequestMetrics::printSummary(Print& out) {
+  commit();
+  for (int i = 0; i < PHASE_COUNT; i++) {
+    PhaseSummary summary = summarize((RequestPhase)i);
+    if (summary.count == 0) {
+      continue;
+    }
+    out.printf("metrics phase=%s n=%u min_us=%lu p50_us=%lu p99_us=%lu\n",
+               phaseNames[i], (unsigned)summary.count, (unsigned long)summary.minUs,
+               (unsigned long)summary.p50Us, (unsigned long)summary.p99Us);
+  }
+}
@@ -0,0 +1,96 @@
+#ifndef REQUEST_METRICS_H
+#define REQUEST_METRICS_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Where the time of one request goes, in the order it is spent
+enum RequestPhase {
+  PHASE_WIFI,     // Joining the access point (its own sample, not per request)
+  PHASE_DNS,      // Resolving the API host
+  PHASE_TLS,      // TCP connect and TLS handshake, skipped on a reused socket
+  PHASE_TTFB,     // Sending the request until the response headers are in
+  PHASE_BODY,     // Waiting on the socket for body bytes
+  PHASE_PARSE,    // Reading the body: inflate and JSON parsing
+  PHASE_CACHE,    // Writing what was fetched to the SD card
+  PHASE_COUNT
+};
+
+struct RequestSample {
+  char label[METRICS_LABEL_LENGTH];   // Method and path, e.g. "GET /cards/5f2..."
+  int httpCode;
+  uint32_t bytes;                     // Body bytes as received
+  uint32_t phaseUs[PHASE_COUNT];
+  uint8_t recorded;                   // Bit per phase that was measured
+
+  RequestSample() { clear(); }
+  void clear();
+  bool has(RequestPhase phase) const { return recorded & (1 << phase); }
+};
+
+struct PhaseSummary {
+  size_t count;
+  uint32_t minUs;
+  uint32_t p50Us;
+  uint32_t p99Us;
+
+  PhaseSummary() : count(0), minUs(0), p50Us(0), p99Us(0) {}
+};
+
+// Keeps the last METRICS_SAMPLE_COUNT requests, each broken down by phase.
+// A sample stays open from begin() until the next begin() or commit(), so
+// parse and cache time spent after the response was released still count
+// towards the request that fetched the data.
+class RequestMetrics {
+private:
+  RequestSample samples[METRICS_SAMPLE_COUNT];
+  size_t next;          // Slot the next sample is written to
+  size_t stored;
+  RequestSample current;
+  bool open;
+  unsigned long total;  // Samples committed since boot
+
+public:
+  RequestMetrics();
+
+  void begin(const String& method, const String& url);
+  void record(RequestPhase phase, uint32_t us);
+  void setHttpCode(int httpCode);
+  void setBytes(size_t bytes);
+  void commit();
+
+  // A measurement that belongs to no request, such as joining WiFi
+  void recordStandalone(const char* label, RequestPhase phase, uint32_t us);
+
+  bool isOpen() const { return open; }
+  uint32_t currentUs(RequestPhase phase) const { return current.phaseUs[phase]; }
+
+  // Summaries over the samples that measured the phase
+  PhaseSummary summarize(RequestPhase phase) const;
+  size_t sampleCount() const { return stored; }
+  unsigned long totalSamples() const { return total; }
+
+  // The open request, or the last one committed
+  const RequestSample* latest() const;
+  String describe(const RequestSample& sample) const;
+
+  // One "metrics" line per phase: key=value pairs, times in microseconds
+  void printSummary(Print& out);
+
+  static const char* phaseName(RequestPhase phase);
+};
+
+// Charges the time until it goes out of scope to a phase of the open request
+class PhaseTimer {
+private:
+  RequestMetrics& metrics;
+  RequestPhase phase;
+  unsigned long startedAt;
+
+public:
+  PhaseTimer(RequestMetrics& metrics, RequestPhase phase)
+    : metrics(metrics), phase(phase), startedAt(micros()) {}
+  ~PhaseTimer() { metrics.record(phase, micros() - startedAt); }
+};
+
+#endif // REQUEST_METRICS_H
@@ -0,0 +1,85 @@
+#include "RetryPolicy.h"
+#include <HTTPClient.h>
+
+RetryPolicy::RetryPolicy(int maxRetries, unsigned long baseDelayMs, unsigned long maxDelayMs)
+  : maxRetries(maxRetries), baseDelayMs(baseDelayMs), maxDelayMs(maxDelayMs) {
+}
+
+bool RetryPolicy::isTransient(int httpCode) {
+  if (httpCode > 0) {
+    return httpCode == 408 || httpCode >= 500;
+  }
+  // Negative codes are HTTPClient transport errors
+  return httpCode < 0;
+}
+
+bool RetryPolicy::wasNotSent(int httpCode) {
+  return httpCode == HTTPC_ERROR_CONNECTION_REFUSED ||
+         httpCode == HTTPC_ERROR_SEND_HEADER_FAILED ||
+         httpCode == HTTPC_ERROR_NOT_CONNECTED;
+}
+
+unsigned long RetryPolicy::delayMs(int attempt) const {
+  unsigned long wait = baseDelayMs;
+  for (int i = 0; i < attempt && wait < maxDelayMs; i++) {
+    wait *= 2;
+  }
+  wait = min(wait, maxDelayMs);
+  return wait / 2 + random(wait / 2 + 1);
+}
+
+CircuitBreaker::CircuitBreaker(int failureThreshold, unsigned long openMs,
+                               unsigned long maxOpenMs, unsigned long (*clock)())
+  : state(BREAKER_CLOSED), consecutiveFailures(0), failureThreshold(failureThreshold),
+    openMs(openMs), baseOpenMs(openMs), maxOpenMs(maxOpenMs), openedAt(0),
+    clock(clock), trips(0), rejected(0) {
+}
+
+void CircuitBreaker::open() {
+  state = BREAKER_OPEN;
+  openedAt = clock();
+  trips++;
+  Serial.printf("Circuit breaker open for %lu ms\n", openMs);
+}
+
+bool CircuitBreaker::allowRequest() {
+  if (state == BREAKER_OPEN) {
+    if (clock() - openedAt < openMs) {
+      rejected++;
+      return false;
+    }
+    state = BREAKER_HALF_OPEN;
+  }
+  return true;
+}
+
+unsigned long CircuitBreaker::waitTimeMs() {
+  if (state != BREAKER_OPEN) {
+    return 0;
+  }
+  unsigned long elapsed = clock() - openedAt;
+  return elapsed < openMs ? openMs - elapsed : 0;
+}
+
+void CircuitBreaker::onSuccess() {
+  if (state != BREAKER_CLOSED) {
+    Serial.println("Circuit breaker closed");
+  }
+  state = BREAKER_CLOSED;
+  consecutiveFailures = 0;
+  openMs = baseOpenMs;
+}
+
+void CircuitBreaker::onFailure() {
+  if (state == BREAKER_HALF_OPEN) {
+    // Still down: wait longer before the next probe
+    openMs = min(openMs * 2, maxOpenMs);
+    open();
+    return;
+  }
+
+  consecutiveFailures++;
+  if (state == BREAKER_CLOSED && consecutiveFailures >= failureThreshold) {
+    open();
+  }
+}
@@ -0,0 +1,77 @@
+#ifndef RETRY_POLICY_H
+#define RETRY_POLICY_H
+
+#include <Arduino.h>
+#include "config.h"
+
+// Capped exponential back-off with jitter for transient request failures.
+// Retries are spread over [delay/2, delay] so clients knocked off by the
+// same outage do not all come back at once.
+class RetryPolicy {
+private:
+  int maxRetries;
+  unsigned long baseDelayMs;
+  unsigned long maxDelayMs;
+
+public:
+  RetryPolicy(int maxRetries = MAX_RETRIES, unsigned long baseDelayMs = RETRY_DELAY_MS,
+              unsigned long maxDelayMs = RETRY_MAX_DELAY_MS);
+
+  // Timeouts, dropped connections and 5xx responses; the server may answer
+  // the same request differently a moment later
+  static bool isTransient(int httpCode);
+
+  // The request never left the device, so even a POST can be resent
+  static bool wasNotSent(int httpCode);
+
+  bool shouldRetry(int attempt) const { return attempt < maxRetries; }
+  unsigned long delayMs(int attempt) const;
+};
+
+enum BreakerState {
+  BREAKER_CLOSED,     // Requests flow normally
+  BREAKER_OPEN,       // Failing fast until the cool-down ends
+  BREAKER_HALF_OPEN   // Cool-down over; one cheap probe decides
+};
+
+// Stops sending requests after CIRCUIT_FAILURE_THRESHOLD consecutive
+// transient failures, so an outage costs one timeout per cool-down rather
+// than one per request. Each failed probe doubles the cool-down.
+class CircuitBreaker {
+private:
+  BreakerState state;
+  int consecutiveFailures;
+  int failureThreshold;
+  unsigned long openMs;
+  unsigned long baseOpenMs;
+  unsigned long maxOpenMs;
+  unsigned long openedAt;
+  unsigned long (*clock)();
+
+  // Statistics
+  unsigned long trips;
+  unsigned long rejected;
+
+  void open();
+
+public:
+  CircuitBreaker(int failureThreshold = CIRCUIT_FAILURE_THRESHOLD,
+                 unsigned long openMs = CIRCUIT_OPEN_MS,
+                 unsigned long maxOpenMs = CIRCUIT_MAX_OPEN_MS,
+                 unsigned long (*clock)() = millis);
+
+  // False while open; moves to half-open once the cool-down has passed
+  bool allowRequest();
+  bool isProbing() const { return state == BREAKER_HALF_OPEN; }
+  unsigned long waitTimeMs();
+
+  void onSuccess();
+  void onFailure();
+
+  // Statistics
+  BreakerState getState() const { return state; }
+  unsigned long getTrips() const { return trips; }
+  unsigned long getRejected() const { return rejected; }
+};
+
+#endif // RETRY_POLICY_H
@@ -0,0 +1,103 @@
+#include "SdStorage.h"
+
+#if defined(ARDUINO)
+
+class SdStorageFile : public StorageFile {
+private:
+  File file;
+
+protected:
+  size_t readRaw(uint8_t* data, size_t length) override {
+    return file.read(data, length);
+  }
+  size_t writeRaw(const uint8_t* data, size_t length) override {
+    return file.write(data, length);
+  }
+  bool flushRaw() override {
+    file.flush();
+    return true;
+  }
+  bool seekRaw(uint32_t position) override { return file.seek(position); }
+  uint32_t positionRaw() override { return file.position(); }
+  uint32_t sizeRaw() override { return file.size(); }
+
+public:
+  SdStorageFile(Storage& owner, File opened) : StorageFile(owner), file(opened) {}
+  ~SdStorageFile() override {
+    lockMedium();
+    file.close();
+    unlockMedium();
+  }
+};
+
+SdStorage::SdStorage() : mounted(false) {
+}
+
+bool SdStorage::begin() {
+  if (!mounted) {
+    mounted = SD.begin();
+  }
+  return mounted;
+}
+
+StorageFile* SdStorage::openPath(const char* path, StorageMode mode) {
+  const char* sdMode = FILE_READ;
+  switch (mode) {
+    case STORAGE_READ:
+      sdMode = FILE_READ;
+      break;
+    case STORAGE_WRITE:
+      sdMode = FILE_WRITE;
+      break;
+    case STORAGE_APPEND:
+      sdMode = FILE_APPEND;
+      break;
+    case STORAGE_UPDATE:
+      // "r+" does not create the file
+      if (!SD.exists(path)) {
+        File created = SD.open(path, FILE_WRITE);
+        if (!created) {
+          return nullptr;
+        }
+        created.close();
+      }
+      sdMode = "r+";
+      break;
+  }
+
+  File file = SD.open(path, sdMode);
+  if (!file) {
+    return nullptr;
+  }
+  return new SdStorageFile(*this, file);
+}
+
+bool SdStorage::existsPath(const char* path) {
+  return SD.exists(path);
+}
+
+bool SdStorage::removePath(const char* path) {
+  return SD.remove(path);
+}
+
+bool SdStorage::renamePath(const char* from, const char* to) {
+  return SD.rename(from, to);
+}
+
+bool SdStorage::listPath(const char* dir, std::vector<std::string>& names) {
+  File root = SD.open(dir);
+  if (!root) {
+    return false;
+  }
+  for (File entry = root.openNextFile(); entry; entry = root.openNextFile()) {
+    // Older cores report the full path
+    const char* name = entry.name();
+    const char* slash = strrchr(name, '/');
+    names.push_back(slash ? slash + 1 : name);
+    entry.close();
+  }
+  root.close();
+  return true;
+}
+
+#endif // ARDUINO
@@ -0,0 +1,32 @@
+#ifndef SD_STORAGE_H
+#define SD_STORAGE_H
+
+#if defined(ARDUINO)
+
+#include <Arduino.h>
+#include <SD.h>
+#include "Storage.h"
+
+// Storage on the Cardputer's SD card, through the Arduino SD library
+class SdStorage : public Storage {
+private:
+  bool mounted;
+
+protected:
+  StorageFile* openPath(const char* path, StorageMode mode) override;
+  bool existsPath(const char* path) override;
+  bool removePath(const char* path) override;
+  bool renamePath(const char* from, const char* to) override;
+  bool listPath(const char* dir, std::vector<std::string>& names) override;
+
+public:
+  SdStorage();
+
+  // Mounts the card the first time; later calls are free
+  bool begin() override;
+  bool isMounted() const override { return mounted; }
+};
+
+#endif // ARDUINO
+
+#endif // SD_STORAGE_H
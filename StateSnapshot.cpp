@@ -0,0 +1,165 @@
+#include "StateSnapshot.h"
+#include "ByteIO.h"
+#include "CardCodec.h"
+#include "Crc32.h"
+
+StateSnapshot::StateSnapshot(Storage* storage) : storage(storage), savedCrc(0) {
+}
+
+void StateSnapshot::encode(const AppState& state, size_t pendingCards,
+                           std::vector<uint8_t>& out) {
+  // Offline cards sit at the top of the list, inside the window only when
+  // it starts there
+  size_t total = state.listTotal - min(pendingCards, state.listTotal);
+  size_t offset = state.listOffset > pendingCards ? state.listOffset - pendingCards : 0;
+
+  out.push_back(state.currentScreen);
+  putU32(out, state.selectedCardIndex);
+  putU32(out, state.currentPage);
+  putString(out, state.inputBuffer);
+  putU32(out, offset);
+  putU32(out, total);
+  out.push_back(state.listHasMore ? 1 : 0);
+
+  uint8_t contexts = min(state.navigationStack.size(), (size_t)0xFF);
+  out.push_back(contexts);
+  for (uint8_t i = 0; i < contexts; i++) {
+    const NavigationContext& context = state.navigationStack[i];
+    out.push_back(context.state);
+    putU32(out, context.selectedIndex);
+    putU32(out, context.currentPage);
+    putString(out, context.cardId);
+    putString(out, context.inputBuffer);
+  }
+
+  size_t countAt = out.size();
+  putU16(out, 0);
+  uint16_t cards = 0;
+  for (const auto& card : state.cardList) {
+    if (!card.id.isPending() && cards < 0xFFFF) {
+      CardCodec::encodeSummary(card, out);
+      cards++;
+    }
+  }
+  out[countAt] = cards & 0xFF;
+  out[countAt + 1] = cards >> 8;
+
+  const FullCard& card = state.currentCard;
+  bool hasCard = !card.summary.id.isEmpty() && !card.summary.id.isPending();
+  out.push_back(hasCard ? 1 : 0);
+  if (hasCard) {
+    putCardId(out, card.summary.id);
+    CardCodec::encode(card, out);
+  }
+}
+
+bool StateSnapshot::decode(const std::vector<uint8_t>& in, uint8_t codecVersion,
+                           AppState& state) {
+  size_t pos = HEADER_SIZE;
+  uint8_t screen, hasMore, contexts;
+  uint32_t selected, page, offset, total;
+  if (!getU8(in, pos, screen) || !getU32(in, pos, selected) || !getU32(in, pos, page) ||
+      !getString(in, pos, state.inputBuffer) || !getU32(in, pos, offset) ||
+      !getU32(in, pos, total) || !getU8(in, pos, hasMore) || !getU8(in, pos, contexts)) {
+    return false;
+  }
+  if (screen > ERROR_SCREEN) {
+    return false;
+  }
+  state.currentScreen = (ScreenState)screen;
+  state.selectedCardIndex = selected;
+  state.currentPage = page;
+  state.listOffset = offset;
+  state.listTotal = total;
+  state.listHasMore = hasMore != 0;
+
+  state.navigationStack.resize(contexts);
+  for (uint8_t i = 0; i < contexts; i++) {
+    NavigationContext& context = state.navigationStack[i];
+    uint8_t contextState;
+    uint32_t contextSelected, contextPage;
+    if (!getU8(in, pos, contextState) || contextState > ERROR_SCREEN ||
+        !getU32(in, pos, contextSelected) || !getU32(in, pos, contextPage) ||
+        !getString(in, pos, context.cardId) || !getString(in, pos, context.inputBuffer)) {
+      return false;
+    }
+    context.state = (ScreenState)contextState;
+    context.selectedIndex = contextSelected;
+    context.currentPage = contextPage;
+  }
+
+  uint16_t cards;
+  if (!getU16(in, pos, cards)) {
+    return false;
+  }
+  state.cardList.resize(cards);
+  for (uint16_t i = 0; i < cards; i++) {
+    if (!CardCodec::decodeSummary(in, pos, codecVersion, state.cardList[i])) {
+      return false;
+    }
+  }
+
+  uint8_t hasCard;
+  if (!getU8(in, pos, hasCard)) {
+    return false;
+  }
+  state.currentCard = FullCard();
+  if (hasCard) {
+    if (!getCardId(in, pos, state.currentCard.summary.id) ||
+        !CardCodec::decode(in, pos, codecVersion, state.currentCard)) {
+      return false;
+    }
+  } else if (pos != in.size()) {
+    return false;
+  }
+  return state.listTotal >= state.listOffset + state.cardList.size();
+}
+
+bool StateSnapshot::save(const AppState& state, size_t pendingCards) {
+  std::vector<uint8_t> data(HEADER_SIZE);
+  encode(state, pendingCards, data);
+  uint32_t crc = crc32Update(0, data.data() + HEADER_SIZE, data.size() - HEADER_SIZE);
+  if (crc == savedCrc) {
+    return false;
+  }
+
+  data[0] = MAGIC;
+  data[1] = VERSION;
+  data[2] = CardCodec::VERSION;
+  putU32(&data[3], crc);
+  storage->writeBehind(SNAPSHOT_FILE, data);
+  savedCrc = crc;
+  return true;
+}
+
+bool StateSnapshot::restore(AppState& state) {
+  std::vector<uint8_t> data;
+  if (!storage->readFile(SNAPSHOT_FILE, data)) {
+    return false;
+  }
+
+  // A snapshot from another build or a damaged one is just not used
+  if (data.size() < HEADER_SIZE || data[0] != MAGIC || data[1] != VERSION) {
+    Serial.println("Snapshot: unknown format, ignoring it");
+    return false;
+  }
+  uint32_t crc = getU32(&data[3]);
+  if (crc32Update(0, data.data() + HEADER_SIZE, data.size() - HEADER_SIZE) != crc) {
+    Serial.println("Snapshot: checksum mismatch, ignoring it");
+    return false;
+  }
+
+  AppState restored;
+  if (!decode(data, data[2], restored)) {
+    Serial.println("Snapshot: unreadable, ignoring it");
+    return false;
+  }
+
+  restored.isOnline = state.isOnline;
+  restored.listStale = restored.listTotal > 0;
+  restored.cardStale = !restored.currentCard.summary.id.isEmpty();
+  restored.needsRefresh = true;
+  state = restored;
+  savedCrc = crc;
+  return true;
+}
@@ -0,0 +1,45 @@
+#ifndef STATE_SNAPSHOT_H
+#define STATE_SNAPSHOT_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+#include "DataStructures.h"
+#include "Storage.h"
+
+// What the UI was showing, saved so a reboot or wake can draw the last
+// screen straight away and reconcile with Trello afterwards. Holds the
+// loaded part of the list, the back stack, the open card and the
+// selection, in one file replaced atomically through Storage.
+//
+// Layout: MAGIC, VERSION, the CardCodec version, a CRC-32 of the rest,
+// then the screen and list position, the back stack, the list window and
+// the open card last, since CardCodec::decode() reads to the end.
+//
+// Cards created offline are left out; MutationLog still has them and the
+// sketch adds them back as it does after a sync.
+class StateSnapshot {
+private:
+  Storage* storage;
+  uint32_t savedCrc;    // Of the last snapshot written or read
+
+  static void encode(const AppState& state, size_t pendingCards, std::vector<uint8_t>& out);
+  static bool decode(const std::vector<uint8_t>& in, uint8_t codecVersion, AppState& state);
+
+public:
+  static const uint8_t MAGIC = 'S';
+  static const uint8_t VERSION = 2;
+  static const size_t HEADER_SIZE = 7;
+
+  StateSnapshot(Storage* storage);
+
+  // Queues the state to be written behind, unless it has not changed since
+  // the last save; pendingCards is how many offline cards the list holds
+  bool save(const AppState& state, size_t pendingCards);
+
+  // Fills in the list, back stack, open card and selection. Everything
+  // restored is marked stale. False if there is no usable snapshot.
+  bool restore(AppState& state);
+};
+
+#endif // STATE_SNAPSHOT_H
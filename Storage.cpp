@@ -0,0 +1,320 @@
+#include "Storage.h"
+#include <stdio.h>
+#include "config.h"
+
+#if defined(ARDUINO)
+static unsigned long nowUs() {
+  return micros();
+}
+#else
+#include <chrono>
+
+static unsigned long nowUs() {
+  using namespace std::chrono;
+  return duration_cast<microseconds>(steady_clock::now().time_since_epoch()).count();
+}
+#endif
+
+void StorageFile::lockMedium() {
+  owner.acquire();
+}
+
+void StorageFile::unlockMedium() {
+  owner.release();
+}
+
+size_t StorageFile::read(uint8_t* data, size_t length) {
+  owner.acquire();
+  unsigned long startedAt = nowUs();
+  size_t done = readRaw(data, length);
+  owner.stats.reads++;
+  owner.stats.bytesRead += done;
+  owner.stats.readUs += nowUs() - startedAt;
+  owner.release();
+  return done;
+}
+
+size_t StorageFile::write(const uint8_t* data, size_t length) {
+  owner.acquire();
+  unsigned long startedAt = nowUs();
+  size_t done = writeRaw(data, length);
+  owner.stats.writes++;
+  owner.stats.bytesWritten += done;
+  owner.stats.writeUs += nowUs() - startedAt;
+  owner.release();
+  return done;
+}
+
+bool StorageFile::flush() {
+  owner.acquire();
+  unsigned long startedAt = nowUs();
+  bool ok = flushRaw();
+  unsigned long elapsed = nowUs() - startedAt;
+  owner.stats.flushes++;
+  owner.stats.flushUs += elapsed;
+  if (elapsed > owner.stats.maxFlushUs) {
+    owner.stats.maxFlushUs = elapsed;
+  }
+  owner.release();
+  return ok;
+}
+
+bool StorageFile::seek(uint32_t position) {
+  owner.acquire();
+  bool ok = seekRaw(position);
+  owner.release();
+  return ok;
+}
+
+uint32_t StorageFile::position() {
+  owner.acquire();
+  uint32_t at = positionRaw();
+  owner.release();
+  return at;
+}
+
+uint32_t StorageFile::size() {
+  owner.acquire();
+  uint32_t bytes = sizeRaw();
+  owner.release();
+  return bytes;
+}
+
+Storage::Storage() : pendingBytes(0) {
+#if defined(ARDUINO)
+  lock = xSemaphoreCreateRecursiveMutex();
+#endif
+}
+
+Storage::~Storage() {
+#if defined(ARDUINO)
+  if (lock) {
+    vSemaphoreDelete(lock);
+  }
+#endif
+}
+
+void Storage::acquire() {
+#if defined(ARDUINO)
+  xSemaphoreTakeRecursive(lock, portMAX_DELAY);
+#else
+  lock.lock();
+#endif
+}
+
+void Storage::release() {
+#if defined(ARDUINO)
+  xSemaphoreGiveRecursive(lock);
+#else
+  lock.unlock();
+#endif
+}
+
+// Removes the queued write to path, handing its data over if asked
+bool Storage::takePending(const char* path, std::vector<uint8_t>* data) {
+  acquire();
+  bool found = false;
+  for (size_t i = 0; i < pending.size(); i++) {
+    if (pending[i].path == path) {
+      pendingBytes -= pending[i].data.size();
+      if (data) {
+        data->swap(pending[i].data);
+      }
+      pending.erase(pending.begin() + i);
+      found = true;
+      break;
+    }
+  }
+  release();
+  return found;
+}
+
+StorageFile* Storage::open(const char* path, StorageMode mode) {
+  acquire();
+  std::vector<uint8_t> queued;
+  if (takePending(path, &queued)) {
+    writeFile(path, queued.data(), queued.size());
+  }
+  StorageFile* file = isMounted() ? openPath(path, mode) : nullptr;
+  release();
+  return file;
+}
+
+bool Storage::exists(const char* path) {
+  acquire();
+  bool found = false;
+  for (const auto& write : pending) {
+    found = found || write.path == path;
+  }
+  found = found || (isMounted() && existsPath(path));
+  release();
+  return found;
+}
+
+bool Storage::remove(const char* path) {
+  acquire();
+  takePending(path, nullptr);
+  bool ok = isMounted() && (removePath(path) || !existsPath(path));
+  release();
+  return ok;
+}
+
+bool Storage::rename(const char* from, const char* to) {
+  acquire();
+  bool ok = isMounted() && renamePath(from, to);
+  release();
+  return ok;
+}
+
+bool Storage::list(const char* dir, std::vector<std::string>& names) {
+  names.clear();
+  acquire();
+  bool ok = isMounted() && listPath(dir, names);
+  release();
+  return ok;
+}
+
+// writeFile() leaves "<path>.tmp" complete before it removes the old file,
+// so a lone temp file is the new copy and one next to the old copy is torn
+void Storage::recover(const char* path) {
+  acquire();
+  std::string tempFile = std::string(path) + ".tmp";
+  if (isMounted() && existsPath(tempFile.c_str())) {
+    if (existsPath(path)) {
+      removePath(tempFile.c_str());
+    } else {
+      renamePath(tempFile.c_str(), path);
+    }
+  }
+  release();
+}
+
+bool Storage::readFile(const char* path, std::vector<uint8_t>& data) {
+  acquire();
+  bool queued = false;
+  for (const auto& write : pending) {
+    if (write.path == path) {
+      data = write.data;
+      queued = true;
+    }
+  }
+  if (queued) {
+    release();
+    return true;
+  }
+
+  recover(path);
+  StorageFile* file = isMounted() ? openPath(path, STORAGE_READ) : nullptr;
+  bool ok = file != nullptr;
+  if (file) {
+    data.resize(file->size());
+    ok = file->read(data.data(), data.size()) == data.size();
+    delete file;
+  }
+  release();
+  return ok;
+}
+
+bool Storage::writeFile(const char* path, const uint8_t* data, size_t length) {
+  acquire();
+  bool ok = replaceFile(path, data, length);
+  release();
+  return ok;
+}
+
+// writeFile() without the lock, which the caller holds
+bool Storage::replaceFile(const char* path, const uint8_t* data, size_t length) {
+  if (!isMounted()) {
+    return false;
+  }
+  std::string tempFile = std::string(path) + ".tmp";
+  StorageFile* file = openPath(tempFile.c_str(), STORAGE_WRITE);
+  if (!file) {
+    return false;
+  }
+  bool ok = file->write(data, length) == length && file->flush();
+  delete file;
+  if (!ok) {
+    removePath(tempFile.c_str());
+    return false;
+  }
+
+  // recover() completes this sequence if power fails between the two steps
+  if (existsPath(path)) {
+    removePath(path);
+  }
+  ok = renamePath(tempFile.c_str(), path);
+  if (ok) {
+    stats.replaces++;
+  }
+  return ok;
+}
+
+// Only ever queues: this is called from the UI loop, which must not stall
+// on the card, so a full queue is left to the network task to write
+void Storage::writeBehind(const char* path, std::vector<uint8_t>& data) {
+  acquire();
+  // Moved to the back so files are written in the order they were last
+  // changed; the sync mark must never land before the list it belongs to
+  if (takePending(path, nullptr)) {
+    stats.coalesced++;
+  }
+  pending.push_back(PendingWrite());
+  pending.back().path = path;
+  pending.back().data.swap(data);
+  pendingBytes += pending.back().data.size();
+  stats.deferred++;
+  release();
+}
+
+// The lock is held for one file at a time, so a task reading or queueing
+// in between waits for a single write rather than the whole queue
+bool Storage::flush() {
+  bool ok = true;
+  while (true) {
+    acquire();
+    if (pending.empty()) {
+      release();
+      return ok;
+    }
+    PendingWrite write;
+    write.path.swap(pending.front().path);
+    write.data.swap(pending.front().data);
+    pendingBytes -= write.data.size();
+    pending.erase(pending.begin());
+    ok = replaceFile(write.path.c_str(), write.data.data(), write.data.size()) && ok;
+    release();
+  }
+}
+
+bool Storage::hasPending() {
+  acquire();
+  bool any = !pending.empty();
+  release();
+  return any;
+}
+
+bool Storage::flushDue() {
+  acquire();
+  bool due = pendingBytes > STORAGE_WRITE_BEHIND_BYTES;
+  release();
+  return due;
+}
+
+void Storage::printStats() {
+  acquire();
+  unsigned long averageFlushUs = stats.flushes > 0 ? (unsigned long)(stats.flushUs / stats.flushes) : 0;
+  char line[256];
+  snprintf(line, sizeof(line),
+           "Storage: %lu reads (%llu bytes, %llu us), %lu writes (%llu bytes, %llu us), "
+           "%lu flushes (avg %lu us, max %lu us), %lu replaces, %lu deferred, %lu coalesced\n",
+           stats.reads, stats.bytesRead, stats.readUs, stats.writes, stats.bytesWritten,
+           stats.writeUs, stats.flushes, averageFlushUs, stats.maxFlushUs, stats.replaces,
+           stats.deferred, stats.coalesced);
+  release();
+#if defined(ARDUINO)
+  Serial.print(line);
+#else
+  fputs(line, stdout);
+#endif
+}
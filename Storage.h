@@ -0,0 +1,156 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <mutex>
+#endif
+
+// I/O counters for everything that goes through a Storage
+struct StorageStats {
+  unsigned long reads;
+  unsigned long long bytesRead;
+  unsigned long long readUs;
+  unsigned long writes;
+  unsigned long long bytesWritten;
+  unsigned long long writeUs;
+  unsigned long flushes;
+  unsigned long long flushUs;
+  unsigned long maxFlushUs;         // Slowest single flush, usually a FAT update
+  unsigned long replaces;           // Atomic whole-file writes
+  unsigned long deferred;           // Writes queued behind
+  unsigned long coalesced;          // ...that a later write to the same file replaced
+
+  StorageStats() : reads(0), bytesRead(0), readUs(0), writes(0), bytesWritten(0),
+                   writeUs(0), flushes(0), flushUs(0), maxFlushUs(0), replaces(0),
+                   deferred(0), coalesced(0) {}
+};
+
+enum StorageMode {
+  STORAGE_READ,
+  STORAGE_WRITE,      // Truncates
+  STORAGE_APPEND,
+  STORAGE_UPDATE      // Read and write anywhere; created if missing
+};
+
+class Storage;
+
+// An open file. Deleting it closes it. Every call holds the storage's
+// lock, so the UI and network tasks can each have files open.
+class StorageFile {
+private:
+  Storage& owner;
+
+protected:
+  virtual size_t readRaw(uint8_t* data, size_t length) = 0;
+  virtual size_t writeRaw(const uint8_t* data, size_t length) = 0;
+  virtual bool flushRaw() = 0;
+  virtual bool seekRaw(uint32_t position) = 0;
+  virtual uint32_t positionRaw() = 0;
+  virtual uint32_t sizeRaw() = 0;
+
+  // For closing the file in a subclass destructor
+  void lockMedium();
+  void unlockMedium();
+
+public:
+  explicit StorageFile(Storage& owner) : owner(owner) {}
+  virtual ~StorageFile() {}
+
+  size_t read(uint8_t* data, size_t length);
+  size_t write(const uint8_t* data, size_t length);
+  // Pushes buffered writes to the medium
+  bool flush();
+
+  bool seek(uint32_t position);
+  uint32_t position();
+  uint32_t size();
+};
+
+// Files on the SD card, or a directory on the host. The medium is mounted
+// once by begin() and stays mounted; every other module goes through this
+// instead of calling the SD library.
+//
+// Small files that are rewritten whole (the list cache, the sync mark) are
+// replaced atomically: written to "<path>.tmp" and renamed over the old
+// copy, so a brownout leaves either the old or the new file. writeBehind()
+// queues such writes in RAM so the caller does not wait on the card; the
+// network task flushes them when it has nothing else to do, or between
+// jobs once flushDue() says too much is queued.
+//
+// One lock covers the queue, the counters and every access to the medium,
+// and the task holding it may take it again.
+class Storage {
+  friend class StorageFile;
+
+private:
+  struct PendingWrite {
+    std::string path;
+    std::vector<uint8_t> data;
+  };
+
+  std::vector<PendingWrite> pending;   // Oldest first
+  size_t pendingBytes;
+#if defined(ARDUINO)
+  SemaphoreHandle_t lock;
+#else
+  std::recursive_mutex lock;
+#endif
+
+  void acquire();
+  void release();
+  bool takePending(const char* path, std::vector<uint8_t>* data);
+  bool replaceFile(const char* path, const uint8_t* data, size_t length);
+
+protected:
+  StorageStats stats;
+
+  virtual StorageFile* openPath(const char* path, StorageMode mode) = 0;
+  virtual bool existsPath(const char* path) = 0;
+  virtual bool removePath(const char* path) = 0;
+  virtual bool renamePath(const char* from, const char* to) = 0;
+  virtual bool listPath(const char* dir, std::vector<std::string>& names) = 0;
+
+public:
+  Storage();
+  virtual ~Storage();
+
+  virtual bool begin() = 0;
+  virtual bool isMounted() const = 0;
+
+  // nullptr if the file cannot be opened; delete the result to close it.
+  // Queued writes to the path are completed first.
+  StorageFile* open(const char* path, StorageMode mode);
+  bool exists(const char* path);
+  // Also drops any queued write to the path
+  bool remove(const char* path);
+  bool rename(const char* from, const char* to);
+  // Names of the files in a directory, without the directory
+  bool list(const char* dir, std::vector<std::string>& names);
+
+  // Finishes or rolls back a replace that a power loss interrupted
+  void recover(const char* path);
+
+  // Whole-file helpers; readFile() sees writes still queued behind
+  bool readFile(const char* path, std::vector<uint8_t>& data);
+  bool writeFile(const char* path, const uint8_t* data, size_t length);
+  // Takes data; a later write to the same path replaces this one. Never
+  // writes to the medium itself, whatever is queued.
+  void writeBehind(const char* path, std::vector<uint8_t>& data);
+  // Writes everything queued, oldest first; false if any write failed
+  bool flush();
+  bool hasPending();
+  // More than STORAGE_WRITE_BEHIND_BYTES is queued
+  bool flushDue();
+
+  const StorageStats& getStats() const { return stats; }
+  void printStats();
+};
+
+#endif // STORAGE_H
@@ -0,0 +1,126 @@
+#include "StringPool.h"
+#include <string.h>
+
+StringPool::StringPool()
+  : chunkUsed(STRING_POOL_CHUNK_BYTES), count(0), bytes(0), lookups(0), hits(0),
+    inPsram(psramFound()) {
+#if defined(ARDUINO)
+  lock = xSemaphoreCreateMutex();
+#endif
+  slots.assign(256, nullptr);
+}
+
+StringPool& StringPool::names() {
+  static StringPool pool;
+  return pool;
+}
+
+// FNV-1a
+uint32_t StringPool::hash(const char* text, size_t length) {
+  uint32_t value = 2166136261UL;
+  for (size_t i = 0; i < length; i++) {
+    value = (value ^ (uint8_t)text[i]) * 16777619UL;
+  }
+  return value;
+}
+
+// Strings too long to share a chunk get a block of their own, so a chunk
+// never wastes more than the tail a string did not fit in
+char* StringPool::allocate(size_t length) {
+  if (length > STRING_POOL_CHUNK_BYTES / 4) {
+    char* block = (char*)(inPsram ? ps_malloc(length) : malloc(length));
+    if (block) {
+      chunks.insert(chunks.end() - (chunks.empty() ? 0 : 1), block);
+    }
+    return block;
+  }
+
+  if (chunkUsed + length > STRING_POOL_CHUNK_BYTES) {
+    char* chunk = (char*)(inPsram ? ps_malloc(STRING_POOL_CHUNK_BYTES)
+                                  : malloc(STRING_POOL_CHUNK_BYTES));
+    if (!chunk) {
+      return nullptr;
+    }
+    chunks.push_back(chunk);
+    chunkUsed = 0;
+  }
+  char* at = chunks.back() + chunkUsed;
+  chunkUsed += length;
+  return at;
+}
+
+// Kept at most half full so probes stay short
+void StringPool::grow() {
+  std::vector<const char*> old(slots.size() * 2, nullptr);
+  old.swap(slots);
+  size_t mask = slots.size() - 1;
+  for (const char* text : old) {
+    if (!text) {
+      continue;
+    }
+    size_t slot = hash(text, strlen(text)) & mask;
+    while (slots[slot]) {
+      slot = (slot + 1) & mask;
+    }
+    slots[slot] = text;
+  }
+}
+
+const char* StringPool::intern(const char* text) {
+  if (!text || !text[0]) {
+    return "";
+  }
+
+  size_t length = strlen(text);
+  uint32_t textHash = hash(text, length);
+  const char* result = nullptr;
+
+#if defined(ARDUINO)
+  xSemaphoreTake(lock, portMAX_DELAY);
+#else
+  lock.lock();
+#endif
+  lookups++;
+  size_t mask = slots.size() - 1;
+  size_t slot = textHash & mask;
+  while (slots[slot]) {
+    if (strcmp(slots[slot], text) == 0) {
+      result = slots[slot];
+      hits++;
+      break;
+    }
+    slot = (slot + 1) & mask;
+  }
+
+  if (!result) {
+    char* copy = allocate(length + 1);
+    if (copy) {
+      memcpy(copy, text, length + 1);
+      slots[slot] = copy;
+      count++;
+      bytes += length + 1;
+      if (count * 2 > slots.size()) {
+        grow();
+      }
+      result = copy;
+    }
+  }
+#if defined(ARDUINO)
+  xSemaphoreGive(lock);
+#else
+  lock.unlock();
+#endif
+
+  if (!result) {
+    Serial.println("String pool: out of memory");
+    return "";
+  }
+  return result;
+}
+
+void StringPool::printStats(const char* name) {
+  Serial.printf("String pool %s: %u strings, %u bytes in %u chunks (%s), "
+                "%lu lookups, %lu reused\n",
+                name, (unsigned)count, (unsigned)bytes, (unsigned)chunks.size(),
+                inPsram ? "PSRAM" : "heap", lookups, hits);
+}
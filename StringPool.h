@@ -0,0 +1,56 @@
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+
+#if !defined(ARDUINO)
+#include <mutex>
+#endif
+
+// Interned, immutable strings packed back to back in large chunks (in
+// PSRAM when there is some), for text that many structs share and copy
+// around, like card names. Each distinct string is stored once and its
+// pointer stays valid for the life of the program, so copying a struct
+// that holds one costs nothing and needs no allocation.
+//
+// Nothing is ever freed: the pool only grows by names it has not seen,
+// which after the first full list load means renames and new cards.
+// intern() may be called from any task.
+class StringPool {
+private:
+  std::vector<char*> chunks;
+  size_t chunkUsed;                  // Bytes taken in the newest chunk
+  std::vector<const char*> slots;    // Open-addressed hash set of the strings
+  size_t count;
+  size_t bytes;
+  unsigned long lookups;
+  unsigned long hits;
+  bool inPsram;
+#if defined(ARDUINO)
+  SemaphoreHandle_t lock;
+#else
+  std::mutex lock;
+#endif
+
+  char* allocate(size_t length);
+  void grow();
+  static uint32_t hash(const char* text, size_t length);
+
+public:
+  StringPool();
+
+  // The pool card names are kept in
+  static StringPool& names();
+
+  // The pooled copy of text; "" for empty text
+  const char* intern(const char* text);
+  const char* intern(const String& text) { return intern(text.c_str()); }
+
+  size_t size() const { return count; }
+  size_t bytesUsed() const { return bytes; }
+  void printStats(const char* name);
+};
+
+#endif // STRING_POOL_H
@@ -0,0 +1,367 @@
+#include "SyncEngine.h"
+#include <algorithm>
+#include "StringPool.h"
+
+static void addUnique(std::vector<String>& ids, const String& id) {
+  if (std::find(ids.begin(), ids.end(), id) == ids.end()) {
+    ids.push_back(id);
+  }
+}
+
+SyncEngine::SyncEngine(TrelloClient* client)
+  : client(client), focusChunk(0), markLoaded(false) {
+}
+
+void SyncEngine::loadMark() {
+  markLoaded = true;
+  highWaterMark = "";
+
+  std::vector<uint8_t> data;
+  if (!client->getStorage()->readFile(SYNC_STATE_FILE, data)) {
+    return;
+  }
+  for (uint8_t c : data) {
+    if (c == '\n') {
+      break;
+    }
+    highWaterMark += (char)c;
+  }
+  highWaterMark.trim();
+}
+
+// Queued behind the list cache commitMark() just wrote, so the two reach
+// the card in that order
+void SyncEngine::saveMark(const String& actionId) {
+  highWaterMark = actionId;
+  Storage* storage = client->getStorage();
+  if (actionId.length() == 0) {
+    storage->remove(SYNC_STATE_FILE);
+    return;
+  }
+
+  String line = actionId + "\n";
+  std::vector<uint8_t> data(line.c_str(), line.c_str() + line.length());
+  storage->writeBehind(SYNC_STATE_FILE, data);
+}
+
+// The list cache holds the first chunk; the mark is only stored while that
+// chunk is resident and was written out with it, otherwise a reboot would
+// pair the mark with an older list
+void SyncEngine::commitMark(const String& actionId) {
+  const std::vector<CardSummary>* top = pager.chunkCards(0);
+  if (top && client->saveCardListCache(*top)) {
+    saveMark(actionId);
+  } else {
+    highWaterMark = actionId;
+    client->getStorage()->remove(SYNC_STATE_FILE);
+  }
+}
+
+void SyncEngine::reset() {
+  highWaterMark = "";
+  client->getStorage()->remove(SYNC_STATE_FILE);
+}
+
+// Refetched chunks ask for a few extra cards so that cards added inside
+// their range since the last fetch do not push the range's tail out
+ApiStatus SyncEngine::fetchChunk(size_t chunk) {
+  int limit = LIST_CHUNK_SIZE;
+  if (chunk + 1 < pager.chunkCount()) {
+    limit = max(limit, (int)pager.chunkSize(chunk) + CARDS_PER_PAGE);
+  }
+
+  std::vector<CardSummary> fresh;
+  ApiStatus status = client->fetchCardPage(pager.cursorFor(chunk), limit, fresh, chunk == 0);
+  if (status != API_SUCCESS) {
+    return status;
+  }
+  bool shortResponse = (int)fresh.size() < limit;
+  pager.store(chunk, fresh, shortResponse);
+  stats.chunkFetches++;
+  return API_SUCCESS;
+}
+
+void SyncEngine::markChanged(SyncOutcome& outcome, const String& cardId) {
+  addUnique(outcome.changedCards, cardId);
+}
+
+// Patches the local copy from one action. Cards whose summary cannot be
+// rebuilt from the action alone (new arrivals, checklist badges, labels)
+// are added to refetch. Returns false if the action was ignored.
+bool SyncEngine::applyAction(const BoardAction& action, std::vector<String>& refetch,
+                             SyncOutcome& outcome) {
+  const String& cardId = action.cardId;
+  if (cardId.length() == 0) {
+    return false;
+  }
+
+  // Cards in evicted chunks are unknown here; they are reread with their chunk
+  CardId id = CardId::fromString(cardId);
+  bool known = pager.find(id) != nullptr;
+  bool inOurList = action.listId == TRELLO_LIST_ID;
+  const String& type = action.type;
+
+  if (type == "createCard" || type == "copyCard" ||
+      type == "convertToCardFromCheckItem" || type == "moveCardToBoard") {
+    if (!inOurList) {
+      return false;
+    }
+    addUnique(refetch, cardId);
+    return true;
+  }
+
+  if (type == "deleteCard" || type == "moveCardFromBoard") {
+    if (!known) {
+      return false;
+    }
+    pager.remove(id);
+    client->invalidateCardCache(cardId);
+    markChanged(outcome, cardId);
+    return true;
+  }
+
+  if (type == "updateCard") {
+    // Moved between lists, archived or restored
+    if (action.changed & (CHANGED_LIST | CHANGED_CLOSED)) {
+      if (inOurList && !action.closed) {
+        if (!known) {
+          addUnique(refetch, cardId);
+        }
+      } else if (known) {
+        pager.remove(id);
+        markChanged(outcome, cardId);
+        return true;
+      }
+    }
+
+    CardSummary* card = pager.find(id);
+    if (card) {
+      if (action.changed & CHANGED_NAME) {
+        card->name = StringPool::names().intern(action.cardName);
+      }
+      if (action.changed & CHANGED_DUE) {
+        card->hasDueDate = action.hasDueDate;
+      }
+    } else if (!inOurList) {
+      return false;
+    }
+    if (action.changed & (CHANGED_NAME | CHANGED_DUE | CHANGED_DETAILS)) {
+      client->invalidateCardCache(cardId);
+      markChanged(outcome, cardId);
+    }
+    return true;
+  }
+
+  if (!known) {
+    // May sit in an evicted chunk, with its details still cached on SD
+    if (!inOurList) {
+      return false;
+    }
+    client->invalidateCardCache(cardId);
+    markChanged(outcome, cardId);
+    return true;
+  }
+
+  if (type == "updateCheckItemStateOnCard") {
+    // The detail cache can be patched directly; the list badge needs the
+    // other items' states, so the summary is reread
+    if (!client->patchCachedCheckItem(cardId, action.checkItemId, action.checkItemComplete)) {
+      client->invalidateCardCache(cardId);
+    }
+    addUnique(refetch, cardId);
+    markChanged(outcome, cardId);
+    return true;
+  }
+
+  // Comments only appear in details; checklist and label changes also
+  // affect the summary
+  client->invalidateCardCache(cardId);
+  markChanged(outcome, cardId);
+  if (type != "commentCard" && type != "updateComment" && type != "deleteComment") {
+    addUnique(refetch, cardId);
+  }
+  return true;
+}
+
+ApiStatus SyncEngine::fullSync(SyncOutcome& outcome) {
+  // Take the mark first so actions made during the download are replayed
+  // next time rather than missed
+  String latest;
+  ApiStatus status = client->fetchLatestActionId(latest);
+  if (status != API_SUCCESS) {
+    return status;
+  }
+
+  // Reread the first chunk, where new cards appear, and whatever else is
+  // loaded; evicted chunks are reread when the UI returns to them
+  for (size_t chunk = 0; chunk == 0 || chunk < pager.chunkCount(); chunk++) {
+    if (chunk > 0 && !pager.isResident(chunk)) {
+      continue;
+    }
+    status = fetchChunk(chunk);
+    if (status != API_SUCCESS) {
+      return status;
+    }
+  }
+  outcome.fullFetch = true;
+
+  // The first chunk went to the list cache; the mark must never be newer
+  commitMark(latest);
+  stats.fullSyncs++;
+  return API_SUCCESS;
+}
+
+ApiStatus SyncEngine::deltaSync(SyncOutcome& outcome, bool& needFull) {
+  std::vector<BoardAction> actions;
+  ApiStatus status = client->fetchBoardActions(highWaterMark, actions);
+  if (status != API_SUCCESS) {
+    // An unknown or expired mark is rejected by the server; start over
+    if (status == API_ERROR_NETWORK || status == API_ERROR_UNAVAILABLE || 
+        status == API_ERROR_RATE_LIMIT || status == API_ERROR_AUTH) {
+      return status;
+    }
+    Serial.println("Sync: high-water mark rejected, doing a full fetch");
+    needFull = true;
+    return status;
+  }
+
+  if (actions.size() >= SYNC_MAX_ACTIONS) {
+    Serial.println("Sync: delta too large, doing a full fetch");
+    needFull = true;
+    return API_SUCCESS;
+  }
+
+  if (actions.empty()) {
+    stats.deltaSyncs++;
+    return API_SUCCESS;
+  }
+
+  // Actions arrive newest first
+  std::vector<String> refetch;
+  for (auto it = actions.rbegin(); it != actions.rend(); ++it) {
+    if (applyAction(*it, refetch, outcome)) {
+      outcome.actionsApplied++;
+    }
+  }
+
+  if (refetch.size() > SYNC_MAX_CARD_FETCHES) {
+    Serial.println("Sync: too many cards changed, doing a full fetch");
+    needFull = true;
+    return API_SUCCESS;
+  }
+
+  for (const auto& cardId : refetch) {
+    CardSummary summary;
+    bool inList = false;
+    status = client->fetchCardSummary(cardId, summary, inList);
+    stats.cardFetches++;
+
+    if (status == API_ERROR_NOT_FOUND) {
+      inList = false;
+    } else if (status != API_SUCCESS) {
+      // The mark is not advanced, so these actions are replayed next time
+      return status;
+    }
+
+    if (!inList) {
+      pager.remove(CardId::fromString(cardId));
+    } else {
+      pager.upsert(summary);
+    }
+  }
+
+  commitMark(actions.front().id);
+
+  stats.deltaSyncs++;
+  stats.actionsApplied += outcome.actionsApplied;
+  return API_SUCCESS;
+}
+
+ApiStatus SyncEngine::sync(std::vector<CardSummary>& result, SyncOutcome& outcome,
+                           ListWindow& window) {
+  if (!markLoaded) {
+    loadMark();
+  }
+
+  unsigned long startedAt = millis();
+  unsigned long bytesBefore = client->getConnectionStats().bodyBytes;
+
+  // After a reboot, start from the cached list the stored mark belongs to
+  if (pager.chunkCount() == 0 && highWaterMark.length() > 0) {
+    std::vector<CardSummary> cached;
+    if (client->fetchCardList(cached, true) == API_SUCCESS) {
+      bool shortList = cached.size() < LIST_CHUNK_SIZE;
+      pager.store(0, cached, shortList);
+    }
+  }
+
+  bool needFull = pager.chunkCount() == 0 || highWaterMark.length() == 0;
+  ApiStatus status = API_SUCCESS;
+  if (!needFull) {
+    status = deltaSync(outcome, needFull);
+    if (!needFull) {
+      stats.deltaBytes += client->getConnectionStats().bodyBytes - bytesBefore;
+    }
+  }
+  if (needFull) {
+    bytesBefore = client->getConnectionStats().bodyBytes;
+    status = fullSync(outcome);
+    stats.fullBytes += client->getConnectionStats().bodyBytes - bytesBefore;
+  }
+
+  if (status == API_SUCCESS) {
+    pager.snapshot(focusChunk, result, window);
+    Serial.printf("Sync: %s, %u actions, %lu bytes, %lu ms\n",
+                  outcome.fullFetch ? "full" : "delta", (unsigned)outcome.actionsApplied,
+                  client->getConnectionStats().bodyBytes - bytesBefore,
+                  millis() - startedAt);
+  }
+  return status;
+}
+
+ApiStatus SyncEngine::loadRange(size_t first, size_t last, std::vector<CardSummary>& result,
+                                ListWindow& window) {
+  if (!markLoaded) {
+    loadMark();
+  }
+
+  // Page forward until the range is covered or the list ends
+  while (pager.hasMore() && pager.knownCount() <= last) {
+    ApiStatus status = fetchChunk(pager.chunkCount());
+    if (status != API_SUCCESS) {
+      return status;
+    }
+  }
+
+  size_t firstChunk = pager.chunkForIndex(first);
+  size_t lastChunk = pager.chunkForIndex(last);
+  if (pager.chunkCount() > 0) {
+    firstChunk = min(firstChunk, pager.chunkCount() - 1);
+    lastChunk = min(lastChunk, pager.chunkCount() - 1);
+  }
+
+  // Bring back evicted chunks in range
+  for (size_t chunk = firstChunk; chunk <= lastChunk && chunk < pager.chunkCount(); chunk++) {
+    if (!pager.isResident(chunk)) {
+      ApiStatus status = fetchChunk(chunk);
+      if (status != API_SUCCESS) {
+        return status;
+      }
+    }
+  }
+
+  focusChunk = firstChunk;
+  pager.evictOutside((int)firstChunk - LIST_RESIDENT_MARGIN,
+                     (int)lastChunk + LIST_RESIDENT_MARGIN);
+  pager.snapshot(focusChunk, result, window);
+  return API_SUCCESS;
+}
+
+void SyncEngine::printStats() {
+  Serial.printf("Sync: %lu delta (%lu bytes), %lu full (%lu bytes), "
+                "%lu actions applied, %lu card fetches, %lu chunk fetches\n",
+                stats.deltaSyncs, stats.deltaBytes, stats.fullSyncs, stats.fullBytes,
+                stats.actionsApplied, stats.cardFetches, stats.chunkFetches);
+  pager.printStats();
+  StringPool::names().printStats("names");
+}
@@ -0,0 +1,78 @@
+#ifndef SYNC_ENGINE_H
+#define SYNC_ENGINE_H
+
+#include <Arduino.h>
+#include <vector>
+#include "config.h"
+#include "DataStructures.h"
+#include "TrelloClient.h"
+#include "ListPager.h"
+
+// Delta vs. full sync counters
+struct SyncStats {
+  unsigned long deltaSyncs;
+  unsigned long fullSyncs;
+  unsigned long actionsApplied;
+  unsigned long cardFetches;
+  unsigned long chunkFetches;
+  unsigned long deltaBytes;
+  unsigned long fullBytes;
+
+  SyncStats() : deltaSyncs(0), fullSyncs(0), actionsApplied(0), cardFetches(0),
+                chunkFetches(0), deltaBytes(0), fullBytes(0) {}
+};
+
+// What changed in one sync, for the UI to act on
+struct SyncOutcome {
+  bool fullFetch;
+  size_t actionsApplied;
+  std::vector<String> changedCards;   // Cards whose details are out of date
+
+  SyncOutcome() : fullFetch(false), actionsApplied(0) {}
+};
+
+// Keeps the card list current by replaying board actions newer than a
+// high-water mark stored on the SD card, instead of downloading the whole
+// list each time. Falls back to a full fetch when there is no mark or the
+// delta is too large to patch cheaply. Only the chunks of the list near
+// the UI's cursor are held; the rest is paged in by loadRange(). Runs on
+// the network task.
+class SyncEngine {
+private:
+  TrelloClient* client;
+  ListPager pager;                  // Last synced copy of the list, in chunks
+  size_t focusChunk;                // Chunk the UI was last looking at
+  String highWaterMark;             // Id of the newest action applied
+  bool markLoaded;
+  SyncStats stats;
+
+  void loadMark();
+  void saveMark(const String& actionId);
+  void commitMark(const String& actionId);
+  ApiStatus fetchChunk(size_t chunk);
+  void markChanged(SyncOutcome& outcome, const String& cardId);
+  bool applyAction(const BoardAction& action, std::vector<String>& refetch,
+                   SyncOutcome& outcome);
+  ApiStatus fullSync(SyncOutcome& outcome);
+  ApiStatus deltaSync(SyncOutcome& outcome, bool& needFull);
+
+public:
+  SyncEngine(TrelloClient* client);
+
+  // Brings the list up to date and copies the loaded cards around the
+  // UI's cursor into result
+  ApiStatus sync(std::vector<CardSummary>& result, SyncOutcome& outcome, ListWindow& window);
+
+  // Loads list indices [first, last] (fewer if the list is shorter), evicts
+  // chunks far from them and copies the loaded cards around them into result
+  ApiStatus loadRange(size_t first, size_t last, std::vector<CardSummary>& result,
+                      ListWindow& window);
+
+  // Forces the next sync to download the whole list
+  void reset();
+
+  const SyncStats& getStats() const { return stats; }
+  void printStats();
+};
+
+#endif // SYNC_ENGINE_H
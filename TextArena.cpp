@@ -0,0 +1,116 @@
+#include "TextArena.h"
+#include "config.h"
+
+static char* allocateBlock(size_t bytes) {
+  return (char*)(psramFound() ? ps_malloc(bytes) : malloc(bytes));
+}
+
+TextArena::TextArena() : data(nullptr), used(0), capacity(0) {
+}
+
+TextArena::~TextArena() {
+  free(data);
+}
+
+TextArena::TextArena(const TextArena& other) : data(nullptr), used(0), capacity(0) {
+  *this = other;
+}
+
+TextArena::TextArena(TextArena&& other) : data(other.data), used(other.used), capacity(other.capacity) {
+  other.data = nullptr;
+  other.used = 0;
+  other.capacity = 0;
+}
+
+TextArena& TextArena::operator=(const TextArena& other) {
+  if (this == &other) {
+    return *this;
+  }
+  used = 0;
+  if (other.used > capacity) {
+    free(data);
+    capacity = 0;
+    data = allocateBlock(other.used);
+    if (!data) {
+      Serial.println("Text arena: out of memory");
+      return *this;
+    }
+    capacity = other.used;
+  }
+  if (other.used > 0) {
+    memcpy(data, other.data, other.used);
+  }
+  used = other.used;
+  return *this;
+}
+
+TextArena& TextArena::operator=(TextArena&& other) {
+  if (this != &other) {
+    free(data);
+    data = other.data;
+    used = other.used;
+    capacity = other.capacity;
+    other.data = nullptr;
+    other.used = 0;
+    other.capacity = 0;
+  }
+  return *this;
+}
+
+// Doubles so a card parsed without a size hint is copied a few times at most
+bool TextArena::grow(size_t needed) {
+  size_t size = max(max(capacity * 2, needed), (size_t)TEXT_ARENA_MIN_BYTES);
+  char* block = allocateBlock(size);
+  if (!block) {
+    Serial.println("Text arena: out of memory");
+    return false;
+  }
+  if (used > 0) {
+    memcpy(block, data, used);
+  }
+  free(data);
+  data = block;
+  capacity = size;
+  return true;
+}
+
+void TextArena::reserve(size_t bytes) {
+  if (bytes > capacity) {
+    grow(bytes);
+  }
+}
+
+// Room for length characters and the NUL; the caller fills it in
+TextRef TextArena::take(size_t length) {
+  TextRef ref;
+  if (length == 0 || (used + length + 1 > capacity && !grow(used + length + 1))) {
+    return ref;
+  }
+  ref.offset = used;
+  ref.length = length;
+  data[used + length] = '\0';
+  used += length + 1;
+  return ref;
+}
+
+TextRef TextArena::add(const char* text, size_t length) {
+  TextRef ref = take(length);
+  if (ref.length > 0) {
+    memcpy(data + ref.offset, text, length);
+  }
+  return ref;
+}
+
+TextRef TextArena::add(const char* first, const char* second, const char* third) {
+  size_t firstLength = strlen(first);
+  size_t secondLength = strlen(second);
+  size_t thirdLength = strlen(third);
+  TextRef ref = take(firstLength + secondLength + thirdLength);
+  if (ref.length > 0) {
+    char* at = data + ref.offset;
+    memcpy(at, first, firstLength);
+    memcpy(at + firstLength, second, secondLength);
+    memcpy(at + firstLength + secondLength, third, thirdLength);
+  }
+  return ref;
+}
@@ -0,0 +1,62 @@
+#ifndef TEXT_ARENA_H
+#define TEXT_ARENA_H
+
+#include <Arduino.h>
+#include <string.h>
+
+// Where a string sits in a TextArena. Offsets rather than pointers, so a
+// copied arena is valid as it is.
+struct TextRef {
+  uint32_t offset;
+  uint32_t length;
+
+  TextRef() : offset(0), length(0) {}
+};
+
+// Bump allocator for the text of one card: every string is appended to a
+// single block (in PSRAM when there is some) and nothing is freed on its
+// own. Clearing or replacing the card releases all of it at once, and
+// assigning into an arena reuses its block when the new text fits, so the
+// card on screen keeps one block across opens instead of churning the
+// heap with dozens of small Strings.
+class TextArena {
+private:
+  char* data;
+  size_t used;
+  size_t capacity;
+
+  bool grow(size_t needed);
+  TextRef take(size_t length);
+
+public:
+  TextArena();
+  ~TextArena();
+  TextArena(const TextArena& other);
+  TextArena(TextArena&& other);
+  TextArena& operator=(const TextArena& other);
+  TextArena& operator=(TextArena&& other);
+
+  // Sizes the block up front when the total is known
+  void reserve(size_t bytes);
+
+  // Stored with a terminating NUL; empty text takes no space
+  TextRef add(const char* text, size_t length);
+  TextRef add(const char* text) { return add(text, strlen(text)); }
+  TextRef add(const String& text) { return add(text.c_str(), text.length()); }
+  // The pieces stored as one string
+  TextRef add(const char* first, const char* second, const char* third = "");
+
+  // "" for a ref the arena no longer holds: one taken before a clear(),
+  // or from a copy that ran out of memory and kept none of the text
+  const char* get(const TextRef& ref) const {
+    return ref.length > 0 && ref.offset + ref.length < used ? data + ref.offset : "";
+  }
+
+  // Forgets every string but keeps the block for the next card
+  void clear() { used = 0; }
+
+  size_t size() const { return used; }
+  size_t blockSize() const { return capacity; }
+};
+
+#endif // TEXT_ARENA_H
@@ -1,4 +1,7 @@
 #include "TrelloClient.h"
+#include "StringPool.h"
+#include "MemoryTelemetry.h"
+#include <functional>
 
 // Trello's root CA certificate (DigiCert Global Root CA)
 const char* trello_root_ca = \
@@ -25,17 +28,192 @@ const char* trello_root_ca = \
 "CAUw7C29C79Fv1C5qfPrmAESrciIxpg0X40KPMbp1ZWVbd4=\n" \
 "-----END CERTIFICATE-----";
 
-TrelloClient::TrelloClient() : secureClient(nullptr), httpClient(nullptr), 
-                               lastApiCall(0), isInitialized(false) {
+// Filters keep only the fields parseCardSummary/parseCardDetails read,
+// so the parser discards everything else straight off the stream
+static StaticJsonDocument<384> cardListFilter;
+static StaticJsonDocument<512> cardDetailsFilter;
+static StaticJsonDocument<512> boardActionFilter;
+static StaticJsonDocument<768> batchDetailsFilter;
+static StaticJsonDocument<256> ownActionFilter;
+
+static const char* CARD_DETAIL_PARAMS = 
+  "fields=name,desc,due,labels,badges,dateLastActivity&actions=commentCard&actions_limit=50&checklists=all";
+
+static void initJsonFilters() {
+  // Shared by every client; a document never frees what is overwritten in
+  // it, so each begin() builds them from empty
+  cardListFilter.clear();
+  cardDetailsFilter.clear();
+  boardActionFilter.clear();
+  batchDetailsFilter.clear();
+  ownActionFilter.clear();
+
+  cardListFilter["id"] = true;
+  cardListFilter["name"] = true;
+  cardListFilter["due"] = true;
+  cardListFilter["idList"] = true;
+  cardListFilter["closed"] = true;
+  cardListFilter["labels"][0]["color"] = true;
+  cardListFilter["badges"]["checkItems"] = true;
+  cardListFilter["badges"]["checkItemsChecked"] = true;
+  
+  cardDetailsFilter["id"] = true;
+  cardDetailsFilter["name"] = true;
+  cardDetailsFilter["desc"] = true;
+  cardDetailsFilter["due"] = true;
+  cardDetailsFilter["dateLastActivity"] = true;
+  cardDetailsFilter["labels"][0]["color"] = true;
+  cardDetailsFilter["actions"][0]["type"] = true;
+  cardDetailsFilter["actions"][0]["data"]["text"] = true;
+  cardDetailsFilter["actions"][0]["memberCreator"]["fullName"] = true;
+  cardDetailsFilter["checklists"][0]["checkItems"][0]["id"] = true;
+  cardDetailsFilter["checklists"][0]["checkItems"][0]["name"] = true;
+  cardDetailsFilter["checklists"][0]["checkItems"][0]["state"] = true;
+  
+  // Old values are only used to tell which fields changed; "desc" is left
+  // out because it can be large, and shows up as a details change instead
+  boardActionFilter["id"] = true;
+  boardActionFilter["type"] = true;
+  boardActionFilter["data"]["card"]["id"] = true;
+  boardActionFilter["data"]["card"]["name"] = true;
+  boardActionFilter["data"]["card"]["idList"] = true;
+  boardActionFilter["data"]["card"]["closed"] = true;
+  boardActionFilter["data"]["card"]["due"] = true;
+  boardActionFilter["data"]["list"]["id"] = true;
+  boardActionFilter["data"]["listAfter"]["id"] = true;
+  boardActionFilter["data"]["old"]["name"] = true;
+  boardActionFilter["data"]["old"]["due"] = true;
+  boardActionFilter["data"]["old"]["pos"] = true;
+  boardActionFilter["data"]["old"]["closed"] = true;
+  boardActionFilter["data"]["old"]["idList"] = true;
+  boardActionFilter["data"]["checkItem"]["id"] = true;
+  boardActionFilter["data"]["checkItem"]["state"] = true;
+  
+  // /batch wraps each response in an object keyed by its status code;
+  // anything other than 200 filters down to an empty object
+  batchDetailsFilter["200"] = cardDetailsFilter;
+  
+  ownActionFilter["id"] = true;
+  ownActionFilter["type"] = true;
+  ownActionFilter["data"]["text"] = true;
+  ownActionFilter["data"]["card"]["id"] = true;
+  ownActionFilter["data"]["card"]["name"] = true;
+  ownActionFilter["data"]["list"]["id"] = true;
 }
 
-TrelloClient::~TrelloClient() {
-  if (httpClient) {
-    delete httpClient;
+// Unix seconds from an HTTP date such as "Fri, 16 Oct 2026 09:30:00 GMT",
+// or 0 if it is not one
+static uint32_t parseHttpDate(const String& date) {
+  static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+  char month[4];
+  int day, year, hour, minute, second;
+  if (sscanf(date.c_str(), "%*3s, %d %3s %d %d:%d:%d", &day, month, &year, 
+             &hour, &minute, &second) != 6) {
+    return 0;
+  }
+  const char* found = strstr(months, month);
+  if (found == nullptr || strlen(month) != 3 || (found - months) % 3 != 0) {
+    return 0;
   }
-  if (secureClient) {
-    delete secureClient;
+  
+  // Days since 1970-01-01 in the proleptic Gregorian calendar, with the
+  // year starting in March so the leap day comes last
+  int m = (found - months) / 3 + 1;
+  int y = year - (m <= 2);
+  int era = y / 400;
+  int yearOfEra = y - era * 400;
+  int dayOfYear = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+  int dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+  long days = (long)era * 146097 + dayOfEra - 719468;
+  return (uint32_t)(days * 86400 + hour * 3600 + minute * 60 + second);
+}
+
+// Returns the next non-whitespace character without consuming it, or -1 on timeout
+static int peekSignificant(Stream& stream) {
+  unsigned long start = millis();
+  while (millis() - start < stream.getTimeout()) {
+    int c = stream.peek();
+    if (c < 0) {
+      delay(1);
+      continue;
+    }
+    if (c == ' ' || c == '\n' || c == '\r' || c == '\t') {
+      stream.read();
+      continue;
+    }
+    return c;
+  }
+  return -1;
+}
+
+// Percent-encodes a value for use inside a query string
+static String encodeQueryValue(const String& value) {
+  static const char hex[] = "0123456789ABCDEF";
+  String encoded;
+  encoded.reserve(value.length() * 3 / 2);
+  for (size_t i = 0; i < value.length(); i++) {
+    char c = value[i];
+    if (isalnum((unsigned char)c) || c == '-' || c == '_' || c == '.' || c == '~' || c == '/') {
+      encoded += c;
+    } else {
+      encoded += '%';
+      encoded += hex[(c >> 4) & 0x0F];
+      encoded += hex[c & 0x0F];
+    }
+  }
+  return encoded;
+}
+
+// Deserializes a JSON array one element at a time, so memory use does not
+// grow with the array. onElement returns false to abort with a parse error;
+// an element too large for doc stops with API_ERROR_NO_MEMORY.
+static ApiStatus streamArray(Stream& stream, JsonDocument& doc, JsonDocument& filter,
+                             const std::function<bool(JsonDocument&)>& onElement) {
+  if (!stream.find("[")) {
+    return API_ERROR_PARSE;
+  }
+  
+  int next = peekSignificant(stream);
+  while (next != ']') {
+    if (next < 0) {
+      Serial.println("JSON parse error: array truncated");
+      return API_ERROR_PARSE;
+    }
+    
+    DeserializationError error = deserializeJson(doc, stream, 
+                                                 DeserializationOption::Filter(filter));
+    if (error == DeserializationError::NoMemory) {
+      return API_ERROR_NO_MEMORY;
+    }
+    if (error) {
+      Serial.println("JSON parse error: " + String(error.c_str()));
+      return API_ERROR_PARSE;
+    }
+    if (!onElement(doc)) {
+      return API_ERROR_PARSE;
+    }
+    
+    // Elements are separated by ',' and the array closes with ']'
+    next = peekSignificant(stream);
+    if (next == ',') {
+      stream.read();
+      next = peekSignificant(stream);
+    } else if (next != ']') {
+      Serial.println("JSON parse error: malformed array");
+      return API_ERROR_PARSE;
+    }
   }
+  stream.read();
+  return API_SUCCESS;
+}
+
+TrelloClient::TrelloClient(Storage* storage)
+  : transport(&connection), storage(storage), cardStore(storage), baseUrl(TRELLO_BASE_URL), 
+                               retryEnabled(true), retries(0), peakDocBytes(0), 
+                               wifiStartedAt(0), serverClockOffset(0), isInitialized(false) {
+}
+
+TrelloClient::~TrelloClient() {
 }
 
 bool TrelloClient::begin() {
@@ -43,39 +221,43 @@ bool TrelloClient::begin() {
     return true;
   }
   
-  // Initialize secure client
-  secureClient = new WiFiClientSecure();
-  if (!secureClient) {
-    Serial.println("Failed to create secure client");
+  // Initialize the persistent TLS connection, unless another transport stands in
+  if (transport == &connection && !connection.begin(trello_root_ca, baseUrl)) {
     return false;
   }
   
-  // Set root CA certificate
-  secureClient->setCACert(trello_root_ca);
-  
-  // Initialize HTTP client
-  httpClient = new HTTPClient();
-  if (!httpClient) {
-    Serial.println("Failed to create HTTP client");
-    return false;
-  }
+  initJsonFilters();
   
-  // Initialize SD card for caching
-  if (!SD.begin()) {
+  // Mounted once here; everything after goes through storage
+  if (!storage->begin()) {
     Serial.println("Warning: SD card initialization failed - caching disabled");
+  } else {
+    cardStore.begin();
   }
   
   isInitialized = true;
   return true;
 }
 
+void TrelloClient::startWiFi() {
+  if (wifiStartedAt != 0 || WiFi.status() == WL_CONNECTED) {
+    return;
+  }
+  wifiStartedAt = micros();
+  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+}
+
 bool TrelloClient::connectWiFi() {
+  MemoryScope memory("connectWiFi");
   if (WiFi.status() == WL_CONNECTED) {
     return true;
   }
   
+  // An association startWiFi() began is waited on rather than restarted
   Serial.print("Connecting to WiFi");
-  WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+  startWiFi();
+  unsigned long startedAt = wifiStartedAt;
+  wifiStartedAt = 0;
   
   int attempts = 0;
   while (WiFi.status() != WL_CONNECTED && attempts < 20) {
@@ -85,17 +267,21 @@ bool TrelloClient::connectWiFi() {
   }
   
   if (WiFi.status() == WL_CONNECTED) {
+    transport->getMetrics().recordStandalone("WiFi join", PHASE_WIFI, micros() - startedAt);
     Serial.println();
     Serial.print("Connected! IP: ");
     Serial.println(WiFi.localIP());
     return true;
   } else {
     Serial.println(" Failed!");
+    recordError("Could not join WiFi " + String(WIFI_SSID) + " (status " + 
+                String(WiFi.status()) + ")", false);
     return false;
   }
 }
 
 void TrelloClient::disconnect() {
+  transport->close();
   WiFi.disconnect();
 }
 
@@ -104,7 +290,7 @@ bool TrelloClient::isConnected() {
 }
 
 String TrelloClient::buildUrl(const String& endpoint, const String& params) {
-  String url = TRELLO_BASE_URL + endpoint;
+  String url = baseUrl + endpoint;
   url += "?key=" + String(TRELLO_API_KEY);
   url += "&token=" + String(TRELLO_API_TOKEN);
   if (params.length() > 0) {
@@ -113,235 +299,592 @@ String TrelloClient::buildUrl(const String& endpoint, const String& params) {
   return url;
 }
 
-ApiStatus TrelloClient::makeRequest(const String& url, const String& method, 
-                                   const String& payload) {
-  if (!isConnected()) {
-    if (!connectWiFi()) {
-      return API_ERROR_NETWORK;
-    }
+int TrelloClient::sendOnce(const String& url, const String& method, const String& payload) {
+  // Never wait here: a throttled request is handed back to the caller to queue
+  if (!rateLimiter.tryAcquire()) {
+    Serial.println("Rate limit: request deferred " + String(rateLimiter.waitTimeMs()) + " ms");
+    return LOCAL_RATE_LIMITED;
   }
   
-  enforceRateLimit();
+  int httpCode = transport->sendRequest(url, method, payload);
   
-  httpClient->begin(*secureClient, url);
-  httpClient->addHeader("Content-Type", "application/json");
-  httpClient->setConnectTimeout(10000);
-  httpClient->setTimeout(10000);
+  String remaining = transport->header("x-rate-limit-api-token-remaining");
+  rateLimiter.onResponse(httpCode, remaining.length() > 0 ? remaining.toInt() : -1);
   
-  int httpCode = -1;
+  uint32_t serverTime = parseHttpDate(transport->header("Date"));
+  if (serverTime != 0) {
+    serverClockOffset = serverTime - millis() / 1000;
+  }
   
-  if (method == "GET") {
-    httpCode = httpClient->GET();
-  } else if (method == "POST") {
-    httpCode = httpClient->POST(payload);
-  } else if (method == "PUT") {
-    httpCode = httpClient->PUT(payload);
+  return httpCode;
+}
+
+// After a cool-down, a tiny request decides whether the API is back before
+// a real one is risked on it
+bool TrelloClient::probeApi() {
+  int httpCode = sendOnce(buildUrl("/members/me", "fields=id"), "GET", "");
+  transport->release();
+  if (httpCode == LOCAL_RATE_LIMITED) {
+    return false;
   }
+  if (RetryPolicy::isTransient(httpCode)) {
+    breaker.onFailure();
+    return false;
+  }
+  breaker.onSuccess();
+  return true;
+}
+
+// Sends a request, retrying transient failures with back-off. GET and PUT
+// are safe to repeat; a POST is only resent here if it never left the
+// device, otherwise the caller decides (the mutation log checks whether
+// it landed before sending it again).
+int TrelloClient::sendRequest(const String& url, const String& method, const String& payload) {
+  bool idempotent = (method == "GET" || method == "PUT");
   
-  lastApiCall = millis();
+  for (int attempt = 0; ; attempt++) {
+    if (!breaker.allowRequest()) {
+      Serial.println("API unavailable: retrying in " + String(breaker.waitTimeMs()) + " ms");
+      return LOCAL_CIRCUIT_OPEN;
+    }
+    if (breaker.isProbing() && !probeApi()) {
+      return breaker.isProbing() ? LOCAL_RATE_LIMITED : LOCAL_CIRCUIT_OPEN;
+    }
+    
+    int httpCode = sendOnce(url, method, payload);
+    if (httpCode == LOCAL_RATE_LIMITED) {
+      return httpCode;
+    }
+    if (!RetryPolicy::isTransient(httpCode)) {
+      // Any answer, even an error, means the API is up
+      breaker.onSuccess();
+      return httpCode;
+    }
+    breaker.onFailure();
+    
+    bool safeToRepeat = idempotent || RetryPolicy::wasNotSent(httpCode);
+    if (!retryEnabled || !safeToRepeat || !retryPolicy.shouldRetry(attempt) || 
+        !isConnected()) {
+      return httpCode;
+    }
+    
+    // This task is the only one waiting; the UI keeps running
+    transport->release();
+    unsigned long wait = retryPolicy.delayMs(attempt);
+    retries++;
+    Serial.printf("HTTP %d, retry %d of %d in %lu ms\n", httpCode, attempt + 1, 
+                  MAX_RETRIES, wait);
+    delay(wait);
+  }
+}
+
+ApiStatus TrelloClient::statusFromHttpCode(int httpCode) {
+  // Neither pseudo code sent anything, so there is no request to describe
+  if (httpCode == LOCAL_RATE_LIMITED) {
+    recordError("Request deferred by the rate limiter for " + 
+                String(rateLimiter.waitTimeMs()) + " ms", false);
+    return API_ERROR_RATE_LIMIT;
+  }
+  if (httpCode == LOCAL_CIRCUIT_OPEN) {
+    recordError("API unavailable, next probe in " + String(breaker.waitTimeMs()) + " ms", false);
+    return API_ERROR_UNAVAILABLE;
+  }
   
   if (httpCode > 0) {
     if (httpCode == 200 || httpCode == 201) {
-      httpClient->end();
       return API_SUCCESS;
     } else if (httpCode == 401) {
-      Serial.println("API authentication error");
-      httpClient->end();
+      recordError("API authentication error");
       return API_ERROR_AUTH;
     } else if (httpCode == 429) {
-      Serial.println("API rate limit exceeded");
-      httpClient->end();
+      recordError("API rate limit exceeded");
       return API_ERROR_RATE_LIMIT;
     } else if (httpCode == 404) {
-      Serial.println("API resource not found");
-      httpClient->end();
+      recordError("API resource not found");
       return API_ERROR_NOT_FOUND;
+    } else if (!RetryPolicy::isTransient(httpCode)) {
+      recordError("HTTP error " + String(httpCode));
+      return API_ERROR_UNKNOWN;
     }
+    recordError("HTTP error " + String(httpCode));
+  } else {
+    recordError("HTTP error: " + HTTPClient::errorToString(httpCode));
   }
   
-  Serial.println("HTTP error: " + String(httpCode));
-  httpClient->end();
-  return API_ERROR_NETWORK;
+  // Timeouts and server errors only mean offline if the WiFi is gone too
+  return isConnected() ? API_ERROR_UNAVAILABLE : API_ERROR_NETWORK;
+}
+
+// Charges the parse phase of the request just read to a parser's totals
+void TrelloClient::recordParse(ParseCost& cost, size_t items, uint32_t heapBefore, 
+                               size_t docBytes) {
+  uint32_t heapAfter = ESP.getFreeHeap();
+  cost.parses++;
+  cost.items += items;
+  cost.totalUs += transport->getMetrics().currentUs(PHASE_PARSE);
+  if (heapBefore > heapAfter) {
+    cost.retainedBytes += heapBefore - heapAfter;
+  }
+  cost.peakDocBytes = max(cost.peakDocBytes, docBytes);
 }
 
-void TrelloClient::enforceRateLimit() {
-  unsigned long timeSinceLastCall = millis() - lastApiCall;
-  if (timeSinceLastCall < API_RATE_LIMIT_DELAY_MS) {
-    delay(API_RATE_LIMIT_DELAY_MS - timeSinceLastCall);
+// Keeps the reason for the last failure, with the phase timings of the
+// request that caused it, for getLastError()
+void TrelloClient::recordError(const String& reason, bool describeRequest) {
+  lastError = reason;
+  const RequestSample* sample = transport->getMetrics().latest();
+  if (describeRequest && sample) {
+    lastError += " [" + transport->getMetrics().describe(*sample) + "]";
   }
+  Serial.println(lastError);
+}
+
+// Reports a response or payload that did not fit in the JSON document,
+// rather than acting on part of it, and grows the document for next time
+ApiStatus TrelloClient::recordOverflow(const String& what) {
+  size_t had = json.capacity();
+  String reason = what + " did not fit in " + String(had) + " bytes of JSON memory";
+  if (json.grow()) {
+    reason += "; grown to " + String(json.capacity());
+  }
+  recordError(reason);
+  return API_ERROR_NO_MEMORY;
+}
+
+// The shared document, sized for the body of the open response
+JsonDocument& TrelloClient::responseDocument() {
+  bool compressed = transport->header("Content-Encoding").indexOf("gzip") >= 0;
+  return json.forResponse(transport->getSize(), compressed);
+}
+
+// Payloads are built in the shared document too; one that overflowed it
+// would go out with fields missing, so it is not sent at all
+String TrelloClient::serializePayload(JsonDocument& payload, ApiStatus& status) {
+  String text;
+  json.noteUsage();
+  if (payload.overflowed()) {
+    status = recordOverflow("Request payload");
+    return text;
+  }
+  serializeJson(payload, text);
+  status = API_SUCCESS;
+  return text;
+}
+
+unsigned long TrelloClient::getRateLimitWaitMs() {
+  return rateLimiter.waitTimeMs();
+}
+
+uint32_t TrelloClient::getServerTime() const {
+  uint32_t offset = serverClockOffset;
+  return offset != 0 ? offset + millis() / 1000 : 0;
+}
+
+unsigned long TrelloClient::getUnavailableWaitMs() {
+  return breaker.waitTimeMs();
 }
 
 ApiStatus TrelloClient::fetchCardList(std::vector<CardSummary>& cards, bool useCache) {
   cards.clear();
   
   // Try cache first if requested or if offline
-  if (useCache || !isConnected()) {
-    DynamicJsonDocument doc(4096);
-    if (loadFromCache(CACHE_LIST_FILE, doc)) {
-      return parseCardList(doc, cards);
-    }
+  if ((useCache || !isConnected()) && loadCachedCardList(cards)) {
+    return API_SUCCESS;
   }
   
-  // Fetch from API
-  String url = buildUrl("/lists/" + String(TRELLO_LIST_ID) + "/cards", 
-                       "fields=name,id,labels,due,badges");
+  // Only the newest page is fetched; the rest is paged in on demand
+  return fetchCardPage("", LIST_CHUNK_SIZE, cards, true);
+}
+
+// Reads the list cache straight into the structs. A JSON cache left by
+// older firmware is parsed once and rewritten in the binary form.
+bool TrelloClient::loadCachedCardList(std::vector<CardSummary>& cards) {
+  MemoryScope memory("loadCachedCardList");
+  cards.clear();
+  unsigned long startedAt = micros();
+  std::vector<uint8_t> data;
+  if (!storage->readFile(CACHE_LIST_FILE, data)) {
+    return migrateCardListCache(cards);
+  }
   
-  // Make request and get response
-  httpClient->begin(*secureClient, url);
-  httpClient->addHeader("Content-Type", "application/json");
-  httpClient->setConnectTimeout(10000);
-  httpClient->setTimeout(10000);
+  if (!CardCodec::decodeList(data, cards)) {
+    Serial.println("List cache unreadable, discarding it");
+    storage->remove(CACHE_LIST_FILE);
+    cards.clear();
+    return false;
+  }
+  Serial.printf("List cache: %u cards, %u bytes, loaded in %lu us\n",
+                (unsigned)cards.size(), (unsigned)data.size(), micros() - startedAt);
+  return true;
+}
+
+bool TrelloClient::migrateCardListCache(std::vector<CardSummary>& cards) {
+  std::vector<uint8_t> data;
+  if (!storage->readFile(CACHE_LIST_JSON_FILE, data)) {
+    return false;
+  }
+  StreamString json;
+  json.write(data.data(), data.size());
+  ApiStatus status = parseCardList(json, cards);
+  if (status != API_SUCCESS) {
+    cards.clear();
+  } else if (saveCardListCache(cards)) {
+    Serial.printf("List cache: converted %u cards from JSON (%u bytes)\n",
+                  (unsigned)cards.size(), (unsigned)data.size());
+  }
+  storage->remove(CACHE_LIST_JSON_FILE);
+  return status == API_SUCCESS;
+}
+
+ApiStatus TrelloClient::fetchCardPage(const String& before, int limit,
+                                      std::vector<CardSummary>& cards, bool writeCache) {
+  MemoryScope memory("fetchCardPage");
+  cards.clear();
+  
+  String params = "fields=name,id,labels,due,badges&limit=" + String(limit);
+  if (before.length() > 0) {
+    params += "&before=" + before;
+  }
+  String url = buildUrl("/lists/" + String(TRELLO_LIST_ID) + "/cards", params);
   
-  int httpCode = httpClient->GET();
+  // Make request and get response
+  int httpCode = sendRequest(url, "GET");
   
   if (httpCode == 200) {
-    String responseStr = httpClient->getString();
-    DynamicJsonDocument doc(4096);
-    DeserializationError error = deserializeJson(doc, responseStr);
-    httpClient->end();
+    // Parse straight off the socket, encoding each card for the cache as it
+    // goes; the old cache stays if the response turns out to be bad
+    std::vector<uint8_t> cacheData;
+    uint32_t heapBefore = ESP.getFreeHeap();
+    ApiStatus status = parseCardList(transport->getBody(), cards, 
+                                     writeCache ? &cacheData : nullptr);
+    transport->release();
     
-    if (error) {
-      Serial.println("JSON parse error: " + String(error.c_str()));
-      return API_ERROR_PARSE;
+    if (writeCache && status == API_SUCCESS) {
+      PhaseTimer timer(transport->getMetrics(), PHASE_CACHE);
+      storage->writeBehind(CACHE_LIST_FILE, cacheData);
     }
-    
-    saveToCache(CACHE_LIST_FILE, doc);
-    return parseCardList(doc, cards);
+    if (status == API_ERROR_NO_MEMORY) {
+      recordOverflow("A card in the list response");
+    } else if (status != API_SUCCESS) {
+      recordError("Card list response could not be parsed");
+    } else {
+      recordParse(parseStats.list, cards.size(), heapBefore, peakDocBytes);
+    }
+    return status;
   } else {
-    httpClient->end();
-    return API_ERROR_NETWORK;
+    transport->release();
+    return statusFromHttpCode(httpCode);
   }
 }
 
-ApiStatus TrelloClient::parseCardList(const DynamicJsonDocument& doc, std::vector<CardSummary>& cards) {
-  if (doc.is<JsonArray>()) {
-    JsonArray cardsArray = doc.as<JsonArray>();
-    for (JsonObject card : cardsArray) {
-      CardSummary summary;
-      summary.id = card["id"].as<String>();
-      summary.name = card["name"].as<String>();
-      
-      // Parse labels
-      JsonArray labels = card["labels"];
-      for (JsonObject label : labels) {
-        String color = label["color"].as<String>();
-        if (color.length() > 0) {
-          summary.labelColors.push_back(color);
-        }
-      }
-      
-      // Check due date
-      if (card.containsKey("due") && !card["due"].isNull()) {
-        summary.hasDueDate = true;
-      }
-      
-      // Check if done (based on badges or checklists)
-      if (card.containsKey("badges")) {
-        JsonObject badges = card["badges"];
-        if (badges.containsKey("checkItems")) {
-          int checkItems = badges["checkItems"];
-          int checkItemsChecked = badges["checkItemsChecked"];
-          summary.isDone = (checkItems > 0) && (checkItems == checkItemsChecked);
-        }
-      }
-      
-      cards.push_back(summary);
+ApiStatus TrelloClient::parseCardList(Stream& stream, std::vector<CardSummary>& cards, 
+                                      std::vector<uint8_t>* cacheOut) {
+  if (cacheOut) {
+    CardCodec::beginList(*cacheOut);
+  }
+  
+  JsonDocument& doc = json.prepare();
+  peakDocBytes = 0;
+  ApiStatus status = streamArray(stream, doc, cardListFilter, 
+                                 [&](JsonDocument& element) {
+    peakDocBytes = max(peakDocBytes, element.memoryUsage());
+    json.noteUsage();
+    CardSummary summary;
+    if (parseCardSummary(element.as<JsonObject>(), summary) != API_SUCCESS) {
+      return false;
     }
-    return API_SUCCESS;
+    cards.push_back(summary);
+    
+    // Mirror each card into the cache as it is parsed
+    if (cacheOut) {
+      PhaseTimer timer(transport->getMetrics(), PHASE_CACHE);
+      CardCodec::writeSummary(*cacheOut, summary);
+    }
+    return true;
+  });
+  return status;
+}
+
+ApiStatus TrelloClient::parseCardSummary(JsonObject card, CardSummary& summary) {
+  if (card.isNull()) {
+    return API_ERROR_PARSE;
   }
-  return API_ERROR_PARSE;
+  
+  summary.id = CardId::fromString(card["id"] | "");
+  summary.name = StringPool::names().intern(card["name"] | "");
+  
+  // Labels are resolved to colors here so drawing them compares nothing
+  JsonArray labels = card["labels"];
+  for (JsonObject label : labels) {
+    const char* color = label["color"] | "";
+    if (color[0]) {
+      summary.addLabel(labelColorFromName(color));
+    }
+  }
+  
+  // Check due date
+  if (card.containsKey("due") && !card["due"].isNull()) {
+    summary.hasDueDate = true;
+  }
+  
+  // Check if done (based on badges or checklists)
+  if (card.containsKey("badges")) {
+    JsonObject badges = card["badges"];
+    if (badges.containsKey("checkItems")) {
+      int checkItems = badges["checkItems"];
+      int checkItemsChecked = badges["checkItemsChecked"];
+      summary.isDone = (checkItems > 0) && (checkItems == checkItemsChecked);
+    }
+  }
+  
+  return API_SUCCESS;
 }
 
 ApiStatus TrelloClient::fetchCardDetails(const String& cardId, FullCard& card, bool useCache) {
+  MemoryScope memory("fetchCardDetails");
   // Try cache first if requested or if offline
-  String cacheFile = CACHE_DETAILS_PREFIX + cardId + ".json";
-  if (useCache || !isConnected()) {
-    DynamicJsonDocument doc(4096);
-    if (loadFromCache(cacheFile, doc)) {
-      return parseCardDetails(doc, card);
-    }
+  if ((useCache || !isConnected()) && cardStore.get(cardId, card)) {
+    return API_SUCCESS;
   }
   
   // Fetch from API
-  String url = buildUrl("/cards/" + cardId, 
-                       "fields=name,desc,due,labels,badges&actions=commentCard&actions_limit=50&checklists=all");
+  String url = buildUrl("/cards/" + cardId, CARD_DETAIL_PARAMS);
   
-  // Make request and get response
-  httpClient->begin(*secureClient, url);
-  httpClient->addHeader("Content-Type", "application/json");
-  httpClient->setConnectTimeout(10000);
-  httpClient->setTimeout(10000);
+  // A card that outgrows the document is asked for once more, after the
+  // document has grown to twice its size
+  for (int attempt = 0; ; attempt++) {
+    int httpCode = sendRequest(url, "GET");
+    if (httpCode != 200) {
+      transport->release();
+      return statusFromHttpCode(httpCode);
+    }
+    
+    uint32_t heapBefore = ESP.getFreeHeap();
+    JsonDocument& doc = responseDocument();
+    DeserializationError error = deserializeJson(doc, transport->getBody(), 
+                                                 DeserializationOption::Filter(cardDetailsFilter));
+    transport->release();
+    
+    if (error == DeserializationError::NoMemory) {
+      size_t had = json.capacity();
+      ApiStatus status = recordOverflow("Card " + cardId);
+      if (attempt == 0 && json.capacity() > had) {
+        continue;
+      }
+      return status;
+    }
+    if (error) {
+      recordError("JSON parse error: " + String(error.c_str()));
+      return API_ERROR_PARSE;
+    }
+    json.noteUsage();
+    
+    // Turning the document into a FullCard is part of parsing too
+    unsigned long convertStart = micros();
+    ApiStatus status = parseCardDetails(doc, card);
+    transport->getMetrics().record(PHASE_PARSE, micros() - convertStart);
+    if (status == API_SUCCESS) {
+      recordParse(parseStats.details, 1, heapBefore, doc.memoryUsage());
+      saveToCache(card);
+    }
+    return status;
+  }
+}
+
+// Fetches details for many cards with one request per BATCH_MAX_URLS cards.
+// Cards that fail individually are left out of the result; the return
+// value reports the first request-level failure.
+ApiStatus TrelloClient::fetchCardDetailsBatch(const std::vector<String>& cardIds, 
+                                              std::vector<FullCard>& cards) {
+  MemoryScope memory("fetchCardDetailsBatch");
+  cards.clear();
+  unsigned long startedAt = millis();
+  size_t requests = 0;
   
-  int httpCode = httpClient->GET();
+  for (size_t start = 0; start < cardIds.size(); start += BATCH_MAX_URLS) {
+    size_t end = min(start + BATCH_MAX_URLS, cardIds.size());
+    
+    // Each route is encoded so its own '?', '&' and ',' survive the trip
+    String routes;
+    for (size_t i = start; i < end; i++) {
+      if (i > start) {
+        routes += ',';
+      }
+      routes += encodeQueryValue("/cards/" + cardIds[i] + "?" + CARD_DETAIL_PARAMS);
+    }
+    
+    // A card that outgrows the document has its group asked for once
+    // more, after the document has grown to twice its size
+    for (int attempt = 0; ; attempt++) {
+      int httpCode = sendRequest(buildUrl("/batch", "urls=" + routes), "GET");
+      requests++;
+      if (httpCode != 200) {
+        transport->release();
+        return statusFromHttpCode(httpCode);
+      }
+      
+      // Responses come back in route order, one per element
+      uint32_t heapBefore = ESP.getFreeHeap();
+      size_t parsedBefore = cards.size();
+      peakDocBytes = 0;
+      JsonDocument& doc = json.prepare();
+      size_t index = start;
+      ApiStatus status = streamArray(transport->getBody(), doc, batchDetailsFilter, 
+                                     [&](JsonDocument& element) {
+        peakDocBytes = max(peakDocBytes, element.memoryUsage());
+        json.noteUsage();
+        JsonVariantConst body = element["200"];
+        if (!body.isNull() && index < end) {
+          FullCard card;
+          if (parseCardDetails(body, card) == API_SUCCESS) {
+            saveToCache(card);
+            cards.push_back(card);
+          }
+        } else if (index < end) {
+          Serial.println("Batch: no details for card " + cardIds[index]);
+        }
+        index++;
+        return true;
+      });
+      transport->release();
+      
+      if (status == API_ERROR_NO_MEMORY) {
+        size_t had = json.capacity();
+        status = recordOverflow("Card " + cardIds[min(index, end - 1)] + " in a batch");
+        cards.erase(cards.begin() + parsedBefore, cards.end());
+        if (attempt == 0 && json.capacity() > had) {
+          continue;
+        }
+        return status;
+      }
+      if (status != API_SUCCESS) {
+        recordError("Batch response could not be parsed");
+        return status;
+      }
+      recordParse(parseStats.details, cards.size() - parsedBefore, heapBefore, peakDocBytes);
+      break;
+    }
+  }
   
-  if (httpCode == 200) {
-    String responseStr = httpClient->getString();
-    DynamicJsonDocument doc(4096);
-    DeserializationError error = deserializeJson(doc, responseStr);
-    httpClient->end();
+  Serial.printf("Batch: %u of %u cards in %u requests, %lu ms\n", 
+                (unsigned)cards.size(), (unsigned)cardIds.size(), 
+                (unsigned)requests, millis() - startedAt);
+  return API_SUCCESS;
+}
+
+bool TrelloClient::loadCachedCardDetails(const String& cardId, FullCard& card) {
+  return cardStore.get(cardId, card);
+}
+
+bool TrelloClient::isCacheFresh(const FullCard& card, unsigned long maxAge) {
+  return card.fetchedAt != 0 && millis() - card.fetchedAt < maxAge;
+}
+
+// Asks only for dateLastActivity, which Trello moves on every change to the
+// card, and downloads the details again only if it differs from the cached
+// copy's. changed is false when the cached copy is still current.
+ApiStatus TrelloClient::revalidateCard(const String& cardId, const String& lastActivity,
+                                       FullCard& card, bool& changed) {
+  MemoryScope memory("revalidateCard");
+  changed = true;
+  if (lastActivity.length() > 0) {
+    String url = buildUrl("/cards/" + cardId, "fields=dateLastActivity");
+    int httpCode = sendRequest(url, "GET");
+    if (httpCode != 200) {
+      transport->release();
+      return statusFromHttpCode(httpCode);
+    }
     
+    JsonDocument& doc = responseDocument();
+    DeserializationError error = deserializeJson(doc, transport->getBody());
+    transport->release();
     if (error) {
-      Serial.println("JSON parse error: " + String(error.c_str()));
+      recordError("JSON parse error: " + String(error.c_str()));
       return API_ERROR_PARSE;
     }
     
-    saveToCache(cacheFile, doc);
-    return parseCardDetails(doc, card);
-  } else {
-    httpClient->end();
-    return API_ERROR_NETWORK;
+    if (doc["dateLastActivity"].as<String>() == lastActivity) {
+      changed = false;
+      return API_SUCCESS;
+    }
   }
+  
+  // Cards cached before validators were stored have none to compare
+  return fetchCardDetails(cardId, card, false);
 }
 
-ApiStatus TrelloClient::parseCardDetails(const DynamicJsonDocument& doc, FullCard& card) {
-  if (!doc.is<JsonObject>()) {
+ApiStatus TrelloClient::parseCardDetails(JsonVariantConst doc, FullCard& card) {
+  if (!doc.is<JsonObjectConst>()) {
     return API_ERROR_PARSE;
   }
   
-  JsonObject cardObj = doc.as<JsonObject>();
+  JsonObjectConst cardObj = doc.as<JsonObjectConst>();
+  
+  // Count the text first so the card's arena and vectors are each
+  // allocated once at their final size
+  const char* desc = cardObj["desc"] | "";
+  const char* lastActivity = cardObj["dateLastActivity"] | "";
+  const char* due = cardObj["due"] | "";
+  size_t textBytes = strlen(desc) + strlen(lastActivity) + strlen(due) + 3;
+  size_t commentCount = 0;
+  size_t itemCount = 0;
+  JsonArrayConst actions = cardObj["actions"];
+  for (JsonObjectConst action : actions) {
+    if (strcmp(action["type"] | "", "commentCard") == 0) {
+      textBytes += strlen(action["memberCreator"]["fullName"] | "") +
+                   strlen(action["data"]["text"] | "") + 3;
+      commentCount++;
+    }
+  }
+  JsonArrayConst checklists = cardObj["checklists"];
+  for (JsonObjectConst checklist : checklists) {
+    for (JsonObjectConst item : checklist["checkItems"].as<JsonArrayConst>()) {
+      textBytes += strlen(item["id"] | "") + strlen(item["name"] | "") + 2;
+      itemCount++;
+    }
+  }
+  card.clearContents();
+  card.text.reserve(textBytes);
+  card.comments.reserve(commentCount);
+  card.checklists.reserve(itemCount);
   
   // Parse basic info
-  card.summary.id = cardObj["id"].as<String>();
-  card.summary.name = cardObj["name"].as<String>();
-  card.description = cardObj["desc"].as<String>();
+  card.summary.id = CardId::fromString(cardObj["id"] | "");
+  card.summary.name = StringPool::names().intern(cardObj["name"] | "");
+  card.description = card.text.add(desc);
+  card.lastActivity = card.text.add(lastActivity);
+  card.fetchedAt = millis();
   
-  if (cardObj.containsKey("due") && !cardObj["due"].isNull()) {
-    card.dueDate = cardObj["due"].as<String>();
+  if (due[0]) {
+    card.dueDate = card.text.add(due);
     card.summary.hasDueDate = true;
   }
   
   // Parse labels
-  card.summary.labelColors.clear();
-  JsonArray labels = cardObj["labels"];
-  for (JsonObject label : labels) {
-    String color = label["color"].as<String>();
-    if (color.length() > 0) {
-      card.summary.labelColors.push_back(color);
+  card.summary.labels = 0;
+  JsonArrayConst labels = cardObj["labels"];
+  for (JsonObjectConst label : labels) {
+    const char* color = label["color"] | "";
+    if (color[0]) {
+      card.summary.addLabel(labelColorFromName(color));
     }
   }
   
   // Parse comments
-  card.comments.clear();
-  JsonArray actions = cardObj["actions"];
-  for (JsonObject action : actions) {
-    if (action["type"].as<String>() == "commentCard") {
-      JsonObject data = action["data"];
-      String text = data["text"].as<String>();
-      String memberName = action["memberCreator"]["fullName"].as<String>();
-      card.comments.push_back(memberName + ": " + text);
+  for (JsonObjectConst action : actions) {
+    if (strcmp(action["type"] | "", "commentCard") == 0) {
+      card.comments.push_back(card.text.add(action["memberCreator"]["fullName"] | "", ": ",
+                                            action["data"]["text"] | ""));
     }
   }
   
   // Parse checklists
-  card.checklists.clear();
-  JsonArray checklists = cardObj["checklists"];
-  for (JsonObject checklist : checklists) {
-    JsonArray checkItems = checklist["checkItems"];
-    for (JsonObject item : checkItems) {
+  for (JsonObjectConst checklist : checklists) {
+    for (JsonObjectConst item : checklist["checkItems"].as<JsonArrayConst>()) {
       ChecklistItem checkItem;
-      checkItem.id = item["id"].as<String>();
-      checkItem.name = item["name"].as<String>();
-      checkItem.isComplete = item["state"].as<String>() == "complete";
+      checkItem.id = card.text.add(item["id"] | "");
+      checkItem.name = card.text.add(item["name"] | "");
+      checkItem.isComplete = strcmp(item["state"] | "", "complete") == 0;
       card.checklists.push_back(checkItem);
     }
   }
@@ -349,106 +892,342 @@ ApiStatus TrelloClient::parseCardDetails(const DynamicJsonDocument& doc, FullCar
   return API_SUCCESS;
 }
 
+ApiStatus TrelloClient::fetchBoardActions(const String& since, std::vector<BoardAction>& actions, 
+                                          int limit) {
+  MemoryScope memory("fetchBoardActions");
+  actions.clear();
+  
+  // Only action types that can change what the list or card screens show
+  String url = buildUrl("/boards/" + String(TRELLO_BOARD_ID) + "/actions",
+                       "since=" + since + "&limit=" + String(limit) +
+                       "&fields=type,data&memberCreator=false"
+                       "&filter=createCard,copyCard,convertToCardFromCheckItem,"
+                       "moveCardToBoard,moveCardFromBoard,deleteCard,updateCard,"
+                       "commentCard,updateComment,deleteComment,"
+                       "updateCheckItemStateOnCard,addChecklistToCard,removeChecklistFromCard,"
+                       "createCheckItem,deleteCheckItem,updateCheckItem,"
+                       "addLabelToCard,removeLabelFromCard");
+  
+  int httpCode = sendRequest(url, "GET");
+  if (httpCode != 200) {
+    transport->release();
+    return statusFromHttpCode(httpCode);
+  }
+  
+  JsonDocument& doc = json.prepare();
+  ApiStatus status = streamArray(transport->getBody(), doc, boardActionFilter, 
+                                 [&](JsonDocument& element) {
+    json.noteUsage();
+    BoardAction action;
+    if (parseBoardAction(element.as<JsonObject>(), action) != API_SUCCESS) {
+      return false;
+    }
+    actions.push_back(action);
+    return true;
+  });
+  transport->release();
+  
+  if (status == API_ERROR_NO_MEMORY) {
+    return recordOverflow("A board action");
+  }
+  if (status != API_SUCCESS) {
+    recordError("Board actions response could not be parsed");
+  }
+  return status;
+}
+
+ApiStatus TrelloClient::parseBoardAction(JsonObject action, BoardAction& result) {
+  if (action.isNull()) {
+    return API_ERROR_PARSE;
+  }
+  
+  result.id = action["id"].as<String>();
+  result.type = action["type"].as<String>();
+  
+  JsonObject data = action["data"];
+  JsonObject card = data["card"];
+  result.cardId = card["id"].as<String>();
+  result.cardName = card["name"].as<String>();
+  result.closed = card["closed"] | false;
+  result.hasDueDate = card.containsKey("due") && !card["due"].isNull();
+  
+  // Moves report the destination in listAfter, everything else in list or card
+  if (data.containsKey("listAfter")) {
+    result.listId = data["listAfter"]["id"].as<String>();
+  } else if (data.containsKey("list")) {
+    result.listId = data["list"]["id"].as<String>();
+  } else {
+    result.listId = card["idList"].as<String>();
+  }
+  
+  if (result.type == "updateCard") {
+    JsonObject old = data["old"];
+    if (old.containsKey("name")) result.changed |= CHANGED_NAME;
+    if (old.containsKey("due")) result.changed |= CHANGED_DUE;
+    if (old.containsKey("pos")) result.changed |= CHANGED_POS;
+    if (old.containsKey("closed")) result.changed |= CHANGED_CLOSED;
+    if (old.containsKey("idList")) result.changed |= CHANGED_LIST;
+    if (result.changed == 0) result.changed = CHANGED_DETAILS;
+  }
+  
+  JsonObject checkItem = data["checkItem"];
+  if (!checkItem.isNull()) {
+    result.checkItemId = checkItem["id"].as<String>();
+    result.checkItemComplete = checkItem["state"].as<String>() == "complete";
+  }
+  
+  return API_SUCCESS;
+}
+
+ApiStatus TrelloClient::fetchLatestActionId(String& actionId) {
+  MemoryScope memory("fetchLatestActionId");
+  actionId = "";
+  String url = buildUrl("/boards/" + String(TRELLO_BOARD_ID) + "/actions", 
+                       "limit=1&fields=id&memberCreator=false");
+  
+  int httpCode = sendRequest(url, "GET");
+  if (httpCode != 200) {
+    transport->release();
+    return statusFromHttpCode(httpCode);
+  }
+  
+  JsonDocument& doc = responseDocument();
+  DeserializationError error = deserializeJson(doc, transport->getBody());
+  transport->release();
+  if (error) {
+    recordError("JSON parse error: " + String(error.c_str()));
+    return API_ERROR_PARSE;
+  }
+  
+  actionId = doc[0]["id"] | "";
+  return API_SUCCESS;
+}
+
+ApiStatus TrelloClient::fetchCardSummary(const String& cardId, CardSummary& summary, bool& inList) {
+  MemoryScope memory("fetchCardSummary");
+  inList = false;
+  String url = buildUrl("/cards/" + cardId, "fields=name,id,labels,due,badges,idList,closed");
+  
+  int httpCode = sendRequest(url, "GET");
+  if (httpCode != 200) {
+    transport->release();
+    return statusFromHttpCode(httpCode);
+  }
+  
+  JsonDocument& doc = responseDocument();
+  DeserializationError error = deserializeJson(doc, transport->getBody(), 
+                                               DeserializationOption::Filter(cardListFilter));
+  transport->release();
+  if (error == DeserializationError::NoMemory) {
+    return recordOverflow("Card " + cardId);
+  }
+  if (error) {
+    recordError("JSON parse error: " + String(error.c_str()));
+    return API_ERROR_PARSE;
+  }
+  
+  JsonObject card = doc.as<JsonObject>();
+  inList = card["idList"].as<String>() == TRELLO_LIST_ID && !(card["closed"] | false);
+  return parseCardSummary(card, summary);
+}
+
 ApiStatus TrelloClient::addComment(const String& cardId, const String& comment) {
+  MemoryScope memory("addComment");
   String url = buildUrl("/cards/" + cardId + "/actions/comments");
   
-  DynamicJsonDocument payload(1024);
+  // Room for the text, its key and the object around them
+  JsonDocument& payload = json.prepare(JSON_OBJECT_SIZE(1) + comment.length() + 16);
   payload["text"] = comment;
   
-  String payloadStr;
-  serializeJson(payload, payloadStr);
+  ApiStatus status;
+  String payloadStr = serializePayload(payload, status);
+  if (status != API_SUCCESS) {
+    return status;
+  }
   
   // Make POST request
-  httpClient->begin(*secureClient, url);
-  httpClient->addHeader("Content-Type", "application/json");
-  int httpCode = httpClient->POST(payloadStr);
-  httpClient->end();
+  int httpCode = sendRequest(url, "POST", payloadStr);
+  transport->release();
   
-  return (httpCode == 200 || httpCode == 201) ? API_SUCCESS : API_ERROR_NETWORK;
+  return statusFromHttpCode(httpCode);
 }
 
-ApiStatus TrelloClient::markChecklistItemDone(const String& cardId, const String& checklistId, const String& itemId) {
-  String url = buildUrl("/cards/" + cardId + "/checklist/" + checklistId + "/idChecklist/" + itemId);
+ApiStatus TrelloClient::setCheckItemState(const String& cardId, const String& itemId, bool complete) {
+  MemoryScope memory("setCheckItemState");
+  String url = buildUrl("/cards/" + cardId + "/checkItem/" + itemId);
   
-  DynamicJsonDocument payload(1024);
-  payload["value"]["state"] = "complete";
+  JsonDocument& payload = json.prepare();
+  payload["state"] = complete ? "complete" : "incomplete";
   
-  String payloadStr;
-  serializeJson(payload, payloadStr);
+  ApiStatus status;
+  String payloadStr = serializePayload(payload, status);
+  if (status != API_SUCCESS) {
+    return status;
+  }
   
   // Make PUT request
-  httpClient->begin(*secureClient, url);
-  httpClient->addHeader("Content-Type", "application/json");
-  int httpCode = httpClient->PUT(payloadStr);
-  httpClient->end();
+  int httpCode = sendRequest(url, "PUT", payloadStr);
+  transport->release();
   
-  return (httpCode == 200 || httpCode == 201) ? API_SUCCESS : API_ERROR_NETWORK;
+  return statusFromHttpCode(httpCode);
 }
 
 ApiStatus TrelloClient::createCard(const String& name, const String& description) {
+  MemoryScope memory("createCard");
   String url = buildUrl("/cards");
   
-  DynamicJsonDocument payload(1024);
+  JsonDocument& payload = json.prepare(JSON_OBJECT_SIZE(3) + name.length() + 
+                                       description.length() + 32);
   payload["name"] = name;
   payload["desc"] = description;
   payload["idList"] = TRELLO_LIST_ID;
   
-  String payloadStr;
-  serializeJson(payload, payloadStr);
+  ApiStatus status;
+  String payloadStr = serializePayload(payload, status);
+  if (status != API_SUCCESS) {
+    return status;
+  }
   
   // Make POST request
-  httpClient->begin(*secureClient, url);
-  httpClient->addHeader("Content-Type", "application/json");
-  int httpCode = httpClient->POST(payloadStr);
-  httpClient->end();
+  int httpCode = sendRequest(url, "POST", payloadStr);
+  transport->release();
   
-  return (httpCode == 200 || httpCode == 201) ? API_SUCCESS : API_ERROR_NETWORK;
+  return statusFromHttpCode(httpCode);
 }
 
-bool TrelloClient::saveToCache(const String& filename, const DynamicJsonDocument& doc) {
-  if (!SD.begin()) {
-    return false;
-  }
+// A comment or card that landed was made after its first attempt was sent,
+// which its action id records to the second. Ids are compared rather than
+// text alone so an identical comment from before the attempt, or someone
+// else's, is not mistaken for it.
+ApiStatus TrelloClient::findOwnAction(const String& cardId, const String& text, uint32_t since, 
+                                      bool& found) {
+  MemoryScope memory("findOwnAction");
+  found = false;
+  uint32_t earliest = since - MUTATION_CLOCK_SLACK_S;
+  String url = buildUrl("/members/me/actions", 
+                       "since=" + CardId::madeAt(earliest).toString() + 
+                       "&limit=" + String(MUTATION_VERIFY_LIMIT) +
+                       "&fields=type,data&memberCreator=false" +
+                       (cardId.length() > 0 ? "&filter=commentCard" : "&filter=createCard"));
   
-  File file = SD.open(filename, FILE_WRITE);
-  if (!file) {
-    return false;
+  int httpCode = sendRequest(url, "GET");
+  if (httpCode != 200) {
+    transport->release();
+    return statusFromHttpCode(httpCode);
   }
   
-  size_t bytesWritten = serializeJson(doc, file);
-  file.close();
+  JsonDocument& doc = json.prepare();
+  ApiStatus status = streamArray(transport->getBody(), doc, ownActionFilter, 
+                                 [&](JsonDocument& element) {
+    json.noteUsage();
+    JsonObjectConst action = element.as<JsonObjectConst>();
+    if (found || CardId::fromString(action["id"] | "").createdAt() < earliest) {
+      return true;
+    }
+    JsonObjectConst data = action["data"];
+    if (cardId.length() > 0) {
+      found = strcmp(action["type"] | "", "commentCard") == 0 &&
+              cardId == (data["card"]["id"] | "") && text == (data["text"] | "");
+    } else {
+      found = strcmp(action["type"] | "", "createCard") == 0 &&
+              text == (data["card"]["name"] | "") && 
+              strcmp(data["list"]["id"] | "", TRELLO_LIST_ID) == 0;
+    }
+    return true;
+  });
+  transport->release();
   
-  return bytesWritten > 0;
+  if (status == API_ERROR_NO_MEMORY) {
+    return recordOverflow("An action");
+  }
+  if (status != API_SUCCESS) {
+    recordError("Actions response could not be parsed");
+  }
+  return status;
+}
+
+bool TrelloClient::saveToCache(const FullCard& card) {
+  PhaseTimer timer(transport->getMetrics(), PHASE_CACHE);
+  return cardStore.put(card);
 }
 
-bool TrelloClient::loadFromCache(const String& filename, DynamicJsonDocument& doc) {
-  if (!SD.begin()) {
+// Rewrites the list cache from summaries that were patched in memory. Only
+// the fields parseCardSummary reads are kept.
+// Queued behind; Storage replaces the file whole when it is flushed
+bool TrelloClient::saveCardListCache(const std::vector<CardSummary>& cards) {
+  MemoryScope memory("saveCardListCache");
+  PhaseTimer timer(transport->getMetrics(), PHASE_CACHE);
+  if (!storage->isMounted()) {
     return false;
   }
   
-  File file = SD.open(filename, FILE_READ);
-  if (!file) {
-    return false;
+  std::vector<uint8_t> data;
+  CardCodec::beginList(data);
+  for (const auto& card : cards) {
+    CardCodec::writeSummary(data, card);
   }
-  
-  DeserializationError error = deserializeJson(doc, file);
-  file.close();
-  
-  return error == DeserializationError::Ok;
+  storage->writeBehind(CACHE_LIST_FILE, data);
+  return true;
 }
 
-bool TrelloClient::testConnection() {
-  String url = buildUrl("/members/me", "fields=username");
-  
-  httpClient->begin(*secureClient, url);
-  httpClient->addHeader("Content-Type", "application/json");
-  int httpCode = httpClient->GET();
-  httpClient->end();
+void TrelloClient::flushStorage() {
+  MemoryScope memory("flushStorage");
+  cardStore.flush();
+  storage->flush();
+}
+
+bool TrelloClient::invalidateCardCache(const String& cardId) {
+  return cardStore.remove(cardId);
+}
+
+// Applies a check item state change to the cached card without refetching it
+bool TrelloClient::patchCachedCheckItem(const String& cardId, const String& itemId, bool complete) {
+  MemoryScope memory("patchCachedCheckItem");
+  FullCard card;
+  if (!cardStore.get(cardId, card)) {
+    return false;
+  }
   
-  return (httpCode == 200);
+  for (auto& item : card.checklists) {
+    if (itemId == card.str(item.id)) {
+      item.isComplete = complete;
+      return saveToCache(card);
+    }
+  }
+  return false;
 }
 
 String TrelloClient::getLastError() {
-  // This would store the last error message
-  return "Check serial output for details";
+  return lastError.length() > 0 ? lastError : String("No error recorded");
+}
+
+const ConnectionStats& TrelloClient::getConnectionStats() {
+  return transport->getStats();
+}
+
+RequestMetrics& TrelloClient::getRequestMetrics() {
+  return transport->getMetrics();
+}
+
+static void printParseCost(const char* kind, const ParseCost& cost, size_t docCapacity) {
+  if (cost.parses == 0) {
+    return;
+  }
+  Serial.printf("parse kind=%s n=%lu items=%lu ns_per_item=%lu bytes_per_item=%lu "
+                "peak_doc=%u doc_capacity=%u\n",
+                kind, cost.parses, cost.items, cost.nsPerItem(), cost.bytesPerItem(),
+                (unsigned)cost.peakDocBytes, (unsigned)docCapacity);
+}
+
+void TrelloClient::printConnectionStats() {
+  transport->printStats();
+  Serial.printf("Retries: %lu, breaker trips %lu, rejected %lu\n",
+                retries, breaker.getTrips(), breaker.getRejected());
+  transport->getMetrics().printSummary(Serial);
+  printParseCost("list", parseStats.list, json.capacity());
+  printParseCost("details", parseStats.details, json.capacity());
+  json.printStats();
+  MemoryTelemetry::instance().printStats();
+  cardStore.printStats();
+  storage->printStats();
 }
\ No newline at end of file
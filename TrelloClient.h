@@ -6,52 +6,155 @@
 #include <WiFiClientSecure.h>
 #include <HTTPClient.h>
 #include <ArduinoJson.h>
-#include <SD.h>
+#include <StreamString.h>
 #include "config.h"
 #include "DataStructures.h"
+#include "ConnectionManager.h"
+#include "RateLimiter.h"
+#include "RetryPolicy.h"
+#include "CardStore.h"
+#include "CardCodec.h"
+#include "Storage.h"
+#include "JsonBuffer.h"
+
+// What parsing real responses costs per item, so parser or data layout
+// changes can be compared on the device. Times come from the parse phase
+// of RequestMetrics; heap is what the results still hold afterwards.
+struct ParseCost {
+  unsigned long parses;
+  unsigned long items;          // Cards parsed
+  unsigned long long totalUs;
+  unsigned long retainedBytes;  // Approximate: the UI task allocates too
+  size_t peakDocBytes;          // Most of the JSON document ever used
+
+  ParseCost() : parses(0), items(0), totalUs(0), retainedBytes(0), peakDocBytes(0) {}
+
+  unsigned long nsPerItem() const {
+    return items > 0 ? (unsigned long)(totalUs * 1000 / items) : 0;
+  }
+  unsigned long bytesPerItem() const {
+    return items > 0 ? retainedBytes / items : 0;
+  }
+};
+
+struct ParseStats {
+  ParseCost list;      // Card list pages
+  ParseCost details;   // Card details, single or batched
+};
 
 class TrelloClient {
 private:
-  WiFiClientSecure* secureClient;
-  HTTPClient* httpClient;
-  unsigned long lastApiCall;
+  static const int LOCAL_RATE_LIMITED = -100;  // Pseudo HTTP code for a throttled request
+  static const int LOCAL_CIRCUIT_OPEN = -101;  // Pseudo HTTP code while the breaker is open
+  
+  ConnectionManager connection;
+  HttpTransport* transport;   // The connection unless setTransport() replaced it
+  Storage* storage;
+  CardStore cardStore;        // Card details cached on SD
+  String baseUrl;
+  TokenBucket rateLimiter;
+  RetryPolicy retryPolicy;
+  CircuitBreaker breaker;
+  bool retryEnabled;
+  unsigned long retries;
+  String lastError;
+  ParseStats parseStats;
+  JsonBuffer json;          // Every response and payload is parsed or built here
+  size_t peakDocBytes;      // Largest element of the last streamed array
+  unsigned long wifiStartedAt;  // micros() when association began, 0 if not joining
+  volatile uint32_t serverClockOffset;  // Trello's Unix time less millis() in seconds, 0 if unknown
   bool isInitialized;
   
   // Helper methods
   String buildUrl(const String& endpoint, const String& params = "");
-  ApiStatus makeRequest(const String& url, const String& method, const String& payload = "");
-  ApiStatus parseCardList(const DynamicJsonDocument& doc, std::vector<CardSummary>& cards);
-  ApiStatus parseCardDetails(const DynamicJsonDocument& doc, FullCard& card);
-  String getColorFromLabel(const String& color);
-  void enforceRateLimit();
-  bool saveToCache(const String& filename, const DynamicJsonDocument& doc);
-  bool loadFromCache(const String& filename, DynamicJsonDocument& doc);
+  int sendRequest(const String& url, const String& method, const String& payload = "");
+  int sendOnce(const String& url, const String& method, const String& payload);
+  bool probeApi();
+  ApiStatus statusFromHttpCode(int httpCode);
+  void recordError(const String& reason, bool describeRequest = true);
+  void recordParse(ParseCost& cost, size_t items, uint32_t heapBefore, size_t docBytes);
+  ApiStatus recordOverflow(const String& what);
+  JsonDocument& responseDocument();
+  String serializePayload(JsonDocument& payload, ApiStatus& status);
+  ApiStatus parseCardSummary(JsonObject card, CardSummary& summary);
+  ApiStatus parseBoardAction(JsonObject action, BoardAction& result);
+  bool saveToCache(const FullCard& card);
+  bool migrateCardListCache(std::vector<CardSummary>& cards);
   
 public:
-  TrelloClient();
+  explicit TrelloClient(Storage* storage);
   ~TrelloClient();
   
-  // Initialization
+  // Initialization. Both setters must be called before begin().
+  void setBaseUrl(const String& url) { baseUrl = url; }
+  void setTransport(HttpTransport* replacement) { transport = replacement; }
   bool begin();
+  // Starts joining Wi-Fi without waiting; connectWiFi() then waits for it
+  void startWiFi();
   bool connectWiFi();
   void disconnect();
   bool isConnected();
   
   // API Methods
   ApiStatus fetchCardList(std::vector<CardSummary>& cards, bool useCache = false);
+  ApiStatus fetchCardPage(const String& before, int limit, std::vector<CardSummary>& cards,
+                          bool writeCache = false);
   ApiStatus fetchCardDetails(const String& cardId, FullCard& card, bool useCache = false);
+  ApiStatus fetchCardDetailsBatch(const std::vector<String>& cardIds, std::vector<FullCard>& cards);
+  bool loadCachedCardDetails(const String& cardId, FullCard& card);
+  ApiStatus revalidateCard(const String& cardId, const String& lastActivity, 
+                           FullCard& card, bool& changed);
   ApiStatus addComment(const String& cardId, const String& comment);
-  ApiStatus markChecklistItemDone(const String& cardId, const String& checklistId, const String& itemId);
+  ApiStatus setCheckItemState(const String& cardId, const String& itemId, bool complete);
   ApiStatus createCard(const String& name, const String& description = "");
   ApiStatus refreshCard(const String& cardId, FullCard& card);
+  // Looks through this member's newest actions for a comment with exactly
+  // this text on the card, or a card of this name created in the list, no
+  // older than since (Trello's Unix time). cardId is empty for a card.
+  ApiStatus findOwnAction(const String& cardId, const String& text, uint32_t since, bool& found);
+  
+  // Incremental sync
+  ApiStatus fetchBoardActions(const String& since, std::vector<BoardAction>& actions, 
+                              int limit = SYNC_MAX_ACTIONS);
+  ApiStatus fetchLatestActionId(String& actionId);
+  ApiStatus fetchCardSummary(const String& cardId, CardSummary& summary, bool& inList);
   
   // Cache Management
   bool clearCache();
-  bool isCacheValid(const String& filename, unsigned long maxAge = 300000); // 5 minutes default
+  bool saveCardListCache(const std::vector<CardSummary>& cards);
+  bool invalidateCardCache(const String& cardId);
+  bool patchCachedCheckItem(const String& cardId, const String& itemId, bool complete);
+  Storage* getStorage() { return storage; }
+  // Writes out cache updates held back by Storage and CardStore
+  void flushStorage();
+  bool loadCachedCardList(std::vector<CardSummary>& cards);
+  
+  // Parsers, public so the host tests and benchmarks can run them on
+  // fixtures; begin() must have been called
+  ApiStatus parseCardList(Stream& stream, std::vector<CardSummary>& cards, 
+                          std::vector<uint8_t>* cacheOut = nullptr);
+  ApiStatus parseCardDetails(JsonVariantConst doc, FullCard& card);
+  
+  // Details downloaded less than maxAge ago are shown without revalidating
+  static bool isCacheFresh(const FullCard& card, unsigned long maxAge = CARD_FRESH_MS);
   
   // Utility
+  unsigned long getRateLimitWaitMs();
+  unsigned long getUnavailableWaitMs();
+  // Trello's clock, from the Date header of the last response; 0 before any
+  uint32_t getServerTime() const;
+  void setRetryEnabled(bool enabled) { retryEnabled = enabled; }
   String getLastError();
-  bool testConnection();
+  void clearLastError() { lastError = ""; }
+  const ConnectionStats& getConnectionStats();
+  RequestMetrics& getRequestMetrics();
+  const ParseStats& getParseStats() const { return parseStats; }
+  // Most of the JSON document one element of the last streamed array used
+  size_t getPeakDocBytes() const { return peakDocBytes; }
+  // Responses that did not fit the JSON document; each is asked for again
+  // once it has grown
+  unsigned long getJsonOverflows() const { return json.overflowCount(); }
+  void printConnectionStats();
 };
 
 #endif // TRELLO_CLIENT_H
\ No newline at end of file
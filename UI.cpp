@@ -3,17 +3,33 @@
 UI::UI() {
 }
 
-uint16_t UI::getLabelColor(const String& colorName) {
-  if (colorName == "red") return COLOR_RED;
-  if (colorName == "green") return COLOR_GREEN;
-  if (colorName == "blue") return COLOR_BLUE;
-  if (colorName == "yellow") return COLOR_YELLOW;
-  if (colorName == "orange") return COLOR_ORANGE;
-  if (colorName == "purple") return COLOR_PURPLE;
-  if (colorName == "pink") return COLOR_RED;
-  if (colorName == "lime") return COLOR_GREEN;
-  if (colorName == "sky") return COLOR_BLUE;
-  return COLOR_GRAY; // Default for unknown colors
+uint16_t UI::getLabelColor(LabelColor color) {
+  static const uint16_t colors[LABEL_COLOR_COUNT] = {
+    COLOR_GREEN,    // LABEL_GREEN
+    COLOR_YELLOW,   // LABEL_YELLOW
+    COLOR_ORANGE,   // LABEL_ORANGE
+    COLOR_RED,      // LABEL_RED
+    COLOR_PURPLE,   // LABEL_PURPLE
+    COLOR_BLUE,     // LABEL_BLUE
+    COLOR_BLUE,     // LABEL_SKY
+    COLOR_GREEN,    // LABEL_LIME
+    COLOR_RED,      // LABEL_PINK
+    COLOR_GRAY,     // LABEL_BLACK
+    COLOR_GRAY      // LABEL_OTHER
+  };
+  return colors[color];
+}
+
+// One square per color on the card, at most maxLabels of them
+void UI::drawLabels(const CardSummary& card, int x, int y, int maxLabels) {
+  int drawn = 0;
+  for (int color = 0; color < LABEL_COLOR_COUNT && drawn < maxLabels; color++) {
+    if (card.hasLabel((LabelColor)color)) {
+      M5Cardputer.Display.fillRect(x + drawn * 4, y, LABEL_INDICATOR_SIZE, 
+                                  LABEL_INDICATOR_SIZE, getLabelColor((LabelColor)color));
+      drawn++;
+    }
+  }
 }
 
 void UI::clearScreen() {
@@ -165,23 +181,27 @@ void UI::renderSplashScreen() {
   dotCount++;
 }
 
-void UI::renderListView(const std::vector<CardSummary>& cards, int selectedIndex, 
-                       int currentPage, int totalPages, bool isOnline) {
+// cards holds the loaded part of the list, starting at list index listOffset;
+// rows outside it are still being paged in
+void UI::renderListView(const std::vector<CardSummary>& cards, int listOffset, 
+                       int totalCards, int selectedIndex, int currentPage, 
+                       int totalPages, bool isOnline, bool isStale) {
   clearScreen();
   
   // Header
   drawHeader("Trello Cards");
   drawScrollIndicator(currentPage, totalPages);
-  drawStatusBar(isOnline);
+  drawStatusBar(isOnline, isStale);
   
   // Cards list
   int startY = MARGIN + LINE_HEIGHT * 3;
   int startIndex = currentPage * CARDS_PER_PAGE;
-  int endIndex = min(startIndex + CARDS_PER_PAGE, (int)cards.size());
+  int endIndex = min(startIndex + CARDS_PER_PAGE, totalCards);
   
-  for (int i = startIndex; i < endIndex; i++) {
-    int itemY = startY + (i - startIndex) * CARD_ITEM_HEIGHT;
-    bool isSelected = (i == selectedIndex);
+  for (int row = startIndex; row < endIndex; row++) {
+    int itemY = startY + (row - startIndex) * CARD_ITEM_HEIGHT;
+    bool isSelected = (row == selectedIndex);
+    int i = row - listOffset;
     
     // Selection highlight
     if (isSelected) {
@@ -194,18 +214,20 @@ void UI::renderListView(const std::vector<CardSummary>& cards, int selectedIndex
     M5Cardputer.Display.setCursor(MARGIN, itemY);
     M5Cardputer.Display.print(isSelected ? ">" : " ");
     
+    if (i < 0 || i >= (int)cards.size()) {
+      M5Cardputer.Display.setTextColor(isSelected ? COLOR_BLACK : COLOR_GRAY);
+      M5Cardputer.Display.setCursor(MARGIN + 10, itemY);
+      M5Cardputer.Display.print("Loading...");
+      continue;
+    }
+    
     // Card name
     String displayName = truncateText(cards[i].name, 30);
     M5Cardputer.Display.setCursor(MARGIN + 10, itemY);
     M5Cardputer.Display.print(displayName);
     
     // Label indicators
-    int labelX = SCREEN_WIDTH - 30;
-    for (int j = 0; j < min(3, (int)cards[i].labelColors.size()); j++) {
-      uint16_t color = getLabelColor(cards[i].labelColors[j]);
-      M5Cardputer.Display.fillRect(labelX + j * 4, itemY + 2, 
-                                  LABEL_INDICATOR_SIZE, LABEL_INDICATOR_SIZE, color);
-    }
+    drawLabels(cards[i], SCREEN_WIDTH - 30, itemY + 2, 3);
     
     // Done indicator
     if (cards[i].isDone) {
@@ -222,40 +244,41 @@ void UI::renderListView(const std::vector<CardSummary>& cards, int selectedIndex
   drawFooter("ENTER:Open C:Comment N:New", "B:Back");
   
   // Empty list message
-  if (cards.empty()) {
+  if (totalCards == 0) {
     M5Cardputer.Display.setTextColor(COLOR_GRAY);
     M5Cardputer.Display.setCursor(60, 60);
     M5Cardputer.Display.print("No cards found");
   }
 }
 
-void UI::renderCardDetail(const FullCard& card, int scrollPosition) {
+void UI::renderCardDetail(const FullCard& card, int scrollPosition, bool isOnline, bool isStale) {
   clearScreen();
   
   // Header with card name
   String headerName = truncateText(card.summary.name, 35);
   drawHeader("Card Details", headerName);
+  drawStatusBar(isOnline, isStale);
   
   int contentY = MARGIN + LINE_HEIGHT * 3;
   int scrollY = contentY - scrollPosition;
   
   // Description
-  if (card.description.length() > 0) {
+  if (card.description.length > 0) {
     M5Cardputer.Display.setTextColor(COLOR_WHITE);
     M5Cardputer.Display.setCursor(MARGIN, scrollY);
     M5Cardputer.Display.print("Description:");
     scrollY += LINE_HEIGHT;
     
     M5Cardputer.Display.setTextColor(COLOR_GRAY);
-    drawWrappedText(card.description, MARGIN, scrollY, SCREEN_WIDTH - 2 * MARGIN, 4);
+    drawWrappedText(card.str(card.description), MARGIN, scrollY, SCREEN_WIDTH - 2 * MARGIN, 4);
     scrollY += LINE_HEIGHT * 4;
   }
   
   // Due date
-  if (card.summary.hasDueDate && card.dueDate.length() > 0) {
+  if (card.summary.hasDueDate && card.dueDate.length > 0) {
     M5Cardputer.Display.setTextColor(COLOR_YELLOW);
     M5Cardputer.Display.setCursor(MARGIN, scrollY);
-    M5Cardputer.Display.print("Due: " + card.dueDate.substring(0, 10));
+    M5Cardputer.Display.print("Due: " + String(card.str(card.dueDate)).substring(0, 10));
     scrollY += LINE_HEIGHT;
   }
   
@@ -272,7 +295,7 @@ void UI::renderCardDetail(const FullCard& card, int scrollPosition) {
       M5Cardputer.Display.setTextColor(item.isComplete ? COLOR_GREEN : COLOR_GRAY);
       M5Cardputer.Display.setCursor(MARGIN, scrollY);
       String checkbox = item.isComplete ? "[x] " : "[ ] ";
-      String itemText = checkbox + truncateText(item.name, 30);
+      String itemText = checkbox + truncateText(card.str(item.name), 30);
       M5Cardputer.Display.print(itemText);
       scrollY += LINE_HEIGHT;
     }
@@ -290,20 +313,13 @@ void UI::renderCardDetail(const FullCard& card, int scrollPosition) {
       if (scrollY >= SCREEN_HEIGHT - LINE_HEIGHT * 3) break;
       
       M5Cardputer.Display.setTextColor(COLOR_BLUE);
-      drawWrappedText(comment, MARGIN, scrollY, SCREEN_WIDTH - 2 * MARGIN, 2);
+      drawWrappedText(card.str(comment), MARGIN, scrollY, SCREEN_WIDTH - 2 * MARGIN, 2);
       scrollY += LINE_HEIGHT * 2;
     }
   }
   
   // Labels display
-  if (!card.summary.labelColors.empty()) {
-    int labelY = MARGIN + LINE_HEIGHT;
-    for (int i = 0; i < min(5, (int)card.summary.labelColors.size()); i++) {
-      uint16_t color = getLabelColor(card.summary.labelColors[i]);
-      M5Cardputer.Display.fillRect(SCREEN_WIDTH - 25 + i * 4, labelY, 
-                                  LABEL_INDICATOR_SIZE, LABEL_INDICATOR_SIZE, color);
-    }
-  }
+  drawLabels(card.summary, SCREEN_WIDTH - 25, MARGIN + LINE_HEIGHT, 5);
   
   // Footer
   drawFooter("C:Comment D:Done", "UP/DN:Scroll B:Back");
@@ -16,7 +16,8 @@ private:
   static const int MAX_LINES = 10;
   
   // Color mapping for labels
-  uint16_t getLabelColor(const String& colorName);
+  uint16_t getLabelColor(LabelColor color);
+  void drawLabels(const CardSummary& card, int x, int y, int maxLabels);
   
   // Text handling
   void drawWrappedText(const String& text, int x, int y, int maxWidth, int maxLines = -1);
@@ -27,16 +28,18 @@ private:
   void drawHeader(const String& title, const String& subtitle = "");
   void drawFooter(const String& leftText = "", const String& rightText = "");
   void drawScrollIndicator(int currentPage, int totalPages);
-  void drawStatusBar(bool online, bool cacheMode = false);
+  void drawStatusBar(bool online, bool cacheMode = false);  // cacheMode: cached data not yet revalidated
   
 public:
   UI();
   
   // Screen rendering methods
   void renderSplashScreen();
-  void renderListView(const std::vector<CardSummary>& cards, int selectedIndex, 
-                     int currentPage, int totalPages, bool isOnline);
-  void renderCardDetail(const FullCard& card, int scrollPosition = 0);
+  void renderListView(const std::vector<CardSummary>& cards, int listOffset, 
+                     int totalCards, int selectedIndex, int currentPage, 
+                     int totalPages, bool isOnline, bool isStale = false);
+  void renderCardDetail(const FullCard& card, int scrollPosition = 0, 
+                       bool isOnline = true, bool isStale = false);
   void renderAddComment(const String& cardName, const String& inputBuffer, 
                        int cursorPosition);
   void renderCreateCard(const String& nameBuffer, const String& descBuffer, 
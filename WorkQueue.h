@@ -0,0 +1,178 @@
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(ARDUINO)
+#include <Arduino.h>
+#else
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#endif
+
+// Bounded, thread-safe FIFO of heap-allocated items. Ownership of an item
+// passes to the queue on push() and to the caller on pop(). On the device it
+// wraps a FreeRTOS queue of pointers; on Linux it uses std::mutex so the same
+// producer/consumer logic can be exercised with std::thread.
+template <typename T>
+class WorkQueue {
+private:
+#if defined(ARDUINO)
+  QueueHandle_t handle;
+#else
+  std::mutex lock;
+  std::condition_variable ready;
+  std::deque<T*> items;
+  size_t depth;
+#endif
+
+  WorkQueue(const WorkQueue&);
+  WorkQueue& operator=(const WorkQueue&);
+
+public:
+  static const unsigned long WAIT_FOREVER = 0xFFFFFFFFUL;
+
+#if defined(ARDUINO)
+  explicit WorkQueue(size_t depth) {
+    handle = xQueueCreate(depth, sizeof(T*));
+  }
+
+  ~WorkQueue() {
+    T* item;
+    while (handle && xQueueReceive(handle, &item, 0) == pdTRUE) {
+      delete item;
+    }
+    if (handle) {
+      vQueueDelete(handle);
+    }
+  }
+
+  bool push(T* item, unsigned long timeoutMs = 0) {
+    TickType_t ticks = timeoutMs == WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+    return handle && xQueueSendToBack(handle, &item, ticks) == pdTRUE;
+  }
+
+  // Jumps ahead of everything already queued
+  bool pushFront(T* item, unsigned long timeoutMs = 0) {
+    TickType_t ticks = timeoutMs == WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+    return handle && xQueueSendToFront(handle, &item, ticks) == pdTRUE;
+  }
+
+  // Returns nullptr if nothing arrived within the timeout
+  T* pop(unsigned long timeoutMs = 0) {
+    T* item = nullptr;
+    TickType_t ticks = timeoutMs == WAIT_FOREVER ? portMAX_DELAY : pdMS_TO_TICKS(timeoutMs);
+    if (!handle || xQueueReceive(handle, &item, ticks) != pdTRUE) {
+      return nullptr;
+    }
+    return item;
+  }
+
+  size_t size() {
+    return handle ? uxQueueMessagesWaiting(handle) : 0;
+  }
+#else
+  explicit WorkQueue(size_t depth) : depth(depth) {}
+
+  ~WorkQueue() {
+    for (T* item : items) {
+      delete item;
+    }
+  }
+
+  bool push(T* item, unsigned long timeoutMs = 0) {
+    return insert(item, timeoutMs, false);
+  }
+
+  bool pushFront(T* item, unsigned long timeoutMs = 0) {
+    return insert(item, timeoutMs, true);
+  }
+
+  T* pop(unsigned long timeoutMs = 0) {
+    std::unique_lock<std::mutex> guard(lock);
+    if (!waitFor(guard, timeoutMs, [this] { return !items.empty(); })) {
+      return nullptr;
+    }
+    T* item = items.front();
+    items.pop_front();
+    ready.notify_all();
+    return item;
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> guard(lock);
+    return items.size();
+  }
+
+private:
+  template <typename Predicate>
+  bool waitFor(std::unique_lock<std::mutex>& guard, unsigned long timeoutMs, Predicate predicate) {
+    if (timeoutMs == WAIT_FOREVER) {
+      ready.wait(guard, predicate);
+      return true;
+    }
+    return ready.wait_for(guard, std::chrono::milliseconds(timeoutMs), predicate);
+  }
+
+  bool insert(T* item, unsigned long timeoutMs, bool front) {
+    std::unique_lock<std::mutex> guard(lock);
+    if (!waitFor(guard, timeoutMs, [this] { return items.size() < depth; })) {
+      return false;
+    }
+    if (front) {
+      items.push_front(item);
+    } else {
+      items.push_back(item);
+    }
+    ready.notify_all();
+    return true;
+  }
+#endif
+};
+
+// Long-running worker: a FreeRTOS task pinned to a core on the device,
+// a detached std::thread on Linux
+class WorkerThread {
+private:
+#if defined(ARDUINO)
+  TaskHandle_t handle;
+#else
+  bool started;
+#endif
+
+public:
+#if defined(ARDUINO)
+  WorkerThread() : handle(nullptr) {}
+
+  bool start(void (*entry)(void*), void* arg, const char* name,
+             uint32_t stackSize, int priority, int core) {
+    if (handle) {
+      return true;
+    }
+    return xTaskCreatePinnedToCore(entry, name, stackSize, arg, priority,
+                                   &handle, core) == pdPASS;
+  }
+
+  bool isRunning() const { return handle != nullptr; }
+#else
+  WorkerThread() : started(false) {}
+
+  bool start(void (*entry)(void*), void* arg, const char*,
+             uint32_t, int, int) {
+    if (started) {
+      return true;
+    }
+    std::thread(entry, arg).detach();
+    started = true;
+    return true;
+  }
+
+  bool isRunning() const { return started; }
+#endif
+};
+
+#endif // WORK_QUEUE_H
@@ -10,14 +10,59 @@
 
 // WiFi Configuration
 // Replace these with your WiFi credentials
-const char* WIFI_SSID = "your_wifi_ssid";
-const char* WIFI_PASSWORD = "your_wifi_password";
+static const char* const WIFI_SSID = "your_wifi_ssid";
+static const char* const WIFI_PASSWORD = "your_wifi_password";
 
 // API Configuration
-#define TRELLO_BASE_URL "https://api.trello.com/1"
-#define MAX_RETRIES 3
-#define RETRY_DELAY_MS 2000
-#define API_RATE_LIMIT_DELAY_MS 5000
+#define TRELLO_BASE_URL "https://api.trello.com/1"   // http://host:port/1 for a local stand-in server
+#define MAX_RETRIES 3                     // Extra attempts after a transient failure...
+#define RETRY_DELAY_MS 2000               // ...starting this far apart, doubling each time...
+#define RETRY_MAX_DELAY_MS 15000          // ...up to this
+#define CIRCUIT_FAILURE_THRESHOLD 5       // Consecutive failures before requests fail fast
+#define CIRCUIT_OPEN_MS 30000             // First wait before probing the API again
+#define CIRCUIT_MAX_OPEN_MS 300000        // Longest wait between probes
+#define API_RATE_LIMIT_REQUESTS 100      // Trello allows 100 requests per token...
+#define API_RATE_LIMIT_WINDOW_MS 10000   // ...every 10 seconds
+#define API_RATE_LIMIT_DELAY_MS 5000     // Initial back-off after a 429
+
+// HTTP Compression
+#define HTTP_ACCEPT_GZIP true             // Ask for gzip; JSON shrinks 5-8x on the air
+#define GZIP_INPUT_BUFFER 512             // Compressed bytes read from the socket at a time
+
+// Request Metrics
+#define METRICS_SAMPLE_COUNT 32           // Requests kept for the latency summaries
+#define METRICS_LABEL_LENGTH 48           // Method and path kept per request
+
+// Network Task (runs on the core not used by loop())
+#define NETWORK_TASK_CORE 0
+#define NETWORK_TASK_PRIORITY 1
+#define NETWORK_TASK_STACK_SIZE 12288
+#define NETWORK_QUEUE_DEPTH 16
+#define NETWORK_RATE_LIMIT_RETRIES 3
+
+// Offline Changes
+#define MUTATION_LOG_FILE "/mutations.log"
+#define PENDING_CARD_PREFIX "pending-"        // Id of a card created while offline
+#define OFFLINE_RECONNECT_INTERVAL_MS 30000   // Reconnect attempts while changes are queued
+#define MUTATION_CLOCK_SLACK_S 3              // Date headers and Trello ids only give whole seconds
+#define MUTATION_VERIFY_LIMIT 50              // Own actions searched for a change that may have landed
+
+// Incremental Sync
+#define SYNC_STATE_FILE "/sync_state.txt"     // Id of the newest board action applied
+#define SYNC_INTERVAL_MS 300000
+#define SYNC_MAX_ACTIONS 50                   // Larger deltas fall back to a full list fetch
+#define SYNC_MAX_CARD_FETCHES 8               // Cards re-read one by one per delta
+
+// Card Detail Prefetch
+#define CARD_CACHE_PSRAM_BYTES 1048576   // Encoded details kept in RAM with PSRAM...
+#define CARD_CACHE_HEAP_BYTES 32768      // ...and without: two pages plus recently opened
+#define PREFETCH_PAGES 2          // Current page and the next
+#define PREFETCH_POLL_MS 100      // How often an idle network task checks for prefetch work
+
+// List Paging
+#define LIST_CHUNK_SIZE 25        // Cards per list request (five screen pages)
+#define LIST_LOOKAHEAD_PAGES 1    // Screen pages loaded ahead of the cursor
+#define LIST_RESIDENT_MARGIN 1    // Chunks kept in RAM either side of the visible one
 
 // Display Configuration
 #define CARDS_PER_PAGE 5
@@ -28,9 +73,42 @@ const char* WIFI_PASSWORD = "your_wifi_password";
 #define IDLE_TIMEOUT_MS 300000  // 5 minutes
 
 // Cache Configuration
-#define CACHE_LIST_FILE "/cache_list.json"
-#define CACHE_DETAILS_PREFIX "/cache_detail_"
+#define CACHE_LIST_FILE "/cache_list.bin"       // First chunk of the list, see CardCodec
+#define CACHE_LIST_JSON_FILE "/cache_list.json" // Its old JSON form, converted on first start
+#define CACHE_DETAILS_PREFIX "/cache_detail_"   // Old per-card files, removed on first start
+#define CARD_STORE_FILE "/cards.log"            // Card details, see CardStore
+#define CARD_STORE_COMPACT_PERCENT 50           // Compact once this much of the log is dead...
+#define CARD_STORE_COMPACT_MIN_BYTES 65536      // ...and it has grown past this
+#define CARD_FRESH_MS 60000                     // Cached details older than this are shown, then revalidated
 #define MAX_CACHE_SIZE 4096
+#define STRING_POOL_CHUNK_BYTES 8192            // Card names are interned in blocks of this size
+#define TEXT_ARENA_MIN_BYTES 512                // Smallest block for a card's text
+
+// Storage
+#define STORAGE_WRITE_BEHIND_BYTES 16384        // Past this, queued cache writes are flushed between network jobs
+
+// Resume
+#define SNAPSHOT_FILE "/state.bin"              // Last screen, list window and open card
+#define SNAPSHOT_IDLE_MS 3000                   // Saved once keys have been idle this long...
+#define SNAPSHOT_INTERVAL_MS 60000              // ...and at least this often while in use
+
+// Memory telemetry
+#define MEMORY_HISTORY_COUNT 60                 // Heap samples kept, one per...
+#define MEMORY_HISTORY_INTERVAL_MS 60000        // ...this long, so the last hour
+#define MEMORY_SCREEN_SAMPLE_MS 1000            // Heap checked at most this often on one screen
+#define MEMORY_SCREEN_SLOTS 8                   // Screens tracked
+#define MEMORY_CALL_SLOTS 20                    // TrelloClient calls tracked
+#define MEMORY_FRAGMENTATION_RISE_PCT 10        // Flagged when fragmentation rises this much over the history...
+#define MEMORY_LOW_BLOCK_BYTES 16384            // ...or the largest block is smaller than a TLS record buffer
+
+// JSON Parsing
+#define JSON_DOC_MIN_BYTES 4096          // The shared JSON document starts at this size...
+#define JSON_DOC_MAX_BYTES 262144        // ...and grows no further than this in PSRAM...
+#define JSON_DOC_HEAP_MAX_BYTES 32768    // ...or this without PSRAM
+#define JSON_GZIP_RATIO 6                // Assumed inflated bytes per gzip byte, for sizing it
+
+// Batch API
+#define BATCH_MAX_URLS 10           // Trello's limit on routes per /batch call
 
 // UI Colors (16-bit RGB565)
 #define COLOR_BLACK 0x0000
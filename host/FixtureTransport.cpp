@@ -0,0 +1,320 @@
+#include "FixtureTransport.h"
+#include <HTTPClient.h>
+#include <string.h>
+#include <time.h>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "config.h"
+#include "RetryPolicy.h"
+
+const FaultProfile FAULTS_NONE = {"none", 0, 0, 0, 0, 0, 0, 0, 0, 10000, 0};
+
+// Bodies arrive in TCP segments, each after the one before it
+static const size_t SEGMENT_BYTES = 1460;
+
+// The path without the scheme, host, API version or query
+static String pathOf(const String& url) {
+  int pathStart = url.indexOf("://");
+  pathStart = url.indexOf('/', pathStart < 0 ? 0 : pathStart + 3);
+  if (pathStart < 0) {
+    return "/";
+  }
+  int queryStart = url.indexOf('?');
+  String path = url.substring(pathStart, queryStart < 0 ? url.length() : queryStart);
+  if (path.startsWith("/1/")) {
+    path = path.substring(2);
+  }
+  return path;
+}
+
+static std::vector<String> segments(const String& path) {
+  std::vector<String> parts;
+  int start = path.startsWith("/") ? 1 : 0;
+  while (start <= (int)path.length()) {
+    int end = path.indexOf('/', start);
+    if (end < 0) {
+      end = path.length();
+    }
+    parts.push_back(path.substring(start, end));
+    start = end + 1;
+  }
+  return parts;
+}
+
+void FixtureTransport::FixtureBody::reset(const String* text, unsigned long rate) {
+  body = text;
+  pos = 0;
+  bytesPerSecond = rate;
+  waitUs = 0;
+  paidUpTo = 0;
+}
+
+void FixtureTransport::FixtureBody::arrive(size_t upTo) {
+  if (bytesPerSecond == 0 || upTo <= paidUpTo) {
+    return;
+  }
+  size_t length = body ? body->length() : 0;
+  size_t target = min(length, (upTo + SEGMENT_BYTES - 1) / SEGMENT_BYTES * SEGMENT_BYTES);
+  unsigned long long us = (unsigned long long)(target - paidUpTo) * 1000000ULL / bytesPerSecond;
+  FixtureTransport::pass(us);
+  waitUs += us;
+  paidUpTo = target;
+}
+
+int FixtureTransport::FixtureBody::available() {
+  return body ? body->length() - pos : 0;
+}
+
+int FixtureTransport::FixtureBody::read() {
+  if (!body || pos >= body->length()) {
+    return -1;
+  }
+  arrive(pos + 1);
+  return (uint8_t)(*body)[pos++];
+}
+
+int FixtureTransport::FixtureBody::peek() {
+  if (!body || pos >= body->length()) {
+    return -1;
+  }
+  arrive(pos + 1);
+  return (uint8_t)(*body)[pos];
+}
+
+size_t FixtureTransport::FixtureBody::readBytes(char* buffer, size_t length) {
+  size_t count = body ? min(length, body->length() - pos) : 0;
+  arrive(pos + count);
+  memcpy(buffer, body ? body->c_str() + pos : "", count);
+  pos += count;
+  return count;
+}
+
+FixtureTransport::FixtureTransport()
+  : outageCode(0), outageUntil(0), profile(FAULTS_NONE), connected(false),
+    requestOpen(false), bodyStartedAt(0), windowStart(0), windowRequests(0) {
+}
+
+bool FixtureTransport::matches(const String& pattern, const String& path) {
+  std::vector<String> want = segments(pattern);
+  std::vector<String> got = segments(path);
+  if (want.size() != got.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < want.size(); i++) {
+    if (want[i] != "*" && want[i] != got[i]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Waits on whichever clock the host runs
+void FixtureTransport::pass(unsigned long long us) {
+  if (HostClock::isSimulated()) {
+    HostClock::advanceMicros(us);
+  } else {
+    std::this_thread::sleep_for(std::chrono::microseconds(us));
+  }
+}
+
+bool FixtureTransport::chance(int percent) {
+  return percent > 0 && random(100) < percent;
+}
+
+// Scripted failures first, then the profile's; 0 when the request goes through
+int FixtureTransport::injectedFault() {
+  if (!forced.empty()) {
+    int httpCode = forced.front();
+    forced.erase(forced.begin());
+    return httpCode;
+  }
+  if (outageCode != 0 && (long)(outageUntil - millis()) > 0) {
+    return outageCode;
+  }
+  if (chance(profile.refusedPercent)) {
+    return HTTPC_ERROR_CONNECTION_REFUSED;
+  }
+  if (chance(profile.timeoutPercent)) {
+    return HTTPC_ERROR_READ_TIMEOUT;
+  }
+  if (chance(profile.serverErrorPercent)) {
+    return 503;
+  }
+  if (chance(profile.rateLimitPercent)) {
+    return 429;
+  }
+  return 0;
+}
+
+void FixtureTransport::route(const char* method, const char* pattern, FixtureHandler handler) {
+  routes.push_back({method, pattern, handler});
+}
+
+void FixtureTransport::route(const char* method, const char* pattern, int httpCode,
+                             const String& body) {
+  route(method, pattern, [httpCode, body](const String&, const String&) {
+    return FixtureResponse{httpCode, body};
+  });
+}
+
+bool FixtureTransport::routeFile(const char* method, const char* pattern, const char* path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    Serial.println("Fixture " + String(path) + " could not be read");
+    return false;
+  }
+  std::ostringstream text;
+  text << file.rdbuf();
+  route(method, pattern, 200, String(text.str()));
+  return true;
+}
+
+void FixtureTransport::failNext(int httpCode, int count) {
+  forced.insert(forced.end(), count, httpCode);
+}
+
+void FixtureTransport::failUntil(unsigned long until, int httpCode) {
+  outageUntil = until;
+  outageCode = httpCode;
+}
+
+size_t FixtureTransport::countRequests(const char* method, const char* pattern) const {
+  size_t count = 0;
+  for (const FixtureRequest& request : log) {
+    if (request.method == method && matches(pattern, request.path)) {
+      count++;
+    }
+  }
+  return count;
+}
+
+int FixtureTransport::sendRequest(const String& url, const String& method,
+                                  const String& payload) {
+  if (requestOpen) {
+    release();
+  }
+  metrics.begin(method, url);
+  String path = pathOf(url);
+  unsigned long sentAt = millis();
+  remainingHeader = "";
+  int fault = injectedFault();
+
+  // A refused connection costs the attempt and nothing reaches the server
+  if (RetryPolicy::wasNotSent(fault)) {
+    pass(profile.handshakeMs * 1000ULL);
+    connected = false;
+    metrics.setHttpCode(fault);
+    log.push_back({method, path, fault, sentAt});
+    return fault;
+  }
+
+  bool reused = connected;
+  if (!connected) {
+    pass(profile.handshakeMs * 1000ULL);
+    metrics.record(PHASE_TLS, profile.handshakeMs * 1000UL);
+    stats.handshakes++;
+    stats.totalHandshakeMs += profile.handshakeMs;
+    connected = true;
+  }
+  stats.requests++;
+  if (reused) {
+    stats.reusedRequests++;
+  }
+
+  // Sent, but the answer never comes or the connection drops on the way
+  if (fault < 0) {
+    unsigned long waitMs = fault == HTTPC_ERROR_READ_TIMEOUT ? profile.timeoutMs : profile.latencyMs;
+    pass(waitMs * 1000ULL);
+    metrics.record(PHASE_TTFB, waitMs * 1000UL);
+    metrics.setHttpCode(fault);
+    connected = false;
+    log.push_back({method, path, fault, sentAt});
+    return fault;
+  }
+
+  unsigned long ttfbMs = profile.latencyMs + (profile.jitterMs > 0 ? random(profile.jitterMs + 1) : 0);
+  pass(ttfbMs * 1000ULL);
+  metrics.record(PHASE_TTFB, ttfbMs * 1000UL);
+
+  // The server counts every request that reaches it, even those it fails
+  if (profile.serverLimit > 0) {
+    if (millis() - windowStart >= API_RATE_LIMIT_WINDOW_MS) {
+      windowStart = millis();
+      windowRequests = 0;
+    }
+    windowRequests++;
+    remainingHeader = String(max(0, profile.serverLimit - windowRequests));
+    if (windowRequests > profile.serverLimit && fault == 0) {
+      fault = 429;
+    }
+  }
+
+  FixtureResponse response = {404, "The requested resource was not found."};
+  if (fault == 429) {
+    response = {429, "{\"message\":\"API_TOKEN_LIMIT_EXCEEDED\"}"};
+  } else if (fault > 0) {
+    response = {fault, "Service Unavailable"};
+  } else {
+    for (const Route& candidate : routes) {
+      if (candidate.method == method && matches(candidate.pattern, path)) {
+        response = candidate.handler(url, payload);
+        break;
+      }
+    }
+  }
+
+  metrics.setHttpCode(response.httpCode);
+  log.push_back({method, path, response.httpCode, sentAt});
+  responseBody = response.body;
+  bodyStream.reset(&responseBody, profile.bytesPerSecond);
+  bodyStartedAt = micros();
+  requestOpen = true;
+  return response.httpCode;
+}
+
+String FixtureTransport::header(const char* name) {
+  if (strcasecmp(name, "x-rate-limit-api-token-remaining") == 0) {
+    return remainingHeader;
+  }
+  if (strcasecmp(name, "Date") == 0 && requestOpen) {
+    time_t now = serverTime();
+    struct tm parts;
+    char date[32];
+    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", gmtime_r(&now, &parts));
+    return date;
+  }
+  return "";
+}
+
+void FixtureTransport::release() {
+  if (!requestOpen) {
+    return;
+  }
+  // Reading less waiting for the bytes went into parsing, as on the device
+  unsigned long readUs = micros() - bodyStartedAt;
+  unsigned long long waitUs = bodyStream.waitMicros();
+  if (bodyStream.bytesConsumed() > 0) {
+    metrics.record(PHASE_PARSE, readUs > waitUs ? readUs - waitUs : 0);
+  }
+  bodyStream.drain();
+  metrics.record(PHASE_BODY, bodyStream.waitMicros());
+  metrics.setBytes(responseBody.length());
+  stats.bodyBytes += responseBody.length();
+  stats.decodedBytes += responseBody.length();
+  bodyStream.reset(nullptr, 0);
+  requestOpen = false;
+}
+
+void FixtureTransport::close() {
+  requestOpen = false;
+  bodyStream.reset(nullptr, 0);
+  connected = false;
+}
+
+void FixtureTransport::printStats() {
+  Serial.printf("Fixtures (%s): %lu requests, %lu handshakes, %lu reused, %lu body bytes\n",
+                profile.name, stats.requests, stats.handshakes, stats.reusedRequests,
+                stats.bodyBytes);
+}
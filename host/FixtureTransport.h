@@ -0,0 +1,146 @@
+#ifndef FIXTURE_TRANSPORT_H
+#define FIXTURE_TRANSPORT_H
+
+// Stands in for ConnectionManager on the host: TrelloClient's requests are
+// answered from fixtures rather than the network, over a connection with
+// the handshakes, latency, bandwidth and failures a real one has. Waiting
+// happens on HostClock, so with a simulated clock a scenario that would
+// take minutes on the device runs at once and gives the same figures every
+// run. Faults are drawn from random(), which the host seeds the same way
+// every time.
+
+#include <Arduino.h>
+#include <functional>
+#include <vector>
+#include "HttpTransport.h"
+
+struct FixtureResponse {
+  int httpCode;
+  String body;
+};
+
+// Builds a response from the request; url includes the query
+typedef std::function<FixtureResponse(const String& url, const String& payload)> FixtureHandler;
+
+// What the connection and the server are like. Percentages are of requests.
+struct FaultProfile {
+  const char* name;
+  unsigned long handshakeMs;     // Each new connection
+  unsigned long latencyMs;       // Request sent to first byte of the answer
+  unsigned long jitterMs;        // Up to this much more, at random
+  unsigned long bytesPerSecond;  // Body download; 0 for no limit
+  int rateLimitPercent;          // Answered 429 on top of the server's own limit
+  int serverErrorPercent;        // Answered 503
+  int refusedPercent;            // Connection refused; nothing was sent
+  int timeoutPercent;            // Sent, then no answer before timeoutMs
+  unsigned long timeoutMs;
+  int serverLimit;               // Requests per API_RATE_LIMIT_WINDOW_MS; 0 for none
+};
+
+// A fast wired connection to a server that never fails
+extern const FaultProfile FAULTS_NONE;
+
+// One request as the server saw it
+struct FixtureRequest {
+  String method;
+  String path;
+  int httpCode;
+  unsigned long at;    // millis() when it was sent
+};
+
+class FixtureTransport : public HttpTransport {
+private:
+  // The body as it arrives, at the profile's bandwidth
+  class FixtureBody : public Stream {
+  private:
+    const String* body;
+    size_t pos;
+    unsigned long bytesPerSecond;
+    unsigned long long waitUs;
+    size_t paidUpTo;            // Bytes whose download time has been waited
+
+    void arrive(size_t upTo);
+
+  public:
+    FixtureBody() : body(nullptr), pos(0), bytesPerSecond(0), waitUs(0), paidUpTo(0) {}
+    void reset(const String* text, unsigned long rate);
+    void drain() { pos = body ? body->length() : 0; arrive(pos); }
+    size_t bytesConsumed() const { return pos; }
+    unsigned long long waitMicros() const { return waitUs; }
+
+    int available() override;
+    int read() override;
+    int peek() override;
+    size_t readBytes(char* buffer, size_t length) override;
+    size_t write(uint8_t) override { return 0; }
+  };
+
+  struct Route {
+    String method;
+    String pattern;
+    FixtureHandler handler;
+  };
+
+  std::vector<Route> routes;
+  std::vector<FixtureRequest> log;
+  std::vector<int> forced;      // Answers for the next requests, in order
+  int outageCode;
+  unsigned long outageUntil;
+  FaultProfile profile;
+  ConnectionStats stats;
+  RequestMetrics metrics;
+  String responseBody;
+  String remainingHeader;
+  FixtureBody bodyStream;
+  bool connected;
+  bool requestOpen;
+  unsigned long bodyStartedAt;
+  unsigned long windowStart;
+  int windowRequests;
+
+  static bool matches(const String& pattern, const String& path);
+  static void pass(unsigned long long us);
+  bool chance(int percent);
+  int injectedFault();
+
+public:
+  FixtureTransport();
+
+  // Routes match on method and path; '*' stands for one path segment,
+  // as in "/cards/*/actions/comments". The first route added that
+  // matches answers; anything else gets a 404.
+  void route(const char* method, const char* pattern, FixtureHandler handler);
+  void route(const char* method, const char* pattern, int httpCode, const String& body);
+  // A response saved from the real API
+  bool routeFile(const char* method, const char* pattern, const char* path);
+
+  void setProfile(const FaultProfile& faults) { profile = faults; }
+  const FaultProfile& getProfile() const { return profile; }
+  // The next count requests get httpCode, whatever the profile says
+  void failNext(int httpCode, int count = 1);
+  // Every request gets httpCode until millis() reaches until
+  void failUntil(unsigned long until, int httpCode);
+
+  // The server's clock, Unix seconds: 2026-10-16 09:30 UTC when millis()
+  // was 0. Sent in the Date header of every answer.
+  static uint32_t serverTime() { return 1792143000 + millis() / 1000; }
+
+  const std::vector<FixtureRequest>& getLog() const { return log; }
+  size_t countRequests(const char* method, const char* pattern) const;
+  void clearLog() { log.clear(); }
+
+  // HttpTransport
+  int sendRequest(const String& url, const String& method,
+                  const String& payload = "") override;
+  Stream& getBody() override { return bodyStream; }
+  int getSize() override { return requestOpen ? responseBody.length() : -1; }
+  String header(const char* name) override;
+  void release() override;
+  void close() override;
+
+  const ConnectionStats& getStats() const override { return stats; }
+  RequestMetrics& getMetrics() override { return metrics; }
+  void printStats() override;
+};
+
+#endif // FIXTURE_TRANSPORT_H
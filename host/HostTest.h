@@ -0,0 +1,64 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+// Checks and timing for the host tests and benchmarks. A failed CHECK is
+// reported and the test carries on; testResult() at the end of main()
+// gives the exit code.
+
+#include <Arduino.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+#include <string>
+
+static int checksFailed = 0;
+static int checksRun = 0;
+
+#define CHECK(condition) checkThat((condition), #condition, __FILE__, __LINE__)
+
+inline bool checkThat(bool passed, const char* what, const char* file, int line) {
+  checksRun++;
+  if (!passed) {
+    checksFailed++;
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+  }
+  return passed;
+}
+
+inline int testResult(const char* name) {
+  printf("%s: %d checks, %d failed\n", name, checksRun, checksFailed);
+  return checksFailed == 0 ? 0 : 1;
+}
+
+// A new empty directory under /tmp, for a PosixStorage to work in
+inline std::string tempDirectory(const char* name) {
+  std::string path = std::string("/tmp/") + name + "-XXXXXX";
+  if (!mkdtemp(&path[0])) {
+    perror("mkdtemp");
+    exit(2);
+  }
+  return path;
+}
+
+// Wall time in nanoseconds, whatever HostClock says
+inline unsigned long long nowNs() {
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// A response body already in memory, read from the start again for each pass
+class BufferStream : public Stream {
+private:
+  const std::string& data;
+  size_t pos;
+
+public:
+  explicit BufferStream(const std::string& data) : data(data), pos(0) {}
+  void rewind() { pos = 0; }
+  int available() override { return data.size() - pos; }
+  int read() override { return pos < data.size() ? (uint8_t)data[pos++] : -1; }
+  int peek() override { return pos < data.size() ? (uint8_t)data[pos] : -1; }
+  size_t write(uint8_t) override { return 0; }
+};
+
+#endif // HOST_TEST_H
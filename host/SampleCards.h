@@ -0,0 +1,183 @@
+#ifndef SAMPLE_CARDS_H
+#define SAMPLE_CARDS_H
+
+// Cards for the tests and benchmarks, varied the way real boards are: no
+// labels on some cards and several on others, comments from a few words
+// to a few paragraphs, checklists from none to a couple of dozen items.
+// Each card follows from its index, so every run sees the same ones, both
+// as the structs the app keeps and as the JSON Trello sends.
+
+#include <Arduino.h>
+#include <vector>
+#include "DataStructures.h"
+#include "StringPool.h"
+
+struct SampleShape {
+  unsigned labels;        // 0-3
+  unsigned comments;      // 0-11
+  unsigned items;         // Checklist items, 0-24
+  unsigned descWords;
+  uint32_t seed;
+
+  explicit SampleShape(unsigned index)
+    : labels(index % 5 == 0 ? 0 : index % 3 + 1), comments(index * 7 % 12),
+      items(index % 4 == 0 ? 0 : index * 5 % 25), descWords(index * 13 % 70),
+      seed(index * 2654435761UL + 1) {}
+
+  uint32_t next() {
+    seed = seed * 1664525UL + 1013904223UL;
+    return seed >> 8;
+  }
+};
+
+// Ids grow with index, as Trello's creation timestamps do
+inline String sampleCardId(unsigned index) {
+  char text[25];
+  snprintf(text, sizeof(text), "%08x%016llx", 0x5f000000u + index * 37,
+           (unsigned long long)index * 2654435761ULL);
+  return String(text);
+}
+
+// The index a sampleCardId() came from
+inline unsigned sampleIndexOf(const String& id) {
+  return (strtoul(id.substring(0, 8).c_str(), nullptr, 16) - 0x5f000000u) / 37;
+}
+
+inline String sampleWords(SampleShape& shape, unsigned count) {
+  static const char* const words[] = {
+    "deploy", "review", "the", "fix", "staging", "customer", "report", "and",
+    "firmware", "battery", "screen", "test", "before", "release", "notes", "check"
+  };
+  String text;
+  for (unsigned i = 0; i < count; i++) {
+    if (i > 0) {
+      text += ' ';
+    }
+    text += words[shape.next() % 16];
+  }
+  return text;
+}
+
+// A comment is a few words, a sentence or two, or now and then a long note
+inline unsigned sampleCommentWords(SampleShape& shape) {
+  uint32_t kind = shape.next() % 10;
+  return kind < 5 ? 2 + kind : kind < 9 ? 15 + kind * 3 : 120;
+}
+
+inline const char* sampleColor(unsigned label, unsigned index) {
+  static const char* const colors[] = {"green", "red_dark", "blue", "yellow", "purple", "sky_light"};
+  return colors[(index + label * 2) % 6];
+}
+
+inline String sampleName(unsigned index) {
+  SampleShape shape(index);
+  return "Card " + String(index) + " " + sampleWords(shape, 2 + index % 5);
+}
+
+inline CardSummary sampleSummary(unsigned index) {
+  SampleShape shape(index);
+  CardSummary summary;
+  summary.id = CardId::fromString(sampleCardId(index));
+  summary.name = StringPool::names().intern(sampleName(index));
+  for (unsigned i = 0; i < shape.labels; i++) {
+    summary.addLabel(labelColorFromName(sampleColor(i, index)));
+  }
+  summary.hasDueDate = index % 3 == 0;
+  summary.isDone = shape.items > 0 && index % 7 == 0;
+  return summary;
+}
+
+inline void sampleCard(unsigned index, FullCard& card) {
+  SampleShape shape(index);
+  card = FullCard(sampleSummary(index));
+  card.description = card.text.add(sampleWords(shape, shape.descWords));
+  if (card.summary.hasDueDate) {
+    card.dueDate = card.text.add("2026-11-01T12:00:00.000Z");
+  }
+  for (unsigned i = 0; i < shape.comments; i++) {
+    String text = sampleWords(shape, sampleCommentWords(shape));
+    card.comments.push_back(card.text.add("Sam Member", ": ", text.c_str()));
+  }
+  for (unsigned i = 0; i < shape.items; i++) {
+    ChecklistItem item;
+    item.id = card.text.add(sampleCardId(index * 100 + i));
+    item.name = card.text.add(sampleWords(shape, 3 + i % 6));
+    item.isComplete = i % 3 == 0;
+    card.checklists.push_back(item);
+  }
+  card.lastActivity = card.text.add("2026-10-16T09:30:00.000Z");
+}
+
+// One card as /lists/{id}/cards returns it, fields the filter drops included
+inline String sampleSummaryJson(unsigned index) {
+  SampleShape shape(index);
+  String json = "{\"id\":\"" + sampleCardId(index) + "\",\"name\":\"" + sampleName(index) +
+                "\",\"idList\":\"5f0000000000000000000001\",\"closed\":false,\"pos\":" +
+                String(index * 16384) + ",\"due\":" +
+                (index % 3 == 0 ? "\"2026-11-01T12:00:00.000Z\"" : "null") +
+                ",\"dueComplete\":false,\"labels\":[";
+  for (unsigned i = 0; i < shape.labels; i++) {
+    json += String(i > 0 ? "," : "") + "{\"id\":\"" + sampleCardId(9000 + i) +
+            "\",\"name\":\"\",\"color\":\"" + sampleColor(i, index) + "\"}";
+  }
+  unsigned checked = shape.items > 0 && index % 7 == 0 ? shape.items : shape.items / 2;
+  json += "],\"badges\":{\"votes\":0,\"comments\":" + String(shape.comments) +
+          ",\"checkItems\":" + String(shape.items) + ",\"checkItemsChecked\":" +
+          String(checked) + ",\"attachments\":0,\"description\":" +
+          (shape.descWords > 0 ? "true" : "false") + "}}";
+  return json;
+}
+
+// Newest first, as cursor paging returns them
+inline String sampleListJson(unsigned first, unsigned count) {
+  String json = "[";
+  for (unsigned i = 0; i < count; i++) {
+    json += String(i > 0 ? "," : "") + sampleSummaryJson(first + count - 1 - i);
+  }
+  return json + "]";
+}
+
+// One card as /cards/{id} returns it with CARD_DETAIL_PARAMS
+inline String sampleCardJson(unsigned index) {
+  SampleShape shape(index);
+  String json = "{\"id\":\"" + sampleCardId(index) + "\",\"name\":\"" + sampleName(index) +
+                "\",\"desc\":\"" + sampleWords(shape, shape.descWords) +
+                "\",\"due\":" + (index % 3 == 0 ? "\"2026-11-01T12:00:00.000Z\"" : "null") +
+                ",\"dateLastActivity\":\"2026-10-16T09:30:00.000Z\",\"labels\":[";
+  for (unsigned i = 0; i < shape.labels; i++) {
+    json += String(i > 0 ? "," : "") + "{\"color\":\"" + sampleColor(i, index) + "\"}";
+  }
+  json += "],\"actions\":[";
+  for (unsigned i = 0; i < shape.comments; i++) {
+    json += String(i > 0 ? "," : "") + "{\"id\":\"" + sampleCardId(index * 100 + 50 + i) +
+            "\",\"type\":\"commentCard\",\"date\":\"2026-10-15T10:00:00.000Z\",\"data\":{\"text\":\"" +
+            sampleWords(shape, sampleCommentWords(shape)) +
+            "\"},\"memberCreator\":{\"id\":\"5f0000000000000000000002\",\"fullName\":\"Sam Member\"}}";
+  }
+  json += "],\"checklists\":[";
+  unsigned lists = shape.items > 12 ? 2 : shape.items > 0 ? 1 : 0;
+  for (unsigned list = 0; list < lists; list++) {
+    json += String(list > 0 ? "," : "") + "{\"id\":\"" + sampleCardId(index * 100 + 90 + list) +
+            "\",\"name\":\"Checklist\",\"checkItems\":[";
+    unsigned from = list == 0 ? 0 : 12;
+    unsigned to = lists == 2 && list == 0 ? 12 : shape.items;
+    for (unsigned i = from; i < to; i++) {
+      json += String(i > from ? "," : "") + "{\"id\":\"" + sampleCardId(index * 100 + i) +
+              "\",\"name\":\"" + sampleWords(shape, 3 + i % 6) + "\",\"state\":\"" +
+              (i % 3 == 0 ? "complete" : "incomplete") + "\",\"pos\":" + String(i * 100) + "}";
+    }
+    json += "]}";
+  }
+  return json + "]}";
+}
+
+// A /batch response: each card wrapped in an object keyed by its status
+inline String sampleBatchJson(const std::vector<unsigned>& indices) {
+  String json = "[";
+  for (size_t i = 0; i < indices.size(); i++) {
+    json += String(i > 0 ? "," : "") + "{\"200\":" + sampleCardJson(indices[i]) + "}";
+  }
+  return json + "]";
+}
+
+#endif // SAMPLE_CARDS_H
@@ -0,0 +1,131 @@
+#ifndef SAMPLE_SERVER_H
+#define SAMPLE_SERVER_H
+
+// The Trello endpoints TrelloClient uses, answered with the sample cards:
+// a list of the first `cards` of them, newest first, paged with before=,
+// their details singly and through /batch, and the writes the app makes.
+// Comments and new cards are kept as the member's actions, with ids made
+// on the server's clock, for /members/me/actions to list.
+
+#include <ArduinoJson.h>
+#include <memory>
+#include "FixtureTransport.h"
+#include "SampleCards.h"
+
+inline String sampleQueryValue(const String& url, const char* name) {
+  String key = String(name) + "=";
+  int start = url.indexOf("?" + key);
+  if (start < 0) {
+    start = url.indexOf("&" + key);
+  }
+  if (start < 0) {
+    return "";
+  }
+  start += key.length() + 1;
+  int end = url.indexOf('&', start);
+  return url.substring(start, end < 0 ? url.length() : end);
+}
+
+// The card id after "/cards/" in a path or a batch route
+inline String sampleIdAfter(const String& text, int from) {
+  return text.substring(from + 7, from + 7 + 24);
+}
+
+// Records a write as Trello would list it among the member's actions
+inline void sampleRecordAction(std::vector<String>& actions, const char* type,
+                               const String& payload, const String& cardId) {
+  DynamicJsonDocument request(1024);
+  deserializeJson(request, payload);
+  char id[25];
+  snprintf(id, sizeof(id), "%08x%016llx", (unsigned)FixtureTransport::serverTime(),
+           (unsigned long long)actions.size());
+
+  DynamicJsonDocument action(1024);
+  action["id"] = id;
+  action["type"] = type;
+  if (request.containsKey("text")) {
+    action["data"]["text"] = request["text"].as<String>();
+  }
+  action["data"]["card"]["id"] = cardId;
+  if (request.containsKey("name")) {
+    action["data"]["card"]["name"] = request["name"].as<String>();
+    action["data"]["list"]["id"] = request["idList"].as<String>();
+  }
+  String json;
+  serializeJson(action, json);
+  actions.push_back(json);
+}
+
+inline void serveSampleBoard(FixtureTransport& server, unsigned cards) {
+  auto actions = std::make_shared<std::vector<String>>();
+
+  server.route("GET", "/lists/*/cards", [cards](const String& url, const String&) {
+    String before = sampleQueryValue(url, "before");
+    unsigned end = before.length() > 0 ? min(sampleIndexOf(before), cards) : cards;
+    unsigned limit = sampleQueryValue(url, "limit").toInt();
+    unsigned count = limit > 0 ? min(limit, end) : end;
+    return FixtureResponse{200, sampleListJson(end - count, count)};
+  });
+
+  server.route("GET", "/cards/*", [cards](const String& url, const String&) {
+    int at = url.indexOf("/cards/");
+    unsigned index = sampleIndexOf(sampleIdAfter(url, at));
+    if (index >= cards) {
+      return FixtureResponse{404, "The requested resource was not found."};
+    }
+    if (sampleQueryValue(url, "fields") == "dateLastActivity") {
+      return FixtureResponse{200, "{\"id\":\"" + sampleCardId(index) +
+                                  "\",\"dateLastActivity\":\"2026-10-16T09:30:00.000Z\"}"};
+    }
+    return FixtureResponse{200, sampleCardJson(index)};
+  });
+
+  server.route("GET", "/batch", [](const String& url, const String&) {
+    std::vector<unsigned> indices;
+    for (int at = url.indexOf("/cards/"); at >= 0; at = url.indexOf("/cards/", at + 1)) {
+      indices.push_back(sampleIndexOf(sampleIdAfter(url, at)));
+    }
+    return FixtureResponse{200, sampleBatchJson(indices)};
+  });
+
+  server.route("POST", "/cards/*/actions/comments", [actions](const String& url,
+                                                             const String& payload) {
+    sampleRecordAction(*actions, "commentCard", payload, sampleIdAfter(url, url.indexOf("/cards/")));
+    return FixtureResponse{200, "{\"id\":\"" + sampleCardId(200000) +
+                                "\",\"type\":\"commentCard\"}"};
+  });
+  server.route("PUT", "/cards/*/checkItem/*", 200, "{\"state\":\"complete\"}");
+
+  server.route("POST", "/cards", [actions, created = 0u](const String&,
+                                                        const String& payload) mutable {
+    String id = sampleCardId(100000 + created++);
+    sampleRecordAction(*actions, "createCard", payload, id);
+    return FixtureResponse{200, "{\"id\":\"" + id + "\"}"};
+  });
+
+  // Newest first, after the since= id, of the types in filter=
+  server.route("GET", "/members/me/actions", [actions](const String& url, const String&) {
+    String since = sampleQueryValue(url, "since");
+    String filter = "," + sampleQueryValue(url, "filter") + ",";
+    unsigned limit = sampleQueryValue(url, "limit").toInt();
+    String body = "[";
+    unsigned listed = 0;
+    for (size_t i = actions->size(); i-- > 0 && listed < limit; ) {
+      const String& action = (*actions)[i];
+      String id = action.substring(7, 31);
+      int typeAt = action.indexOf("\"type\":\"") + 8;
+      String type = action.substring(typeAt, action.indexOf('"', typeAt));
+      if (!(since < id) || filter.indexOf("," + type + ",") < 0) {
+        continue;
+      }
+      if (listed++ > 0) {
+        body += ",";
+      }
+      body += action;
+    }
+    return FixtureResponse{200, body + "]"};
+  });
+  server.route("GET", "/members/me", 200, "{\"id\":\"5f0000000000000000000002\"}");
+}
+
+#endif // SAMPLE_SERVER_H
@@ -0,0 +1,115 @@
+// Warming the card cache one request per card against /batch, ten cards a
+// request, through a FixtureTransport on the simulated clock: time taken,
+// requests and rate limit tokens spent, and bytes received, for 10, 50
+// and 100 cards over a fast link and over the device's Wi-Fi.
+
+#include "HostTest.h"
+#include "FixtureTransport.h"
+#include "PosixStorage.h"
+#include "SampleServer.h"
+#include "TrelloClient.h"
+
+static const unsigned BOARD_CARDS = 500;
+
+static const FaultProfile PROFILES[] = {
+  // name, handshake, latency, jitter ms, bytes/s, 429 %, 503 %, refused %, timeout %,
+  // timeout ms, server limit
+  {"lan", 20, 5, 2, 5000000, 0, 0, 0, 0, 10000, 0},
+  {"wifi", 400, 150, 100, 150000, 0, 0, 0, 0, 10000, API_RATE_LIMIT_REQUESTS},
+};
+
+struct WarmFigures {
+  unsigned long ms;
+  size_t requests;
+  unsigned long bodyBytes;
+  unsigned long overflows;
+  size_t cached;
+};
+
+static std::vector<String> cardIds(unsigned count) {
+  std::vector<String> ids;
+  for (unsigned i = 0; i < count; i++) {
+    ids.push_back(sampleCardId((i * 37) % BOARD_CARDS));
+  }
+  return ids;
+}
+
+template <typename Warm>
+static WarmFigures warm(const FaultProfile& profile, const std::vector<String>& ids, Warm fetch) {
+  PosixStorage storage(tempDirectory("batch"));
+  FixtureTransport server;
+  server.setProfile(profile);
+  serveSampleBoard(server, BOARD_CARDS);
+  TrelloClient client(&storage);
+  client.setTransport(&server);
+  CHECK(client.begin());
+  CHECK(client.connectWiFi());
+
+  WarmFigures figures = {};
+  unsigned long start = millis();
+  fetch(client, ids);
+  figures.ms = millis() - start;
+  figures.requests = server.getLog().size();
+  figures.bodyBytes = server.getStats().bodyBytes;
+  figures.overflows = client.getJsonOverflows();
+
+  // Either way every card ends up in the cache
+  for (const String& id : ids) {
+    FullCard card;
+    if (client.loadCachedCardDetails(id, card)) {
+      figures.cached++;
+    }
+  }
+  return figures;
+}
+
+static void singleFetches(TrelloClient& client, const std::vector<String>& ids) {
+  for (const String& id : ids) {
+    FullCard card;
+    ApiStatus status;
+    // As the network task does: wait for a token rather than give up
+    do {
+      delay(client.getRateLimitWaitMs());
+      status = client.fetchCardDetails(id, card, false);
+    } while (status == API_ERROR_RATE_LIMIT);
+    CHECK(status == API_SUCCESS);
+  }
+}
+
+static void batchFetches(TrelloClient& client, const std::vector<String>& ids) {
+  std::vector<FullCard> cards;
+  CHECK(client.fetchCardDetailsBatch(ids, cards) == API_SUCCESS);
+  CHECK(cards.size() == ids.size());
+  for (size_t i = 0; i < cards.size() && i < ids.size(); i++) {
+    CHECK(cards[i].summary.id == CardId::fromString(ids[i]));
+  }
+}
+
+int main() {
+  Serial.mute(true);
+  HostClock::simulate(true);
+  printf("%-6s %6s %-7s %10s %9s %10s %7s\n", "link", "cards", "fetch", "ms", "requests",
+         "body bytes", "cached");
+  const unsigned counts[] = {10, 50, 100};
+  for (const FaultProfile& profile : PROFILES) {
+    for (unsigned count : counts) {
+      std::vector<String> ids = cardIds(count);
+      WarmFigures single = warm(profile, ids, singleFetches);
+      WarmFigures batched = warm(profile, ids, batchFetches);
+      printf("%-6s %6u %-7s %10lu %9u %10lu %7u\n", profile.name, count, "single",
+             single.ms, (unsigned)single.requests, single.bodyBytes, (unsigned)single.cached);
+      printf("%-6s %6u %-7s %10lu %9u %10lu %7u  (%.1fx faster)\n", profile.name, count,
+             "batch", batched.ms, (unsigned)batched.requests, batched.bodyBytes,
+             (unsigned)batched.cached, (double)single.ms / max(batched.ms, 1UL));
+
+      // A request per card or group, and again for each that did not fit
+      // the JSON document until it had grown
+      CHECK(single.requests == count + single.overflows);
+      CHECK(batched.requests == (count + BATCH_MAX_URLS - 1) / BATCH_MAX_URLS +
+                                batched.overflows);
+      CHECK(single.cached == count && batched.cached == count);
+      CHECK(batched.ms < single.ms);
+    }
+  }
+  return testResult("bench_batch");
+}
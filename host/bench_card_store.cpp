@@ -0,0 +1,131 @@
+// CardStore against the layout it replaced, one JSON file per card, with
+// 100, 1,000 and 5,000 cards cached: time to write them all, to start up,
+// and to open cards at random, and the space they take. The host's page
+// cache and directory lookups are far faster than FAT on an SD card, so
+// the gap on the device is wider than here; the old layout's figures are
+// I/O only and leave out the JSON parse it also needed.
+
+#include "HostTest.h"
+#include "CardStore.h"
+#include "PosixStorage.h"
+#include "SampleCards.h"
+
+static const unsigned OPENS = 500;
+
+struct LayoutFigures {
+  double writeUs;       // Per card
+  double startMs;
+  double openUs;        // Per card
+  unsigned long long bytes;
+  size_t files;
+};
+
+static String legacyPath(unsigned index) {
+  return String(CACHE_DETAILS_PREFIX) + sampleCardId(index) + ".json";
+}
+
+static LayoutFigures benchLegacy(unsigned count) {
+  LayoutFigures figures = {};
+  PosixStorage storage(tempDirectory("store-legacy"));
+  CHECK(storage.begin());
+
+  unsigned long long spent = 0;
+  for (unsigned i = 0; i < count; i++) {
+    String json = sampleCardJson(i);
+    String path = legacyPath(i);
+    unsigned long long start = nowNs();
+    CHECK(storage.writeFile(path.c_str(), (const uint8_t*)json.c_str(), json.length()));
+    spent += nowNs() - start;
+    figures.bytes += json.length();
+  }
+  figures.writeUs = spent / 1000.0 / count;
+
+  // Nothing to load up front; each open finds and reads its own file
+  std::vector<uint8_t> data;
+  unsigned long long start = nowNs();
+  for (unsigned i = 0; i < OPENS; i++) {
+    unsigned index = random(count);
+    CHECK(storage.readFile(legacyPath(index).c_str(), data) && !data.empty());
+  }
+  figures.openUs = (nowNs() - start) / 1000.0 / OPENS;
+  figures.files = count;
+  return figures;
+}
+
+static LayoutFigures benchStore(unsigned count) {
+  LayoutFigures figures = {};
+  std::string dir = tempDirectory("store-log");
+  PosixStorage storage(dir);
+  {
+    CardStore store(&storage);
+    CHECK(store.begin());
+    unsigned long long spent = 0;
+    FullCard card;
+    for (unsigned i = 0; i < count; i++) {
+      sampleCard(i, card);
+      unsigned long long start = nowNs();
+      CHECK(store.put(card));
+      spent += nowNs() - start;
+    }
+    unsigned long long start = nowNs();
+    store.flush();
+    spent += nowNs() - start;
+    figures.writeUs = spent / 1000.0 / count;
+    figures.bytes = store.getStats().bytesWritten;
+  }
+
+  // Starting up scans the record headers into the index
+  unsigned long long start = nowNs();
+  CardStore store(&storage);
+  CHECK(store.begin());
+  figures.startMs = (nowNs() - start) / 1000000.0;
+  CHECK(store.size() == count);
+
+  FullCard card;
+  start = nowNs();
+  for (unsigned i = 0; i < OPENS; i++) {
+    unsigned index = random(count);
+    bool found = store.get(sampleCardId(index), card);
+    CHECK(found && strcmp(card.summary.name, sampleName(index).c_str()) == 0);
+  }
+  figures.openUs = (nowNs() - start) / 1000.0 / OPENS;
+  figures.files = 1;
+  return figures;
+}
+
+// Every card refetched twice over: the log stays bounded by compaction
+static void benchRewrites(unsigned count) {
+  PosixStorage storage(tempDirectory("store-rewrite"));
+  CardStore store(&storage);
+  CHECK(store.begin());
+  FullCard card;
+  for (unsigned pass = 0; pass < 3; pass++) {
+    for (unsigned i = 0; i < count; i++) {
+      sampleCard(i, card);
+      store.put(card);
+    }
+  }
+  store.flush();
+  CHECK(store.size() == count);
+  CHECK(store.getStats().compactions > 0);
+  printf("card store: %u cards written 3 times, %lu compactions\n",
+         count, store.getStats().compactions);
+}
+
+int main() {
+  Serial.mute(true);
+  printf("%-6s %-7s %10s %10s %10s %12s %6s\n",
+         "cards", "layout", "write us", "start ms", "open us", "bytes", "files");
+  const unsigned counts[] = {100, 1000, 5000};
+  for (unsigned count : counts) {
+    LayoutFigures legacy = benchLegacy(count);
+    LayoutFigures store = benchStore(count);
+    printf("%-6u %-7s %10.1f %10s %10.1f %12llu %6u\n", count, "json",
+           legacy.writeUs, "-", legacy.openUs, legacy.bytes, (unsigned)legacy.files);
+    printf("%-6u %-7s %10.1f %10.2f %10.1f %12llu %6u\n", count, "store",
+           store.writeUs, store.startMs, store.openUs, store.bytes, (unsigned)store.files);
+    CHECK(store.bytes < legacy.bytes);
+  }
+  benchRewrites(1000);
+  return testResult("bench_card_store");
+}
@@ -0,0 +1,120 @@
+// CardCodec on a 500-card list and 500 full cards: bytes on the card and
+// load time against the JSON they were parsed from. With ArduinoJson on
+// the include path the JSON side is timed too, the way the old cache
+// loaded: parse the whole document, then copy the fields out. The host
+// Makefile puts its stand-in there when the real library is missing, and
+// then the JSON time is the stand-in's.
+
+#include "HostTest.h"
+#include "CardCodec.h"
+#include "SampleCards.h"
+
+#if __has_include(<ArduinoJson.h>)
+#include <ArduinoJson.h>
+#define HAVE_ARDUINOJSON 1
+#endif
+
+static const unsigned CARDS = 500;
+static const int PASSES = 20;
+
+static bool sameSummary(const CardSummary& a, const CardSummary& b) {
+  return a.id == b.id && a.name == b.name && a.labels == b.labels &&
+         a.hasDueDate == b.hasDueDate && a.isDone == b.isDone;
+}
+
+#if HAVE_ARDUINOJSON
+static double jsonListUs(const String& json, std::vector<CardSummary>& cards) {
+  unsigned long long start = nowNs();
+  for (int pass = 0; pass < PASSES; pass++) {
+    DynamicJsonDocument doc(json.length() * 2);
+    CHECK(!deserializeJson(doc, json.c_str(), json.length()));
+    cards.clear();
+    for (JsonObject item : doc.as<JsonArray>()) {
+      CardSummary summary;
+      summary.id = CardId::fromString(item["id"].as<const char*>());
+      summary.name = StringPool::names().intern(item["name"].as<const char*>());
+      for (JsonObject label : item["labels"].as<JsonArray>()) {
+        summary.addLabel(labelColorFromName(label["color"] | ""));
+      }
+      summary.hasDueDate = !item["due"].isNull();
+      cards.push_back(summary);
+    }
+  }
+  return (nowNs() - start) / 1000.0 / PASSES;
+}
+#endif
+
+static void benchList() {
+  std::vector<CardSummary> cards;
+  std::vector<uint8_t> list;
+  CardCodec::beginList(list);
+  for (unsigned i = 0; i < CARDS; i++) {
+    cards.push_back(sampleSummary(i));
+    CardCodec::writeSummary(list, cards.back());
+  }
+  String json = sampleListJson(0, CARDS);
+
+  std::vector<CardSummary> decoded;
+  unsigned long long start = nowNs();
+  for (int pass = 0; pass < PASSES; pass++) {
+    CHECK(CardCodec::decodeList(list, decoded));
+  }
+  double binaryUs = (nowNs() - start) / 1000.0 / PASSES;
+  CHECK(decoded.size() == CARDS);
+  bool same = true;
+  for (unsigned i = 0; i < CARDS && i < decoded.size(); i++) {
+    same = same && sameSummary(decoded[i], cards[i]);
+  }
+  CHECK(same);
+
+  // A file in any other layout is a cache miss
+  std::vector<uint8_t> other = list;
+  other[1] = CardCodec::VERSION + 1;
+  CHECK(!CardCodec::decodeList(other, decoded));
+
+  printf("codec list of %u: %u bytes binary, %u bytes JSON (%.1fx); load %.0f us",
+         CARDS, (unsigned)list.size(), json.length(), (double)json.length() / list.size(),
+         binaryUs);
+#if HAVE_ARDUINOJSON
+  std::vector<CardSummary> parsed;
+  double jsonUs = jsonListUs(json, parsed);
+  CHECK(parsed.size() == CARDS);
+  printf(", from JSON %.0f us (%.1fx)\n", jsonUs, jsonUs / binaryUs);
+#else
+  printf(" (JSON load not timed without ArduinoJson)\n");
+#endif
+}
+
+static void benchDetails() {
+  std::vector<std::vector<uint8_t>> records(CARDS);
+  size_t jsonBytes = 0;
+  for (unsigned i = 0; i < CARDS; i++) {
+    FullCard card;
+    sampleCard(i, card);
+    CardCodec::encode(card, records[i]);
+    jsonBytes += sampleCardJson(i).length();
+  }
+  size_t binaryBytes = 0;
+  for (const auto& record : records) {
+    binaryBytes += record.size();
+  }
+
+  FullCard card;
+  unsigned long long start = nowNs();
+  for (int pass = 0; pass < PASSES; pass++) {
+    for (unsigned i = 0; i < CARDS; i++) {
+      CHECK(CardCodec::decode(records[i], 0, CardCodec::VERSION, card));
+    }
+  }
+  double decodeUs = (nowNs() - start) / 1000.0 / PASSES / CARDS;
+  printf("codec details of %u: %u bytes binary, %u bytes JSON (%.1fx); %.2f us a card\n",
+         CARDS, (unsigned)binaryBytes, (unsigned)jsonBytes, (double)jsonBytes / binaryBytes,
+         decodeUs);
+  CHECK(binaryBytes < jsonBytes);
+}
+
+int main() {
+  benchList();
+  benchDetails();
+  return testResult("bench_codec");
+}
@@ -0,0 +1,111 @@
+// GzipStream throughput on bodies shaped like the ones it inflates on the
+// device: a 1,000-card list page and a batch of 10 and of 100 full cards.
+// Read a byte at a time, as ArduinoJson does, and in blocks, against
+// reading the same bytes uncompressed. The host inflater is zlib behind
+// the ROM's interface, so the figures compare read paths; they do not
+// predict the device's.
+
+#include <zlib.h>
+#include "HostTest.h"
+#include "GzipStream.h"
+#include "SampleCards.h"
+
+// What a server sends for Accept-Encoding: gzip
+static std::string gzip(const String& text) {
+  z_stream stream = {};
+  deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+  std::string out(deflateBound(&stream, text.length()), '\0');
+  stream.next_in = (Bytef*)text.c_str();
+  stream.avail_in = text.length();
+  stream.next_out = (Bytef*)&out[0];
+  stream.avail_out = out.size();
+  deflate(&stream, Z_FINISH);
+  out.resize(stream.total_out);
+  deflateEnd(&stream);
+  return out;
+}
+
+static size_t drainBytes(Stream& stream) {
+  size_t total = 0;
+  while (stream.read() >= 0) {
+    total++;
+  }
+  return total;
+}
+
+static size_t drainBlocks(Stream& stream) {
+  char block[512];
+  size_t total = 0;
+  for (size_t got; (got = stream.readBytes(block, sizeof(block))) > 0;) {
+    total += got;
+  }
+  return total;
+}
+
+// Passes over the body until a quarter of a second has gone by
+static double megabytesPerSecond(size_t (*drain)(Stream&), Stream& stream, BufferStream& source,
+                                 GzipStream* gzipStream, size_t expected) {
+  unsigned long long start = nowNs();
+  unsigned long long bytes = 0;
+  do {
+    source.rewind();
+    if (gzipStream) {
+      gzipStream->reset(&source);
+    }
+    size_t got = drain(stream);
+    CHECK(got == expected);
+    bytes += got;
+  } while (nowNs() - start < 250000000ULL);
+  return bytes * 1000.0 / (nowNs() - start);
+}
+
+static void bench(const char* name, const String& body, GzipStream& gzipStream) {
+  std::string plain(body.c_str(), body.length());
+  std::string compressed = gzip(body);
+
+  // One careful pass first: the output must be the body
+  BufferStream source(compressed);
+  gzipStream.reset(&source);
+  String inflated = gzipStream.readString();
+  CHECK(inflated == body);
+  CHECK(!gzipStream.hasFailed());
+  CHECK(gzipStream.bytesInflated() == body.length());
+
+  BufferStream plainSource(plain);
+  double copied = megabytesPerSecond(drainBytes, plainSource, plainSource, nullptr, plain.size());
+  double bytewise = megabytesPerSecond(drainBytes, gzipStream, source, &gzipStream, plain.size());
+  double blockwise = megabytesPerSecond(drainBlocks, gzipStream, source, &gzipStream, plain.size());
+  printf("inflate %-10s %7u -> %8u bytes (%4.1fx): read() %6.1f MB/s, readBytes() %6.1f MB/s, "
+         "uncompressed read() %6.1f MB/s\n",
+         name, (unsigned)compressed.size(), (unsigned)plain.size(),
+         (double)plain.size() / compressed.size(), bytewise, blockwise, copied);
+}
+
+int main() {
+  GzipStream gzipStream;
+  CHECK(gzipStream.begin());
+
+  std::vector<unsigned> ten;
+  std::vector<unsigned> hundred;
+  for (unsigned i = 0; i < 100; i++) {
+    if (i < 10) {
+      ten.push_back(i);
+    }
+    hundred.push_back(i);
+  }
+  bench("list-1000", sampleListJson(0, 1000), gzipStream);
+  bench("batch-10", sampleBatchJson(ten), gzipStream);
+  bench("batch-100", sampleBatchJson(hundred), gzipStream);
+
+  // A truncated body ends the stream early rather than hanging
+  std::string cut = gzip(sampleListJson(0, 100));
+  cut.resize(cut.size() / 2);
+  BufferStream source(cut);
+  gzipStream.reset(&source);
+  Serial.mute(true);
+  gzipStream.readString();
+  Serial.mute(false);
+  CHECK(gzipStream.hasFailed());
+
+  return testResult("bench_inflate");
+}
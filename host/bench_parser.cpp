@@ -0,0 +1,132 @@
+// parseCardList and parseCardDetails on generated Trello JSON of 100 and
+// 1,000 cards, with labels, comment lengths and checklist sizes varying
+// from card to card as SampleCards makes them: time per card, heap blocks
+// per card and peak heap. A baseline for parser and data layout changes.
+//
+// Blocks and bytes are operator new's, as MemoryTelemetry counts them;
+// the JSON document and TextArena blocks are malloc'd and not among them.
+// The list is parsed off a stream, as fetchCardPage does; details are
+// deserialized first and the conversion timed on its own, as
+// fetchCardDetails records it. Built against the ArduinoJson stand-in,
+// deserialize times are the stand-in's; conversion times are the client's
+// either way.
+
+#include "HostTest.h"
+#include "FixtureTransport.h"
+#include "MemoryTelemetry.h"
+#include "PosixStorage.h"
+#include "SampleCards.h"
+#include "TrelloClient.h"
+
+static const int PASSES = 10;
+
+static void benchList(TrelloClient& client, unsigned count) {
+  String json = sampleListJson(0, count);
+  std::string body(json.c_str(), json.length());
+  BufferStream stream(body);
+  std::vector<CardSummary> cards;
+  cards.reserve(count);
+
+  // The first pass pools the names; the figures are for the ones after
+  CHECK(client.parseCardList(stream, cards) == API_SUCCESS);
+  CHECK(cards.size() == count);
+
+  MemoryTelemetry::resetPeak();
+  MemorySample before = MemoryTelemetry::read();
+  unsigned long long start = nowNs();
+  for (int pass = 0; pass < PASSES; pass++) {
+    stream.rewind();
+    cards.clear();
+    CHECK(client.parseCardList(stream, cards) == API_SUCCESS);
+  }
+  double nsPerCard = (double)(nowNs() - start) / PASSES / count;
+  MemorySample after = MemoryTelemetry::read();
+  CHECK(cards.size() == count);
+
+  printf("list    %5u cards %8u bytes: %8.0f ns/card %6.2f blocks/card, peak %llu bytes "
+         "+ %u of JSON document\n",
+         count, (unsigned)body.size(), nsPerCard,
+         (double)(after.allocations - before.allocations) / PASSES / count,
+         after.peakBytes - before.liveBytes, (unsigned)client.getPeakDocBytes());
+}
+
+struct DetailFigures {
+  const char* name;
+  unsigned cards;
+  unsigned long long deserializeNs;
+  unsigned long long convertNs;
+  unsigned long long blocks;
+  unsigned long long peakBytes;   // The largest card's
+};
+
+static DetailFigures& groupOf(DetailFigures groups[3], unsigned index) {
+  SampleShape shape(index);
+  if (shape.comments == 0 && shape.items == 0) {
+    return groups[0];
+  }
+  return shape.comments >= 8 || shape.items >= 16 ? groups[2] : groups[1];
+}
+
+static void benchDetails(TrelloClient& client, unsigned count) {
+  DetailFigures groups[3] = {{"bare"}, {"typical"}, {"heavy"}};
+  DynamicJsonDocument doc(65536);
+  size_t jsonBytes = 0;
+
+  for (unsigned index = 0; index < count; index++) {
+    String json = sampleCardJson(index);
+    jsonBytes += json.length();
+    DetailFigures& group = groupOf(groups, index);
+    group.cards++;
+
+    unsigned long long start = nowNs();
+    for (int pass = 0; pass < PASSES; pass++) {
+      CHECK(!deserializeJson(doc, json.c_str(), json.length()));
+    }
+    group.deserializeNs += (nowNs() - start) / PASSES;
+
+    FullCard card;
+    CHECK(client.parseCardDetails(doc, card) == API_SUCCESS);
+    CHECK(card.comments.size() == SampleShape(index).comments);
+    CHECK(card.checklists.size() == SampleShape(index).items);
+
+    MemoryTelemetry::resetPeak();
+    MemorySample before = MemoryTelemetry::read();
+    start = nowNs();
+    for (int pass = 0; pass < PASSES; pass++) {
+      FullCard parsed;
+      client.parseCardDetails(doc, parsed);
+    }
+    group.convertNs += (nowNs() - start) / PASSES;
+    MemorySample after = MemoryTelemetry::read();
+    group.blocks += (after.allocations - before.allocations) / PASSES;
+    group.peakBytes = max(group.peakBytes, after.peakBytes - before.liveBytes);
+  }
+
+  printf("details %5u cards %8u bytes of JSON\n", count, (unsigned)jsonBytes);
+  for (const DetailFigures& group : groups) {
+    if (group.cards == 0) {
+      continue;
+    }
+    printf("  %-8s %5u cards: deserialize %8.0f ns/card, convert %8.0f ns/card "
+           "%6.2f blocks/card, peak %llu bytes\n",
+           group.name, group.cards, (double)group.deserializeNs / group.cards,
+           (double)group.convertNs / group.cards, (double)group.blocks / group.cards,
+           group.peakBytes);
+  }
+}
+
+int main() {
+  Serial.mute(true);
+  PosixStorage storage(tempDirectory("bench-parser"));
+  FixtureTransport transport;
+  TrelloClient client(&storage);
+  client.setTransport(&transport);
+  CHECK(client.begin());
+
+  const unsigned counts[] = {100, 1000};
+  for (unsigned count : counts) {
+    benchList(client, count);
+    benchDetails(client, count);
+  }
+  return testResult("bench_parser");
+}
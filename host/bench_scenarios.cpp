@@ -0,0 +1,158 @@
+// End-to-end times for what the user waits on: loading the list, opening a
+// card, commenting and creating a card, with the whole TrelloClient running
+// against a FixtureTransport. Each connection profile runs on the simulated
+// clock, so the network figures are exact and the same every run; the CPU
+// figures are the host's own and only compare one build with another.
+
+#include <algorithm>
+#include <functional>
+#include "HostTest.h"
+#include "FixtureTransport.h"
+#include "PosixStorage.h"
+#include "SampleServer.h"
+#include "TrelloClient.h"
+
+static const unsigned BOARD_CARDS = 500;
+static const int OPENS = 30;
+static const int COMMENTS = 10;
+static const int CREATES = 10;
+
+static const FaultProfile PROFILES[] = {
+  // name, handshake, latency, jitter ms, bytes/s, 429 %, 503 %, refused %, timeout %,
+  // timeout ms, server limit
+  {"lan", 20, 5, 2, 5000000, 0, 0, 0, 0, 10000, 0},
+  {"wifi", 400, 150, 100, 150000, 0, 0, 0, 0, 10000, API_RATE_LIMIT_REQUESTS},
+  {"throttled", 400, 150, 100, 150000, 10, 0, 0, 0, 10000, 30},
+  {"flaky", 400, 150, 100, 150000, 0, 8, 3, 3, 10000, API_RATE_LIMIT_REQUESTS},
+};
+
+struct OperationFigures {
+  const char* name;
+  std::vector<unsigned long> ms;    // Simulated, per operation
+  unsigned long long cpuNs;
+  int failed;
+  size_t requests;
+};
+
+// As NetworkWorker runs a job: wait out the rate limiter, then try again
+static ApiStatus runJob(TrelloClient& client, const std::function<ApiStatus()>& job) {
+  for (int attempt = 0; ; attempt++) {
+    unsigned long wait = client.getRateLimitWaitMs();
+    if (wait > 0) {
+      delay(wait);
+    }
+    ApiStatus status = job();
+    if (status != API_ERROR_RATE_LIMIT || attempt >= NETWORK_RATE_LIMIT_RETRIES) {
+      return status;
+    }
+  }
+}
+
+static ApiStatus measure(OperationFigures& figures, TrelloClient& client,
+                         FixtureTransport& server, const std::function<ApiStatus()>& job) {
+  size_t requests = server.getLog().size();
+  unsigned long startedAt = millis();
+  unsigned long long start = nowNs();
+  ApiStatus status = runJob(client, job);
+  figures.cpuNs += nowNs() - start;
+  figures.ms.push_back(millis() - startedAt);
+  figures.requests += server.getLog().size() - requests;
+  if (status != API_SUCCESS) {
+    figures.failed++;
+  }
+  return status;
+}
+
+static unsigned long percentile(std::vector<unsigned long> values, int percent) {
+  if (values.empty()) {
+    return 0;
+  }
+  std::sort(values.begin(), values.end());
+  return values[(values.size() - 1) * percent / 100];
+}
+
+static void printFigures(const char* profile, const OperationFigures& figures) {
+  size_t count = figures.ms.size();
+  printf("%-10s %-8s %5u %6d %8lu %8lu %8lu %8.1f %9.1f\n", profile, figures.name,
+         (unsigned)count, figures.failed, percentile(figures.ms, 50),
+         percentile(figures.ms, 95), percentile(figures.ms, 100),
+         (double)figures.requests / count, figures.cpuNs / 1000.0 / count);
+}
+
+static void runScenario(const FaultProfile& profile) {
+  PosixStorage storage(tempDirectory("scenario"));
+  FixtureTransport server;
+  server.setProfile(profile);
+  serveSampleBoard(server, BOARD_CARDS);
+
+  TrelloClient client(&storage);
+  client.setTransport(&server);
+  CHECK(client.begin());
+  CHECK(client.connectWiFi());
+
+  OperationFigures list = {"list"};
+  OperationFigures open = {"open"};
+  OperationFigures comment = {"comment"};
+  OperationFigures create = {"create"};
+
+  std::vector<CardSummary> cards;
+  if (measure(list, client, server, [&]() { return client.fetchCardList(cards, false); }) ==
+      API_SUCCESS) {
+    CHECK(cards.size() == LIST_CHUNK_SIZE);
+    CHECK(cards[0].id == CardId::fromString(sampleCardId(BOARD_CARDS - 1)));
+  }
+
+  unsigned long overflows = client.getJsonOverflows();
+  for (int i = 0; i < OPENS; i++) {
+    unsigned index = random(BOARD_CARDS);
+    FullCard card;
+    ApiStatus status = measure(open, client, server, [&]() {
+      return client.fetchCardDetails(sampleCardId(index), card, false);
+    });
+    if (status == API_SUCCESS) {
+      CHECK(strcmp(card.summary.name, sampleName(index).c_str()) == 0);
+    }
+  }
+  overflows = client.getJsonOverflows() - overflows;
+  for (int i = 0; i < COMMENTS; i++) {
+    String cardId = sampleCardId(random(BOARD_CARDS));
+    measure(comment, client, server, [&]() {
+      return client.addComment(cardId, "Checked on the device, works now");
+    });
+  }
+  for (int i = 0; i < CREATES; i++) {
+    measure(create, client, server, [&]() {
+      return client.createCard("Scenario card " + String(i), "Made by bench_scenarios");
+    });
+  }
+
+  printFigures(profile.name, list);
+  printFigures(profile.name, open);
+  printFigures(profile.name, comment);
+  printFigures(profile.name, create);
+
+  // Without injected faults nothing fails, and nothing is sent twice but a
+  // card that outgrew the JSON document
+  bool clean = profile.rateLimitPercent == 0 && profile.serverErrorPercent == 0 &&
+               profile.refusedPercent == 0 && profile.timeoutPercent == 0;
+  if (clean) {
+    CHECK(list.failed == 0 && list.requests == 1);
+    CHECK(open.failed == 0 && open.requests == OPENS + overflows);
+    CHECK(comment.failed == 0 && comment.requests == (size_t)COMMENTS);
+    CHECK(create.failed == 0 && create.requests == (size_t)CREATES);
+    CHECK(server.getStats().handshakes == 1);
+  }
+}
+
+int main() {
+  Serial.mute(true);
+  HostClock::simulate(true);
+  printf("%d opens, %d comments and %d creates after loading a %u-card list; "
+         "network times on the simulated clock\n", OPENS, COMMENTS, CREATES, BOARD_CARDS);
+  printf("%-10s %-8s %5s %6s %8s %8s %8s %8s %9s\n", "profile", "step", "runs", "failed",
+         "p50 ms", "p95 ms", "max ms", "requests", "cpu us");
+  for (const FaultProfile& profile : PROFILES) {
+    runScenario(profile);
+  }
+  return testResult("bench_scenarios");
+}
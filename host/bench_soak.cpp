@@ -0,0 +1,160 @@
+// 10,000 card opens from the RAM cache, the way showCardDetails() and
+// showCard() do them, against the same opens with a card made of Strings
+// as FullCard was before TextArena. Each runs in its own process so their
+// heaps do not mix, and reports heap blocks per open and how the heap
+// itself drifts over the run.
+//
+// The host has no largest-free-block figure; glibc's free bytes outside
+// the top chunk are used instead. They are the holes left between live
+// blocks, which is what shrinks the largest block on the ESP32's heap.
+
+#include <limits.h>
+#include <malloc.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "HostTest.h"
+#include "CardCache.h"
+#include "MemoryTelemetry.h"
+#include "SampleCards.h"
+
+static const unsigned CACHED = 200;
+static const unsigned OPENS = 10000;
+static const unsigned REPORT_EVERY = 2500;
+static const unsigned WARM_UP = 100;
+
+struct OldChecklistItem {
+  String id;
+  String name;
+  bool isComplete;
+};
+
+struct OldFullCard {
+  String id;
+  String name;
+  String description;
+  String dueDate;
+  std::vector<String> comments;
+  std::vector<OldChecklistItem> checklists;
+  String lastActivity;
+};
+
+static OldFullCard oldCard(unsigned index) {
+  FullCard card;
+  sampleCard(index, card);
+  OldFullCard old;
+  old.id = sampleCardId(index);
+  old.name = card.summary.name;
+  old.description = card.str(card.description);
+  old.dueDate = card.str(card.dueDate);
+  for (const TextRef& comment : card.comments) {
+    old.comments.push_back(card.str(comment));
+  }
+  for (const ChecklistItem& item : card.checklists) {
+    old.checklists.push_back({card.str(item.id), card.str(item.name), item.isComplete});
+  }
+  old.lastActivity = card.str(card.lastActivity);
+  return old;
+}
+
+struct SoakFigures {
+  unsigned long minBlocks;      // Per open, after warming up
+  unsigned long maxBlocks;
+  unsigned long long liveAfterWarmUp;
+  unsigned long long liveAtEnd;
+};
+
+static size_t heapHoles() {
+  struct mallinfo2 info = mallinfo2();
+  return info.fordblks - info.keepcost;
+}
+
+static void report(const char* name, unsigned opens) {
+  struct mallinfo2 info = mallinfo2();
+  printf("%-8s %6u %10zu %10zu %12llu\n", name, opens, info.arena, heapHoles(),
+         MemoryTelemetry::read().liveBytes);
+}
+
+template <typename Open>
+static SoakFigures soak(const char* name, Open open) {
+  SoakFigures figures = {ULONG_MAX, 0, 0, 0};
+  for (unsigned i = 1; i <= OPENS; i++) {
+    unsigned long before = MemoryTelemetry::read().allocations;
+    open((unsigned)random(CACHED));
+    unsigned long blocks = MemoryTelemetry::read().allocations - before;
+    if (i == WARM_UP) {
+      figures.liveAfterWarmUp = MemoryTelemetry::read().liveBytes;
+      report(name, i);
+    }
+    if (i > WARM_UP) {
+      figures.minBlocks = min(figures.minBlocks, blocks);
+      figures.maxBlocks = max(figures.maxBlocks, blocks);
+    }
+    if (i % REPORT_EVERY == 0) {
+      report(name, i);
+    }
+  }
+  figures.liveAtEnd = MemoryTelemetry::read().liveBytes;
+  printf("%-8s %lu-%lu heap blocks an open, %lld bytes held after warming up\n", name,
+         figures.minBlocks, figures.maxBlocks,
+         (long long)(figures.liveAtEnd - figures.liveAfterWarmUp));
+  return figures;
+}
+
+static int soakArena() {
+  CardCache cache;
+  cache.begin();
+  for (unsigned i = 0; i < CACHED; i++) {
+    FullCard card;
+    sampleCard(i, card);
+    cache.put(card, 0, false);
+  }
+  CHECK(cache.size() == CACHED);
+
+  FullCard onScreen;
+  SoakFigures figures = soak("arena", [&](unsigned index) {
+    FullCard cached;
+    bool found = cache.get(sampleCardId(index), cached);
+    CHECK(found);
+    onScreen = cached;
+  });
+  // The card on screen reuses its block; nothing builds up
+  CHECK(figures.liveAtEnd == figures.liveAfterWarmUp);
+  CHECK(figures.maxBlocks <= 8);
+  return testResult("bench_soak arena");
+}
+
+static int soakStrings() {
+  std::vector<OldFullCard> cache;
+  for (unsigned i = 0; i < CACHED; i++) {
+    cache.push_back(oldCard(i));
+  }
+
+  OldFullCard onScreen;
+  soak("strings", [&](unsigned index) {
+    OldFullCard cached = cache[index];
+    onScreen = cached;
+  });
+  return testResult("bench_soak strings");
+}
+
+static int inChild(int (*run)()) {
+  fflush(stdout);
+  pid_t child = fork();
+  if (child == 0) {
+    int result = run();
+    fflush(stdout);
+    _exit(result);
+  }
+  int status = 1;
+  waitpid(child, &status, 0);
+  return WIFEXITED(status) ? WEXITSTATUS(status) : 1;
+}
+
+int main() {
+  Serial.mute(true);
+  mallopt(M_MMAP_THRESHOLD, 64 * 1024 * 1024);
+  printf("%-8s %6s %10s %10s %12s\n", "card", "opens", "heap", "holes", "live");
+  int arena = inChild(soakArena);
+  int strings = inChild(soakStrings);
+  return arena || strings;
+}
@@ -0,0 +1,167 @@
+// A 2,000-card list in CardSummary against the layout it replaced, a
+// String id, a String name and a vector of color name Strings: memory per
+// card, heap blocks, the cost of copying the list, and the label work of
+// drawing it. Host pointers and Strings are larger than the ESP32's, so
+// the byte figures compare the layouts rather than predict the device.
+
+#include "HostTest.h"
+#include "MemoryTelemetry.h"
+#include "SampleCards.h"
+
+static const unsigned CARDS = 2000;
+static const int PASSES = 50;
+
+struct OldCardSummary {
+  String id;
+  String name;
+  std::vector<String> labelColors;
+  bool hasDueDate;
+  bool isDone;
+  double position;
+};
+
+// UI::getLabelColor before labels were resolved at parse time
+static uint16_t oldLabelColor(const String& colorName) {
+  if (colorName == "red") return COLOR_RED;
+  if (colorName == "green") return COLOR_GREEN;
+  if (colorName == "blue") return COLOR_BLUE;
+  if (colorName == "yellow") return COLOR_YELLOW;
+  if (colorName == "orange") return COLOR_ORANGE;
+  if (colorName == "purple") return COLOR_PURPLE;
+  if (colorName == "pink") return COLOR_RED;
+  if (colorName == "lime") return COLOR_GREEN;
+  if (colorName == "sky") return COLOR_BLUE;
+  return COLOR_GRAY;
+}
+
+// UI::getLabelColor now
+static uint16_t labelColor(LabelColor color) {
+  static const uint16_t colors[LABEL_COLOR_COUNT] = {
+    COLOR_GREEN, COLOR_YELLOW, COLOR_ORANGE, COLOR_RED, COLOR_PURPLE, COLOR_BLUE,
+    COLOR_BLUE, COLOR_GREEN, COLOR_RED, COLOR_GRAY, COLOR_GRAY
+  };
+  return colors[color];
+}
+
+static volatile uint32_t sink;
+
+struct LayoutFigures {
+  size_t structBytes;
+  unsigned long long heapBytes;
+  unsigned long heapBlocks;
+  size_t pooledBytes;
+  double copyUs;
+  unsigned long copyBlocks;
+  double labelsUs;
+};
+
+static void printFigures(const char* name, const LayoutFigures& figures) {
+  unsigned long long total = figures.structBytes + figures.heapBytes + figures.pooledBytes;
+  printf("%-8s %8.1f %8.1f %8.1f %8.1f %8.2f %10.0f %10lu %10.1f\n", name,
+         (double)figures.structBytes / CARDS, (double)figures.heapBytes / CARDS,
+         (double)figures.pooledBytes / CARDS, (double)total / CARDS,
+         (double)figures.heapBlocks / CARDS, figures.copyUs, figures.copyBlocks,
+         figures.labelsUs);
+}
+
+static LayoutFigures benchOld() {
+  LayoutFigures figures = {};
+  std::vector<OldCardSummary> cards(CARDS);
+  MemorySample before = MemoryTelemetry::read();
+  for (unsigned i = 0; i < CARDS; i++) {
+    SampleShape shape(i);
+    OldCardSummary& card = cards[i];
+    card.id = sampleCardId(i);
+    card.name = sampleName(i);
+    for (unsigned label = 0; label < shape.labels; label++) {
+      card.labelColors.push_back(sampleColor(label, i));
+    }
+  }
+  MemorySample after = MemoryTelemetry::read();
+  figures.structBytes = sizeof(OldCardSummary) * CARDS;
+  // Only the blocks that outlived their card's construction
+  figures.heapBytes = after.liveBytes - before.liveBytes;
+
+  unsigned long long start = nowNs();
+  before = MemoryTelemetry::read();
+  for (int pass = 0; pass < PASSES; pass++) {
+    std::vector<OldCardSummary> copy = cards;
+    sink = copy.size();
+  }
+  figures.copyBlocks = (MemoryTelemetry::read().allocations - before.allocations) / PASSES;
+  figures.copyUs = (nowNs() - start) / 1000.0 / PASSES;
+  // A copy allocates what the cards hold, plus the vector itself
+  figures.heapBlocks = figures.copyBlocks - 1;
+
+  start = nowNs();
+  for (int pass = 0; pass < PASSES; pass++) {
+    uint32_t total = 0;
+    for (const OldCardSummary& card : cards) {
+      for (size_t j = 0; j < min((size_t)3, card.labelColors.size()); j++) {
+        total += oldLabelColor(card.labelColors[j]);
+      }
+    }
+    sink = total;
+  }
+  figures.labelsUs = (nowNs() - start) / 1000.0 / PASSES;
+  return figures;
+}
+
+static LayoutFigures benchNew() {
+  LayoutFigures figures = {};
+  std::vector<CardSummary> cards;
+  cards.reserve(CARDS);
+  size_t pooled = StringPool::names().bytesUsed();
+  MemorySample before = MemoryTelemetry::read();
+  for (unsigned i = 0; i < CARDS; i++) {
+    cards.push_back(sampleSummary(i));
+  }
+  MemorySample after = MemoryTelemetry::read();
+  figures.structBytes = sizeof(CardSummary) * CARDS;
+  // The cards themselves hold nothing on the heap; what grew there is the
+  // pool's hash table, counted with the pooled names
+  figures.pooledBytes = StringPool::names().bytesUsed() - pooled + after.liveBytes - before.liveBytes;
+
+  unsigned long long start = nowNs();
+  before = MemoryTelemetry::read();
+  for (int pass = 0; pass < PASSES; pass++) {
+    std::vector<CardSummary> copy = cards;
+    sink = copy.size();
+  }
+  figures.copyBlocks = (MemoryTelemetry::read().allocations - before.allocations) / PASSES;
+  figures.copyUs = (nowNs() - start) / 1000.0 / PASSES;
+
+  // As UI::drawLabels walks the mask, three squares at most on the list
+  start = nowNs();
+  for (int pass = 0; pass < PASSES; pass++) {
+    uint32_t total = 0;
+    for (const CardSummary& card : cards) {
+      int drawn = 0;
+      for (int color = 0; color < LABEL_COLOR_COUNT && drawn < 3; color++) {
+        if (card.hasLabel((LabelColor)color)) {
+          total += labelColor((LabelColor)color);
+          drawn++;
+        }
+      }
+    }
+    sink = total;
+  }
+  figures.labelsUs = (nowNs() - start) / 1000.0 / PASSES;
+  return figures;
+}
+
+int main() {
+  LayoutFigures old = benchOld();
+  LayoutFigures current = benchNew();
+  printf("%u cards, bytes and heap blocks per card; copy and label times for the whole list\n",
+         CARDS);
+  printf("%-8s %8s %8s %8s %8s %8s %10s %10s %10s\n", "layout", "struct", "heap", "pooled",
+         "total", "blocks", "copy us", "copy blks", "labels us");
+  printFigures("strings", old);
+  printFigures("summary", current);
+
+  CHECK(current.copyBlocks == 1);
+  CHECK(current.structBytes + current.pooledBytes <
+        old.structBytes + old.heapBytes);
+  return testResult("bench_summary");
+}
@@ -0,0 +1,85 @@
+#include "Arduino.h"
+#include "WiFi.h"
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+
+size_t Print::printf(const char* format, ...) {
+  char line[512];
+  va_list args;
+  va_start(args, format);
+  int length = vsnprintf(line, sizeof(line), format, args);
+  va_end(args);
+  if (length < 0) {
+    return 0;
+  }
+  return write((const uint8_t*)line, std::min((size_t)length, sizeof(line) - 1));
+}
+
+static std::atomic<bool> simulated(false);
+static std::atomic<unsigned long long> simulatedUs(0);
+
+static unsigned long long realMicros() {
+  using namespace std::chrono;
+  static const steady_clock::time_point start = steady_clock::now();
+  return duration_cast<microseconds>(steady_clock::now() - start).count();
+}
+
+void HostClock::simulate(bool enabled) {
+  simulatedUs = realMicros();
+  simulated = enabled;
+}
+
+bool HostClock::isSimulated() {
+  return simulated;
+}
+
+void HostClock::advanceMicros(unsigned long long us) {
+  simulatedUs += us;
+}
+
+unsigned long micros() {
+  return simulated ? simulatedUs.load() : realMicros();
+}
+
+unsigned long millis() {
+  return micros() / 1000;
+}
+
+void delay(unsigned long ms) {
+  if (simulated) {
+    HostClock::advance(ms);
+  } else {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+  }
+}
+
+void yield() {
+  std::this_thread::yield();
+}
+
+// Seeded the same every run so benchmarks and fault scenarios repeat
+static std::mt19937& generator() {
+  static std::mt19937 engine(1);
+  return engine;
+}
+
+long random(long upper) {
+  return upper > 0 ? random(0, upper) : 0;
+}
+
+long random(long lower, long upper) {
+  if (upper <= lower) {
+    return lower;
+  }
+  return std::uniform_int_distribution<long>(lower, upper - 1)(generator());
+}
+
+void randomSeed(unsigned long seed) {
+  generator().seed(seed);
+}
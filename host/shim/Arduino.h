@@ -0,0 +1,399 @@
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+// Just enough of the Arduino core for the modules that do not touch the
+// hardware to build and run on Linux. ARDUINO is deliberately left
+// undefined, so Storage, WorkQueue and the other modules with a host path
+// use std::mutex and std::thread instead of FreeRTOS.
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <string>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define F(text) text
+#define DEC 10
+#define HEX 16
+
+using std::max;
+using std::min;
+
+class String {
+private:
+  std::string text;
+
+public:
+  String() {}
+  String(const char* value) : text(value ? value : "") {}
+  String(const std::string& value) : text(value) {}
+  String(char value) : text(1, value) {}
+  String(int value, unsigned char base = DEC) { setNumber(value, base); }
+  String(unsigned int value, unsigned char base = DEC) { setNumber(value, base); }
+  String(long value, unsigned char base = DEC) { setNumber(value, base); }
+  String(unsigned long value, unsigned char base = DEC) { setNumber(value, base); }
+  String(long long value, unsigned char base = DEC) { setNumber(value, base); }
+  String(unsigned long long value, unsigned char base = DEC) { setNumber(value, base); }
+  String(unsigned char value, unsigned char base = DEC) { setNumber(value, base); }
+  String(float value, unsigned int decimals = 2) { setDecimal(value, decimals); }
+  String(double value, unsigned int decimals = 2) { setDecimal(value, decimals); }
+
+  String& operator=(const char* value) {
+    text = value ? value : "";
+    return *this;
+  }
+
+  unsigned int length() const { return text.size(); }
+  const char* c_str() const { return text.c_str(); }
+  bool isEmpty() const { return text.empty(); }
+  bool reserve(unsigned int size) {
+    text.reserve(size);
+    return true;
+  }
+
+  bool concat(const String& value) {
+    text += value.text;
+    return true;
+  }
+  bool concat(const char* value) {
+    if (value) {
+      text += value;
+    }
+    return true;
+  }
+  bool concat(const char* value, unsigned int length) {
+    text.append(value, length);
+    return true;
+  }
+  bool concat(char value) {
+    text += value;
+    return true;
+  }
+
+  template <typename T>
+  String& operator+=(const T& value) {
+    concat(String(value));
+    return *this;
+  }
+  String& operator+=(const String& value) {
+    concat(value);
+    return *this;
+  }
+  String& operator+=(const char* value) {
+    concat(value);
+    return *this;
+  }
+  String& operator+=(char value) {
+    concat(value);
+    return *this;
+  }
+
+  friend String operator+(const String& left, const String& right) {
+    return String(left.text + right.text);
+  }
+  friend String operator+(const String& left, const char* right) {
+    return String(left.text + (right ? right : ""));
+  }
+  friend String operator+(const char* left, const String& right) {
+    return String((left ? left : "") + right.text);
+  }
+  friend String operator+(const String& left, char right) { return String(left.text + right); }
+
+  bool operator==(const String& other) const { return text == other.text; }
+  bool operator==(const char* other) const { return text == (other ? other : ""); }
+  bool operator!=(const String& other) const { return text != other.text; }
+  bool operator!=(const char* other) const { return !(*this == other); }
+  bool operator<(const String& other) const { return text < other.text; }
+  bool operator>(const String& other) const { return text > other.text; }
+  bool equals(const String& other) const { return text == other.text; }
+  bool equalsIgnoreCase(const String& other) const {
+    return text.size() == other.text.size() &&
+           std::equal(text.begin(), text.end(), other.text.begin(),
+                      [](char a, char b) { return tolower(a) == tolower(b); });
+  }
+
+  char operator[](unsigned int index) const { return index < text.size() ? text[index] : 0; }
+  char& operator[](unsigned int index) { return text[index]; }
+  char charAt(unsigned int index) const { return (*this)[index]; }
+  void setCharAt(unsigned int index, char value) {
+    if (index < text.size()) {
+      text[index] = value;
+    }
+  }
+
+  String substring(unsigned int from) const {
+    return from < text.size() ? String(text.substr(from)) : String();
+  }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) {
+      std::swap(from, to);
+    }
+    return from < text.size() ? String(text.substr(from, to - from)) : String();
+  }
+  int indexOf(char value, unsigned int from = 0) const { return found(text.find(value, from)); }
+  int indexOf(const String& value, unsigned int from = 0) const {
+    return found(text.find(value.text, from));
+  }
+  int lastIndexOf(char value) const { return found(text.rfind(value)); }
+  int lastIndexOf(const String& value) const { return found(text.rfind(value.text)); }
+  bool startsWith(const String& prefix) const { return text.compare(0, prefix.text.size(), prefix.text) == 0; }
+  bool endsWith(const String& suffix) const {
+    return text.size() >= suffix.text.size() &&
+           text.compare(text.size() - suffix.text.size(), suffix.text.size(), suffix.text) == 0;
+  }
+
+  void remove(unsigned int index) {
+    if (index < text.size()) {
+      text.erase(index);
+    }
+  }
+  void remove(unsigned int index, unsigned int count) {
+    if (index < text.size()) {
+      text.erase(index, count);
+    }
+  }
+  void trim() {
+    size_t start = text.find_first_not_of(" \t\r\n");
+    size_t end = text.find_last_not_of(" \t\r\n");
+    text = start == std::string::npos ? "" : text.substr(start, end - start + 1);
+  }
+  void toLowerCase() {
+    std::transform(text.begin(), text.end(), text.begin(), ::tolower);
+  }
+  void toUpperCase() {
+    std::transform(text.begin(), text.end(), text.begin(), ::toupper);
+  }
+  void replace(const String& from, const String& to) {
+    if (from.text.empty()) {
+      return;
+    }
+    for (size_t at = text.find(from.text); at != std::string::npos;
+         at = text.find(from.text, at + to.text.size())) {
+      text.replace(at, from.text.size(), to.text);
+    }
+  }
+  long toInt() const { return atol(text.c_str()); }
+  float toFloat() const { return atof(text.c_str()); }
+  void toCharArray(char* buffer, unsigned int size) const {
+    if (size > 0) {
+      strncpy(buffer, text.c_str(), size - 1);
+      buffer[size - 1] = '\0';
+    }
+  }
+
+private:
+  static int found(size_t at) { return at == std::string::npos ? -1 : (int)at; }
+
+  template <typename T>
+  void setNumber(T value, unsigned char base) {
+    char digits[72];
+    if (base == HEX) {
+      snprintf(digits, sizeof(digits), "%llx", (unsigned long long)value);
+    } else if (value < 0) {
+      snprintf(digits, sizeof(digits), "%lld", (long long)value);
+    } else {
+      snprintf(digits, sizeof(digits), "%llu", (unsigned long long)value);
+    }
+    text = digits;
+  }
+  void setDecimal(double value, unsigned int decimals) {
+    char digits[64];
+    snprintf(digits, sizeof(digits), "%.*f", (int)decimals, value);
+    text = digits;
+  }
+};
+
+// ArduinoJson recognises String sums by this type
+class StringSumHelper : public String {};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t value) = 0;
+  virtual size_t write(const uint8_t* data, size_t length) {
+    size_t done = 0;
+    while (done < length && write(data[done])) {
+      done++;
+    }
+    return done;
+  }
+  size_t write(const char* text) { return write((const uint8_t*)text, strlen(text)); }
+  virtual void flush() {}
+
+  size_t print(const String& value) { return write((const uint8_t*)value.c_str(), value.length()); }
+  size_t print(const char* value) { return write(value); }
+  size_t print(char value) { return write((uint8_t)value); }
+  size_t print(int value, int base = DEC) { return print(String(value, base)); }
+  size_t print(unsigned int value, int base = DEC) { return print(String(value, base)); }
+  size_t print(long value, int base = DEC) { return print(String(value, base)); }
+  size_t print(unsigned long value, int base = DEC) { return print(String(value, base)); }
+  size_t print(double value, int decimals = 2) { return print(String(value, decimals)); }
+
+  template <typename T>
+  size_t println(const T& value) {
+    size_t done = print(value);
+    return done + println();
+  }
+  size_t println() { return write("\n"); }
+
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+class Stream : public Print {
+protected:
+  unsigned long timeoutMs;
+
+public:
+  Stream() : timeoutMs(1000) {}
+
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+
+  void setTimeout(unsigned long timeout) { timeoutMs = timeout; }
+  unsigned long getTimeout() const { return timeoutMs; }
+
+  // Host streams never block, so a read that comes back empty is the end
+  virtual size_t readBytes(char* buffer, size_t length) {
+    size_t done = 0;
+    while (done < length) {
+      int c = read();
+      if (c < 0) {
+        break;
+      }
+      buffer[done++] = (char)c;
+    }
+    return done;
+  }
+  size_t readBytes(uint8_t* buffer, size_t length) { return readBytes((char*)buffer, length); }
+
+  // Reads up to and including target; false if the stream ended first
+  bool find(const char* target) {
+    size_t length = strlen(target);
+    size_t matched = 0;
+    while (matched < length) {
+      int c = read();
+      if (c < 0) {
+        return false;
+      }
+      if (c == target[matched]) {
+        matched++;
+      } else {
+        matched = c == target[0] ? 1 : 0;
+      }
+    }
+    return true;
+  }
+
+  String readString() {
+    String result;
+    for (int c = read(); c >= 0; c = read()) {
+      result += (char)c;
+    }
+    return result;
+  }
+  String readStringUntil(char terminator) {
+    String result;
+    for (int c = read(); c >= 0 && c != terminator; c = read()) {
+      result += (char)c;
+    }
+    return result;
+  }
+};
+
+// Serial prints to stdout; tests that log a lot can mute it
+class HardwareSerial : public Stream {
+private:
+  bool muted;
+
+public:
+  HardwareSerial() : muted(false) {}
+
+  void begin(unsigned long) {}
+  void mute(bool enabled) { muted = enabled; }
+
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t write(uint8_t value) override {
+    if (!muted) {
+      fputc(value, stdout);
+    }
+    return 1;
+  }
+  size_t write(const uint8_t* data, size_t length) override {
+    if (!muted) {
+      fwrite(data, 1, length, stdout);
+    }
+    return length;
+  }
+  using Print::write;
+};
+
+extern HardwareSerial Serial;
+
+// The host has no heap figures to give; MemoryTelemetry counts operator
+// new instead
+class EspClass {
+public:
+  uint32_t getFreeHeap() { return 0; }
+  uint32_t getMinFreeHeap() { return 0; }
+  uint32_t getMaxAllocHeap() { return 0; }
+  uint32_t getHeapSize() { return 0; }
+  uint32_t getFreePsram() { return 0; }
+  uint32_t getPsramSize() { return 0; }
+  void restart() { exit(0); }
+};
+
+extern EspClass ESP;
+
+class IPAddress {
+private:
+  uint8_t octets[4];
+
+public:
+  IPAddress() : octets{0, 0, 0, 0} {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : octets{a, b, c, d} {}
+  String toString() const {
+    char text[16];
+    snprintf(text, sizeof(text), "%u.%u.%u.%u", octets[0], octets[1], octets[2], octets[3]);
+    return String(text);
+  }
+};
+
+inline size_t operator<<(Print& out, const IPAddress& address) { return out.print(address.toString()); }
+template <>
+inline size_t Print::println<IPAddress>(const IPAddress& address) {
+  return println(address.toString());
+}
+
+// Time runs on the real clock unless a test switches to a simulated one,
+// which only moves when delay() or HostClock::advance() is called
+namespace HostClock {
+  void simulate(bool enabled);
+  bool isSimulated();
+  void advanceMicros(unsigned long long us);
+  inline void advance(unsigned long ms) { advanceMicros(ms * 1000ULL); }
+}
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void yield();
+
+long random(long upper);
+long random(long lower, long upper);
+void randomSeed(unsigned long seed);
+
+// Every host allocation is "PSRAM", so the PSRAM paths are the ones tested
+inline bool psramFound() { return true; }
+inline void* ps_malloc(size_t size) { return malloc(size); }
+inline void* ps_realloc(void* block, size_t size) { return realloc(block, size); }
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,1268 @@
+// Host stand-in for the part of ArduinoJson 6 the sketch uses, for when the
+// library is not in ARDUINOJSON (it is fetched by `pio run`, and the host
+// build has to work offline). Same model as the library: a document is one
+// fixed block, strings filling it from the front and 16-byte value slots
+// from the back, so capacity(), memoryUsage() and NoMemory behave as they
+// do on the ESP32. Parsing, filters and serializing follow ArduinoJson 6;
+// comments, MessagePack, string deduplication and most of the API are left
+// out. Its timings are not ArduinoJson's.
+
+#ifndef ARDUINOJSON_H
+#define ARDUINOJSON_H
+
+#include <Arduino.h>
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace ArduinoJsonHost {
+
+enum : uint8_t { TYPE_NULL, TYPE_BOOL, TYPE_INT, TYPE_FLOAT, TYPE_STRING, TYPE_ARRAY, TYPE_OBJECT };
+
+static const uint32_t NONE = 0xFFFFFFFF;
+static const uint32_t NO_KEY = 0xFFFFFF;
+static const int NESTING_LIMIT = 10;
+
+// Offsets into the document's block rather than pointers keep a slot the
+// size it is on a 32-bit target
+struct Slot {
+  union {
+    int64_t integer;
+    double real;
+    bool boolean;
+    struct { uint32_t offset, length; } string;
+    struct { uint32_t head, tail; } collection;
+  } content;
+  uint32_t next;
+  uint32_t keyType;   // Key offset in the top 24 bits, type in the low 8
+
+  uint8_t type() const { return keyType & 0xFF; }
+  void setType(uint8_t type) { keyType = (keyType & ~0xFFu) | type; }
+  uint32_t key() const { return keyType >> 8; }
+  void setKey(uint32_t offset) { keyType = (offset << 8) | type(); }
+  void reset() { content.integer = 0; next = NONE; keyType = (NO_KEY << 8) | TYPE_NULL; }
+};
+static_assert(sizeof(Slot) == 16, "a slot is 16 bytes, as on the ESP32");
+
+class Pool {
+private:
+  char* base;
+  size_t size;
+  size_t left;       // End of the strings
+  size_t right;      // Start of the slots
+  size_t building;   // Length of the string being read in, not yet kept
+  bool overflow;
+
+public:
+  Pool(char* base = nullptr, size_t size = 0) : base(base), size(base ? size : 0) { clear(); }
+
+  void clear() {
+    left = 0;
+    right = size & ~(size_t)7;
+    building = 0;
+    overflow = false;
+  }
+  size_t capacity() const { return size; }
+  size_t usage() const { return left + ((size & ~(size_t)7) - right); }
+  bool overflowed() const { return overflow; }
+  char* block() const { return base; }
+
+  Slot* slot(uint32_t offset) const { return offset == NONE ? nullptr : (Slot*)(base + offset); }
+  uint32_t offsetOf(const Slot* slot) const { return (uint32_t)((const char*)slot - base); }
+  const char* string(uint32_t offset) const { return base + offset; }
+
+  Slot* newSlot() {
+    if (right - left < sizeof(Slot) + building) {
+      overflow = true;
+      return nullptr;
+    }
+    right -= sizeof(Slot);
+    Slot* slot = (Slot*)(base + right);
+    slot->reset();
+    return slot;
+  }
+
+  uint32_t saveString(const char* text, size_t length) {
+    if (right - left < length + 1) {
+      overflow = true;
+      return NONE;
+    }
+    memcpy(base + left, text, length);
+    base[left + length] = 0;
+    uint32_t offset = (uint32_t)left;
+    left += length + 1;
+    return offset;
+  }
+
+  // A string read in a character at a time; kept only if the filter wants it
+  void startString() { building = 0; }
+  bool push(char c) {
+    if (right - left < building + 2) {
+      overflow = true;
+      return false;
+    }
+    base[left + building++] = c;
+    return true;
+  }
+  const char* endString() {
+    if (right - left < building + 1) {
+      overflow = true;
+      return nullptr;
+    }
+    base[left + building] = 0;
+    return base + left;
+  }
+  size_t stringLength() const { return building; }
+  uint32_t keepString() {
+    uint32_t offset = (uint32_t)left;
+    left += building + 1;
+    building = 0;
+    return offset;
+  }
+  void dropString() { building = 0; }
+};
+
+struct Ref {
+  Pool* pool;
+  Slot* slot;
+
+  uint8_t type() const { return slot ? slot->type() : TYPE_NULL; }
+  const char* string() const { return type() == TYPE_STRING ? pool->string(slot->content.string.offset) : nullptr; }
+
+  Slot* first() const {
+    uint8_t t = type();
+    return t == TYPE_ARRAY || t == TYPE_OBJECT ? pool->slot(slot->content.collection.head) : nullptr;
+  }
+  Slot* next(const Slot* child) const { return pool->slot(child->next); }
+
+  Ref member(const char* key) const {
+    if (type() == TYPE_OBJECT && key) {
+      for (Slot* child = first(); child; child = next(child)) {
+        if (strcmp(pool->string(child->key()), key) == 0) {
+          return Ref{pool, child};
+        }
+      }
+    }
+    return Ref{pool, nullptr};
+  }
+  Ref element(size_t index) const {
+    if (type() == TYPE_ARRAY) {
+      for (Slot* child = first(); child; child = next(child)) {
+        if (index-- == 0) {
+          return Ref{pool, child};
+        }
+      }
+    }
+    return Ref{pool, nullptr};
+  }
+  size_t size() const {
+    size_t count = 0;
+    for (Slot* child = first(); child; child = next(child)) {
+      count++;
+    }
+    return count;
+  }
+};
+
+inline void makeCollection(Slot* slot, uint8_t type) {
+  slot->setType(type);
+  slot->content.collection.head = NONE;
+  slot->content.collection.tail = NONE;
+}
+
+inline void append(Pool* pool, Slot* parent, Slot* child) {
+  uint32_t offset = pool->offsetOf(child);
+  if (parent->content.collection.tail == NONE) {
+    parent->content.collection.head = offset;
+  } else {
+    pool->slot(parent->content.collection.tail)->next = offset;
+  }
+  parent->content.collection.tail = offset;
+}
+
+inline Slot* getOrAddMember(Pool* pool, Slot* parent, const char* key) {
+  if (!parent || !key) {
+    return nullptr;
+  }
+  if (parent->type() == TYPE_NULL) {
+    makeCollection(parent, TYPE_OBJECT);
+  }
+  if (parent->type() != TYPE_OBJECT) {
+    return nullptr;
+  }
+  Ref existing = Ref{pool, parent}.member(key);
+  if (existing.slot) {
+    return existing.slot;
+  }
+  uint32_t keyOffset = pool->saveString(key, strlen(key));
+  Slot* child = keyOffset == NONE ? nullptr : pool->newSlot();
+  if (!child) {
+    return nullptr;
+  }
+  child->setKey(keyOffset);
+  append(pool, parent, child);
+  return child;
+}
+
+inline Slot* getOrAddElement(Pool* pool, Slot* parent, size_t index) {
+  if (!parent) {
+    return nullptr;
+  }
+  if (parent->type() == TYPE_NULL) {
+    makeCollection(parent, TYPE_ARRAY);
+  }
+  if (parent->type() != TYPE_ARRAY) {
+    return nullptr;
+  }
+  size_t count = 0;
+  for (Slot* child = pool->slot(parent->content.collection.head); child;
+       child = pool->slot(child->next)) {
+    if (count++ == index) {
+      return child;
+    }
+  }
+  Slot* child = nullptr;
+  while (count++ <= index) {
+    child = pool->newSlot();
+    if (!child) {
+      return nullptr;
+    }
+    append(pool, parent, child);
+  }
+  return child;
+}
+
+inline void setString(Pool* pool, Slot* slot, const char* text, size_t length) {
+  uint32_t offset = pool->saveString(text, length);
+  if (offset == NONE) {
+    slot->setType(TYPE_NULL);
+    return;
+  }
+  slot->setType(TYPE_STRING);
+  slot->content.string.offset = offset;
+  slot->content.string.length = (uint32_t)length;
+}
+
+inline void copyValue(Pool* pool, Slot* slot, Ref source) {
+  switch (source.type()) {
+    case TYPE_STRING:
+      setString(pool, slot, source.string(), source.slot->content.string.length);
+      return;
+    case TYPE_ARRAY:
+    case TYPE_OBJECT: {
+      uint8_t type = source.type();
+      makeCollection(slot, type);
+      for (Slot* from = source.first(); from; from = source.next(from)) {
+        Slot* to = type == TYPE_OBJECT
+                 ? getOrAddMember(pool, slot, source.pool->string(from->key()))
+                 : pool->newSlot();
+        if (!to) {
+          return;
+        }
+        if (type == TYPE_ARRAY) {
+          append(pool, slot, to);
+        }
+        copyValue(pool, to, Ref{source.pool, from});
+      }
+      return;
+    }
+    case TYPE_NULL:
+      slot->setType(TYPE_NULL);
+      return;
+    default:
+      slot->content = source.slot->content;
+      slot->setType(source.type());
+      return;
+  }
+}
+
+template <typename Output>
+void writeString(Output& out, const char* text) {
+  out += '"';
+  for (; *text; text++) {
+    char c = *text;
+    switch (c) {
+      case '"': out += "\\\""; break;
+      case '\\': out += "\\\\"; break;
+      case '\b': out += "\\b"; break;
+      case '\f': out += "\\f"; break;
+      case '\n': out += "\\n"; break;
+      case '\r': out += "\\r"; break;
+      case '\t': out += "\\t"; break;
+      default: out += c; break;
+    }
+  }
+  out += '"';
+}
+
+inline void writeValue(std::string& out, Ref value) {
+  char number[32];
+  switch (value.type()) {
+    case TYPE_NULL:
+      out += "null";
+      break;
+    case TYPE_BOOL:
+      out += value.slot->content.boolean ? "true" : "false";
+      break;
+    case TYPE_INT:
+      snprintf(number, sizeof(number), "%lld", (long long)value.slot->content.integer);
+      out += number;
+      break;
+    case TYPE_FLOAT:
+      snprintf(number, sizeof(number), "%.9g", value.slot->content.real);
+      out += number;
+      break;
+    case TYPE_STRING:
+      writeString(out, value.string());
+      break;
+    case TYPE_ARRAY:
+    case TYPE_OBJECT: {
+      bool object = value.type() == TYPE_OBJECT;
+      out += object ? '{' : '[';
+      for (Slot* child = value.first(); child; child = value.next(child)) {
+        if (child != value.first()) {
+          out += ',';
+        }
+        if (object) {
+          writeString(out, value.pool->string(child->key()));
+          out += ':';
+        }
+        writeValue(out, Ref{value.pool, child});
+      }
+      out += object ? '}' : ']';
+      break;
+    }
+  }
+}
+
+template <typename T, typename Enable = void>
+struct Converter;
+
+}  // namespace ArduinoJsonHost
+
+class JsonVariantConst;
+
+// Reading, shared by every kind of value reference
+template <typename Derived>
+class JsonReads {
+protected:
+  ArduinoJsonHost::Ref readRef() const { return static_cast<const Derived*>(this)->ref(); }
+
+public:
+  bool isNull() const { return readRef().type() == ArduinoJsonHost::TYPE_NULL; }
+  size_t size() const { return readRef().size(); }
+  bool containsKey(const char* key) const { return readRef().member(key).slot != nullptr; }
+  bool containsKey(const String& key) const { return containsKey(key.c_str()); }
+
+  template <typename T>
+  T as() const { return ArduinoJsonHost::Converter<T>::read(readRef()); }
+  template <typename T>
+  bool is() const { return ArduinoJsonHost::Converter<T>::check(readRef()); }
+
+  const char* operator|(const char* fallback) const {
+    const char* text = readRef().string();
+    return text ? text : fallback;
+  }
+  String operator|(const String& fallback) const {
+    const char* text = readRef().string();
+    return text ? String(text) : fallback;
+  }
+  template <typename T, typename = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  T operator|(T fallback) const {
+    return is<T>() ? as<T>() : fallback;
+  }
+
+  inline operator JsonVariantConst() const;
+};
+
+// Read-only references; indexing one gives another, or null
+class JsonVariantConst : public JsonReads<JsonVariantConst> {
+protected:
+  ArduinoJsonHost::Ref value;
+
+public:
+  JsonVariantConst() : value{nullptr, nullptr} {}
+  explicit JsonVariantConst(ArduinoJsonHost::Ref value) : value(value) {}
+  ArduinoJsonHost::Ref ref() const { return value; }
+
+  JsonVariantConst operator[](const char* key) const { return JsonVariantConst(value.member(key)); }
+  JsonVariantConst operator[](const String& key) const { return (*this)[key.c_str()]; }
+  template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+  JsonVariantConst operator[](T index) const { return JsonVariantConst(value.element(index)); }
+};
+
+template <typename Derived>
+inline JsonReads<Derived>::operator JsonVariantConst() const {
+  return JsonVariantConst(readRef());
+}
+
+class JsonObjectConst : public JsonVariantConst {
+public:
+  JsonObjectConst() {}
+  JsonObjectConst(JsonVariantConst variant) {
+    if (variant.ref().type() == ArduinoJsonHost::TYPE_OBJECT) {
+      value = variant.ref();
+    }
+  }
+};
+
+template <typename Element>
+class JsonIterator {
+private:
+  ArduinoJsonHost::Ref collection;
+  ArduinoJsonHost::Slot* slot;
+
+public:
+  JsonIterator(ArduinoJsonHost::Ref collection, ArduinoJsonHost::Slot* slot)
+    : collection(collection), slot(slot) {}
+  Element operator*() const { return Element(ArduinoJsonHost::Ref{collection.pool, slot}); }
+  JsonIterator& operator++() {
+    slot = collection.next(slot);
+    return *this;
+  }
+  bool operator!=(const JsonIterator& other) const { return slot != other.slot; }
+};
+
+class JsonArrayConst : public JsonVariantConst {
+public:
+  JsonArrayConst() {}
+  JsonArrayConst(JsonVariantConst variant) {
+    if (variant.ref().type() == ArduinoJsonHost::TYPE_ARRAY) {
+      value = variant.ref();
+    }
+  }
+  JsonIterator<JsonVariantConst> begin() const { return {value, value.first()}; }
+  JsonIterator<JsonVariantConst> end() const { return {value, nullptr}; }
+};
+
+template <typename Upstream>
+class JsonMemberProxy;
+template <typename Upstream>
+class JsonElementProxy;
+
+// Writing, shared by the references that can change the document. Indexing
+// gives a proxy that finds the value when read and adds it when written.
+template <typename Derived>
+class JsonWrites {
+private:
+  const Derived& self() const { return *static_cast<const Derived*>(this); }
+
+public:
+  JsonMemberProxy<Derived> operator[](const char* key) const { return {self(), key}; }
+  JsonMemberProxy<Derived> operator[](const String& key) const { return {self(), key.c_str()}; }
+  template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+  JsonElementProxy<Derived> operator[](T index) const { return {self(), (size_t)index}; }
+
+  template <typename T>
+  bool set(const T& value) const;
+};
+
+class JsonDocument;
+
+namespace ArduinoJsonHost {
+
+inline bool store(Pool* pool, Slot* slot, bool value) {
+  slot->setType(TYPE_BOOL);
+  slot->content.boolean = value;
+  return true;
+}
+template <typename T>
+typename std::enable_if<std::is_integral<T>::value && !std::is_same<T, bool>::value, bool>::type
+store(Pool* pool, Slot* slot, T value) {
+  slot->setType(TYPE_INT);
+  slot->content.integer = (int64_t)value;
+  return true;
+}
+template <typename T>
+typename std::enable_if<std::is_floating_point<T>::value, bool>::type
+store(Pool* pool, Slot* slot, T value) {
+  slot->setType(TYPE_FLOAT);
+  slot->content.real = value;
+  return true;
+}
+inline bool store(Pool* pool, Slot* slot, const char* value) {
+  if (!value) {
+    slot->setType(TYPE_NULL);
+    return true;
+  }
+  setString(pool, slot, value, strlen(value));
+  return slot->type() == TYPE_STRING;
+}
+inline bool store(Pool* pool, Slot* slot, const String& value) {
+  setString(pool, slot, value.c_str(), value.length());
+  return slot->type() == TYPE_STRING;
+}
+inline bool store(Pool* pool, Slot* slot, JsonVariantConst value) {
+  copyValue(pool, slot, value.ref());
+  return !pool->overflowed();
+}
+inline bool store(Pool* pool, Slot* slot, const JsonDocument& value);
+
+}  // namespace ArduinoJsonHost
+
+// Mutable references
+class JsonVariant : public JsonReads<JsonVariant>, public JsonWrites<JsonVariant> {
+protected:
+  ArduinoJsonHost::Ref value;
+
+public:
+  JsonVariant() : value{nullptr, nullptr} {}
+  explicit JsonVariant(ArduinoJsonHost::Ref value) : value(value) {}
+  ArduinoJsonHost::Ref ref() const { return value; }
+  ArduinoJsonHost::Pool* pool() const { return value.pool; }
+  ArduinoJsonHost::Slot* slotForWrite() const { return value.slot; }
+
+  using JsonWrites<JsonVariant>::operator[];
+};
+
+class JsonObject : public JsonVariant {
+public:
+  JsonObject() {}
+  JsonObject(JsonVariant variant) {
+    if (variant.ref().type() == ArduinoJsonHost::TYPE_OBJECT) {
+      value = variant.ref();
+    }
+  }
+  operator JsonObjectConst() const { return JsonObjectConst(JsonVariantConst(value)); }
+};
+
+class JsonArray : public JsonVariant {
+public:
+  JsonArray() {}
+  JsonArray(JsonVariant variant) {
+    if (variant.ref().type() == ArduinoJsonHost::TYPE_ARRAY) {
+      value = variant.ref();
+    }
+  }
+  operator JsonArrayConst() const { return JsonArrayConst(JsonVariantConst(value)); }
+  JsonIterator<JsonVariant> begin() const { return {value, value.first()}; }
+  JsonIterator<JsonVariant> end() const { return {value, nullptr}; }
+
+  JsonVariant add() const {
+    if (!value.slot) {
+      return JsonVariant();
+    }
+    ArduinoJsonHost::Slot* slot = value.pool->newSlot();
+    if (slot) {
+      ArduinoJsonHost::append(value.pool, value.slot, slot);
+    }
+    return JsonVariant(ArduinoJsonHost::Ref{value.pool, slot});
+  }
+};
+
+template <typename Derived>
+template <typename T>
+bool JsonWrites<Derived>::set(const T& value) const {
+  ArduinoJsonHost::Slot* slot = self().slotForWrite();
+  return slot && ArduinoJsonHost::store(self().pool(), slot, value);
+}
+
+template <typename Upstream>
+class JsonMemberProxy : public JsonReads<JsonMemberProxy<Upstream>>,
+                        public JsonWrites<JsonMemberProxy<Upstream>> {
+private:
+  Upstream upstream;
+  const char* key;
+
+public:
+  JsonMemberProxy(const Upstream& upstream, const char* key) : upstream(upstream), key(key) {}
+
+  ArduinoJsonHost::Ref ref() const { return upstream.ref().member(key); }
+  ArduinoJsonHost::Pool* pool() const { return upstream.pool(); }
+  ArduinoJsonHost::Slot* slotForWrite() const {
+    return ArduinoJsonHost::getOrAddMember(pool(), upstream.slotForWrite(), key);
+  }
+
+  template <typename T>
+  JsonMemberProxy& operator=(const T& value) {
+    this->set(value);
+    return *this;
+  }
+  JsonMemberProxy& operator=(const JsonMemberProxy& other) {
+    this->set(JsonVariantConst(other.ref()));
+    return *this;
+  }
+  template <typename T>
+  operator T() const { return this->template as<T>(); }
+
+  using JsonWrites<JsonMemberProxy<Upstream>>::operator[];
+};
+
+template <typename Upstream>
+class JsonElementProxy : public JsonReads<JsonElementProxy<Upstream>>,
+                         public JsonWrites<JsonElementProxy<Upstream>> {
+private:
+  Upstream upstream;
+  size_t index;
+
+public:
+  JsonElementProxy(const Upstream& upstream, size_t index) : upstream(upstream), index(index) {}
+
+  ArduinoJsonHost::Ref ref() const { return upstream.ref().element(index); }
+  ArduinoJsonHost::Pool* pool() const { return upstream.pool(); }
+  ArduinoJsonHost::Slot* slotForWrite() const {
+    return ArduinoJsonHost::getOrAddElement(pool(), upstream.slotForWrite(), index);
+  }
+
+  template <typename T>
+  JsonElementProxy& operator=(const T& value) {
+    this->set(value);
+    return *this;
+  }
+  JsonElementProxy& operator=(const JsonElementProxy& other) {
+    this->set(JsonVariantConst(other.ref()));
+    return *this;
+  }
+  template <typename T>
+  operator T() const { return this->template as<T>(); }
+
+  using JsonWrites<JsonElementProxy<Upstream>>::operator[];
+};
+
+class JsonDocument : public JsonReads<JsonDocument> {
+protected:
+  ArduinoJsonHost::Pool memory;
+  ArduinoJsonHost::Slot root;
+
+  JsonDocument(char* block, size_t size) : memory(block, size) { root.reset(); }
+  JsonDocument(const JsonDocument&) = delete;
+  JsonDocument& operator=(const JsonDocument&) = delete;
+
+  void take(JsonDocument& other) {
+    memory = other.memory;
+    root = other.root;
+    other.memory = ArduinoJsonHost::Pool();
+    other.root.reset();
+  }
+
+public:
+  ArduinoJsonHost::Ref ref() const {
+    return ArduinoJsonHost::Ref{const_cast<ArduinoJsonHost::Pool*>(&memory),
+                                const_cast<ArduinoJsonHost::Slot*>(&root)};
+  }
+  ArduinoJsonHost::Pool* pool() { return &memory; }
+  ArduinoJsonHost::Slot* slotForWrite() { return &root; }
+  JsonVariant asVariant() { return JsonVariant(ref()); }
+
+  size_t capacity() const { return memory.capacity(); }
+  size_t memoryUsage() const { return memory.usage(); }
+  bool overflowed() const { return memory.overflowed(); }
+  void clear() {
+    memory.clear();
+    root.reset();
+  }
+
+  JsonMemberProxy<JsonVariant> operator[](const char* key) { return asVariant()[key]; }
+  JsonMemberProxy<JsonVariant> operator[](const String& key) { return asVariant()[key]; }
+  template <typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+  JsonElementProxy<JsonVariant> operator[](T index) { return asVariant()[index]; }
+  JsonVariantConst operator[](const char* key) const { return JsonVariantConst(ref())[key]; }
+
+  template <typename T>
+  bool set(const T& value) {
+    clear();
+    return ArduinoJsonHost::store(&memory, &root, value);
+  }
+};
+
+inline bool ArduinoJsonHost::store(Pool* pool, Slot* slot, const JsonDocument& value) {
+  return store(pool, slot, JsonVariantConst(value.ref()));
+}
+
+template <typename TAllocator>
+class BasicJsonDocument : public JsonDocument {
+private:
+  TAllocator allocator;
+
+  char* allocate(size_t size) { return size ? (char*)allocator.allocate(size) : nullptr; }
+  void release() {
+    if (memory.block()) {
+      allocator.deallocate(memory.block());
+    }
+  }
+
+public:
+  explicit BasicJsonDocument(size_t capacity) : JsonDocument(nullptr, 0) {
+    memory = ArduinoJsonHost::Pool(allocate(capacity), capacity);
+  }
+  BasicJsonDocument(BasicJsonDocument&& other) : JsonDocument(nullptr, 0) { take(other); }
+  BasicJsonDocument& operator=(BasicJsonDocument&& other) {
+    if (this != &other) {
+      release();
+      take(other);
+    }
+    return *this;
+  }
+  ~BasicJsonDocument() { release(); }
+};
+
+struct DefaultAllocator {
+  void* allocate(size_t size) { return malloc(size); }
+  void deallocate(void* pointer) { free(pointer); }
+  void* reallocate(void* pointer, size_t size) { return realloc(pointer, size); }
+};
+
+typedef BasicJsonDocument<DefaultAllocator> DynamicJsonDocument;
+
+template <size_t CAPACITY>
+class StaticJsonDocument : public JsonDocument {
+private:
+  alignas(8) char block[CAPACITY];
+
+public:
+  StaticJsonDocument() : JsonDocument(block, CAPACITY) {}
+};
+
+#define JSON_OBJECT_SIZE(n) ((n) * sizeof(ArduinoJsonHost::Slot))
+#define JSON_ARRAY_SIZE(n) ((n) * sizeof(ArduinoJsonHost::Slot))
+
+namespace ArduinoJsonHost {
+
+inline String toString(Ref value) {
+  if (value.type() == TYPE_STRING) {
+    return String(value.string());
+  }
+  std::string text;
+  writeValue(text, value);
+  return String(text);
+}
+
+template <>
+struct Converter<bool> {
+  static bool read(Ref value) { return value.type() == TYPE_BOOL && value.slot->content.boolean; }
+  static bool check(Ref value) { return value.type() == TYPE_BOOL; }
+};
+template <typename T>
+struct Converter<T, typename std::enable_if<std::is_integral<T>::value &&
+                                            !std::is_same<T, bool>::value>::type> {
+  static T read(Ref value) {
+    switch (value.type()) {
+      case TYPE_INT: return (T)value.slot->content.integer;
+      case TYPE_FLOAT: return (T)value.slot->content.real;
+      case TYPE_BOOL: return (T)value.slot->content.boolean;
+      default: return 0;
+    }
+  }
+  static bool check(Ref value) { return value.type() == TYPE_INT; }
+};
+template <typename T>
+struct Converter<T, typename std::enable_if<std::is_floating_point<T>::value>::type> {
+  static T read(Ref value) {
+    switch (value.type()) {
+      case TYPE_INT: return (T)value.slot->content.integer;
+      case TYPE_FLOAT: return (T)value.slot->content.real;
+      default: return 0;
+    }
+  }
+  static bool check(Ref value) { return value.type() == TYPE_INT || value.type() == TYPE_FLOAT; }
+};
+template <>
+struct Converter<const char*> {
+  static const char* read(Ref value) { return value.string(); }
+  static bool check(Ref value) { return value.type() == TYPE_STRING; }
+};
+// As in ArduinoJson 6, anything but a string comes back serialized ("null")
+template <>
+struct Converter<String> {
+  static String read(Ref value) { return toString(value); }
+  static bool check(Ref value) { return value.type() == TYPE_STRING; }
+};
+template <typename T, uint8_t TYPE>
+struct CollectionConverter {
+  static T read(Ref value) { return T(JsonVariant(value)); }
+  static bool check(Ref value) { return value.type() == TYPE; }
+};
+template <>
+struct Converter<JsonObject> : CollectionConverter<JsonObject, TYPE_OBJECT> {};
+template <>
+struct Converter<JsonArray> : CollectionConverter<JsonArray, TYPE_ARRAY> {};
+template <typename T, uint8_t TYPE>
+struct ConstCollectionConverter {
+  static T read(Ref value) { return T(JsonVariantConst(value)); }
+  static bool check(Ref value) { return value.type() == TYPE; }
+};
+template <>
+struct Converter<JsonObjectConst> : ConstCollectionConverter<JsonObjectConst, TYPE_OBJECT> {};
+template <>
+struct Converter<JsonArrayConst> : ConstCollectionConverter<JsonArrayConst, TYPE_ARRAY> {};
+template <>
+struct Converter<JsonVariant> {
+  static JsonVariant read(Ref value) { return JsonVariant(value); }
+  static bool check(Ref value) { return value.slot != nullptr; }
+};
+template <>
+struct Converter<JsonVariantConst> {
+  static JsonVariantConst read(Ref value) { return JsonVariantConst(value); }
+  static bool check(Ref value) { return value.slot != nullptr; }
+};
+
+}  // namespace ArduinoJsonHost
+
+class DeserializationError {
+public:
+  enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory, TooDeep };
+
+  DeserializationError(Code code = Ok) : value(code) {}
+  explicit operator bool() const { return value != Ok; }
+  bool operator==(Code code) const { return value == code; }
+  bool operator!=(Code code) const { return value != code; }
+  Code code() const { return value; }
+  const char* c_str() const {
+    static const char* const names[] = {"Ok", "EmptyInput", "IncompleteInput",
+                                        "InvalidInput", "NoMemory", "TooDeep"};
+    return names[value];
+  }
+
+private:
+  Code value;
+};
+
+namespace DeserializationOption {
+
+class Filter {
+private:
+  JsonVariantConst filter;
+
+public:
+  explicit Filter(JsonVariantConst filter) : filter(filter) {}
+  explicit Filter(const JsonDocument& filter) : filter(filter.ref()) {}
+  JsonVariantConst variant() const { return filter; }
+};
+
+}  // namespace DeserializationOption
+
+namespace ArduinoJsonHost {
+
+// What a filter lets through at one point of the input: everything, a
+// value of some shape, or nothing
+struct FilterRef {
+  Ref filter;
+  bool all;
+
+  static FilterRef everything() { return FilterRef{Ref{nullptr, nullptr}, true}; }
+
+  bool allowValue() const {
+    return all || (filter.type() == TYPE_BOOL && filter.slot->content.boolean);
+  }
+  bool allowObject() const { return allowValue() || filter.type() == TYPE_OBJECT; }
+  bool allowArray() const { return allowValue() || filter.type() == TYPE_ARRAY; }
+  bool allowAny() const { return allowObject() || allowArray(); }
+
+  FilterRef member(const char* key) const {
+    if (allowValue()) {
+      return everything();
+    }
+    Ref found = filter.member(key);
+    if (!found.slot) {
+      found = filter.member("*");
+    }
+    return FilterRef{found, false};
+  }
+  FilterRef element() const {
+    if (allowValue()) {
+      return everything();
+    }
+    return FilterRef{filter.element(0), false};
+  }
+};
+
+struct StreamReader {
+  Stream& stream;
+  int peek() { return stream.peek(); }
+  int read() { return stream.read(); }
+};
+
+struct BufferReader {
+  const char* position;
+  const char* end;
+  int peek() { return position < end && *position ? (uint8_t)*position : -1; }
+  int read() { return position < end && *position ? (uint8_t)*position++ : -1; }
+};
+
+// Reads one value and stops right after it, so a stream can be read an
+// element at a time
+template <typename Reader>
+class Parser {
+private:
+  Reader reader;
+  Pool* pool;
+  DeserializationError::Code error;
+
+  bool fail(DeserializationError::Code code) {
+    if (error == DeserializationError::Ok) {
+      error = code;
+    }
+    return false;
+  }
+  bool failAt(int c) { return fail(c < 0 ? DeserializationError::IncompleteInput
+                                         : DeserializationError::InvalidInput); }
+
+  void skipSpace() {
+    for (;;) {
+      int c = reader.peek();
+      if (c != ' ' && c != '\t' && c != '\r' && c != '\n') {
+        return;
+      }
+      reader.read();
+    }
+  }
+
+  bool expect(char wanted) {
+    skipSpace();
+    int c = reader.read();
+    return c == wanted || failAt(c);
+  }
+
+  static bool isLiteralChar(int c) {
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           c == '+' || c == '-' || c == '.';
+  }
+
+  static int hexValue(int c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+  }
+
+  bool readHex4(uint32_t& value) {
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+      int c = reader.read();
+      int digit = hexValue(c);
+      if (digit < 0) {
+        return failAt(c);
+      }
+      value = value * 16 + digit;
+    }
+    return true;
+  }
+
+  // Reads a quoted string, into the pool when keep is set
+  bool readString(bool keep) {
+    int quote = reader.read();
+    if (keep) {
+      pool->startString();
+    }
+    for (;;) {
+      int c = reader.read();
+      if (c < 0) {
+        return failAt(c);
+      }
+      if (c == quote) {
+        return !keep || pool->endString() || fail(DeserializationError::NoMemory);
+      }
+      if (c == '\\') {
+        c = reader.read();
+        switch (c) {
+          case 'b': c = '\b'; break;
+          case 'f': c = '\f'; break;
+          case 'n': c = '\n'; break;
+          case 'r': c = '\r'; break;
+          case 't': c = '\t'; break;
+          case '"': case '\'': case '\\': case '/': break;
+          case 'u': {
+            uint32_t code;
+            if (!readHex4(code)) {
+              return false;
+            }
+            if (code >= 0xD800 && code < 0xDC00) {
+              uint32_t low;
+              if (reader.read() != '\\' || reader.read() != 'u' || !readHex4(low)) {
+                return fail(DeserializationError::InvalidInput);
+              }
+              code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+            }
+            if (keep && !pushCodepoint(code)) {
+              return fail(DeserializationError::NoMemory);
+            }
+            continue;
+          }
+          default:
+            return failAt(c);
+        }
+      }
+      if (keep && !pool->push((char)c)) {
+        return fail(DeserializationError::NoMemory);
+      }
+    }
+  }
+
+  bool pushCodepoint(uint32_t code) {
+    if (code < 0x80) {
+      return pool->push((char)code);
+    }
+    if (code < 0x800) {
+      return pool->push((char)(0xC0 | (code >> 6))) && pool->push((char)(0x80 | (code & 0x3F)));
+    }
+    if (code < 0x10000) {
+      return pool->push((char)(0xE0 | (code >> 12))) &&
+             pool->push((char)(0x80 | ((code >> 6) & 0x3F))) &&
+             pool->push((char)(0x80 | (code & 0x3F)));
+    }
+    return pool->push((char)(0xF0 | (code >> 18))) &&
+           pool->push((char)(0x80 | ((code >> 12) & 0x3F))) &&
+           pool->push((char)(0x80 | ((code >> 6) & 0x3F))) &&
+           pool->push((char)(0x80 | (code & 0x3F)));
+  }
+
+  // true, false, null or a number, stored in slot unless it is null
+  bool readLiteral(Slot* slot) {
+    char text[64];
+    size_t length = 0;
+    while (isLiteralChar(reader.peek())) {
+      int c = reader.read();
+      if (length + 1 >= sizeof(text)) {
+        return fail(DeserializationError::InvalidInput);
+      }
+      text[length++] = (char)c;
+    }
+    text[length] = 0;
+    if (length == 0) {
+      return failAt(reader.peek());
+    }
+    if (!slot) {
+      return true;
+    }
+    if (strcmp(text, "true") == 0 || strcmp(text, "false") == 0) {
+      return store(pool, slot, text[0] == 't');
+    }
+    if (strcmp(text, "null") == 0) {
+      slot->setType(TYPE_NULL);
+      return true;
+    }
+    char* end;
+    bool integer = strpbrk(text, ".eE") == nullptr;
+    if (integer) {
+      errno = 0;
+      long long value = strtoll(text, &end, 10);
+      if (*end == 0 && errno == 0) {
+        return store(pool, slot, value);
+      }
+    }
+    double value = strtod(text, &end);
+    if (*end != 0) {
+      return fail(DeserializationError::InvalidInput);
+    }
+    return store(pool, slot, value);
+  }
+
+  bool skipValue(int depth) {
+    skipSpace();
+    int c = reader.peek();
+    if (c == '"' || c == '\'') {
+      return readString(false);
+    }
+    if (c != '{' && c != '[') {
+      return readLiteral(nullptr);
+    }
+    if (depth == 0) {
+      return fail(DeserializationError::TooDeep);
+    }
+    bool object = c == '{';
+    char close = object ? '}' : ']';
+    reader.read();
+    skipSpace();
+    if (reader.peek() == close) {
+      reader.read();
+      return true;
+    }
+    for (;;) {
+      if (object) {
+        skipSpace();
+        if (reader.peek() != '"' && reader.peek() != '\'') {
+          return failAt(reader.peek());
+        }
+        if (!readString(false) || !expect(':')) {
+          return false;
+        }
+      }
+      if (!skipValue(depth - 1)) {
+        return false;
+      }
+      skipSpace();
+      c = reader.read();
+      if (c == close) {
+        return true;
+      }
+      if (c != ',') {
+        return failAt(c);
+      }
+    }
+  }
+
+  bool readObject(Slot* slot, FilterRef filter, int depth) {
+    if (depth == 0) {
+      return fail(DeserializationError::TooDeep);
+    }
+    reader.read();
+    makeCollection(slot, TYPE_OBJECT);
+    skipSpace();
+    if (reader.peek() == '}') {
+      reader.read();
+      return true;
+    }
+    for (;;) {
+      skipSpace();
+      if (reader.peek() != '"' && reader.peek() != '\'') {
+        return failAt(reader.peek());
+      }
+      if (!readString(true)) {
+        return false;
+      }
+      FilterRef memberFilter = filter.member(pool->endString());
+      if (memberFilter.allowAny()) {
+        uint32_t key = pool->keepString();
+        Slot* child = pool->newSlot();
+        if (!child) {
+          return fail(DeserializationError::NoMemory);
+        }
+        child->setKey(key);
+        append(pool, slot, child);
+        if (!expect(':') || !readValue(child, memberFilter, depth - 1)) {
+          return false;
+        }
+      } else {
+        pool->dropString();
+        if (!expect(':') || !skipValue(depth - 1)) {
+          return false;
+        }
+      }
+      skipSpace();
+      int c = reader.read();
+      if (c == '}') {
+        return true;
+      }
+      if (c != ',') {
+        return failAt(c);
+      }
+    }
+  }
+
+  bool readArray(Slot* slot, FilterRef filter, int depth) {
+    if (depth == 0) {
+      return fail(DeserializationError::TooDeep);
+    }
+    reader.read();
+    makeCollection(slot, TYPE_ARRAY);
+    FilterRef elementFilter = filter.element();
+    skipSpace();
+    if (reader.peek() == ']') {
+      reader.read();
+      return true;
+    }
+    for (;;) {
+      if (elementFilter.allowAny()) {
+        Slot* child = pool->newSlot();
+        if (!child) {
+          return fail(DeserializationError::NoMemory);
+        }
+        append(pool, slot, child);
+        if (!readValue(child, elementFilter, depth - 1)) {
+          return false;
+        }
+      } else if (!skipValue(depth - 1)) {
+        return false;
+      }
+      skipSpace();
+      int c = reader.read();
+      if (c == ']') {
+        return true;
+      }
+      if (c != ',') {
+        return failAt(c);
+      }
+    }
+  }
+
+  bool readValue(Slot* slot, FilterRef filter, int depth) {
+    skipSpace();
+    int c = reader.peek();
+    if (c == '{') {
+      return filter.allowObject() ? readObject(slot, filter, depth) : skipValue(depth);
+    }
+    if (c == '[') {
+      return filter.allowArray() ? readArray(slot, filter, depth) : skipValue(depth);
+    }
+    if (!filter.allowValue()) {
+      return skipValue(depth);
+    }
+    if (c == '"' || c == '\'') {
+      if (!readString(true)) {
+        return false;
+      }
+      size_t length = pool->stringLength();
+      slot->setType(TYPE_STRING);
+      slot->content.string.offset = pool->keepString();
+      slot->content.string.length = (uint32_t)length;
+      return true;
+    }
+    return readLiteral(slot);
+  }
+
+public:
+  Parser(Reader reader, Pool* pool)
+    : reader(reader), pool(pool), error(DeserializationError::Ok) {}
+
+  DeserializationError parse(Slot* root, FilterRef filter) {
+    skipSpace();
+    if (reader.peek() < 0) {
+      return DeserializationError::EmptyInput;
+    }
+    if (!readValue(root, filter, NESTING_LIMIT)) {
+      return error;
+    }
+    return DeserializationError::Ok;
+  }
+};
+
+template <typename Reader>
+DeserializationError deserialize(JsonDocument& doc, Reader reader, FilterRef filter) {
+  doc.clear();
+  return Parser<Reader>(reader, doc.pool()).parse(doc.slotForWrite(), filter);
+}
+
+}  // namespace ArduinoJsonHost
+
+inline DeserializationError deserializeJson(JsonDocument& doc, Stream& input) {
+  return ArduinoJsonHost::deserialize(doc, ArduinoJsonHost::StreamReader{input},
+                                      ArduinoJsonHost::FilterRef::everything());
+}
+
+inline DeserializationError deserializeJson(JsonDocument& doc, Stream& input,
+                                            DeserializationOption::Filter filter) {
+  return ArduinoJsonHost::deserialize(doc, ArduinoJsonHost::StreamReader{input},
+                                      ArduinoJsonHost::FilterRef{filter.variant().ref(), false});
+}
+
+inline DeserializationError deserializeJson(JsonDocument& doc, const char* input, size_t length) {
+  return ArduinoJsonHost::deserialize(doc, ArduinoJsonHost::BufferReader{input, input + length},
+                                      ArduinoJsonHost::FilterRef::everything());
+}
+
+inline DeserializationError deserializeJson(JsonDocument& doc, const char* input) {
+  return deserializeJson(doc, input, strlen(input));
+}
+
+inline DeserializationError deserializeJson(JsonDocument& doc, const String& input) {
+  return deserializeJson(doc, input.c_str(), input.length());
+}
+
+inline size_t serializeJson(const JsonDocument& doc, String& output) {
+  std::string text;
+  ArduinoJsonHost::writeValue(text, doc.ref());
+  output += String(text);
+  return text.size();
+}
+
+inline size_t measureJson(const JsonDocument& doc) {
+  std::string text;
+  ArduinoJsonHost::writeValue(text, doc.ref());
+  return text.size();
+}
+
+#endif // ARDUINOJSON_H
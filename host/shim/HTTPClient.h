@@ -0,0 +1,61 @@
+#ifndef HOST_HTTP_CLIENT_H
+#define HOST_HTTP_CLIENT_H
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+#define HTTPC_ERROR_SEND_HEADER_FAILED (-2)
+#define HTTPC_ERROR_SEND_PAYLOAD_FAILED (-3)
+#define HTTPC_ERROR_NOT_CONNECTED (-4)
+#define HTTPC_ERROR_CONNECTION_LOST (-5)
+#define HTTPC_ERROR_NO_STREAM (-6)
+#define HTTPC_ERROR_NO_HTTP_SERVER (-7)
+#define HTTPC_ERROR_TOO_LESS_RAM (-8)
+#define HTTPC_ERROR_ENCODING (-9)
+#define HTTPC_ERROR_STREAM_WRITE (-10)
+#define HTTPC_ERROR_READ_TIMEOUT (-11)
+
+// Every request is refused; the host uses a fixture transport instead
+class HTTPClient {
+private:
+  WiFiClient* client;
+
+public:
+  HTTPClient() : client(nullptr) {}
+
+  void useHTTP10(bool) {}
+  void setReuse(bool) {}
+  void setConnectTimeout(int32_t) {}
+  void setTimeout(uint16_t) {}
+  bool begin(WiFiClient& socket, const String&) {
+    client = &socket;
+    return true;
+  }
+  void addHeader(const String&, const String&) {}
+  void collectHeaders(const char**, size_t) {}
+  int sendRequest(const char*, const String& = String()) { return HTTPC_ERROR_CONNECTION_REFUSED; }
+  String header(const char*) { return String(); }
+  int getSize() { return -1; }
+  WiFiClient& getStream() { return *client; }
+  void end() {}
+
+  static String errorToString(int error) {
+    switch (error) {
+      case HTTPC_ERROR_CONNECTION_REFUSED: return "connection refused";
+      case HTTPC_ERROR_SEND_HEADER_FAILED: return "send header failed";
+      case HTTPC_ERROR_SEND_PAYLOAD_FAILED: return "send payload failed";
+      case HTTPC_ERROR_NOT_CONNECTED: return "not connected";
+      case HTTPC_ERROR_CONNECTION_LOST: return "connection lost";
+      case HTTPC_ERROR_NO_STREAM: return "no stream";
+      case HTTPC_ERROR_NO_HTTP_SERVER: return "no HTTP server";
+      case HTTPC_ERROR_TOO_LESS_RAM: return "too less ram";
+      case HTTPC_ERROR_ENCODING: return "Transfer-Encoding not supported";
+      case HTTPC_ERROR_STREAM_WRITE: return "Stream write error";
+      case HTTPC_ERROR_READ_TIMEOUT: return "read Timeout";
+      default: return String();
+    }
+  }
+};
+
+#endif // HOST_HTTP_CLIENT_H
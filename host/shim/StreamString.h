@@ -0,0 +1,27 @@
+#ifndef HOST_STREAM_STRING_H
+#define HOST_STREAM_STRING_H
+
+#include <Arduino.h>
+
+// A String that can be written to and read back as a stream
+class StreamString : public Stream, public String {
+private:
+  size_t readPos;
+
+public:
+  StreamString() : readPos(0) {}
+
+  size_t write(uint8_t value) override {
+    concat((char)value);
+    return 1;
+  }
+  size_t write(const uint8_t* data, size_t length) override {
+    concat((const char*)data, length);
+    return length;
+  }
+  int available() override { return length() - readPos; }
+  int read() override { return readPos < length() ? (uint8_t)c_str()[readPos++] : -1; }
+  int peek() override { return readPos < length() ? (uint8_t)c_str()[readPos] : -1; }
+};
+
+#endif // HOST_STREAM_STRING_H
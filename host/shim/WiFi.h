@@ -0,0 +1,58 @@
+#ifndef HOST_WIFI_H
+#define HOST_WIFI_H
+
+#include <Arduino.h>
+
+enum wl_status_t {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_DISCONNECTED = 6
+};
+
+// Joins at once; a test can take the network away with setStatus()
+class WiFiClass {
+private:
+  wl_status_t current;
+
+public:
+  WiFiClass() : current(WL_DISCONNECTED) {}
+
+  void setStatus(wl_status_t status) { current = status; }
+
+  wl_status_t begin(const char*, const char*) {
+    current = WL_CONNECTED;
+    return current;
+  }
+  bool disconnect(bool = false) {
+    current = WL_DISCONNECTED;
+    return true;
+  }
+  wl_status_t status() { return current; }
+  IPAddress localIP() { return IPAddress(127, 0, 0, 1); }
+  int hostByName(const char*, IPAddress& address) {
+    address = IPAddress(127, 0, 0, 1);
+    return 1;
+  }
+};
+
+extern WiFiClass WiFi;
+
+// Never connects: the host talks to fixtures through HttpTransport, not
+// sockets
+class WiFiClient : public Stream {
+public:
+  virtual ~WiFiClient() {}
+  virtual int connect(const char*, uint16_t) { return 0; }
+  virtual uint8_t connected() { return 0; }
+  virtual void stop() {}
+
+  int available() override { return 0; }
+  int read() override { return -1; }
+  int peek() override { return -1; }
+  size_t write(uint8_t) override { return 0; }
+  using Print::write;
+};
+
+#endif // HOST_WIFI_H
@@ -0,0 +1,12 @@
+#ifndef HOST_WIFI_CLIENT_SECURE_H
+#define HOST_WIFI_CLIENT_SECURE_H
+
+#include <WiFi.h>
+
+class WiFiClientSecure : public WiFiClient {
+public:
+  void setCACert(const char*) {}
+  void setInsecure() {}
+};
+
+#endif // HOST_WIFI_CLIENT_SECURE_H
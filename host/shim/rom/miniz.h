@@ -0,0 +1,73 @@
+#ifndef HOST_ROM_MINIZ_H
+#define HOST_ROM_MINIZ_H
+
+// The ESP32 ROM's tinfl inflater, as GzipStream uses it, over zlib. zlib
+// keeps its own history window, so the output buffer is only written to.
+
+#include <stddef.h>
+#include <stdint.h>
+#include <zlib.h>
+
+typedef enum {
+  TINFL_STATUS_BAD_PARAM = -3,
+  TINFL_STATUS_ADLER32_MISMATCH = -2,
+  TINFL_STATUS_FAILED = -1,
+  TINFL_STATUS_DONE = 0,
+  TINFL_STATUS_NEEDS_MORE_INPUT = 1,
+  TINFL_STATUS_HAS_MORE_OUTPUT = 2
+} tinfl_status;
+
+enum {
+  TINFL_FLAG_PARSE_ZLIB_HEADER = 1,
+  TINFL_FLAG_HAS_MORE_INPUT = 2,
+  TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF = 4,
+  TINFL_FLAG_COMPUTE_ADLER32 = 8
+};
+
+#define TINFL_LZ_DICT_SIZE 32768
+
+struct tinfl_decompressor {
+  z_stream stream;
+  bool open;
+
+  tinfl_decompressor() : stream(), open(false) {}
+  ~tinfl_decompressor() {
+    if (open) {
+      inflateEnd(&stream);
+    }
+  }
+};
+
+inline void tinfl_init(tinfl_decompressor* inflater) {
+  if (inflater->open) {
+    inflateReset(&inflater->stream);
+  } else {
+    inflater->open = inflateInit2(&inflater->stream, -MAX_WBITS) == Z_OK;
+  }
+}
+
+inline tinfl_status tinfl_decompress(tinfl_decompressor* inflater, const uint8_t* in,
+                                     size_t* inSize, uint8_t*, uint8_t* out,
+                                     size_t* outSize, const uint32_t) {
+  if (!inflater->open) {
+    return TINFL_STATUS_BAD_PARAM;
+  }
+  z_stream& stream = inflater->stream;
+  stream.next_in = (Bytef*)in;
+  stream.avail_in = *inSize;
+  stream.next_out = out;
+  stream.avail_out = *outSize;
+  int result = inflate(&stream, Z_NO_FLUSH);
+  *inSize -= stream.avail_in;
+  *outSize -= stream.avail_out;
+
+  if (result == Z_STREAM_END) {
+    return TINFL_STATUS_DONE;
+  }
+  if (result != Z_OK && result != Z_BUF_ERROR) {
+    return TINFL_STATUS_FAILED;
+  }
+  return stream.avail_out == 0 ? TINFL_STATUS_HAS_MORE_OUTPUT : TINFL_STATUS_NEEDS_MORE_INPUT;
+}
+
+#endif // HOST_ROM_MINIZ_H
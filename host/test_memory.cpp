@@ -0,0 +1,108 @@
+// MemoryTelemetry's host counters: operator new calls, live and peak
+// bytes, per-call figures through MemoryScope, and the operations that
+// are meant to allocate a fixed amount whatever the card holds.
+
+#include "HostTest.h"
+#include "CardCodec.h"
+#include "MemoryTelemetry.h"
+#include "SampleCards.h"
+
+// Kept where the compiler can see it escape, so the new is not elided
+static char* volatile escaped;
+
+static void testCounters() {
+  MemorySample before = MemoryTelemetry::read();
+  MemoryTelemetry::resetPeak();
+  escaped = new char[4000];
+  MemorySample during = MemoryTelemetry::read();
+  CHECK(during.allocations == before.allocations + 1);
+  CHECK(during.allocatedBytes == before.allocatedBytes + 4000);
+  CHECK(during.liveBytes == before.liveBytes + 4000);
+  delete[] escaped;
+  MemorySample after = MemoryTelemetry::read();
+  CHECK(after.liveBytes == before.liveBytes);
+  CHECK(after.peakBytes >= before.liveBytes + 4000);
+
+  MemoryTelemetry::resetPeak();
+  CHECK(MemoryTelemetry::read().peakBytes == after.liveBytes);
+}
+
+// Two Strings too long to be stored inline, one of them kept
+static std::vector<String> kept;
+
+static void keepOne() {
+  MemoryScope memory("keepOne");
+  String dropped("a string well past the inline buffer");
+  kept.push_back(String("another string well past the inline buffer"));
+}
+
+static void testScope() {
+  kept.reserve(4);
+  keepOne();
+  keepOne();
+  const MemoryBucket* stats = MemoryTelemetry::instance().callStats("keepOne");
+  CHECK(stats != nullptr);
+  if (!stats) {
+    return;
+  }
+  CHECK(stats->count == 2);
+  CHECK(stats->allocations == 4);
+  CHECK(stats->maxAllocations == 2);
+  CHECK(stats->retainedBytes >= 2 * 42);
+  CHECK(stats->retainedBytes < 2 * 128);
+}
+
+static unsigned long allocationsSince(const MemorySample& before) {
+  return MemoryTelemetry::read().allocations - before.allocations;
+}
+
+// The text goes in one arena block, which is malloc and not counted, so a
+// card costs its two vectors and the name read on its way to the pool,
+// however many comments and items it has
+static void testDecode() {
+  unsigned long most = 0;
+  size_t largest = 0;
+  for (unsigned index = 1; index <= 60; index++) {
+    FullCard source;
+    sampleCard(index, source);
+    std::vector<uint8_t> encoded;
+    CardCodec::encode(source, encoded);
+
+    FullCard card;
+    MemorySample before = MemoryTelemetry::read();
+    bool decoded = CardCodec::decode(encoded, 0, CardCodec::VERSION, card);
+    unsigned long allocations = allocationsSince(before);
+    CHECK(decoded);
+    CHECK(card.comments.size() == source.comments.size());
+    CHECK(card.checklists.size() == source.checklists.size());
+    most = max(most, allocations);
+    largest = max(largest, source.comments.size() + source.checklists.size());
+
+    // Decoding into a card already holding one reuses its vectors
+    before = MemoryTelemetry::read();
+    CardCodec::decode(encoded, 0, CardCodec::VERSION, card);
+    CHECK(allocationsSince(before) <= 1);
+  }
+  CHECK(most <= 3);
+  CHECK(largest >= 20);
+}
+
+// The loop calls this every pass, so it must not allocate at all
+static void testSampleScreen() {
+  MemoryTelemetry& telemetry = MemoryTelemetry::instance();
+  telemetry.sampleScreen("list");
+  telemetry.sampleScreen("card");
+  MemorySample before = MemoryTelemetry::read();
+  for (int i = 0; i < 1000; i++) {
+    telemetry.sampleScreen(i % 2 == 0 ? "list" : "card");
+  }
+  CHECK(allocationsSince(before) == 0);
+}
+
+int main() {
+  testCounters();
+  testScope();
+  testDecode();
+  testSampleScreen();
+  return testResult("test_memory");
+}
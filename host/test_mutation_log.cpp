@@ -0,0 +1,160 @@
+// MutationLog on PosixStorage: a 500-change backlog drained the way
+// replayMutations() does it, a reboot halfway through, a torn tail, and
+// check item toggles that cancel out.
+
+#include "HostTest.h"
+#include "MutationLog.h"
+#include "PosixStorage.h"
+#include "SampleCards.h"
+
+static const unsigned BACKLOG = 500;
+
+static Mutation sampleMutation(unsigned index) {
+  Mutation mutation((MutationType)(index % 3 + 1));
+  mutation.cardId = sampleCardId(index);
+  if (mutation.type == MUTATION_SET_CHECK_ITEM) {
+    mutation.itemId = sampleCardId(index * 100);
+    mutation.complete = true;
+  } else {
+    SampleShape shape(index);
+    mutation.text = sampleWords(shape, sampleCommentWords(shape));
+  }
+  if (mutation.type == MUTATION_CREATE_CARD) {
+    mutation.extra = "Created offline";
+  }
+  return mutation;
+}
+
+static void fillBacklog(MutationLog& log) {
+  for (unsigned i = 0; i < BACKLOG; i++) {
+    CHECK(log.append(sampleMutation(i)) == i + 1);
+  }
+}
+
+// As replayMutations() and onMutationReplayed() do between them: send the
+// oldest, mark it attempted, commit it once the server answers
+static unsigned drain(MutationLog& log, unsigned limit, bool& inOrder) {
+  unsigned sent = 0;
+  uint32_t last = 0;
+  while (log.hasPending() && sent < limit) {
+    const Mutation* mutation = log.next();
+    uint32_t seq = mutation->seq;
+    inOrder = inOrder && seq > last;
+    last = seq;
+    log.markAttempted(seq);
+    log.markDone(seq);
+    sent++;
+  }
+  return sent;
+}
+
+static void testDrain(const std::string& dir) {
+  PosixStorage storage(dir);
+  MutationLog log(&storage);
+  CHECK(log.begin());
+  fillBacklog(log);
+  CHECK(log.size() == BACKLOG);
+
+  unsigned long writesBefore = storage.getStats().writes;
+  unsigned long long start = nowNs();
+  bool inOrder = true;
+  CHECK(drain(log, BACKLOG, inOrder) == BACKLOG);
+  unsigned long long elapsed = nowNs() - start;
+  CHECK(inOrder);
+  CHECK(!log.hasPending());
+  CHECK(!storage.exists(MUTATION_LOG_FILE));
+
+  // An attempt and a done record per change, then the empty log removed
+  unsigned long writes = storage.getStats().writes - writesBefore;
+  CHECK(writes == 2 * BACKLOG);
+  printf("mutation log: drained %u changes in %llu ms, %llu us each, %lu writes\n",
+         BACKLOG, elapsed / 1000000, elapsed / 1000 / BACKLOG, writes);
+}
+
+// A reboot halfway through the drain resumes at the first unsent change,
+// with the one that was in flight marked for verification
+static void testResume(const std::string& dir) {
+  PosixStorage storage(dir);
+  {
+    MutationLog log(&storage);
+    CHECK(log.begin());
+    fillBacklog(log);
+    bool inOrder = true;
+    CHECK(drain(log, BACKLOG / 2, inOrder) == BACKLOG / 2);
+    // Resending keeps the time of the first send
+    log.markAttempted(log.next()->seq, 1792143000);
+    log.markAttempted(log.next()->seq, 1792143060);
+  }
+
+  MutationLog log(&storage);
+  CHECK(log.begin());
+  CHECK(log.size() == BACKLOG / 2);
+  const Mutation* first = log.next();
+  CHECK(first && first->seq == BACKLOG / 2 + 1 && first->attempted);
+  CHECK(first && first->attemptedAt == 1792143000);
+  Mutation expected = sampleMutation(BACKLOG / 2);
+  CHECK(first && first->text == expected.text && first->cardId == expected.cardId);
+
+  // New changes carry on from the highest sequence number seen
+  CHECK(log.append(sampleMutation(BACKLOG)) == BACKLOG + 1);
+  bool inOrder = true;
+  CHECK(drain(log, BACKLOG, inOrder) == BACKLOG / 2 + 1);
+  CHECK(inOrder);
+}
+
+// Power lost in the middle of an append: the torn record goes, the rest stays
+static void testTornTail(const std::string& dir) {
+  PosixStorage storage(dir);
+  {
+    MutationLog log(&storage);
+    CHECK(log.begin());
+    fillBacklog(log);
+  }
+  StorageFile* file = storage.open(MUTATION_LOG_FILE, STORAGE_APPEND);
+  CHECK(file != nullptr);
+  if (file) {
+    file->write((const uint8_t*)"W\x01\x40\x00torn", 8);
+    delete file;
+  }
+
+  MutationLog log(&storage);
+  CHECK(log.begin());
+  CHECK(log.size() == BACKLOG);
+
+  MutationLog reread(&storage);
+  CHECK(reread.begin());
+  CHECK(reread.size() == BACKLOG);
+}
+
+static void testToggles(const std::string& dir) {
+  PosixStorage storage(dir);
+  MutationLog log(&storage);
+  CHECK(log.begin());
+
+  Mutation check(MUTATION_SET_CHECK_ITEM);
+  check.cardId = sampleCardId(1);
+  check.itemId = sampleCardId(100);
+  for (int i = 0; i < 9; i++) {
+    check.wasComplete = i % 2 == 1;
+    check.complete = i % 2 == 0;
+    log.append(check);
+  }
+  // Nine toggles leave one change, from the original state
+  CHECK(log.size() == 1);
+  CHECK(log.next()->complete && !log.next()->wasComplete);
+
+  // The tenth undoes it
+  check.wasComplete = true;
+  check.complete = false;
+  CHECK(log.append(check) == 0);
+  CHECK(!log.hasPending());
+}
+
+int main() {
+  Serial.mute(true);
+  testDrain(tempDirectory("log-drain"));
+  testResume(tempDirectory("log-resume"));
+  testTornTail(tempDirectory("log-torn"));
+  testToggles(tempDirectory("log-toggles"));
+  return testResult("test_mutation_log");
+}
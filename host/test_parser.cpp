@@ -0,0 +1,81 @@
+// parseCardList straight off a stream, on lists of 100 to 5,000 cards. The
+// parser's own peak memory has to be the same however long the list: one
+// card at a time in the JSON document, nothing else held while it works.
+// What it keeps is the CardSummary per card and the pooled names.
+//
+// The heap figures are what operator new saw; the JSON document is
+// malloc'd once and reported as the most of it one card used.
+
+#include "HostTest.h"
+#include "FixtureTransport.h"
+#include "MemoryTelemetry.h"
+#include "PosixStorage.h"
+#include "SampleCards.h"
+#include "TrelloClient.h"
+
+struct ListFigures {
+  unsigned cards;
+  size_t bodyBytes;
+  double keptPerCard;               // First parse: the vector and the name pool
+  unsigned long long parserPeak;    // Second parse: above what was live before it
+  size_t docBytes;
+};
+
+static ListFigures parseList(TrelloClient& client, unsigned count) {
+  ListFigures figures = {count};
+  String json = sampleListJson(0, count);
+  std::string body(json.c_str(), json.length());
+  figures.bodyBytes = body.size();
+  BufferStream stream(body);
+
+  std::vector<CardSummary> cards;
+  MemorySample before = MemoryTelemetry::read();
+  CHECK(client.parseCardList(stream, cards) == API_SUCCESS);
+  MemorySample after = MemoryTelemetry::read();
+  CHECK(cards.size() == count);
+  CHECK(cards.front().id == CardId::fromString(sampleCardId(count - 1)));
+  CHECK(cards.back().id == CardId::fromString(sampleCardId(0)));
+  figures.keptPerCard = (double)(after.liveBytes - before.liveBytes) / count;
+
+  // Again with the names already pooled and room for the cards, so all the
+  // heap the parse touches is its own
+  std::vector<CardSummary> again;
+  again.reserve(count);
+  stream.rewind();
+  MemoryTelemetry::resetPeak();
+  before = MemoryTelemetry::read();
+  CHECK(client.parseCardList(stream, again) == API_SUCCESS);
+  after = MemoryTelemetry::read();
+  CHECK(again.size() == count);
+  CHECK(after.liveBytes == before.liveBytes);
+  figures.parserPeak = after.peakBytes - before.liveBytes;
+  figures.docBytes = client.getPeakDocBytes();
+  return figures;
+}
+
+int main() {
+  Serial.mute(true);
+  PosixStorage storage(tempDirectory("parser"));
+  FixtureTransport transport;
+  TrelloClient client(&storage);
+  client.setTransport(&transport);
+  CHECK(client.begin());
+
+  printf("%7s %10s %12s %12s %12s\n", "cards", "body", "kept/card", "parser peak", "doc peak");
+  const unsigned counts[] = {100, 1000, 5000};
+  ListFigures smallest = {};
+  for (unsigned count : counts) {
+    ListFigures figures = parseList(client, count);
+    printf("%7u %10u %12.1f %12llu %12u\n", figures.cards, (unsigned)figures.bodyBytes,
+           figures.keptPerCard, figures.parserPeak, (unsigned)figures.docBytes);
+    if (count == counts[0]) {
+      smallest = figures;
+      continue;
+    }
+    // Fifty times the body, the same working memory
+    CHECK(figures.parserPeak <= smallest.parserPeak + 256);
+    CHECK(figures.docBytes <= smallest.docBytes + 64);
+    CHECK(figures.docBytes < JSON_DOC_MIN_BYTES);
+  }
+  return testResult("test_parser");
+}
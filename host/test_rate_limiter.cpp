@@ -0,0 +1,129 @@
+// TokenBucket on the simulated clock: the burst, the steady rate it
+// settles to, and how a 429 and the server's own count slow it down.
+
+#include <limits.h>
+#include "HostTest.h"
+#include "RateLimiter.h"
+
+static void testBurst() {
+  TokenBucket bucket;
+  int granted = 0;
+  while (bucket.tryAcquire()) {
+    granted++;
+  }
+  CHECK(granted == API_RATE_LIMIT_REQUESTS);
+  CHECK(bucket.getThrottled() == 1);
+
+  // One token takes window/capacity to come back; the wait is rounded up
+  unsigned long perToken = API_RATE_LIMIT_WINDOW_MS / API_RATE_LIMIT_REQUESTS;
+  unsigned long wait = bucket.waitTimeMs();
+  CHECK(wait >= perToken && wait <= perToken + 1);
+  delay(perToken - 1);
+  CHECK(!bucket.tryAcquire());
+  delay(wait - perToken + 1);
+  CHECK(bucket.tryAcquire());
+}
+
+// A caller that sends whenever it is allowed, over a minute: after the
+// first burst it gets the window's rate and no more. A window that opens
+// on a full bucket can see up to twice the capacity; Trello's 429 covers
+// that case.
+static void testSteadyRate() {
+  TokenBucket bucket;
+  const unsigned long minuteMs = 60000;
+  unsigned long start = millis();
+  unsigned long granted = 0;
+  unsigned long inWindow[minuteMs / API_RATE_LIMIT_WINDOW_MS] = {};
+  while (millis() - start < minuteMs) {
+    if (bucket.tryAcquire()) {
+      granted++;
+      inWindow[(millis() - start) / API_RATE_LIMIT_WINDOW_MS]++;
+    } else {
+      delay(bucket.waitTimeMs());
+    }
+  }
+  unsigned long expected = API_RATE_LIMIT_REQUESTS * (1 + minuteMs / API_RATE_LIMIT_WINDOW_MS);
+  CHECK(granted <= expected && granted + 2 >= expected);
+  CHECK(inWindow[0] <= 2 * API_RATE_LIMIT_REQUESTS);
+  for (size_t i = 1; i < sizeof(inWindow) / sizeof(inWindow[0]); i++) {
+    CHECK(inWindow[i] <= API_RATE_LIMIT_REQUESTS + 1);
+  }
+  // Throttled calls were answered with a wait, not spun on
+  CHECK(bucket.getThrottled() <= granted);
+}
+
+static void testTooManyRequests() {
+  TokenBucket bucket;
+  bucket.onResponse(429);
+  CHECK(bucket.getRateLimited() == 1);
+  CHECK(bucket.getRateScale() == 0.5f);
+  CHECK(bucket.waitTimeMs() == API_RATE_LIMIT_DELAY_MS);
+  delay(API_RATE_LIMIT_DELAY_MS - 1);
+  CHECK(!bucket.tryAcquire());
+  delay(1);
+  CHECK(bucket.tryAcquire());
+
+  // Tokens came back at half the rate while it was blocked
+  float halfRate = API_RATE_LIMIT_DELAY_MS * 0.5f * API_RATE_LIMIT_REQUESTS / API_RATE_LIMIT_WINDOW_MS;
+  CHECK(bucket.getTokens() > halfRate - 2 && bucket.getTokens() < halfRate);
+
+  // A second 429 doubles the back-off and halves the rate again
+  bucket.onResponse(429);
+  CHECK(bucket.waitTimeMs() == 2 * API_RATE_LIMIT_DELAY_MS);
+  CHECK(bucket.getRateScale() == 0.25f);
+
+  // Each success wins back a sixteenth of the rate
+  for (int i = 0; i < 11; i++) {
+    bucket.onResponse(200);
+  }
+  CHECK(bucket.getRateScale() == 0.9375f);
+  bucket.onResponse(200);
+  bucket.onResponse(200);
+  CHECK(bucket.getRateScale() == 1.0f);
+
+  // ...and the back-off starts over
+  delay(bucket.waitTimeMs());
+  bucket.onResponse(429);
+  CHECK(bucket.waitTimeMs() == API_RATE_LIMIT_DELAY_MS);
+}
+
+// Trello's X-Rate-Limit header only ever lowers the estimate
+static void testServerRemaining() {
+  TokenBucket bucket;
+  bucket.onResponse(200, 3);
+  CHECK(bucket.getTokens() == 3.0f);
+  bucket.onResponse(200, 50);
+  CHECK(bucket.getTokens() == 3.0f);
+  CHECK(bucket.tryAcquire() && bucket.tryAcquire() && bucket.tryAcquire());
+  CHECK(!bucket.tryAcquire());
+  // A failed connection says nothing about the server's count
+  bucket.onResponse(-1, 0);
+  CHECK(bucket.getRateScale() == 1.0f);
+}
+
+// millis() wraps after 49 days on the device
+static unsigned long wrappingNow = ULONG_MAX - 500;
+
+static unsigned long wrappingClock() {
+  return wrappingNow;
+}
+
+static void testWrap() {
+  TokenBucket bucket(API_RATE_LIMIT_REQUESTS, API_RATE_LIMIT_WINDOW_MS, wrappingClock);
+  bucket.onResponse(429);
+  wrappingNow += API_RATE_LIMIT_DELAY_MS - 1;
+  CHECK(!bucket.tryAcquire());
+  wrappingNow += 1;
+  CHECK(bucket.waitTimeMs() == 0);
+  CHECK(bucket.tryAcquire());
+}
+
+int main() {
+  HostClock::simulate(true);
+  testBurst();
+  testSteadyRate();
+  testTooManyRequests();
+  testServerRemaining();
+  testWrap();
+  return testResult("test_rate_limiter");
+}
@@ -0,0 +1,215 @@
+// TrelloClient's retries and circuit breaker against a FixtureTransport
+// that fails on cue: what gets resent, how long it waits, what is never
+// resent, and how an outage is ridden out with a probe per cool-down
+// rather than a request per call. All on the simulated clock.
+
+#include "HostTest.h"
+#include "FixtureTransport.h"
+#include "PosixStorage.h"
+#include "SampleServer.h"
+#include "TrelloClient.h"
+
+static const unsigned BOARD_CARDS = 100;
+
+struct Rig {
+  PosixStorage storage;
+  FixtureTransport server;
+  TrelloClient client;
+
+  Rig() : storage(tempDirectory("retry")), client(&storage) {
+    serveSampleBoard(server, BOARD_CARDS);
+    client.setTransport(&server);
+    CHECK(client.begin());
+    CHECK(client.connectWiFi());
+  }
+
+  ApiStatus open(unsigned index) {
+    FullCard card;
+    return client.fetchCardDetails(sampleCardId(index), card, false);
+  }
+};
+
+// Two 503s then the card: three sends, two jittered back-offs between them
+static void testTransientGet() {
+  Rig rig;
+  rig.server.failNext(503, 2);
+  unsigned long start = millis();
+  CHECK(rig.open(1) == API_SUCCESS);
+  unsigned long waited = millis() - start;
+  CHECK(rig.server.countRequests("GET", "/cards/*") == 3);
+  CHECK(waited >= RETRY_DELAY_MS / 2 + RETRY_DELAY_MS && waited <= 3 * RETRY_DELAY_MS);
+
+  // Dropped connections and timeouts are retried the same way
+  rig.server.clearLog();
+  rig.server.failNext(HTTPC_ERROR_CONNECTION_LOST);
+  rig.server.failNext(HTTPC_ERROR_READ_TIMEOUT);
+  CHECK(rig.open(2) == API_SUCCESS);
+  CHECK(rig.server.countRequests("GET", "/cards/*") == 3);
+}
+
+static void testGivesUp() {
+  Rig rig;
+  rig.server.failNext(503, MAX_RETRIES + 1);
+  CHECK(rig.open(3) == API_ERROR_UNAVAILABLE);
+  CHECK(rig.server.countRequests("GET", "/cards/*") == (size_t)MAX_RETRIES + 1);
+
+  // An answer that will not change is not asked for again
+  rig.server.clearLog();
+  CHECK(rig.open(BOARD_CARDS + 5) == API_ERROR_NOT_FOUND);
+  CHECK(rig.server.getLog().size() == 1);
+
+  // Nor is anything while the Wi-Fi is down
+  rig.server.clearLog();
+  rig.server.failNext(503);
+  WiFi.setStatus(WL_DISCONNECTED);
+  CHECK(rig.open(4) == API_ERROR_NETWORK);
+  CHECK(rig.server.getLog().size() == 1);
+  WiFi.setStatus(WL_CONNECTED);
+}
+
+// A comment that may have reached Trello is left to the mutation log; one
+// that never left the device is sent again
+static void testMutations() {
+  Rig rig;
+  rig.server.failNext(HTTPC_ERROR_READ_TIMEOUT);
+  CHECK(rig.client.addComment(sampleCardId(5), "Sent once") == API_ERROR_UNAVAILABLE);
+  CHECK(rig.server.countRequests("POST", "/cards/*/actions/comments") == 1);
+
+  rig.server.clearLog();
+  rig.server.failNext(503);
+  CHECK(rig.client.createCard("Sent once too") == API_ERROR_UNAVAILABLE);
+  CHECK(rig.server.countRequests("POST", "/cards") == 1);
+
+  rig.server.clearLog();
+  rig.server.failNext(HTTPC_ERROR_CONNECTION_REFUSED, 2);
+  CHECK(rig.client.addComment(sampleCardId(5), "Resent") == API_SUCCESS);
+  CHECK(rig.server.countRequests("POST", "/cards/*/actions/comments") == 3);
+
+  // A PUT sets a state, so repeating it is harmless
+  rig.server.clearLog();
+  rig.server.failNext(HTTPC_ERROR_READ_TIMEOUT);
+  CHECK(rig.client.setCheckItemState(sampleCardId(5), sampleCardId(500), true) == API_SUCCESS);
+  CHECK(rig.server.countRequests("PUT", "/cards/*/checkItem/*") == 2);
+}
+
+// A write whose answer was lost is found among the member's actions by its
+// exact text and target, and only if it was made after the first attempt
+static void testLandedWrites() {
+  Rig rig;
+  CHECK(rig.client.getServerTime() == 0);
+  CHECK(rig.open(1) == API_SUCCESS);
+  CHECK(rig.client.getServerTime() == FixtureTransport::serverTime());
+
+  uint32_t attempt = rig.client.getServerTime();
+  CHECK(rig.client.addComment(sampleCardId(5), "Landed") == API_SUCCESS);
+  CHECK(rig.client.createCard("Landed card") == API_SUCCESS);
+  rig.server.clearLog();
+  bool found = false;
+  CHECK(rig.client.findOwnAction(sampleCardId(5), "Landed", attempt, found) == API_SUCCESS);
+  CHECK(found);
+  CHECK(rig.client.findOwnAction("", "Landed card", attempt, found) == API_SUCCESS);
+  CHECK(found);
+  CHECK(rig.server.countRequests("GET", "/members/me/actions") == 2);
+
+  // Not a comment that merely ends the same, one on another card, or a card
+  CHECK(rig.client.findOwnAction(sampleCardId(5), "ed", attempt, found) == API_SUCCESS);
+  CHECK(!found);
+  CHECK(rig.client.findOwnAction(sampleCardId(6), "Landed", attempt, found) == API_SUCCESS);
+  CHECK(!found);
+  CHECK(rig.client.findOwnAction("", "Landed", attempt, found) == API_SUCCESS);
+  CHECK(!found);
+
+  // Nor an identical one from before the attempt
+  delay(60000);
+  uint32_t later = rig.client.getServerTime();
+  CHECK(rig.client.findOwnAction(sampleCardId(5), "Landed", later, found) == API_SUCCESS);
+  CHECK(!found);
+  CHECK(rig.client.findOwnAction("", "Landed card", later, found) == API_SUCCESS);
+  CHECK(!found);
+}
+
+// Three minutes of 503s. The breaker opens after CIRCUIT_FAILURE_THRESHOLD
+// failures; from then on calls fail fast and only a probe per cool-down
+// reaches the server, until one finds it back.
+static void testOutage() {
+  Rig rig;
+  const unsigned long outageMs = 180000;
+  unsigned long start = millis();
+  rig.server.failUntil(start + outageMs, 503);
+
+  while (rig.client.getUnavailableWaitMs() == 0) {
+    CHECK(rig.open(6) == API_ERROR_UNAVAILABLE);
+  }
+  CHECK(rig.server.getLog().size() == (size_t)CIRCUIT_FAILURE_THRESHOLD);
+
+  // Open: nothing is sent
+  rig.server.clearLog();
+  for (int i = 0; i < 10; i++) {
+    CHECK(rig.open(6) == API_ERROR_UNAVAILABLE);
+  }
+  CHECK(rig.server.getLog().empty());
+
+  // Each cool-down ends in one probe and, while it fails, a longer cool-down
+  unsigned long lastWait = 0;
+  for (;;) {
+    unsigned long wait = rig.client.getUnavailableWaitMs();
+    if (millis() + wait - start >= outageMs) {
+      break;
+    }
+    CHECK(wait >= lastWait);
+    lastWait = wait;
+    delay(wait);
+    CHECK(rig.open(6) != API_SUCCESS);
+  }
+  size_t probes = rig.server.countRequests("GET", "/members/me");
+  CHECK(probes == rig.server.getLog().size());
+  CHECK(probes >= 2 && probes <= 3);
+
+  // Back up: the next probe succeeds and the card follows it
+  rig.server.clearLog();
+  delay(rig.client.getUnavailableWaitMs());
+  CHECK(rig.open(6) == API_SUCCESS);
+  CHECK(rig.server.countRequests("GET", "/members/me") == 1);
+  CHECK(rig.server.countRequests("GET", "/cards/*") == 1);
+  CHECK(rig.client.getUnavailableWaitMs() == 0);
+}
+
+// A fifth of requests fail at random: retries carry almost every call
+static void testFlakyConnection() {
+  Rig rig;
+  FaultProfile flaky = FAULTS_NONE;
+  flaky.name = "flaky";
+  flaky.latencyMs = 100;
+  flaky.serverErrorPercent = 12;
+  flaky.refusedPercent = 4;
+  flaky.timeoutPercent = 4;
+  flaky.timeoutMs = 5000;
+  rig.server.setProfile(flaky);
+
+  const int calls = 100;
+  int succeeded = 0;
+  for (int i = 0; i < calls; i++) {
+    // As the network task does, wait for the breaker and the rate limiter
+    delay(max(rig.client.getUnavailableWaitMs(), rig.client.getRateLimitWaitMs()));
+    if (rig.open(i % BOARD_CARDS) == API_SUCCESS) {
+      succeeded++;
+    }
+  }
+  size_t sent = rig.server.getLog().size();
+  printf("flaky connection: %d of %d calls succeeded with %u requests\n",
+         succeeded, calls, (unsigned)sent);
+  CHECK(succeeded >= calls - 2);
+  CHECK(sent > (size_t)calls);
+}
+
+int main() {
+  Serial.mute(true);
+  HostClock::simulate(true);
+  testTransientGet();
+  testGivesUp();
+  testMutations();
+  testLandedWrites();
+  testOutage();
+  testFlakyConnection();
+  return testResult("test_retry");
+}
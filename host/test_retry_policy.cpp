@@ -0,0 +1,115 @@
+// RetryPolicy and CircuitBreaker on the simulated clock: which failures are
+// retried, how far apart, and how the breaker opens, probes and recovers.
+
+#include <limits.h>
+#include "HostTest.h"
+#include <HTTPClient.h>
+#include "RetryPolicy.h"
+
+static void testTransientCodes() {
+  CHECK(RetryPolicy::isTransient(408));
+  CHECK(RetryPolicy::isTransient(500));
+  CHECK(RetryPolicy::isTransient(503));
+  CHECK(RetryPolicy::isTransient(HTTPC_ERROR_CONNECTION_REFUSED));
+  CHECK(RetryPolicy::isTransient(HTTPC_ERROR_READ_TIMEOUT));
+  CHECK(!RetryPolicy::isTransient(200));
+  CHECK(!RetryPolicy::isTransient(404));
+  CHECK(!RetryPolicy::isTransient(429));   // The rate limiter's to handle
+
+  // Only failures before the request left the device make a POST safe to resend
+  CHECK(RetryPolicy::wasNotSent(HTTPC_ERROR_CONNECTION_REFUSED));
+  CHECK(RetryPolicy::wasNotSent(HTTPC_ERROR_SEND_HEADER_FAILED));
+  CHECK(RetryPolicy::wasNotSent(HTTPC_ERROR_NOT_CONNECTED));
+  CHECK(!RetryPolicy::wasNotSent(HTTPC_ERROR_CONNECTION_LOST));
+  CHECK(!RetryPolicy::wasNotSent(HTTPC_ERROR_READ_TIMEOUT));
+  CHECK(!RetryPolicy::wasNotSent(503));
+}
+
+// Each wait falls in [cap/2, cap] for a cap that doubles up to the maximum,
+// and the draws spread over that range
+static void testBackOff() {
+  RetryPolicy policy;
+  CHECK(policy.shouldRetry(MAX_RETRIES - 1));
+  CHECK(!policy.shouldRetry(MAX_RETRIES));
+
+  unsigned long cap = RETRY_DELAY_MS;
+  for (int attempt = 0; attempt < 8; attempt++) {
+    unsigned long lowest = ULONG_MAX;
+    unsigned long highest = 0;
+    for (int draw = 0; draw < 200; draw++) {
+      unsigned long wait = policy.delayMs(attempt);
+      lowest = min(lowest, wait);
+      highest = max(highest, wait);
+    }
+    CHECK(lowest >= cap / 2 && highest <= cap);
+    CHECK(highest - lowest >= cap / 4);
+    cap = min(cap * 2, (unsigned long)RETRY_MAX_DELAY_MS);
+  }
+}
+
+static void testBreakerTrips() {
+  CircuitBreaker breaker;
+  for (int i = 0; i < CIRCUIT_FAILURE_THRESHOLD - 1; i++) {
+    CHECK(breaker.allowRequest());
+    breaker.onFailure();
+  }
+  CHECK(breaker.getState() == BREAKER_CLOSED);
+
+  // A success in between starts the count again
+  breaker.onSuccess();
+  for (int i = 0; i < CIRCUIT_FAILURE_THRESHOLD - 1; i++) {
+    breaker.onFailure();
+  }
+  CHECK(breaker.getState() == BREAKER_CLOSED);
+  breaker.onFailure();
+  CHECK(breaker.getState() == BREAKER_OPEN);
+  CHECK(breaker.getTrips() == 1);
+
+  // Open: every request fails fast until the cool-down is over
+  CHECK(breaker.waitTimeMs() == CIRCUIT_OPEN_MS);
+  delay(CIRCUIT_OPEN_MS - 1);
+  CHECK(!breaker.allowRequest());
+  CHECK(breaker.waitTimeMs() == 1);
+  CHECK(breaker.getRejected() == 1);
+  delay(1);
+  CHECK(breaker.allowRequest());
+  CHECK(breaker.isProbing());
+}
+
+// Each failed probe doubles the cool-down up to the maximum; a good one
+// closes the breaker and puts the cool-down back
+static void testBreakerProbes() {
+  CircuitBreaker breaker;
+  for (int i = 0; i < CIRCUIT_FAILURE_THRESHOLD; i++) {
+    breaker.onFailure();
+  }
+  unsigned long expected = CIRCUIT_OPEN_MS;
+  for (int probe = 0; probe < 6; probe++) {
+    CHECK(breaker.waitTimeMs() == expected);
+    delay(breaker.waitTimeMs());
+    CHECK(breaker.allowRequest() && breaker.isProbing());
+    breaker.onFailure();
+    expected = min(expected * 2, (unsigned long)CIRCUIT_MAX_OPEN_MS);
+  }
+  CHECK(breaker.waitTimeMs() == CIRCUIT_MAX_OPEN_MS);
+
+  delay(breaker.waitTimeMs());
+  CHECK(breaker.allowRequest());
+  breaker.onSuccess();
+  CHECK(breaker.getState() == BREAKER_CLOSED);
+  CHECK(breaker.waitTimeMs() == 0);
+  for (int i = 0; i < CIRCUIT_FAILURE_THRESHOLD; i++) {
+    breaker.onFailure();
+  }
+  CHECK(breaker.waitTimeMs() == CIRCUIT_OPEN_MS);
+}
+
+int main() {
+  Serial.mute(true);
+  HostClock::simulate(true);
+  testTransientCodes();
+  testBackOff();
+  testBreakerTrips();
+  testBreakerProbes();
+  return testResult("test_retry_policy");
+}
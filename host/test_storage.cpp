@@ -0,0 +1,206 @@
+// Storage on PosixStorage: atomic replace, recovery after a torn replace,
+// write-behind queueing and coalescing, and the UI and network tasks
+// using it at once.
+
+#include <thread>
+#include "HostTest.h"
+#include "PosixStorage.h"
+#include "config.h"
+
+static std::vector<uint8_t> bytes(const char* text) {
+  return std::vector<uint8_t>(text, text + strlen(text));
+}
+
+static std::string contents(Storage& storage, const char* path) {
+  std::vector<uint8_t> data;
+  if (!storage.readFile(path, data)) {
+    return "<missing>";
+  }
+  return std::string(data.begin(), data.end());
+}
+
+static void testReplace(const std::string& dir) {
+  PosixStorage storage(dir);
+  CHECK(storage.begin());
+
+  std::vector<uint8_t> first = bytes("first");
+  std::vector<uint8_t> second = bytes("second copy");
+  CHECK(storage.writeFile("/list.bin", first.data(), first.size()));
+  CHECK(storage.writeFile("/list.bin", second.data(), second.size()));
+  CHECK(contents(storage, "/list.bin") == "second copy");
+  CHECK(!storage.exists("/list.bin.tmp"));
+  CHECK(storage.getStats().replaces == 2);
+}
+
+static void writeRaw(Storage& storage, const char* path, const char* text) {
+  StorageFile* file = storage.open(path, STORAGE_WRITE);
+  CHECK(file != nullptr);
+  if (file) {
+    file->write((const uint8_t*)text, strlen(text));
+    delete file;
+  }
+}
+
+// A brownout between writing the temp file and renaming it leaves one of
+// two states behind
+static void testRecover(const std::string& dir) {
+  PosixStorage storage(dir);
+  CHECK(storage.begin());
+
+  // The old copy was already removed: the temp file is the new one
+  writeRaw(storage, "/mark.txt.tmp", "new");
+  CHECK(contents(storage, "/mark.txt") == "new");
+  CHECK(!storage.exists("/mark.txt.tmp"));
+
+  // The temp file sits next to the old copy: it may be torn, so it goes
+  writeRaw(storage, "/mark.txt.tmp", "torn");
+  storage.recover("/mark.txt");
+  CHECK(contents(storage, "/mark.txt") == "new");
+  CHECK(!storage.exists("/mark.txt.tmp"));
+}
+
+static void testWriteBehind(const std::string& dir) {
+  PosixStorage storage(dir);
+  CHECK(storage.begin());
+
+  std::vector<uint8_t> list = bytes("list v1");
+  std::vector<uint8_t> mark = bytes("mark");
+  std::vector<uint8_t> listAgain = bytes("list v2");
+  storage.writeBehind("/list.bin", list);
+  storage.writeBehind("/mark.txt", mark);
+  storage.writeBehind("/list.bin", listAgain);
+  CHECK(list.empty());
+
+  // Nothing reaches the disk until a flush, but reads see the queue
+  CHECK(storage.getStats().writes == 0);
+  CHECK(storage.hasPending());
+  CHECK(storage.exists("/list.bin"));
+  CHECK(contents(storage, "/list.bin") == "list v2");
+  CHECK(storage.getStats().deferred == 3);
+  CHECK(storage.getStats().coalesced == 1);
+
+  CHECK(storage.flush());
+  CHECK(!storage.hasPending());
+  CHECK(storage.getStats().replaces == 2);
+
+  PosixStorage reopened(dir);
+  CHECK(reopened.begin());
+  CHECK(contents(reopened, "/list.bin") == "list v2");
+  CHECK(contents(reopened, "/mark.txt") == "mark");
+
+  // Removing a file drops its queued write
+  std::vector<uint8_t> doomed = bytes("doomed");
+  storage.writeBehind("/doomed.bin", doomed);
+  CHECK(storage.remove("/doomed.bin"));
+  CHECK(!storage.hasPending());
+  CHECK(!storage.exists("/doomed.bin"));
+
+  // Opening a file writes its queued copy first
+  std::vector<uint8_t> log = bytes("queued");
+  storage.writeBehind("/log.bin", log);
+  StorageFile* file = storage.open("/log.bin", STORAGE_APPEND);
+  CHECK(file != nullptr);
+  if (file) {
+    file->write((const uint8_t*)"+more", 5);
+    delete file;
+  }
+  CHECK(contents(storage, "/log.bin") == "queued+more");
+}
+
+// Past STORAGE_WRITE_BEHIND_BYTES the queue only reports that it is due;
+// the write itself is left to whoever flushes
+static void testFlushDue(const std::string& dir) {
+  PosixStorage storage(dir);
+  CHECK(storage.begin());
+
+  size_t written = 0;
+  for (int i = 0; written <= STORAGE_WRITE_BEHIND_BYTES; i++) {
+    std::vector<uint8_t> data(1024, (uint8_t)i);
+    std::string path = "/chunk" + std::to_string(i);
+    written += data.size();
+    CHECK(!storage.flushDue());
+    storage.writeBehind(path.c_str(), data);
+  }
+  CHECK(storage.flushDue());
+  CHECK(storage.getStats().writes == 0);
+  CHECK(storage.flush());
+  CHECK(!storage.flushDue());
+}
+
+static void testFiles(const std::string& dir) {
+  PosixStorage storage(dir);
+  CHECK(storage.begin());
+
+  StorageFile* file = storage.open("/records.bin", STORAGE_UPDATE);
+  CHECK(file != nullptr);
+  if (!file) {
+    return;
+  }
+  CHECK(file->write((const uint8_t*)"0123456789", 10) == 10);
+  CHECK(file->seek(4));
+  CHECK(file->write((const uint8_t*)"xy", 2) == 2);
+  CHECK(file->position() == 6);
+  CHECK(file->flush());
+  CHECK(file->size() == 10);
+  delete file;
+  CHECK(contents(storage, "/records.bin") == "0123xy6789");
+
+  std::vector<std::string> names;
+  CHECK(storage.list("/", names));
+  CHECK(std::find(names.begin(), names.end(), "records.bin") != names.end());
+
+  PosixStorage missing(dir + "/not-there");
+  CHECK(!missing.begin());
+  CHECK(missing.open("/records.bin", STORAGE_READ) == nullptr);
+}
+
+// The UI task queues snapshots and reads files while the network task
+// flushes and appends; every counter must add up afterwards
+static void testConcurrentTasks(const std::string& dir) {
+  PosixStorage storage(dir);
+  CHECK(storage.begin());
+  const int rounds = 2000;
+
+  std::thread network([&storage]() {
+    StorageFile* log = storage.open("/cards.log", STORAGE_APPEND);
+    for (int i = 0; i < rounds; i++) {
+      log->write((const uint8_t*)"record\n", 7);
+      if (i % 10 == 0) {
+        storage.flush();
+      }
+    }
+    delete log;
+  });
+
+  bool readsConsistent = true;
+  for (int i = 0; i < rounds; i++) {
+    std::string text = "snapshot " + std::to_string(i);
+    std::vector<uint8_t> data(text.begin(), text.end());
+    storage.writeBehind("/snapshot.bin", data);
+    std::string read = contents(storage, "/snapshot.bin");
+    readsConsistent = readsConsistent && read.compare(0, 9, "snapshot ") == 0;
+  }
+  network.join();
+  storage.flush();
+
+  CHECK(readsConsistent);
+  CHECK(contents(storage, "/snapshot.bin") == "snapshot " + std::to_string(rounds - 1));
+  const StorageStats& stats = storage.getStats();
+  CHECK(stats.deferred == (unsigned long)rounds);
+  CHECK(stats.coalesced + stats.replaces == (unsigned long)rounds);
+  // One log record plus one temp file write per replace
+  CHECK(stats.writes == rounds + stats.replaces);
+  std::vector<uint8_t> log;
+  CHECK(storage.readFile("/cards.log", log) && log.size() == rounds * 7U);
+}
+
+int main() {
+  Serial.mute(true);
+  testReplace(tempDirectory("storage-replace"));
+  testRecover(tempDirectory("storage-recover"));
+  testWriteBehind(tempDirectory("storage-behind"));
+  testFlushDue(tempDirectory("storage-due"));
+  testFiles(tempDirectory("storage-files"));
+  testConcurrentTasks(tempDirectory("storage-tasks"));
+  return testResult("test_storage");
+}
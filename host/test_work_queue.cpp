@@ -0,0 +1,178 @@
+// WorkQueue and WorkerThread on the std::thread path: order across
+// threads, pushFront(), the bound and timeouts, and how long an item
+// takes to reach a worker blocked in pop().
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include "HostTest.h"
+#include "WorkQueue.h"
+#include "config.h"
+
+struct Item {
+  static std::atomic<int> alive;
+  int producer;
+  int sequence;
+  unsigned long long pushedAt;
+
+  Item(int producer, int sequence) : producer(producer), sequence(sequence), pushedAt(nowNs()) {
+    alive++;
+  }
+  ~Item() { alive--; }
+};
+
+std::atomic<int> Item::alive(0);
+
+static void testOrder() {
+  WorkQueue<Item> queue(8);
+  const int count = 20000;
+  std::thread producer([&queue]() {
+    for (int i = 0; i < count; i++) {
+      queue.push(new Item(0, i), WorkQueue<Item>::WAIT_FOREVER);
+    }
+  });
+
+  bool inOrder = true;
+  for (int i = 0; i < count; i++) {
+    Item* item = queue.pop(WorkQueue<Item>::WAIT_FOREVER);
+    inOrder = inOrder && item->sequence == i;
+    delete item;
+  }
+  producer.join();
+  CHECK(inOrder);
+  CHECK(queue.size() == 0);
+}
+
+// Items from several producers interleave, but each one's stay in order
+static void testProducers() {
+  WorkQueue<Item> queue(16);
+  const int producers = 4;
+  const int each = 5000;
+  std::vector<std::thread> threads;
+  for (int p = 0; p < producers; p++) {
+    threads.emplace_back([&queue, p]() {
+      for (int i = 0; i < each; i++) {
+        queue.push(new Item(p, i), WorkQueue<Item>::WAIT_FOREVER);
+      }
+    });
+  }
+
+  int next[producers] = {};
+  bool inOrder = true;
+  for (int i = 0; i < producers * each; i++) {
+    Item* item = queue.pop(WorkQueue<Item>::WAIT_FOREVER);
+    inOrder = inOrder && item->sequence == next[item->producer];
+    next[item->producer]++;
+    delete item;
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  CHECK(inOrder);
+  for (int p = 0; p < producers; p++) {
+    CHECK(next[p] == each);
+  }
+}
+
+static void testBound() {
+  WorkQueue<Item> queue(2);
+  CHECK(queue.push(new Item(0, 1)));
+  CHECK(queue.push(new Item(0, 2)));
+
+  Item* refused = new Item(0, 3);
+  CHECK(!queue.push(refused));
+  unsigned long long start = nowNs();
+  CHECK(!queue.pushFront(refused, 20));
+  CHECK(nowNs() - start >= 20000000ULL);
+
+  // A blocked push goes through once the worker takes something
+  std::thread worker([&queue]() {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    delete queue.pop();
+  });
+  CHECK(queue.pushFront(refused, WorkQueue<Item>::WAIT_FOREVER));
+  worker.join();
+
+  // pushFront() jumped the queue
+  Item* first = queue.pop();
+  CHECK(first && first->sequence == 3);
+  delete first;
+  Item* second = queue.pop();
+  CHECK(second && second->sequence == 2);
+  delete second;
+
+  start = nowNs();
+  CHECK(queue.pop(20) == nullptr);
+  CHECK(nowNs() - start >= 20000000ULL);
+}
+
+// Whatever is still queued belongs to the queue and goes with it
+static void testDestructor() {
+  {
+    WorkQueue<Item> queue(4);
+    queue.push(new Item(0, 1));
+    queue.push(new Item(0, 2));
+    CHECK(Item::alive == 2);
+  }
+  CHECK(Item::alive == 0);
+}
+
+struct LatencyRun {
+  WorkQueue<Item>* queue;
+  std::vector<unsigned long long>* latencies;
+  std::atomic<bool>* done;
+};
+
+static void worker(void* arg) {
+  LatencyRun* run = (LatencyRun*)arg;
+  for (;;) {
+    Item* item = run->queue->pop(WorkQueue<Item>::WAIT_FOREVER);
+    if (item->sequence < 0) {
+      delete item;
+      *run->done = true;
+      return;
+    }
+    run->latencies->push_back(nowNs() - item->pushedAt);
+    delete item;
+  }
+}
+
+// Push to pop across threads, with the worker idle in pop() each time as
+// the network task is between jobs
+static void testLatency() {
+  WorkQueue<Item> queue(NETWORK_QUEUE_DEPTH);
+  std::vector<unsigned long long> latencies;
+  std::atomic<bool> done(false);
+  latencies.reserve(2000);
+  LatencyRun run = {&queue, &latencies, &done};
+  WorkerThread thread;
+  CHECK(thread.start(worker, &run, "worker", 0, 0, 0));
+
+  for (int i = 0; i < 2000; i++) {
+    queue.push(new Item(0, i), WorkQueue<Item>::WAIT_FOREVER);
+    std::this_thread::sleep_for(std::chrono::microseconds(200));
+  }
+  queue.push(new Item(0, -1), WorkQueue<Item>::WAIT_FOREVER);
+  while (!done) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  CHECK(latencies.size() == 2000);
+  std::sort(latencies.begin(), latencies.end());
+  unsigned long long median = latencies[latencies.size() / 2];
+  unsigned long long p99 = latencies[latencies.size() * 99 / 100];
+  printf("work queue: push to pop median %llu us, p99 %llu us, max %llu us\n",
+         median / 1000, p99 / 1000, latencies.back() / 1000);
+  // Loose enough for a loaded CI machine; a lost wakeup would be seconds
+  CHECK(p99 < 50000000ULL);
+}
+
+int main() {
+  testOrder();
+  testProducers();
+  testBound();
+  testDestructor();
+  testLatency();
+  return testResult("test_work_queue");
+}